@@ -0,0 +1,186 @@
+#include "AtmosStream.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+
+#include "vicNl.h"
+
+// Number of double arrays of length NR+1 in atmos_data_struct (all but snowflag).
+static const int ATMOS_DOUBLE_ARRAYS = 11;
+// out_prec, out_rain, out_snow.
+static const int ATMOS_DOUBLE_SCALARS = 3;
+
+AtmosStream::AtmosStream(const std::string& scratchDirectory, int numCells, int windowRecords, const ProgramState* state)
+  : state(state), file(NULL), numCells(numCells), windowRecords(windowRecords), currentWindow(-1), currentBuffer(0),
+    secondsStoring(0), secondsLoading(0), secondsWaiting(0) {
+  numWindows = (state->global_param.nrecs + windowRecords - 1) / windowRecords;
+  recordBytes = (ATMOS_DOUBLE_ARRAYS * (state->NR + 1) + ATMOS_DOUBLE_SCALARS) * sizeof(double) + (state->NR + 1) * sizeof(char);
+
+  std::ostringstream path;
+  path << scratchDirectory << "/vic_atmos_scratch_" << getpid() << ".bin";
+  file = fopen(path.str().c_str(), "w+b");
+  if (file == NULL) {
+    char ErrStr[MAXSTRING];
+    sprintf(ErrStr, "Unable to open atmospheric forcing scratch file %s (ATMOS_WINDOW_RECORDS)", path.str().c_str());
+    nrerror(ErrStr);
+  }
+  // The open stream stays usable; the data is removed when it is closed or VIC exits.
+  unlink(path.str().c_str());
+
+  for (int b = 0; b < 2; b++) {
+    buffers[b].resize(numCells, NULL);
+    for (int c = 0; c < numCells; c++) {
+      buffers[b][c] = alloc_atmos(windowRecords, state->NR);
+    }
+  }
+}
+
+AtmosStream::~AtmosStream() {
+  if (prefetcher.joinable()) {
+    prefetcher.join();
+  }
+  for (int b = 0; b < 2; b++) {
+    for (int c = 0; c < numCells; c++) {
+      free_atmos(windowRecords, &buffers[b][c]);
+    }
+  }
+  if (file != NULL) {
+    fclose(file);
+  }
+}
+
+long long AtmosStream::fileOffset(int window, int cellIndex) const {
+  return ((long long) window * numCells + cellIndex) * windowRecords * (long long) recordBytes;
+}
+
+void AtmosStream::serializeRecord(const atmos_data_struct& atmos, char* bytes) const {
+  const size_t arrayBytes = (state->NR + 1) * sizeof(double);
+  const double* arrays[ATMOS_DOUBLE_ARRAYS] = { atmos.air_temp, atmos.channel_in, atmos.density, atmos.longwave, atmos.prec,
+      atmos.pressure, atmos.shortwave, atmos.tskc, atmos.vp, atmos.vpd, atmos.wind };
+  for (int i = 0; i < ATMOS_DOUBLE_ARRAYS; i++) {
+    memcpy(bytes, arrays[i], arrayBytes);
+    bytes += arrayBytes;
+  }
+  const double scalars[ATMOS_DOUBLE_SCALARS] = { atmos.out_prec, atmos.out_rain, atmos.out_snow };
+  memcpy(bytes, scalars, sizeof(scalars));
+  bytes += sizeof(scalars);
+  memcpy(bytes, atmos.snowflag, (state->NR + 1) * sizeof(char));
+}
+
+void AtmosStream::deserializeRecord(const char* bytes, atmos_data_struct& atmos) const {
+  const size_t arrayBytes = (state->NR + 1) * sizeof(double);
+  double* arrays[ATMOS_DOUBLE_ARRAYS] = { atmos.air_temp, atmos.channel_in, atmos.density, atmos.longwave, atmos.prec,
+      atmos.pressure, atmos.shortwave, atmos.tskc, atmos.vp, atmos.vpd, atmos.wind };
+  for (int i = 0; i < ATMOS_DOUBLE_ARRAYS; i++) {
+    memcpy(arrays[i], bytes, arrayBytes);
+    bytes += arrayBytes;
+  }
+  double scalars[ATMOS_DOUBLE_SCALARS];
+  memcpy(scalars, bytes, sizeof(scalars));
+  atmos.out_prec = scalars[0];
+  atmos.out_rain = scalars[1];
+  atmos.out_snow = scalars[2];
+  bytes += sizeof(scalars);
+  memcpy(atmos.snowflag, bytes, (state->NR + 1) * sizeof(char));
+}
+
+void AtmosStream::storeCell(int cellIndex, const atmos_data_struct* atmos) {
+  std::chrono::time_point<std::chrono::system_clock> start = std::chrono::system_clock::now();
+  std::vector<char> bytes(windowRecords * recordBytes);
+  for (int window = 0; window < numWindows; window++) {
+    int firstRec = window * windowRecords;
+    int numRecs = std::min(windowRecords, state->global_param.nrecs - firstRec);
+    for (int r = 0; r < numRecs; r++) {
+      serializeRecord(atmos[firstRec + r], &bytes[r * recordBytes]);
+    }
+    if (fseeko(file, (off_t) fileOffset(window, cellIndex), SEEK_SET) != 0
+        || fwrite(&bytes[0], recordBytes, numRecs, file) != (size_t) numRecs) {
+      nrerror("Unable to write to the atmospheric forcing scratch file (ATMOS_WINDOW_RECORDS), check the free space in the result directory.");
+    }
+  }
+  std::chrono::duration<double> elapsed = std::chrono::system_clock::now() - start;
+  secondsStoring += elapsed.count();
+}
+
+void AtmosStream::loadWindow(int window, int buffer) {
+  std::chrono::time_point<std::chrono::system_clock> start = std::chrono::system_clock::now();
+  int firstRec = window * windowRecords;
+  int numRecs = std::min(windowRecords, state->global_param.nrecs - firstRec);
+  std::vector<char> bytes(windowRecords * recordBytes);
+  // The cells of a window are contiguous in the file, so only the first read needs a seek.
+  if (fseeko(file, (off_t) fileOffset(window, 0), SEEK_SET) != 0) {
+    throw VICException("Unable to seek in the atmospheric forcing scratch file (ATMOS_WINDOW_RECORDS).");
+  }
+  for (int c = 0; c < numCells; c++) {
+    if (numRecs < windowRecords && c > 0 && fseeko(file, (off_t) fileOffset(window, c), SEEK_SET) != 0) {
+      throw VICException("Unable to seek in the atmospheric forcing scratch file (ATMOS_WINDOW_RECORDS).");
+    }
+    if (fread(&bytes[0], recordBytes, numRecs, file) != (size_t) numRecs) {
+      throw VICException("Unable to read from the atmospheric forcing scratch file (ATMOS_WINDOW_RECORDS).");
+    }
+    for (int r = 0; r < numRecs; r++) {
+      deserializeRecord(&bytes[r * recordBytes], buffers[buffer][c][r]);
+    }
+  }
+  std::chrono::duration<double> elapsed = std::chrono::system_clock::now() - start;
+  secondsLoading += elapsed.count();
+}
+
+void AtmosStream::prefetchWindow(int window, int buffer) {
+  // An exception cannot leave the prefetcher thread, so it is kept and rethrown by advance() after the join.
+  try {
+    loadWindow(window, buffer);
+  } catch (...) {
+    prefetchError = std::current_exception();
+  }
+}
+
+void AtmosStream::advance(int rec, std::vector<cell_info_struct>& cells) {
+  int window = rec / windowRecords;
+  if (window == currentWindow) {
+    return;
+  }
+  if (currentWindow < 0) {
+    loadWindow(window, currentBuffer);
+  } else {
+    if (window != currentWindow + 1 || !prefetcher.joinable()) {
+      throw VICException("Error: AtmosStream::advance must be called for consecutive records.");
+    }
+    std::chrono::time_point<std::chrono::system_clock> start = std::chrono::system_clock::now();
+    prefetcher.join();
+    std::chrono::duration<double> elapsed = std::chrono::system_clock::now() - start;
+    secondsWaiting += elapsed.count();
+    if (prefetchError) {
+      std::rethrow_exception(prefetchError);
+    }
+    currentBuffer = 1 - currentBuffer;
+  }
+  currentWindow = window;
+
+  for (unsigned int c = 0; c < cells.size(); c++) {
+    cells[c].atmos = buffers[currentBuffer][c];
+    cells[c].atmos_first_rec = window * windowRecords;
+  }
+
+  // The other buffer was used by the previous window, which no cell refers to any more.
+  if (window + 1 < numWindows) {
+    prefetcher = std::thread(&AtmosStream::prefetchWindow, this, window + 1, 1 - currentBuffer);
+  }
+}
+
+void AtmosStream::release(std::vector<cell_info_struct>& cells) {
+  for (unsigned int c = 0; c < cells.size(); c++) {
+    cells[c].atmos = NULL;
+    cells[c].atmos_first_rec = 0;
+  }
+}
+
+void AtmosStream::printStatistics() const {
+  fprintf(stderr, "Atmospheric forcing windows: %d windows of %d records, %.1f MB per window; %.3f seconds storing, %.3f seconds loading, %.3f seconds waiting for the next window\n",
+      numWindows, windowRecords, (double) numCells * windowRecords * recordBytes / (1024 * 1024),
+      secondsStoring, secondsLoading, secondsWaiting);
+}
@@ -0,0 +1,65 @@
+#ifndef ATMOSSTREAM_H_
+#define ATMOSSTREAM_H_
+
+#include <stdio.h>
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "vicNl_def.h"
+
+/*
+ * Keeps only a window of ATMOS_WINDOW_RECORDS atmospheric forcing records in memory per cell, instead of the
+ * whole simulation period.
+ *
+ * The forcings of each cell are still disaggregated for the whole period at initialization (MTCLIM uses
+ * statistics of the whole record, so disaggregating in windows would change the forcings). Each cell's
+ * atmos arrays are then written to a scratch file with storeCell() and freed. During the time loop the
+ * cells' atmos pointers refer to the current window (cell.atmos[rec - cell.atmos_first_rec]), while a
+ * background thread reads the next window of all cells from the scratch file. The model results are
+ * identical to a run with all forcings in memory.
+ *
+ * The scratch file is laid out window by window, so each window is read sequentially. It is removed
+ * from the directory as soon as it is created, and disappears when VIC exits.
+ */
+class AtmosStream {
+public:
+  AtmosStream(const std::string& scratchDirectory, int numCells, int windowRecords, const ProgramState* state);
+  ~AtmosStream();
+
+  // Writes the whole-period atmos arrays of a cell to the scratch file. The caller may then free them.
+  void storeCell(int cellIndex, const atmos_data_struct* atmos);
+  // Points each cell's atmos at the window holding record rec, loading it first if needed. Call with
+  // rec = 0, 1, 2, ... at the start of every time step, while no other thread is using the cells' atmos.
+  void advance(int rec, std::vector<cell_info_struct>& cells);
+  // Clears the cells' atmos pointers, which refer to buffers owned (and freed) by this object.
+  void release(std::vector<cell_info_struct>& cells);
+  void printStatistics() const;
+
+private:
+  void loadWindow(int window, int buffer);
+  void prefetchWindow(int window, int buffer);  // loadWindow() on the prefetcher thread
+  void serializeRecord(const atmos_data_struct& atmos, char* bytes) const;
+  void deserializeRecord(const char* bytes, atmos_data_struct& atmos) const;
+  long long fileOffset(int window, int cellIndex) const;
+
+  const ProgramState* state;
+  FILE* file;
+  int numCells;
+  int windowRecords;
+  int numWindows;
+  size_t recordBytes;
+  int currentWindow;
+  int currentBuffer;
+  std::vector<atmos_data_struct*> buffers[2];   // per cell, windowRecords records each
+  std::thread prefetcher;                       // loads currentWindow + 1 into the other buffer
+  std::exception_ptr prefetchError;             // thrown by loadWindow() on the prefetcher thread
+
+  // Reported by printStatistics() when VERBOSE is TRUE.
+  double secondsStoring;
+  double secondsLoading;      // inside loadWindow(), mostly on the prefetcher thread
+  double secondsWaiting;      // main thread waiting for the prefetcher
+};
+
+#endif /* ATMOSSTREAM_H_ */
@@ -0,0 +1,277 @@
+#include "BinaryForcing.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <sstream>
+
+#include "vicNl.h"
+
+// Records decoded per block by BinaryForcingFile::decode()
+static const int DECODE_BLOCK_RECORDS = 256;
+
+static const char SIDECAR_MAGIC[8] = { 'V', 'I', 'C', 'F', 'O', 'R', 'C', 'E' };
+static const int SIDECAR_VERSION = 1;
+
+MappedFile::MappedFile(int fd, bool writableCopy, const char* description) : bytes(NULL), length(0) {
+  struct stat status;
+  if (fstat(fd, &status) != 0) {
+    char ErrStr[MAXSTRING];
+    sprintf(ErrStr, "Unable to get the size of %s", description);
+    nrerror(ErrStr);
+  }
+  length = status.st_size;
+  if (length == 0) {
+    return;
+  }
+  void* address = mmap(NULL, length, writableCopy ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, fd, 0);
+  if (address == MAP_FAILED) {
+    char ErrStr[MAXSTRING];
+    sprintf(ErrStr, "Unable to map %s into memory", description);
+    nrerror(ErrStr);
+  }
+  bytes = (unsigned char*) address;
+}
+
+MappedFile::~MappedFile() {
+  if (bytes != NULL) {
+    munmap(bytes, length);
+  }
+}
+
+ForcingData::ForcingData(const ProgramState* state) {
+  length = state->global_param.nrecs * state->NF;
+  columns = (double **) calloc(N_FORCING_TYPES, sizeof(double*));
+  for (int type = 0; type < N_FORCING_TYPES; type++) {
+    mapped[type] = false;
+    if (state->param_set.TYPE[type].SUPPLIED) {
+      columns[type] = (double *) calloc(length, sizeof(double));
+    }
+  }
+}
+
+ForcingData::~ForcingData() {
+  for (int type = 0; type < N_FORCING_TYPES; type++) {
+    if (!mapped[type]) {
+      free(columns[type]);
+    }
+  }
+  free(columns);
+  for (unsigned int i = 0; i < files.size(); i++) {
+    delete files[i];
+  }
+}
+
+void ForcingData::useMappedColumn(int type, double* column) {
+  if (!mapped[type]) {
+    free(columns[type]);
+  }
+  columns[type] = column;
+  mapped[type] = true;
+}
+
+void ForcingData::keep(MappedFile* file) {
+  files.push_back(file);
+}
+
+BinaryForcingFile::BinaryForcingFile(FILE* infile, int file_num, const ProgramState* state)
+  : file(fileno(infile), false, "the binary forcing file") {
+  if (file.size() == 0) {
+    nrerror("No data in the forcing file.  Model stopping...");
+  }
+  bigEndian = state->param_set.FORCE_ENDIAN[file_num] == BIG;
+
+  // Check for presence of a header, & skip over it if appropriate.
+  // A VIC header will start with 4 instances of the identifier,
+  // followed by number of bytes in the header (Nbytes).
+  // Nbytes is assumed to be the byte offset at which the data records start.
+  const unsigned char* bytes = file.data();
+  size_t Nbytes = 0;
+  if (file.size() >= 10 && memcmp(bytes, "\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF", 8) == 0) {
+    Nbytes = bigEndian ? (bytes[8] << 8) | bytes[9] : (bytes[9] << 8) | bytes[8];
+  }
+  recordBytes = bytes + Nbytes;
+
+  const int Nfields = state->param_set.N_TYPES[file_num];
+  for (int i = 0; i < Nfields; i++) {
+    fieldTypes.push_back(state->param_set.FORCE_INDEX[file_num][i]);
+  }
+  records = Nbytes < file.size() ? (file.size() - Nbytes) / (Nfields * sizeof(short)) : 0;
+
+  for (int r = 0; r < DECODE_BLOCK_RECORDS; r++) {
+    for (int i = 0; i < Nfields; i++) {
+      const force_type_struct& type = state->param_set.TYPE[fieldTypes[i]];
+      signBits.push_back(type.SIGNED ? 0x8000 : 0);
+      multipliers.push_back(type.multiplier);
+    }
+  }
+}
+
+/* Converts n 16 bit values of the given byte order: unsigned, or two's complement where signBits is 0x8000, divided
+   by the multipliers (as the values were read one at a time). */
+template <bool BIG_ENDIAN_VALUES>
+static void decodeValues(const unsigned char* bytes, int n, const int* signBits, const double* multipliers,
+    double* values) {
+  for (int k = 0; k < n; k++) {
+    const int raw = BIG_ENDIAN_VALUES ? (bytes[2 * k] << 8) | bytes[2 * k + 1] : (bytes[2 * k + 1] << 8) | bytes[2 * k];
+    values[k] = (double) (raw - ((raw & signBits[k]) << 1)) / multipliers[k];
+  }
+}
+
+int BinaryForcingFile::decode(double** columns, int firstRec, int count) const {
+  const int Nfields = numFields();
+  count = std::max(0, std::min(count, records - firstRec));
+  std::vector<double> values(DECODE_BLOCK_RECORDS * Nfields);
+  for (int blockStart = 0; blockStart < count; blockStart += DECODE_BLOCK_RECORDS) {
+    const int blockRecords = std::min(DECODE_BLOCK_RECORDS, count - blockStart);
+    const unsigned char* bytes = recordBytes + (size_t) (firstRec + blockStart) * Nfields * sizeof(short);
+    if (bigEndian) {
+      decodeValues<true>(bytes, blockRecords * Nfields, &signBits[0], &multipliers[0], &values[0]);
+    }
+    else {
+      decodeValues<false>(bytes, blockRecords * Nfields, &signBits[0], &multipliers[0], &values[0]);
+    }
+    for (int i = 0; i < Nfields; i++) {
+      double* column = columns[fieldTypes[i]] + blockStart;
+      for (int r = 0; r < blockRecords; r++) {
+        column[r] = values[r * Nfields + i];
+      }
+    }
+  }
+  return count;
+}
+
+struct ForcingSidecar::Header {
+  char magic[8];
+  int version;
+  int numFields;
+  long long numRecords;
+  long long sourceSize;
+  long long sourceModified;
+  int sourceEndian;
+  int unused;
+  struct {
+    int type;
+    int isSigned;
+    double multiplier;
+  } fields[N_FORCING_TYPES];
+};
+
+ForcingSidecar::ForcingSidecar(const char* fileName, FILE* infile, int file_num, const ProgramState* state)
+  : state(state), fileNum(file_num), sidecar(NULL), source(NULL), numFields(state->param_set.N_TYPES[file_num]),
+    numRecords(0) {
+  struct stat status;
+  fstat(fileno(infile), &status);
+
+  Header expected;
+  memset(&expected, 0, sizeof(expected));
+  memcpy(expected.magic, SIDECAR_MAGIC, sizeof(SIDECAR_MAGIC));
+  expected.version = SIDECAR_VERSION;
+  expected.numFields = numFields;
+  expected.sourceSize = status.st_size;
+  expected.sourceModified = status.st_mtime;
+  expected.sourceEndian = state->param_set.FORCE_ENDIAN[file_num];
+  for (int i = 0; i < numFields; i++) {
+    fieldTypes.push_back(state->param_set.FORCE_INDEX[file_num][i]);
+    expected.fields[i].type = fieldTypes[i];
+    expected.fields[i].isSigned = state->param_set.TYPE[fieldTypes[i]].SIGNED;
+    expected.fields[i].multiplier = state->param_set.TYPE[fieldTypes[i]].multiplier;
+  }
+
+  const std::string sidecarName = std::string(fileName) + ".f64";
+  if (!mapIfCurrent(sidecarName, expected)) {
+    if (!write(sidecarName, expected, infile) || !mapIfCurrent(sidecarName, expected)) {
+      fprintf(stderr, "WARNING: Unable to write the forcing sidecar %s; the forcing file is decoded instead.\n",
+          sidecarName.c_str());
+      source = new BinaryForcingFile(infile, file_num, state);
+      numRecords = source->numRecords();
+    }
+  }
+}
+
+ForcingSidecar::~ForcingSidecar() {
+  delete sidecar;
+  delete source;
+}
+
+bool ForcingSidecar::mapIfCurrent(const std::string& sidecarName, const Header& expected) {
+  FILE* file = fopen(sidecarName.c_str(), "rb");
+  if (file == NULL) {
+    return false;
+  }
+  MappedFile* map = new MappedFile(fileno(file), true, "the forcing sidecar");
+  fclose(file);   // the mapping stays valid
+
+  const Header* header = (const Header*) map->data();
+  if (map->size() < sizeof(Header) || memcmp(header->magic, expected.magic, sizeof(expected.magic)) != 0
+      || header->version != expected.version || header->numFields != expected.numFields
+      || header->sourceSize != expected.sourceSize || header->sourceModified != expected.sourceModified
+      || header->sourceEndian != expected.sourceEndian
+      || memcmp(header->fields, expected.fields, sizeof(expected.fields)) != 0
+      || map->size() != sizeof(Header) + header->numRecords * header->numFields * sizeof(double)) {
+    delete map;
+    return false;
+  }
+  numRecords = header->numRecords;
+  sidecar = map;
+  return true;
+}
+
+bool ForcingSidecar::write(const std::string& sidecarName, const Header& header, FILE* infile) {
+  BinaryForcingFile forcingFile(infile, fileNum, state);
+  Header written = header;
+  written.numRecords = forcingFile.numRecords();
+
+  // Decode all records, a column per field
+  std::vector<double> values((size_t) written.numRecords * numFields);
+  double* columns[N_FORCING_TYPES];
+  for (int i = 0; i < numFields; i++) {
+    columns[fieldTypes[i]] = &values[0] + (size_t) i * written.numRecords;
+  }
+  forcingFile.decode(columns, 0, written.numRecords);
+
+  // Written under a temporary name and renamed, so that other runs never map a partly written sidecar
+  std::ostringstream temporaryName;
+  temporaryName << sidecarName << ".tmp" << getpid();
+  FILE* file = fopen(temporaryName.str().c_str(), "wb");
+  if (file == NULL) {
+    return false;
+  }
+  bool ok = fwrite(&written, sizeof(Header), 1, file) == 1;
+  if (!values.empty()) {
+    ok = ok && fwrite(&values[0], sizeof(double), values.size(), file) == values.size();
+  }
+  ok = fclose(file) == 0 && ok;
+  if (!ok || rename(temporaryName.str().c_str(), sidecarName.c_str()) != 0) {
+    remove(temporaryName.str().c_str());
+    return false;
+  }
+  return true;
+}
+
+int ForcingSidecar::read(ForcingData* forcing, int firstRec, int count) {
+  if (source != NULL) {
+    return source->decode(forcing->columns, firstRec, count);
+  }
+  count = (int) std::max(0LL, std::min((long long) count, numRecords - firstRec));
+  double* values = (double*) (sidecar->writableData() + sizeof(Header));
+  const bool wholeColumns = numRecords - firstRec >= forcing->columnLength();
+  for (int i = 0; i < numFields; i++) {
+    double* column = values + (size_t) i * numRecords + firstRec;
+    if (wholeColumns) {
+      forcing->useMappedColumn(fieldTypes[i], column);
+    }
+    else if (count > 0) {
+      memcpy(forcing->columns[fieldTypes[i]], column, count * sizeof(double));
+    }
+  }
+  if (wholeColumns) {
+    forcing->keep(sidecar);
+    sidecar = NULL;
+  }
+  return count;
+}
@@ -0,0 +1,122 @@
+#ifndef BINARYFORCING_H_
+#define BINARYFORCING_H_
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "vicNl_def.h"
+
+/*
+ * A whole file mapped into memory (mmap), read-only. With writableCopy the pages can also be written, privately
+ * (copy-on-write): the changes are never written back to the file.
+ */
+class MappedFile {
+public:
+  MappedFile(int fd, bool writableCopy, const char* description);
+  ~MappedFile();
+  const unsigned char* data() const { return bytes; }
+  unsigned char* writableData() { return bytes; }
+  size_t size() const { return length; }
+
+private:
+  MappedFile(const MappedFile&);
+  MappedFile& operator=(const MappedFile&);
+
+  unsigned char* bytes;
+  size_t length;
+};
+
+/*
+ * The forcing data of a cell, as read from its forcing files: a column of forcing time steps per forcing type
+ * (NULL for the types that are not supplied), of nrecs * NF values each, as initialize_atmos() expects them.
+ *
+ * The columns are allocated, except those pointing into a mapped forcing sidecar (FORCE_SIDECAR), which stays
+ * mapped until the forcing data is released. initialize_atmos() converts the columns in place; the changes to a
+ * mapped column only go to private copies of its pages.
+ */
+class ForcingData {
+public:
+  explicit ForcingData(const ProgramState* state);
+  ~ForcingData();
+  int columnLength() const { return length; }
+  // Replaces the allocated column of a forcing type with one in a mapped file, which must stay mapped (see keep()).
+  void useMappedColumn(int type, double* column);
+  // Unmaps the file when the forcing data is released.
+  void keep(MappedFile* file);
+
+  double** columns;
+
+private:
+  ForcingData(const ForcingData&);
+  ForcingData& operator=(const ForcingData&);
+
+  int length;
+  bool mapped[N_FORCING_TYPES];
+  std::vector<MappedFile*> files;
+};
+
+/*
+ * A per-cell BINARY forcing file, mapped into memory. Its records (after the optional VIC header) are decoded
+ * many at a time: the byte order (FORCE_ENDIAN), sign and multiplier of every value of a block of records are
+ * applied in one branch-free loop, which the compiler vectorizes, and the values are then distributed to the
+ * columns of their forcing types. The results are the same as with one fread() per value.
+ */
+class BinaryForcingFile {
+public:
+  // Maps the forcing file of file_num (FORCING1 or FORCING2) that is open as infile.
+  BinaryForcingFile(FILE* infile, int file_num, const ProgramState* state);
+  int numFields() const { return fieldTypes.size(); }
+  int numRecords() const { return records; }
+  int fieldType(int field) const { return fieldTypes[field]; }
+  // Decodes the records [firstRec, firstRec + count) of the file, or as many of them as the file holds, into
+  // columns[type][0...] of the forcing type of each field. Returns the number of records decoded.
+  int decode(double** columns, int firstRec, int count) const;
+
+private:
+  MappedFile file;
+  const unsigned char* recordBytes;   // start of the first record
+  int records;
+  bool bigEndian;
+  std::vector<int> fieldTypes;        // FORCE_INDEX of each field
+  // Per value of a block of DECODE_BLOCK_RECORDS records: 0x8000 for SIGNED fields (0 otherwise), and the multiplier
+  std::vector<int> signBits;
+  std::vector<double> multipliers;
+};
+
+/*
+ * A preprocessed copy of a BINARY forcing file (FORCE_SIDECAR), written next to it as <forcing file>.f64: a
+ * header, then the decoded values of every record of the file as native doubles, a column of all records per
+ * field. It is mapped, and the forcing columns of a cell point straight into it, without any decoding.
+ *
+ * The header records the size and modification time of the forcing file, its FORCE_ENDIAN, and the forcing type,
+ * SIGNED flag and multiplier of each field. A sidecar that does not match the forcing file and the global
+ * parameter file is written again.
+ */
+class ForcingSidecar {
+public:
+  // Maps the sidecar of the forcing file fileName of file_num, open as infile, after writing it if it is missing or
+  // out of date. If it cannot be written (e.g. a read-only directory), the forcing file is decoded directly.
+  ForcingSidecar(const char* fileName, FILE* infile, int file_num, const ProgramState* state);
+  ~ForcingSidecar();
+  // Sets the columns of the forcing types of the file to the records [firstRec, firstRec + count), or as many of
+  // them as the file holds, and returns the number of records. The columns point into the sidecar if the file holds
+  // a whole column length of records from firstRec; otherwise the records are copied.
+  int read(ForcingData* forcing, int firstRec, int count);
+
+private:
+  struct Header;
+
+  bool mapIfCurrent(const std::string& sidecarName, const Header& expected);
+  bool write(const std::string& sidecarName, const Header& header, FILE* infile);
+
+  const ProgramState* state;
+  int fileNum;
+  MappedFile* sidecar;                // NULL if the sidecar could not be written
+  BinaryForcingFile* source;          // the forcing file, decoded directly without a sidecar
+  int numFields;
+  long long numRecords;
+  std::vector<int> fieldTypes;
+};
+
+#endif /* BINARYFORCING_H_ */
@@ -0,0 +1,242 @@
+#include "BlowingSnowTable.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+
+#include "vicNl.h"
+#include "mtclim_constants_vic.h"
+
+// Range of the table. The wind range is the one CalcBlowingSnow() limits U10 to, and ushear is at most von_K * U10.
+static const double BLOWING_TABLE_WIND_MIN = 0.4;
+static const double BLOWING_TABLE_WIND_MAX = 25.;
+static const double BLOWING_TABLE_SHEAR_MIN = 0.1;
+static const double BLOWING_TABLE_SHEAR_MAX = von_K * BLOWING_TABLE_WIND_MAX;
+// Nodes along each axis, including the node beyond each edge
+static const int BLOWING_TABLE_NODES = 100;
+static const int NUM_VALUES = 3;
+
+// Largest relative error of the interpolated sublimation or transport that enable() accepts.
+static const double BLOWING_TABLE_MAX_ERROR = 1e-3;
+
+// Header of a BLOWING_TABLE_FILE. The version has to change whenever sub_with_height(), transport_with_height() or
+// the integration limits change, so that tables of the old formulas are built again.
+static const char TABLE_MAGIC[8] = { 'V', 'I', 'C', 'B', 'L', 'O', 'W', 'T' };
+static const int TABLE_VERSION = 1;
+
+struct BlowingSnowTable::Header {
+  char magic[8];
+  int version;
+  int numNodes;
+  double windMin;
+  double windMax;
+  double shearMin;
+  double shearMax;
+  double sublimationError;
+  double transportError;
+};
+
+namespace {
+
+const double WIND_STEP = (log(BLOWING_TABLE_WIND_MAX) - log(BLOWING_TABLE_WIND_MIN)) / (BLOWING_TABLE_NODES - 3);
+const double WIND_START = log(BLOWING_TABLE_WIND_MIN) - WIND_STEP;
+const double SHEAR_STEP = (log(BLOWING_TABLE_SHEAR_MAX) - log(BLOWING_TABLE_SHEAR_MIN)) / (BLOWING_TABLE_NODES - 3);
+const double SHEAR_START = log(BLOWING_TABLE_SHEAR_MIN) - SHEAR_STEP;
+
+// Catmull-Rom cubic through p[1] (t = 0) and p[2] (t = 1)
+inline double catmullRom(const double* p, double t) {
+  return p[1] + 0.5 * t * (p[2] - p[0] + t * (2. * p[0] - 5. * p[1] + 4. * p[2] - p[3]
+      + t * (3. * (p[1] - p[2]) + p[3] - p[0])));
+}
+
+// Transport of suspended snow per unit saltation concentration, for the roughness of the saltation layer
+double transport(const SuspensionIntegrals& integrals, double ushear) {
+  const double Zo_salt = 0.12 * ushear * ushear / (2. * G_STD);
+  return integrals.concentration * (integrals.logHeight - log(Zo_salt));
+}
+
+}
+
+BlowingSnowTable& BlowingSnowTable::instance() {
+  static BlowingSnowTable table;
+  return table;
+}
+
+BlowingSnowTable::BlowingSnowTable() : enabled(false), sublimationError(0), transportError(0) {
+}
+
+void BlowingSnowTable::enable(const char* fileName) {
+  typedef std::chrono::steady_clock Clock;
+  const Clock::time_point start = Clock::now();
+  const bool hasFile = strcasecmp(fileName, "NONE") != 0;
+  const bool loaded = hasFile && load(fileName);
+  if (!loaded) {
+    build();
+    check();
+  }
+
+  if (!(sublimationError <= BLOWING_TABLE_MAX_ERROR) || !(transportError <= BLOWING_TABLE_MAX_ERROR)) {
+    char ErrStr[MAXSTRING];
+    sprintf(ErrStr, "ERROR: BLOWING_TABLE: the relative error of the tabulated blowing snow sublimation (%g) or "
+        "transport (%g) is larger than %g; set BLOWING_TABLE to FALSE.\n", sublimationError, transportError,
+        BLOWING_TABLE_MAX_ERROR);
+    nrerror(ErrStr);
+  }
+  if (hasFile && !loaded && !save(fileName)) {
+    fprintf(stderr, "WARNING: Unable to write the blowing snow table to %s; it will be built again in the next run.\n",
+        fileName);
+  }
+  enabled = true;
+
+#if VERBOSE
+  fprintf(stderr, "BLOWING_TABLE: %d x %d nodes %s%s in %.2f s; max relative error against the Romberg integration: "
+      "sublimation %.2g, transport %.2g\n", BLOWING_TABLE_NODES, BLOWING_TABLE_NODES, loaded ? "loaded from " : "built",
+      loaded ? fileName : "", std::chrono::duration<double>(Clock::now() - start).count(), sublimationError,
+      transportError);
+#endif
+}
+
+void BlowingSnowTable::build() {
+  values.resize((size_t) BLOWING_TABLE_NODES * BLOWING_TABLE_NODES * NUM_VALUES);
+  for (int i = 0; i < BLOWING_TABLE_NODES; i++) {
+    const double U10 = exp(WIND_START + i * WIND_STEP);
+    for (int j = 0; j < BLOWING_TABLE_NODES; j++) {
+      SuspensionIntegrals integrals;
+      suspension_integrals(U10, exp(SHEAR_START + j * SHEAR_STEP), &integrals);
+      double* node = &values[((size_t) i * BLOWING_TABLE_NODES + j) * NUM_VALUES];
+      node[0] = log(integrals.sublimation);
+      node[1] = log(integrals.concentration);
+      node[2] = integrals.logHeight;
+    }
+  }
+}
+
+double BlowingSnowTable::interpolate(int value, int windNode, int shearNode, double windFraction,
+    double shearFraction) const {
+  double alongWind[4];
+  for (int a = 0; a < 4; a++) {
+    const double* row = &values[((size_t) (windNode - 1 + a) * BLOWING_TABLE_NODES + shearNode - 1) * NUM_VALUES + value];
+    const double alongShear[4] = { row[0], row[NUM_VALUES], row[2 * NUM_VALUES], row[3 * NUM_VALUES] };
+    alongWind[a] = catmullRom(alongShear, shearFraction);
+  }
+  return catmullRom(alongWind, windFraction);
+}
+
+bool BlowingSnowTable::lookup(double U10, double ushear, SuspensionIntegrals* integrals) const {
+  if (!(U10 >= BLOWING_TABLE_WIND_MIN && U10 <= BLOWING_TABLE_WIND_MAX && ushear >= BLOWING_TABLE_SHEAR_MIN
+      && ushear <= BLOWING_TABLE_SHEAR_MAX)) {
+    return false;
+  }
+  // The cell of the table, between nodes 1 and BLOWING_TABLE_NODES - 2 (the maximum falls on the last node)
+  const double x = (log(U10) - WIND_START) / WIND_STEP;
+  const double y = (log(ushear) - SHEAR_START) / SHEAR_STEP;
+  const int i = std::min(std::max((int) x, 1), BLOWING_TABLE_NODES - 3);
+  const int j = std::min(std::max((int) y, 1), BLOWING_TABLE_NODES - 3);
+  integrals->sublimation = exp(interpolate(0, i, j, x - i, y - j));
+  integrals->concentration = exp(interpolate(1, i, j, x - i, y - j));
+  integrals->logHeight = interpolate(2, i, j, x - i, y - j);
+  return true;
+}
+
+/*
+ * Compares the table with the Romberg integration at the centre of every table cell that shear_stress() can reach,
+ * and with VERBOSE times both.
+ */
+void BlowingSnowTable::check() {
+  typedef std::chrono::steady_clock Clock;
+  std::vector<double> winds, shears;
+  for (int i = 1; i < BLOWING_TABLE_NODES - 2; i++) {
+    for (int j = 1; j < BLOWING_TABLE_NODES - 2; j++) {
+      const double U10 = exp(WIND_START + (i + 0.5) * WIND_STEP);
+      const double ushear = exp(SHEAR_START + (j + 0.5) * SHEAR_STEP);
+      if (ushear <= von_K * U10) {
+        winds.push_back(U10);
+        shears.push_back(ushear);
+      }
+    }
+  }
+
+  const Clock::time_point startExact = Clock::now();
+  std::vector<SuspensionIntegrals> exact(winds.size());
+  for (unsigned int k = 0; k < winds.size(); k++) {
+    suspension_integrals(winds[k], shears[k], &exact[k]);
+  }
+  const double exactSeconds = std::chrono::duration<double>(Clock::now() - startExact).count();
+  const Clock::time_point startTable = Clock::now();
+  std::vector<SuspensionIntegrals> tabulated(winds.size());
+  for (unsigned int k = 0; k < winds.size(); k++) {
+    lookup(winds[k], shears[k], &tabulated[k]);
+  }
+  const double tableSeconds = std::chrono::duration<double>(Clock::now() - startTable).count();
+
+  sublimationError = 0;
+  transportError = 0;
+  for (unsigned int k = 0; k < winds.size(); k++) {
+    sublimationError = std::max(sublimationError, fabs(tabulated[k].sublimation / exact[k].sublimation - 1.));
+    transportError = std::max(transportError,
+        fabs(transport(tabulated[k], shears[k]) / transport(exact[k], shears[k]) - 1.));
+  }
+
+#if VERBOSE
+  fprintf(stderr, "BLOWING_TABLE: %.2f us per Romberg integration of the suspension layer, %.3f us per table lookup\n",
+      1e6 * exactSeconds / winds.size(), 1e6 * tableSeconds / winds.size());
+#endif
+}
+
+bool BlowingSnowTable::load(const char* fileName) {
+  FILE* file = fopen(fileName, "rb");
+  if (file == NULL) {
+    return false;
+  }
+  Header header;
+  std::vector<double> loaded((size_t) BLOWING_TABLE_NODES * BLOWING_TABLE_NODES * NUM_VALUES);
+  bool ok = fread(&header, sizeof(Header), 1, file) == 1
+      && memcmp(header.magic, TABLE_MAGIC, sizeof(TABLE_MAGIC)) == 0 && header.version == TABLE_VERSION
+      && header.numNodes == BLOWING_TABLE_NODES
+      && header.windMin == BLOWING_TABLE_WIND_MIN && header.windMax == BLOWING_TABLE_WIND_MAX
+      && header.shearMin == BLOWING_TABLE_SHEAR_MIN && header.shearMax == BLOWING_TABLE_SHEAR_MAX
+      && fread(&loaded[0], sizeof(double), loaded.size(), file) == loaded.size()
+      && fgetc(file) == EOF;
+  fclose(file);
+  if (!ok) {
+    return false;
+  }
+  values.swap(loaded);
+  sublimationError = header.sublimationError;
+  transportError = header.transportError;
+  return true;
+}
+
+bool BlowingSnowTable::save(const char* fileName) const {
+  Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, TABLE_MAGIC, sizeof(TABLE_MAGIC));
+  header.version = TABLE_VERSION;
+  header.numNodes = BLOWING_TABLE_NODES;
+  header.windMin = BLOWING_TABLE_WIND_MIN;
+  header.windMax = BLOWING_TABLE_WIND_MAX;
+  header.shearMin = BLOWING_TABLE_SHEAR_MIN;
+  header.shearMax = BLOWING_TABLE_SHEAR_MAX;
+  header.sublimationError = sublimationError;
+  header.transportError = transportError;
+
+  // Written under a temporary name and renamed, so that other runs never load a partly written table
+  std::ostringstream temporaryName;
+  temporaryName << fileName << ".tmp" << getpid();
+  FILE* file = fopen(temporaryName.str().c_str(), "wb");
+  if (file == NULL) {
+    return false;
+  }
+  bool ok = fwrite(&header, sizeof(Header), 1, file) == 1
+      && fwrite(&values[0], sizeof(double), values.size(), file) == values.size();
+  ok = fclose(file) == 0 && ok;
+  if (!ok || rename(temporaryName.str().c_str(), fileName) != 0) {
+    remove(temporaryName.str().c_str());
+    return false;
+  }
+  return true;
+}
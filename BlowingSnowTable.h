@@ -0,0 +1,76 @@
+#ifndef BLOWINGSNOWTABLE_H_
+#define BLOWINGSNOWTABLE_H_
+
+#include <vector>
+
+/*
+ * The integrals over the suspension layer of blowing snow, from the top of the saltation layer (hsalt) to the top
+ * of the suspended snow (ztop), that CalcSubFlux() finds by Romberg integration for every wind increment of
+ * CalcBlowingSnow().
+ *
+ * The sublimation rate (sub_with_height) and the transport rate (transport_with_height) at a height are the
+ * product of factors that do not depend on the height (the humidity deficit EactAir / es - 1 over F, which
+ * holds the temperature dependence, and the saltation layer concentration phi_s, which holds the air density)
+ * and of a function of the height, the 10 m wind speed U10 and the shear velocity ushear. The roughness only
+ * enters through ushear and through ln(Zo_salt) in the wind profile. So for all temperatures, humidities, air
+ * densities and roughnesses:
+ *   integral of sub_with_height       = (EactAir / es - 1) / F * phi_s * sublimation
+ *   integral of transport_with_height = phi_s * concentration * (logHeight - ln(Zo_salt))
+ * with sublimation, concentration and logHeight functions of U10 and ushear alone.
+ */
+struct SuspensionIntegrals {
+  double sublimation;     // integral of sub_with_height() for EactAir / es - 1 = F = phi_r = 1
+  double concentration;   // ushear / von_K times the integral of the relative concentration of suspended snow
+  double logHeight;       // mean ln(z) of the suspended snow, weighted by its concentration
+};
+
+// Computes the integrals by Romberg integration of sub_with_height() and transport_with_height(), as
+// CalcSubFlux() does (CalcBlowingSnow.c).
+void suspension_integrals(double U10, double ushear, SuspensionIntegrals* integrals);
+
+/*
+ * A table of the suspension integrals over U10 and ushear, for the BLOWING_TABLE global parameter, which
+ * CalcSubFlux() interpolates instead of integrating.
+ *
+ * The table covers U10 from BLOWING_TABLE_WIND_MIN to BLOWING_TABLE_WIND_MAX (the range CalcBlowingSnow() limits
+ * the wind increments to) and ushear from BLOWING_TABLE_SHEAR_MIN to von_K * BLOWING_TABLE_WIND_MAX, with nodes
+ * equally spaced in ln U10 and ln ushear, and one more node beyond each edge. ln(sublimation), ln(concentration)
+ * and logHeight are interpolated between the 4 x 4 nearest nodes with Catmull-Rom cubics. Outside the table the
+ * integrals are computed as before.
+ *
+ * enable() builds the table, or loads it from BLOWING_TABLE_FILE if that holds a table of the same layout (and
+ * otherwise writes it there), then compares the interpolated integrals with the Romberg integration at the centre
+ * of every table cell with ushear <= von_K * U10 (shear_stress() does not go beyond it), where the interpolation
+ * errors are largest. The largest relative errors of the sublimation and of the transport found there are the
+ * reported error bound; the run stops if either exceeds BLOWING_TABLE_MAX_ERROR.
+ */
+class BlowingSnowTable {
+public:
+  static BlowingSnowTable& instance();
+  // Builds or loads the table and checks it. fileName is the BLOWING_TABLE_FILE, or NONE. Called once, before the
+  // cells are run.
+  void enable(const char* fileName);
+  bool isEnabled() const { return enabled; }
+
+  // The interpolated integrals, or false if (U10, ushear) is outside the table.
+  bool lookup(double U10, double ushear, SuspensionIntegrals* integrals) const;
+
+private:
+  struct Header;
+
+  BlowingSnowTable();
+  void build();
+  bool load(const char* fileName);
+  bool save(const char* fileName) const;
+  void check();
+  double interpolate(int value, int windNode, int shearNode, double windFraction, double shearFraction) const;
+
+  bool enabled;
+  double sublimationError;   // largest relative errors found by check()
+  double transportError;
+  // NUM_VALUES values per node: ln(sublimation), ln(concentration), logHeight, node (wind, shear) at
+  // (wind * numShearNodes + shear) * NUM_VALUES
+  std::vector<double> values;
+};
+
+#endif /* BLOWINGSNOWTABLE_H_ */
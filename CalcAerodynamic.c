@@ -9,7 +9,7 @@
  * LAST-MOD: Thu Mar  8 13:24:10 2001 by Keith Cherkauer <cherkaue@u.washington.edu>
  * DESCRIPTION:  Calculate the aerodynamic resistances
  * DESCRIP-END.
- * FUNCTIONS:    CalcAerodynamic()
+ * FUNCTIONS:    CalcAerodynamic(), build_aero_table(), get_aero_terms()
  * COMMENTS:     Modified for use with the vicNl model 3-12-98
  *		 by Keith Cherkauer
  */
@@ -79,6 +79,8 @@ int  CalcAerodynamic(char    OverStory,     /* overstory flag */
               subroutine.                                      GCT/KAC
   2009-Jun-09 Modified to use extension of veg_lib structure to contain
 	      bare soil information.				TJB
+  2026-Oct-17 Added build_aero_table() and get_aero_terms(), which
+	      tabulate the results of this function per HRU and month.	AG
   *******************************************************************/
 
 
@@ -270,3 +272,173 @@ int  CalcAerodynamic(char    OverStory,     /* overstory flag */
   return (0);
 
 }
+
+/*****************************************************************************
+  Function name: build_aero_table()
+
+  Purpose      : Tabulate the terms of CalcAerodynamic() that do not depend on
+                 the wind speed, for each month and each type of potential
+                 evaporation of an HRU (the HRU's own vegetation last), so
+                 that full_energy() only has to scale them by the wind speed
+                 of the time step (see get_aero_terms()).  The inputs are
+                 those full_energy() used to compute every time step; they
+                 only change with the vegetation class and the month.
+
+                 Must be called once the vegetation parameters of all cells
+                 have been read, since reading them may change the
+                 vegetation library.
+
+  Returns      : void.  If CalcAerodynamic() fails for a month and PET type,
+                 the failure is recorded and reported by get_aero_terms().
+
+  Modifies     :
+    HRU &hru     - hru.aero_table
+*****************************************************************************/
+void build_aero_table(HRU& hru, const soil_con_struct* soil_con, const ProgramState* state)
+{
+  VegConditions displacement;
+  VegConditions ref_height;
+  VegConditions roughness;
+  VegConditions wind_speed;
+  aero_table_struct& table = hru.aero_table;
+
+  const int veg_class_index = hru.veg_con.vegIndex;
+  const double wind_h = state->veg_lib[veg_class_index].wind_h;
+
+  for (int month = 0; month < 12; month++) {
+    for (int p = 0; p < N_PET_TYPES + 1; p++) {
+      aero_terms_struct& terms = table.terms[month][p];
+
+      /* Set surface descriptive variables */
+      int pet_veg_class;
+      if (p < N_PET_TYPES_NON_NAT) {
+        pet_veg_class = state->veg_lib[0].NVegLibTypes + p;
+      } else {
+        pet_veg_class = veg_class_index;
+      }
+
+      if (pet_veg_class == state->options.GLACIER_ID)
+        roughness.snowFree = soil_con->GLAC_ROUGH;
+      else
+        roughness.snowFree = state->veg_lib[pet_veg_class].roughness[month];
+
+      displacement.snowFree = state->veg_lib[pet_veg_class].displacement[month];
+      char overstory = state->veg_lib[pet_veg_class].overstory;
+      if (p >= N_PET_TYPES_NON_NAT)
+        if (roughness.snowFree == 0)
+          roughness.snowFree = soil_con->rough;
+
+      /* Estimate vegetation height */
+      double height = calc_veg_height(displacement.snowFree, state->veg_lib[veg_class_index].LAI[month]);
+
+      /* Estimate reference height */
+      if (displacement.snowFree < wind_h)
+        ref_height.snowFree = wind_h;
+      else
+        ref_height.snowFree = displacement.snowFree + wind_h + roughness.snowFree;
+
+      /* Adjust magnitude of 'measured' windspeed from nominal surface height to reference height (based on wind height given in vegetation library) */
+      /* Assume an open-ground logarithmic wind profile */
+      double tmp_z0 = soil_con->rough;
+      double tmp_d = 0.;
+      double tmp_zref = state->global_param.wind_h;	//nominal surface height
+      terms.wind_corr = log((ref_height.snowFree - tmp_d)/tmp_z0)/log((tmp_zref - tmp_d)/tmp_z0);
+
+      /* Unit wind speed at the reference height */
+      wind_speed.snowFree = 1.;
+      wind_speed.canopyIfOverstory = INVALID;
+      wind_speed.snowCovered = INVALID;
+      wind_speed.glacierSurface = INVALID;
+      terms.aero_resist = VegConditions();
+
+      int ErrorFlag = CalcAerodynamic(overstory, height,
+          state->veg_lib[pet_veg_class].trunk_ratio, soil_con->snow_rough,
+          soil_con->rough, state->veg_lib[pet_veg_class].wind_atten,
+          terms.aero_resist, wind_speed, displacement, ref_height, roughness);
+      terms.error = (ErrorFlag == ERROR);
+      terms.wind_speed = wind_speed;
+
+      if (p == N_PET_TYPES) {
+        table.displacement[month] = displacement;
+        table.ref_height[month] = ref_height;
+        table.roughness[month] = roughness;
+        table.height[month] = height;
+      }
+    }
+  }
+}
+
+/*****************************************************************************
+  Function name: get_aero_terms()
+
+  Purpose      : Compute the aerodynamic resistances and wind speeds of a time
+                 step from an HRU's table of wind-independent terms (see
+                 build_aero_table()) and the measured wind speed, as
+                 CalcAerodynamic() scales its results for a unit wind speed.
+                 The results are the same as calling CalcAerodynamic() with
+                 the wind speed.
+
+  Required     :
+    const aero_table_struct &table - the HRU's table
+    int month                      - month of the time step (1-12)
+    double wind                    - measured wind speed (m/s)
+
+  Returns      : int - ERROR if CalcAerodynamic() failed for the month
+
+  Modifies     :
+    VegConditions *aero_resist     - per PET type, the HRU's own vegetation last
+    VegConditions &wind_speed, &displacement, &ref_height, &roughness, double *height
+                                   - of the HRU's own vegetation
+*****************************************************************************/
+int get_aero_terms(const aero_table_struct& table, int month, double wind,
+                   VegConditions* aero_resist, VegConditions& wind_speed,
+                   VegConditions& displacement, VegConditions& ref_height,
+                   VegConditions& roughness, double* height)
+{
+  for (int p = 0; p < N_PET_TYPES + 1; p++) {
+    const aero_terms_struct& terms = table.terms[month - 1][p];
+    if (terms.error) {
+      fprintf(stderr,"ERROR: get_aero_terms - the aerodynamic terms of month %d could not be computed (see the CalcAerodynamic error reported at initialization)\n", month);
+      return( ERROR );
+    }
+
+    double tmp_wind = wind * terms.wind_corr;
+    wind_speed = terms.wind_speed;
+    aero_resist[p] = terms.aero_resist;
+    if ( tmp_wind > 0. ) {
+      wind_speed.snowFree *= tmp_wind;
+      aero_resist[p].snowFree /= tmp_wind;
+      if(IS_VALID(wind_speed.canopyIfOverstory)) {
+        wind_speed.canopyIfOverstory *= tmp_wind;
+        aero_resist[p].canopyIfOverstory /= tmp_wind;
+      }
+      if(IS_VALID(wind_speed.snowCovered)) {
+        wind_speed.snowCovered *= tmp_wind;
+        aero_resist[p].snowCovered /= tmp_wind;
+      }
+      if(IS_VALID(wind_speed.glacierSurface)) {
+        wind_speed.glacierSurface *= tmp_wind;
+        aero_resist[p].glacierSurface /= tmp_wind;
+      }
+    }
+    else {
+      wind_speed.snowFree *= tmp_wind;
+      aero_resist[p].snowFree = HUGE_RESIST;
+      if(IS_VALID(wind_speed.canopyIfOverstory))
+        wind_speed.canopyIfOverstory *= tmp_wind;
+      aero_resist[p].canopyIfOverstory = HUGE_RESIST;
+      if(IS_VALID(wind_speed.snowCovered))
+        wind_speed.snowCovered *= tmp_wind;
+      aero_resist[p].snowCovered = HUGE_RESIST;
+      if(IS_VALID(wind_speed.glacierSurface))
+        wind_speed.glacierSurface *= tmp_wind;
+      aero_resist[p].glacierSurface = HUGE_RESIST;
+    }
+  }
+
+  displacement = table.displacement[month - 1];
+  ref_height = table.ref_height[month - 1];
+  roughness = table.roughness[month - 1];
+  *height = table.height[month - 1];
+  return (0);
+}
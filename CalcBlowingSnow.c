@@ -22,6 +22,9 @@
  *   2004-Oct-04 Merged with Laura Bowling's updated lake model code.		TJB
  *   2007-Apr-03 Module returns an ERROR value that can be trapped in main      GCT
  *   2011-Nov-04 Updated mtclim functions to MTCLIM 4.3.			TJB
+ *   2026-Oct-17 With BLOWING_TABLE, CalcSubFlux() interpolates the integrals
+ *	         over the suspension layer in a table (BlowingSnowTable.h)
+ *	         instead of integrating them for every wind increment.	AG
  */
 
 #include <stdarg.h>
@@ -29,6 +32,7 @@
 #include <stdlib.h>
 #include "vicNl.h"
 #include "mtclim_constants_vic.h"
+#include "BlowingSnowTable.h"
 
 static char vcid[] = "$Id$";
 
@@ -73,6 +77,7 @@ void shear_stress(double U10, double ZO,double *ushear, double *Zo_salt, double
 double CalcSubFlux(double EactAir, double es, double Zrh, double AirDens, double utshear, 
 		   double ushear, double fe, double Tsnow, double Tair, double U10, 
 		   double Zo_salt, double F, double *Transport);
+static void suspension_layer(double U10, double ushear, double *hsalt, double *ztop);
 
 /*****************************************************************************
   Function name: CalcBlowingSnow()
@@ -670,10 +675,13 @@ double CalcSubFlux(double EactAir, double es, double Zrh, double AirDens, double
   double SubFlux;
   double Qsalt, hsalt;
   double phi_s, psi_s;
-  double T, ztop;
+  double ztop;
   double particle;
   double saltation_transport;
   double suspension_transport;
+  SuspensionIntegrals integrals;
+  const bool tabulated = BlowingSnowTable::instance().isEnabled()
+    && BlowingSnowTable::instance().lookup(U10, ushear, &integrals);
 
   SubFlux=0.0;
   particle = utshear*2.8;
@@ -699,18 +707,11 @@ double CalcSubFlux(double EactAir, double es, double Zrh, double AirDens, double
     if(FETCH)
       Qsalt *= (1.+(500./(3.*fe))*(exp(-3.*fe/500.)-1.));
     
-    // Liston and Sturm (1998)
-    // hsalt = 1.6 * ushear * ushear / ( 2. * G_STD );
-	
-    // Pomeroy and Male (1992)
-    hsalt = 0.08436*pow(ushear,1.27);
+    suspension_layer(U10, ushear, &hsalt, &ztop);
 
     // Saltation layer mass concentration (kg/m3)
     phi_s = Qsalt / (hsalt * particle);
 
-    T = 0.5*(ushear*ushear)/(U10*SETTLING);
-    ztop = hsalt*pow(T/(T+1.), (von_K*ushear)/(-1.*SETTLING));
-
     if(EactAir >= es) {
       SubFlux = 0.0;
     }
@@ -724,16 +725,22 @@ double CalcSubFlux(double EactAir, double es, double Zrh, double AirDens, double
 	SubFlux = phi_s*psi_s*hsalt;
     
 	//  Suspension layer must be integrated
-	SubFlux += qromb(sub_with_height, es, U10, AirDens, Zo_salt, EactAir, F, hsalt,
-			 phi_s, ushear, Zrh, hsalt, ztop);
+	if(tabulated)
+	  SubFlux += ((EactAir/es) - 1.) / F * phi_s * integrals.sublimation;
+	else
+	  SubFlux += qromb(sub_with_height, es, U10, AirDens, Zo_salt, EactAir, F, hsalt,
+			   phi_s, ushear, Zrh, hsalt, ztop);
       }
 
     // Transport out of the domain by saltation Qs(fe) (kg/m*s), eq 10 Liston and Sturm
     saltation_transport = Qsalt*(1-exp(-3.*fe/500.));
 
     // Transport in the suspension layer
-    suspension_transport = qromb(transport_with_height, es, U10, AirDens, Zo_salt, 
-    				 EactAir, F, hsalt, phi_s, ushear, Zrh, hsalt, ztop);
+    if(tabulated)
+      suspension_transport = phi_s * integrals.concentration * (integrals.logHeight - log(Zo_salt));
+    else
+      suspension_transport = qromb(transport_with_height, es, U10, AirDens, Zo_salt, 
+    				   EactAir, F, hsalt, phi_s, ushear, Zrh, hsalt, ztop);
 
     // Transport at the downstream edge of the fetch in kg/m*s
     *Transport = (suspension_transport + saltation_transport);
@@ -744,6 +751,71 @@ double CalcSubFlux(double EactAir, double es, double Zrh, double AirDens, double
   return SubFlux;
 }
 
+/*****************************************************************************
+  Function name: suspension_layer()
+
+  Purpose      : Find the bottom (the top of the saltation layer) and the top
+                 of the suspension layer, between which CalcSubFlux()
+                 integrates.
+
+  Required     :
+    double U10             - 10 m wind speed (m/s)
+    double ushear          - shear velocity (m/s)
+
+  Modifies     :
+    double *hsalt          - Height of the saltation layer (m)
+    double *ztop           - Height of the top of the suspended snow (m)
+*****************************************************************************/
+static void suspension_layer(double U10, double ushear, double *hsalt, double *ztop)
+{
+  double T;
+
+  // Liston and Sturm (1998)
+  // hsalt = 1.6 * ushear * ushear / ( 2. * G_STD );
+
+  // Pomeroy and Male (1992)
+  *hsalt = 0.08436*pow(ushear,1.27);
+
+  T = 0.5*(ushear*ushear)/(U10*SETTLING);
+  *ztop = (*hsalt)*pow(T/(T+1.), (von_K*ushear)/(-1.*SETTLING));
+}
+
+/*****************************************************************************
+  Function name: suspension_integrals()
+
+  Purpose      : Integrate the sublimation and transport rates over the
+                 suspension layer for unit factors (see BlowingSnowTable.h),
+                 for the table of BLOWING_TABLE.
+
+  Required     :
+    double U10             - 10 m wind speed (m/s)
+    double ushear          - shear velocity (m/s)
+
+  Modifies     :
+    SuspensionIntegrals *integrals
+
+  Comments     : The transport rate is integrated for two roughnesses, 1 and
+                 1/e m, whose difference of ln(ZO) is 1.
+*****************************************************************************/
+void suspension_integrals(double U10, double ushear, SuspensionIntegrals *integrals)
+{
+  double hsalt, ztop;
+  double transport_1, transport_e;
+
+  suspension_layer(U10, ushear, &hsalt, &ztop);
+
+  // EactAir/es - 1 = 1, F = 1 and phi_r = 1
+  integrals->sublimation = qromb(sub_with_height, 1., U10, 0., 0., 2., 1., hsalt,
+				 1., ushear, 0., hsalt, ztop);
+
+  transport_1 = qromb(transport_with_height, 1., U10, 0., 1., 2., 1., hsalt,
+		      1., ushear, 0., hsalt, ztop);
+  transport_e = qromb(transport_with_height, 1., U10, 0., exp(-1.), 2., 1., hsalt,
+		      1., ushear, 0., hsalt, ztop);
+  integrals->concentration = transport_e - transport_1;
+  integrals->logHeight = transport_1 / integrals->concentration;
+}
+
 /*****************************************************************************
   Function name: transport_with_height()
 
@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "vicNl.h"
+#include "CellFileIndex.h"
+
+static char vcid[] = "$Id$";
+
+CellFileIndex* CellFileIndex::forVegparamFile(FILE* file, int linesPerTile) {
+  CellFileIndex* index = new CellFileIndex();
+  char str[500];
+  char ErrStr[MAXSTRING];
+  int vegcel, numHRUs;
+
+  rewind(file);
+  long offset = ftell(file);
+  while (fscanf(file, "%d %d", &vegcel, &numHRUs) == 2) {
+    if (numHRUs < 0) {
+      sprintf(ErrStr,"ERROR number of vegetation tiles (%i) given for cell %i is < 0.\n",numHRUs,vegcel);
+      nrerror(ErrStr);
+    }
+    index->offsets.insert(std::make_pair(vegcel, offset));
+    // The first fgets finishes the "gridcel Nveg" line
+    for (int i = 0; i <= numHRUs * linesPerTile; i++) {
+      if (fgets(str, 500, file) == NULL) {
+        sprintf(ErrStr,"ERROR unexpected EOF for cell %i while reading root zones and LAI\n",vegcel);
+        nrerror(ErrStr);
+      }
+    }
+    offset = ftell(file);
+  }
+  rewind(file);
+  return index;
+}
+
+CellFileIndex* CellFileIndex::forSnowbandFile(FILE* file) {
+  CellFileIndex* index = new CellFileIndex();
+  char str[MAXSTRING];
+  int cell;
+
+  rewind(file);
+  long offset = ftell(file);
+  while (fscanf(file, "%d", &cell) == 1) {
+    index->offsets.insert(std::make_pair(cell, offset));
+    if (fgets(str, MAXSTRING, file) == NULL) break;
+    offset = ftell(file);
+  }
+  rewind(file);
+  return index;
+}
+
+CellFileIndex* CellFileIndex::forLakeparamFile(FILE* file) {
+  CellFileIndex* index = new CellFileIndex();
+  char str[MAXSTRING];
+  int lakecel;
+
+  rewind(file);
+  long offset = ftell(file);
+  while (fscanf(file, "%d", &lakecel) == 1) {
+    index->offsets.insert(std::make_pair(lakecel, offset));
+    if (fgets(str, MAXSTRING, file) == NULL) break;  // grid cell number, etc.
+    if (fgets(str, MAXSTRING, file) == NULL) break;  // lake depth-area relationship
+    offset = ftell(file);
+  }
+  rewind(file);
+  return index;
+}
+
+CellFileIndex* CellFileIndex::forBinaryStateFile(FILE* file, long headerBytes) {
+  CellFileIndex* index = new CellFileIndex();
+  int cellInfo[4];  // gridcel, Nveg, Nband, NBytes
+
+  fseek(file, headerBytes, SEEK_SET);
+  long offset = ftell(file);
+  while (fread(cellInfo, sizeof(int), 4, file) == 4 && cellInfo[3] >= 0) {
+    index->offsets.insert(std::make_pair(cellInfo[0], offset));
+    if (fseek(file, cellInfo[3], SEEK_CUR) != 0) break;
+    offset = ftell(file);
+  }
+  rewind(file);
+  return index;
+}
+
+bool CellFileIndex::seekToCell(FILE* file, int gridcel) const {
+  std::map<int, long>::const_iterator it = offsets.find(gridcel);
+  if (it == offsets.end()) {
+    fseek(file, 0, SEEK_END);
+    return false;
+  }
+  fseek(file, it->second, SEEK_SET);
+  return true;
+}
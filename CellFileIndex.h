@@ -0,0 +1,36 @@
+#ifndef CELLFILEINDEX_H_
+#define CELLFILEINDEX_H_
+
+#include <stdio.h>
+#include <map>
+
+/*
+ * Maps grid cell numbers to the file offset of their record in a per-cell parameter file
+ * (vegetation parameters, snow bands, lake parameters, binary model state), so that the readers can seek straight to
+ * a cell instead of rewinding and scanning the file for every cell.  Each index is built with a
+ * single pass that skips records exactly the way the corresponding reader used to.  Where a cell
+ * number appears more than once, the first record wins, as it did with the rewind-and-scan readers.
+ */
+class CellFileIndex {
+public:
+  // Records are a "gridcel Nveg" line followed by Nveg * linesPerTile lines.
+  static CellFileIndex* forVegparamFile(FILE* file, int linesPerTile);
+  // Records are a single line beginning with gridcel.
+  static CellFileIndex* forSnowbandFile(FILE* file);
+  // Records are a line beginning with gridcel followed by the lake depth-area line.
+  static CellFileIndex* forLakeparamFile(FILE* file);
+  // Binary state file records (after a header of headerBytes): gridcel, Nveg, Nband and NBytes as ints,
+  // followed by NBytes bytes of state data.
+  static CellFileIndex* forBinaryStateFile(FILE* file, long headerBytes);
+
+  // Positions the file at the start of the cell's record and returns true, or at end of file (so
+  // that the next read sets feof) and returns false if the cell is not in the file.
+  bool seekToCell(FILE* file, int gridcel) const;
+  size_t size() const { return offsets.size(); }
+
+private:
+  CellFileIndex() {}
+  std::map<int, long> offsets;
+};
+
+#endif /* CELLFILEINDEX_H_ */
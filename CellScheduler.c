@@ -0,0 +1,100 @@
+#include "CellScheduler.h"
+
+#include <stdio.h>
+#include <omp.h>
+#include <algorithm>
+
+#include "vicNl.h"
+
+// Weight of the latest measurement in the predicted cost of a cell (costs change with the season, e.g. snow cover).
+static const double COST_SMOOTHING = 0.5;
+
+namespace {
+// Most expensive first; ties in cell order.
+struct ByDescendingCost {
+  const std::vector<double>& cost;
+  explicit ByDescendingCost(const std::vector<double>& cost) : cost(cost) {}
+  bool operator()(int a, int b) const {
+    return cost[a] > cost[b] || (cost[a] == cost[b] && a < b);
+  }
+};
+}
+
+CellScheduler::CellScheduler(const std::vector<cell_info_struct>& cells, int numThreads, int schedule)
+  : schedule(schedule), numThreads(std::max(numThreads, 1)), predictedCost(cells.size()), measured(cells.size(), FALSE),
+    cellOrder(cells.size()), threadTimes(this->numThreads), numBlocks(0), sumBusiestThread(0), sumBusyTime(0), sumLoopTime(0) {
+
+  for (unsigned int c = 0; c < cells.size(); c++) {
+    predictedCost[c] = cells[c].prcp.hruList.size();
+    cellOrder[c] = c;
+  }
+  if (schedule == CELL_SCHEDULE_COST) {
+    std::sort(cellOrder.begin(), cellOrder.end(), ByDescendingCost(predictedCost));
+  }
+  for (int t = 0; t < this->numThreads; t++) {
+    threadTimes[t].seconds = 0;
+  }
+
+  // The cell loop uses schedule(runtime)
+#if PARALLEL_AVAILABLE
+  if (schedule == CELL_SCHEDULE_COST) {
+    omp_set_schedule(omp_sched_dynamic, 1);
+  }
+  else {
+    omp_set_schedule(omp_sched_static, 0);
+  }
+#endif
+}
+
+void CellScheduler::recordCell(int cellIndex, double seconds) {
+  if (measured[cellIndex]) {
+    predictedCost[cellIndex] += COST_SMOOTHING * (seconds - predictedCost[cellIndex]);
+  }
+  else {
+    predictedCost[cellIndex] = seconds;
+    measured[cellIndex] = TRUE;
+  }
+#if PARALLEL_AVAILABLE
+  int thread = omp_get_thread_num();
+#else
+  int thread = 0;
+#endif
+  if (thread < numThreads) {
+    threadTimes[thread].seconds += seconds;
+  }
+}
+
+void CellScheduler::endBlock(double loopSeconds) {
+  double busiest = 0;
+  for (int t = 0; t < numThreads; t++) {
+    busiest = std::max(busiest, threadTimes[t].seconds);
+    sumBusyTime += threadTimes[t].seconds;
+    threadTimes[t].seconds = 0;
+  }
+  sumBusiestThread += busiest;
+  sumLoopTime += loopSeconds;
+  numBlocks++;
+
+  if (schedule == CELL_SCHEDULE_COST) {
+    std::sort(cellOrder.begin(), cellOrder.end(), ByDescendingCost(predictedCost));
+  }
+}
+
+void CellScheduler::printStatistics() const {
+  if (numBlocks == 0 || sumBusyTime <= 0) {
+    return;
+  }
+  // Spread of the predicted costs of the cells that are still running
+  double cheapest = 0, dearest = 0;
+  for (unsigned int c = 0; c < predictedCost.size(); c++) {
+    if (measured[c] && predictedCost[c] > 0) {
+      cheapest = (cheapest == 0) ? predictedCost[c] : std::min(cheapest, predictedCost[c]);
+      dearest = std::max(dearest, predictedCost[c]);
+    }
+  }
+  const double averageBusy = sumBusyTime / numThreads;
+  fprintf(stderr, "Cell scheduling (CELL_SCHEDULE %s, %d threads): load imbalance %.1f%% (busiest thread over the average thread, per block), "
+      "%.1f%% of the cell loop time spent computing cells; cell cost spread %.1fx (most over least expensive cell)\n",
+      schedule == CELL_SCHEDULE_COST ? "COST" : "STATIC", numThreads, 100 * (sumBusiestThread / averageBusy - 1),
+      sumLoopTime > 0 ? 100 * sumBusyTime / (numThreads * sumLoopTime) : 0.0, cheapest > 0 ? dearest / cheapest : 0.0);
+}
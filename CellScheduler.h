@@ -0,0 +1,56 @@
+#ifndef CELLSCHEDULER_H_
+#define CELLSCHEDULER_H_
+
+#include <vector>
+
+#include "vicNl_def.h"
+
+/*
+ * Decides the order in which the threads of the time loop pick up cells, and measures how evenly the work was
+ * shared among them.
+ *
+ * The cost of a cell varies a lot (a single-tile lowland cell versus a cell with glacier HRUs, snow bands, lakes
+ * and frozen soil), so with CELL_SCHEDULE COST the cells are handed out one at a time to whichever thread is free
+ * (OpenMP dynamic schedule), most expensive first. The predicted cost of a cell is a moving average of its measured
+ * wall time per block of time steps; before the first block has been measured, the number of HRUs is used. Cells
+ * do not interact within a block, so the order does not change the results. CELL_SCHEDULE STATIC keeps the cell
+ * order and OpenMP's static schedule, and is timed the same way for comparison.
+ *
+ * Usage per block: order() gives the cell to run at each iteration of the parallel loop, each thread calls
+ * recordCell() after running a cell, and endBlock() is called on the main thread after the loop.
+ */
+class CellScheduler {
+public:
+  CellScheduler(const std::vector<cell_info_struct>& cells, int numThreads, int schedule);
+
+  int getSchedule() const { return schedule; }
+  // Cell index to run at each iteration of the cell loop of the next block.
+  const std::vector<int>& order() const { return cellOrder; }
+  // Records the wall time a cell took in this block. Called by the thread that ran it.
+  void recordCell(int cellIndex, double seconds);
+  // Accumulates the load balance statistics of the block that just ended and orders the cells for the next one.
+  void endBlock(double loopSeconds);
+  void printStatistics() const;
+
+private:
+  // Per-thread busy time of the current block, padded so that the threads do not share a cache line.
+  struct ThreadTime {
+    double seconds;
+    char padding[64 - sizeof(double)];
+  };
+
+  int schedule;
+  int numThreads;
+  std::vector<double> predictedCost;   // seconds per block, or the number of HRUs before the first measurement
+  std::vector<char> measured;
+  std::vector<int> cellOrder;
+  std::vector<ThreadTime> threadTimes;
+
+  // Reported by printStatistics() when VERBOSE is TRUE.
+  int numBlocks;
+  double sumBusiestThread;   // per block, the busy time of the busiest thread
+  double sumBusyTime;        // per block, the busy time of all threads
+  double sumLoopTime;        // per block, the wall time of the cell loop
+};
+
+#endif /* CELLSCHEDULER_H_ */
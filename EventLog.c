@@ -0,0 +1,179 @@
+#include "EventLog.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <omp.h>
+#include <algorithm>
+
+#include "vicNl.h"
+
+static const char* EVENT_TYPE_NAMES[NUM_EVENT_TYPES] = { "TFALLBACK", "SOLVER_ERROR", "CELL_ERROR", "WARNING" };
+
+static thread_local EventLog::Context currentContext = { -1, -1 };
+
+namespace {
+// By time step, then by cell; events of the same cell and time step stay in the order they were reported.
+struct ByRecordAndCell {
+  bool operator()(const ModelEvent& a, const ModelEvent& b) const {
+    return a.rec < b.rec || (a.rec == b.rec && a.cell < b.cell);
+  }
+};
+}
+
+EventMessage::EventMessage() : buffer(NULL), size(0) {
+  file = open_memstream(&buffer, &size);
+}
+
+EventMessage::~EventMessage() {
+  if (file != NULL) {
+    fclose(file);
+  }
+  free(buffer);
+}
+
+std::string EventMessage::text() {
+  if (file == NULL) {
+    return std::string();
+  }
+  fflush(file);
+  return std::string(buffer, size);
+}
+
+EventLog& EventLog::instance() {
+  static EventLog log;
+  return log;
+}
+
+EventLog::EventLog() : log(stderr), counts(NUM_EVENT_TYPES, std::vector<long long>(NUM_SOLVERS + 1, 0)),
+    cells(NUM_EVENT_TYPES) {
+}
+
+void EventLog::open(const char* fileName, int numThreads) {
+  if (fileName != NULL && strcasecmp(fileName, "NONE") != 0) {
+    log = open_file(fileName, "w");
+  }
+  buffers.resize(std::max(numThreads, 1));
+}
+
+EventLog::Context EventLog::context() {
+  return currentContext;
+}
+
+void EventLog::setContext(int cell, int rec) {
+  currentContext.cell = cell;
+  currentContext.rec = rec;
+}
+
+void EventLog::setContext(const Context& context) {
+  currentContext = context;
+}
+
+void EventLog::report(int type, int solver, const std::string& message) {
+  ModelEvent event;
+  event.type = type;
+  event.solver = solver;
+  event.cell = currentContext.cell;
+  event.rec = currentContext.rec;
+  event.message = message;
+
+#if PARALLEL_AVAILABLE
+  const unsigned int thread = omp_get_thread_num();
+#else
+  const unsigned int thread = 0;
+#endif
+  if (thread < buffers.size()) {
+    buffers[thread].events.push_back(event);
+  }
+  else {
+    write(stderr, event);
+  }
+}
+
+void EventLog::write(FILE* out, const ModelEvent& event) const {
+  fprintf(out, "rec %d cell %d %s", event.rec, event.cell, EVENT_TYPE_NAMES[event.type]);
+  if (event.solver != NO_SOLVER) {
+    fprintf(out, " %s", SolverCounters::solverName(event.solver));
+  }
+  std::string message = event.message;
+  if (!message.empty() && message[message.size() - 1] == '\n') {
+    message.erase(message.size() - 1);
+  }
+  if (message.empty()) {
+    fprintf(out, "\n");
+  }
+  else if (message.find('\n') == std::string::npos) {
+    fprintf(out, ": %s\n", message.c_str());
+  }
+  else {
+    fprintf(out, ":\n%s\n", message.c_str());
+  }
+}
+
+void EventLog::drain() {
+  std::vector<ModelEvent> events;
+  for (unsigned int thread = 0; thread < buffers.size(); thread++) {
+    events.insert(events.end(), buffers[thread].events.begin(), buffers[thread].events.end());
+    buffers[thread].events.clear();
+  }
+  if (events.empty()) {
+    return;
+  }
+  std::stable_sort(events.begin(), events.end(), ByRecordAndCell());
+  for (std::vector<ModelEvent>::const_iterator event = events.begin(); event != events.end(); ++event) {
+    write(log, *event);
+    counts[event->type][event->solver == NO_SOLVER ? NUM_SOLVERS : event->solver]++;
+    cells[event->type].insert(event->cell);
+  }
+  fflush(log);
+}
+
+void EventLog::printSummary() const {
+  bool any = false;
+  for (int type = 0; type < NUM_EVENT_TYPES; type++) {
+    any = any || !cells[type].empty();
+  }
+  if (!any) {
+    return;
+  }
+  fprintf(stderr, "Model events%s:\n", log != stderr ? " (listed in the EVENT_LOG file)" : "");
+  for (int type = 0; type < NUM_EVENT_TYPES; type++) {
+    if (cells[type].empty()) {
+      continue;
+    }
+    long long total = 0;
+    for (int solver = 0; solver <= NUM_SOLVERS; solver++) {
+      total += counts[type][solver];
+    }
+    fprintf(stderr, "  %-12s %12lld in %d cells\n", EVENT_TYPE_NAMES[type], total, (int) cells[type].size());
+    for (int solver = 0; solver < NUM_SOLVERS; solver++) {
+      if (counts[type][solver] > 0) {
+        fprintf(stderr, "    %-22s %12lld\n", SolverCounters::solverName(solver), counts[type][solver]);
+      }
+    }
+  }
+}
+
+void EventLog::close() {
+  drain();
+  printSummary();
+  if (log != stderr) {
+    fclose(log);
+    log = stderr;
+  }
+  buffers.clear();
+}
+
+void EventLog::flushCallingThread() {
+#if PARALLEL_AVAILABLE
+  const unsigned int thread = omp_get_thread_num();
+#else
+  const unsigned int thread = 0;
+#endif
+  if (thread < buffers.size()) {
+    for (std::vector<ModelEvent>::const_iterator event = buffers[thread].events.begin(); event != buffers[thread].events.end(); ++event) {
+      write(stderr, *event);
+    }
+    buffers[thread].events.clear();
+  }
+}
@@ -0,0 +1,101 @@
+#ifndef EVENTLOG_H_
+#define EVENTLOG_H_
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <set>
+
+/*
+ * Events (temperature fallbacks, solver failures with their variable dumps, invalidated cells and warnings) that
+ * the threads of the cell loop report while running cells, instead of writing them to stderr themselves, which
+ * serialized the threads on the stdio lock and interleaved their messages.
+ *
+ * Each thread appends to its own buffer, without locking. Between blocks of time steps the main thread drains the
+ * buffers: it writes the events, ordered by time step and cell, to the EVENT_LOG file (or to stderr if there is
+ * none), and counts them per type and solver for the summary printed at the end of the run.
+ *
+ * The cell and time step of an event are those the reporting thread is working on (setContext()).
+ */
+enum EventType {
+  EVENT_TFALLBACK,       // a temperature solve failed and the previous temperature was used (TFALLBACK)
+  EVENT_SOLVER_ERROR,    // a solver failed; the message holds the dump of its variables
+  EVENT_CELL_ERROR,      // a cell was marked as invalid and is skipped from then on (CONTINUEONERROR)
+  EVENT_WARNING,
+  NUM_EVENT_TYPES
+};
+
+struct ModelEvent {
+  int type;              // EventType
+  int solver;            // SolverId, or NO_SOLVER
+  int cell;              // grid cell number, or -1
+  int rec;               // time step record, or -1
+  std::string message;
+};
+
+/*
+ * Builds the text of an event with fprintf(), e.g. a solver dump, in memory.
+ */
+class EventMessage {
+public:
+  EventMessage();
+  ~EventMessage();
+  FILE* stream() { return file; }
+  std::string text();
+
+private:
+  EventMessage(const EventMessage&);
+  EventMessage& operator=(const EventMessage&);
+
+  FILE* file;
+  char* buffer;
+  size_t size;
+};
+
+class EventLog {
+public:
+  static const int NO_SOLVER = -1;
+
+  struct Context {
+    int cell;
+    int rec;
+  };
+
+  static EventLog& instance();
+
+  // Opens the log file (NONE: the events are written to stderr) and sets up a buffer per thread. Events reported
+  // before, or by threads beyond numThreads, are written to stderr directly.
+  void open(const char* fileName, int numThreads);
+  // Appends an event to the calling thread's buffer, for the cell and time step of its context.
+  void report(int type, int solver, const std::string& message);
+  // Writes and counts the buffered events of all threads. Only called by the main thread, outside the cell loop.
+  void drain();
+  // Drains, prints the summary and closes the log file.
+  void close();
+  // Writes the calling thread's buffered events to stderr, before vicerror() exits from that thread.
+  void flushCallingThread();
+
+  // The cell and time step the calling thread is working on.
+  static Context context();
+  static void setContext(int cell, int rec);
+  static void setContext(const Context& context);
+
+private:
+  EventLog();
+  void write(FILE* out, const ModelEvent& event) const;
+  void printSummary() const;
+
+  // Padded so that the threads do not share a cache line.
+  struct ThreadBuffer {
+    std::vector<ModelEvent> events;
+    char padding[64 - sizeof(std::vector<ModelEvent>)];
+  };
+
+  FILE* log;
+  std::vector<ThreadBuffer> buffers;
+  // Counts of the drained events, per type and solver (the last column for NO_SOLVER), and the cells they occurred in.
+  std::vector<std::vector<long long> > counts;
+  std::vector<std::set<int> > cells;
+};
+
+#endif /* EVENTLOG_H_ */
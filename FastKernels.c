@@ -0,0 +1,248 @@
+#include "FastKernels.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <float.h>
+#include <algorithm>
+#include <chrono>
+
+#include "vicNl.h"
+
+// Range and spacing of the svp() table (C). 0C must be a table point.
+static const double SVP_TABLE_TMIN = -100.;
+static const double SVP_TABLE_TMAX = 60.;
+static const double SVP_TABLE_STEP = 0.25;
+
+// Largest relative errors that enable() accepts.
+static const double SVP_MAX_ERROR = 1e-7;
+static const double UNFROZEN_MAX_ERROR = 1e-10;
+
+namespace {
+
+// The svp() formula for either side of 0C, and its derivative with respect to temperature.
+double svpAndSlope(double temp, bool belowFreezing, double* slope) {
+  double value = 1000. * A_SVP * exp((B_SVP * temp) / (C_SVP + temp));
+  double dvalue = value * (B_SVP * C_SVP) / ((C_SVP + temp) * (C_SVP + temp));
+  if (belowFreezing) {
+    double factor = 1.0 + .00972 * temp + .000042 * temp * temp;
+    double dfactor = .00972 + 2 * .000042 * temp;
+    dvalue = dvalue * factor + value * dfactor;
+    value *= factor;
+  }
+  *slope = dvalue;
+  return value;
+}
+
+inline uint64_t bitsOf(double x) {
+  uint64_t bits;
+  memcpy(&bits, &x, sizeof(bits));
+  return bits;
+}
+
+inline double doubleOf(uint64_t bits) {
+  double x;
+  memcpy(&x, &bits, sizeof(x));
+  return x;
+}
+
+/*
+ * Natural logarithm of a normal positive x.  x = m * 2^k with m in [sqrt(1/2), sqrt(2)), and
+ * log(m) = 2 atanh(s), s = (m - 1) / (m + 1), |s| < 0.1716, from its series up to s^17 (relative error < 1e-15).
+ * Branch-free and without calls, so that loops over it can be vectorized.
+ */
+inline double fastLog(double x) {
+  const uint64_t SQRT_HALF = 0x3fe6a09e667f3bcdULL;   // bits of sqrt(1/2)
+  const double LN2 = 0.6931471805599453;
+  // Shifting the bits by 1 - sqrt(1/2) in the mantissa moves the exponent up by one where m >= sqrt(2)
+  uint64_t bits = bitsOf(x) + (0x3ff0000000000000ULL - SQRT_HALF);
+  // The exponent as a double: the low bits of 2^52 + biased exponent
+  double k = doubleOf(0x4330000000000000ULL | (bits >> 52)) - (4503599627370496.0 + 1023.);
+  double m = doubleOf((bits & 0x000fffffffffffffULL) + SQRT_HALF);
+  double s = (m - 1.) / (m + 1.);
+  double s2 = s * s;
+  double series = 1. + s2 * (1. / 3 + s2 * (1. / 5 + s2 * (1. / 7 + s2 * (1. / 9 + s2 * (1. / 11 + s2 * (1. / 13
+      + s2 * (1. / 15 + s2 * (1. / 17))))))));
+  return k * LN2 + 2. * s * series;
+}
+
+/*
+ * e^y for y in [-700, 700].  y = n ln2 + r with |r| <= ln2 / 2, e^r from its Taylor series up to r^13 (relative
+ * error < 1e-15), times 2^n built from its bits.  Branch-free, as fastLog().
+ */
+inline double fastExp(double y) {
+  const double LOG2E = 1.4426950408889634;
+  const double LN2_HI = 6.93147180369123816490e-01;
+  const double LN2_LO = 1.90821492927058770002e-10;
+  const double ROUND = 6755399441055744.0;   // 1.5 * 2^52: adding it rounds to an integer held in the low bits
+  double shifted = y * LOG2E + ROUND;
+  double n = shifted - ROUND;
+  double r = (y - n * LN2_HI) - n * LN2_LO;
+  double p = 1. + r * (1. + r * (1. / 2 + r * (1. / 6 + r * (1. / 24 + r * (1. / 120 + r * (1. / 720
+      + r * (1. / 5040 + r * (1. / 40320 + r * (1. / 362880 + r * (1. / 3628800 + r * (1. / 39916800
+      + r * (1. / 479001600 + r * (1. / 6227020800.)))))))))))));
+  uint64_t exponent = (bitsOf(shifted) - bitsOf(ROUND) + 1023) << 52;
+  return p * doubleOf(exponent);
+}
+
+}
+
+FastKernels& FastKernels::instance() {
+  static FastKernels kernels;
+  return kernels;
+}
+
+FastKernels::FastKernels() : enabled(false) {
+}
+
+void FastKernels::enable() {
+  buildSvpTable();
+  checkAndTime();
+  enabled = true;
+}
+
+void FastKernels::buildSvpTable() {
+  const int numIntervals = (int) ((SVP_TABLE_TMAX - SVP_TABLE_TMIN) / SVP_TABLE_STEP + 0.5);
+  svpCoefficients.resize(4 * numIntervals);
+  for (int i = 0; i < numIntervals; i++) {
+    const double t0 = SVP_TABLE_TMIN + i * SVP_TABLE_STEP;
+    const double t1 = t0 + SVP_TABLE_STEP;
+    // Both ends of an interval use the formula of its interior
+    const bool belowFreezing = t0 < 0;
+    double d0, d1;
+    const double f0 = svpAndSlope(t0, belowFreezing, &d0);
+    const double f1 = svpAndSlope(t1, belowFreezing, &d1);
+    d0 *= SVP_TABLE_STEP;
+    d1 *= SVP_TABLE_STEP;
+    double* c = &svpCoefficients[4 * i];
+    c[0] = f0;
+    c[1] = d0;
+    c[2] = 3 * (f1 - f0) - 2 * d0 - d1;
+    c[3] = 2 * (f0 - f1) + d0 + d1;
+  }
+}
+
+double FastKernels::svp(double temp) const {
+  if (temp >= SVP_TABLE_TMIN && temp < SVP_TABLE_TMAX) {
+    const double x = (temp - SVP_TABLE_TMIN) * (1. / SVP_TABLE_STEP);
+    const int i = (int) x;
+    const double t = x - i;
+    const double* c = &svpCoefficients[4 * i];
+    return c[0] + t * (c[1] + t * (c[2] + t * c[3]));
+  }
+  return svp_exact(temp);
+}
+
+void FastKernels::unfrozenWater(int n, const double* T, const double* max_moist, const double* bubble,
+    const double* expt, double* unfrozen) {
+  // unfrozen = max_moist * x^e for T < 0, limited to [0, max_moist], as in maximum_unfrozen_water()
+#pragma omp simd
+  for (int i = 0; i < n; i++) {
+    const double maxMoist = max_moist[i];
+    double x = (-Lf * T[i]) / 273.16 / (9.81 * bubble[i] / 100.);
+    double e = -(2.0 / (expt[i] - 3.0));
+    // Evaluated for every node and then selected, rather than clamping the arguments, which the compiler would
+    // turn into branches.  Outside the ranges of fastLog() and fastExp() the power is either far beyond max_moist
+    // (x < DBL_MIN, including T >= 0, or y > 700, as e < 0) or far below any soil moisture (y < -700).
+    double y = e * fastLog(x);
+    double value = maxMoist * fastExp(y);
+    value = value > maxMoist ? maxMoist : value;
+    value = value < 0. ? 0. : value;
+    value = y < -700. ? 0. : value;
+    value = y > 700. ? maxMoist : value;
+    unfrozen[i] = x < DBL_MIN ? maxMoist : value;
+  }
+}
+
+/*
+ * Compares the kernels with the exact formulas over the range of temperatures and soil parameters they are used
+ * for, and times both.
+ */
+void FastKernels::checkAndTime() {
+  typedef std::chrono::steady_clock Clock;
+
+  // svp(): every 0.001C across the table, and just below and above 0C
+  std::vector<double> temps;
+  for (double temp = SVP_TABLE_TMIN; temp < SVP_TABLE_TMAX; temp += 0.001) {
+    temps.push_back(temp);
+  }
+  temps.push_back(-1e-9);
+  temps.push_back(0.);
+  temps.push_back(1e-9);
+  double svpError = 0;
+  for (unsigned int i = 0; i < temps.size(); i++) {
+    const double exact = svp_exact(temps[i]);
+    svpError = std::max(svpError, fabs(svp(temps[i]) - exact) / exact);
+  }
+
+  // Unfrozen water: temperatures from -1e-6C to -60C, across the range of bubbling pressures and pore size
+  // distribution exponents of the soil parameter files
+  const double bubbles[] = { 2., 5., 10., 20., 40., 80., 150. };
+  const double expts[] = { 3.2, 4., 6., 9., 13., 20., 30. };
+  const int numBubbles = sizeof(bubbles) / sizeof(bubbles[0]);
+  const int numExpts = sizeof(expts) / sizeof(expts[0]);
+  const int numTemps = 1000;
+  const int numNodes = numTemps * numBubbles * numExpts;
+  std::vector<double> nodeT(numNodes), nodeMaxMoist(numNodes, 0.4), nodeBubble(numNodes), nodeExpt(numNodes);
+  std::vector<double> fast(numNodes), exact(numNodes);
+  int node = 0;
+  for (int b = 0; b < numBubbles; b++) {
+    for (int e = 0; e < numExpts; e++) {
+      for (int t = 0; t < numTemps; t++, node++) {
+        nodeT[node] = -1e-6 * pow(6e7, (double) t / (numTemps - 1));
+        nodeBubble[node] = bubbles[b];
+        nodeExpt[node] = expts[e];
+      }
+    }
+  }
+  unfrozenWater(numNodes, &nodeT[0], &nodeMaxMoist[0], &nodeBubble[0], &nodeExpt[0], &fast[0]);
+  double unfrozenError = 0;
+  for (int i = 0; i < numNodes; i++) {
+    exact[i] = maximum_unfrozen_water_exact(nodeT[i], nodeMaxMoist[i], nodeBubble[i], nodeExpt[i]);
+    if (exact[i] > 0) {
+      unfrozenError = std::max(unfrozenError, fabs(fast[i] - exact[i]) / exact[i]);
+    }
+    else if (fast[i] != 0) {
+      unfrozenError = std::max(unfrozenError, 1.);
+    }
+  }
+
+  if (!(svpError <= SVP_MAX_ERROR) || !(unfrozenError <= UNFROZEN_MAX_ERROR)) {
+    char ErrStr[MAXSTRING];
+    sprintf(ErrStr, "ERROR: FAST_KERNELS: the relative error of the tabulated svp (%g, at most %g allowed) or of the "
+        "vectorized unfrozen water content (%g, at most %g allowed) is too large; set FAST_KERNELS to FALSE.\n",
+        svpError, SVP_MAX_ERROR, unfrozenError, UNFROZEN_MAX_ERROR);
+    nrerror(ErrStr);
+  }
+
+#if VERBOSE
+  // Throughput, in millions of evaluations per second
+  const int repeats = 10;
+  double sum = 0;
+  Clock::time_point start = Clock::now();
+  for (int r = 0; r < repeats; r++)
+    for (unsigned int i = 0; i < temps.size(); i++)
+      sum += svp_exact(temps[i]);
+  const double svpExactRate = repeats * temps.size() / std::chrono::duration<double>(Clock::now() - start).count() / 1e6;
+  start = Clock::now();
+  for (int r = 0; r < repeats; r++)
+    for (unsigned int i = 0; i < temps.size(); i++)
+      sum += svp(temps[i]);
+  const double svpFastRate = repeats * temps.size() / std::chrono::duration<double>(Clock::now() - start).count() / 1e6;
+  start = Clock::now();
+  for (int r = 0; r < repeats; r++)
+    for (int i = 0; i < numNodes; i++)
+      exact[i] = maximum_unfrozen_water_exact(nodeT[i], nodeMaxMoist[i], nodeBubble[i], nodeExpt[i]);
+  const double unfrozenExactRate = repeats * numNodes / std::chrono::duration<double>(Clock::now() - start).count() / 1e6;
+  start = Clock::now();
+  for (int r = 0; r < repeats; r++)
+    unfrozenWater(numNodes, &nodeT[0], &nodeMaxMoist[0], &nodeBubble[0], &nodeExpt[0], &fast[0]);
+  const double unfrozenFastRate = repeats * numNodes / std::chrono::duration<double>(Clock::now() - start).count() / 1e6;
+
+  fprintf(stderr, "FAST_KERNELS: tabulated svp: max relative error %.2g, %.1f million evaluations per second (exact: %.1f); "
+      "vectorized unfrozen water: max relative error %.2g, %.1f million nodes per second (exact: %.1f)\n",
+      svpError, svpFastRate, svpExactRate, unfrozenError, unfrozenFastRate, unfrozenExactRate);
+  volatile double sink = sum;   // keeps the timed svp loops from being optimized away
+  (void) sink;
+#endif
+}
@@ -0,0 +1,44 @@
+#ifndef FASTKERNELS_H_
+#define FASTKERNELS_H_
+
+#include <vector>
+
+/*
+ * Faster evaluations of the saturated vapour pressure, svp(), and of the maximum unfrozen water content,
+ * maximum_unfrozen_water(), which are evaluated inside the residuals of the energy balance solvers and of the soil
+ * temperature solvers, for the FAST_KERNELS global parameter:
+ *
+ * - svp() is interpolated in a table of cubic Hermite polynomials, built from the exact formula and its derivative
+ *   at every SVP_TABLE_STEP degrees between SVP_TABLE_TMIN and SVP_TABLE_TMAX (0C being a table point, where the
+ *   formula changes).  Outside that range the exact formula is used.
+ * - unfrozenWater() evaluates the unfrozen water content of a set of soil nodes in one branch-free loop, with
+ *   polynomial log and exp approximations in place of pow(), which the compiler can vectorize (SIMD) when
+ *   optimizing.  maximum_unfrozen_water() uses it for a single node.
+ *
+ * enable() checks both against the exact formulas, stops the run if the relative error exceeds SVP_MAX_ERROR or
+ * UNFROZEN_MAX_ERROR, and with VERBOSE reports the errors and the throughput of the fast and exact versions.
+ * The kernels are disabled by default, in which case the exact formulas are used.
+ */
+class FastKernels {
+public:
+  static FastKernels& instance();
+  // Builds the svp table and checks and times the kernels. Called once, before the cells are run.
+  void enable();
+  bool isEnabled() const { return enabled; }
+
+  // Tabulated svp() (Pa).
+  double svp(double temp) const;
+  // Maximum unfrozen water content of n soil nodes, as maximum_unfrozen_water() does for each node.
+  static void unfrozenWater(int n, const double* T, const double* max_moist, const double* bubble,
+      const double* expt, double* unfrozen);
+
+private:
+  FastKernels();
+  void buildSvpTable();
+  void checkAndTime();
+
+  bool enabled;
+  std::vector<double> svpCoefficients;   // 4 per table interval, for t = 0..1 across the interval
+};
+
+#endif /* FASTKERNELS_H_ */
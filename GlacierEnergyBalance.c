@@ -91,3 +91,6 @@ double GlacierEnergyBalance::calculate(double TSurf) {
 
   return RestTerm;
 }
+
+// The root search of this solver, compiled here so that calculate() can be inlined into it
+template class RootBrent<GlacierEnergyBalance>;
@@ -4,7 +4,7 @@
 #include "root_brent.h"
 #include "vicNl.h"
 
-class GlacierEnergyBalance : public RootBrent {
+class GlacierEnergyBalance : public RootBrent<GlacierEnergyBalance> {
 public:
   GlacierEnergyBalance(
   double Dt,                      /* Model time step (sec) */
@@ -51,6 +51,8 @@ public:
        {}
 
   double calculate(double);
+
+  SolverId solver() const { return SOLVER_GLACIER_ENERGY_BALANCE; }
 private:
   double Dt;                      /* Model time step (sec) */
   double Ra;                      /* Aerodynamic resistance (s/m) */
@@ -86,5 +88,8 @@ private:
   double *vapor_flux;             /* Mass flux of water vapor to or from the intercepted snow (m/timestep) */
 };
 
+// Instantiated in GlacierEnergyBalance.c
+extern template class RootBrent<GlacierEnergyBalance>;
+
 
 #endif /* GLACIERENERGYBALANCE_H_ */
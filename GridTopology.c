@@ -0,0 +1,105 @@
+#include "GridTopology.h"
+
+#include <math.h>
+#include <algorithm>
+#include <sstream>
+
+#include "vicNl.h"
+
+const double GridTopology::GRID_COORDINATE_TOLERANCE = 1e-6;
+const double GridTopology::GRID_OFFSET_TOLERANCE = 0.1;
+
+// Largest number of rows or columns of a grid, beyond which the cells are taken to be irregularly spaced
+static const double MAX_GRID_DIVISIONS = 1e7;
+
+GridTopology::GridTopology() {
+}
+
+int GridTopology::Axis::toIndex(double coordinate) const {
+  if (step == 0) {
+    return 0;
+  }
+  return (int) lround((coordinate - start) / step);
+}
+
+void GridTopology::Axis::build(const std::vector<double>& coordinates, const char* name) {
+  std::vector<double> sorted(coordinates);
+  std::sort(sorted.begin(), sorted.end());
+
+  // The distinct coordinates, each standing for those within GRID_COORDINATE_TOLERANCE above it
+  std::vector<double> distinct;
+  for (unsigned int i = 0; i < sorted.size(); i++) {
+    if (distinct.empty() || sorted[i] - distinct.back() > GRID_COORDINATE_TOLERANCE) {
+      distinct.push_back(sorted[i]);
+    }
+  }
+
+  start = distinct.front();
+  step = 0;
+  count = 1;
+  if (distinct.size() == 1) {
+    return;
+  }
+
+  const double extent = distinct.back() - distinct.front();
+  double smallest = extent;
+  for (unsigned int i = 1; i < distinct.size(); i++) {
+    smallest = std::min(smallest, distinct[i] - distinct[i - 1]);
+  }
+  if (extent / smallest > MAX_GRID_DIVISIONS) {
+    std::stringstream s;
+    s << "Error: the cell " << name << "s are not on a regular grid: a step of " << smallest << " over " << extent
+        << " degrees would make " << extent / smallest << " grid divisions.";
+    throw VICException(s.str());
+  }
+  // A whole number of steps from the first to the last coordinate
+  count = (int) lround(extent / smallest) + 1;
+  step = extent / (count - 1);
+
+  for (unsigned int i = 0; i < distinct.size(); i++) {
+    const double offset = (distinct[i] - start) / step;
+    if (fabs(offset - lround(offset)) > GRID_OFFSET_TOLERANCE) {
+      std::stringstream s;
+      s << "Error: the cell " << name << " " << distinct[i] << " is not on the regular grid starting at " << start
+          << " with a step of " << step << " degrees.";
+      throw VICException(s.str());
+    }
+  }
+}
+
+void GridTopology::build(const std::vector<double>& lats, const std::vector<double>& lons) {
+  if (lats.empty()) {
+    throw VICException("Error: cannot run the model with no cells! Make sure that some cells are enabled.");
+  }
+  latAxis.build(lats, "latitude");
+  lonAxis.build(lons, "longitude");
+
+  cellFlatIndices.resize(lats.size());
+  mask.assign(numPoints(), false);
+  for (unsigned int cellIndex = 0; cellIndex < lats.size(); cellIndex++) {
+    const size_t flat = (size_t) latitudeToIndex(lats[cellIndex]) * lonAxis.count + longitudeToIndex(lons[cellIndex]);
+    if (mask[flat]) {
+      std::stringstream s;
+      s << "Error: more than one cell is at the grid point of latitude " << lats[cellIndex] << ", longitude "
+          << lons[cellIndex] << ".";
+      throw VICException(s.str());
+    }
+    mask[flat] = true;
+    cellFlatIndices[cellIndex] = flat;
+  }
+
+  landPoints = cellFlatIndices;
+  std::sort(landPoints.begin(), landPoints.end());
+  cellGatheredIndices.resize(lats.size());
+  for (unsigned int cellIndex = 0; cellIndex < lats.size(); cellIndex++) {
+    cellGatheredIndices[cellIndex] = gatheredIndexOfPoint(cellFlatIndices[cellIndex]);
+  }
+}
+
+int GridTopology::gatheredIndexOfPoint(size_t flat) const {
+  std::vector<size_t>::const_iterator point = std::lower_bound(landPoints.begin(), landPoints.end(), flat);
+  if (point == landPoints.end() || *point != flat) {
+    return -1;
+  }
+  return point - landPoints.begin();
+}
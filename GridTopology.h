@@ -0,0 +1,80 @@
+#ifndef GRIDTOPOLOGY_H_
+#define GRIDTOPOLOGY_H_
+
+#include <stddef.h>
+#include <vector>
+
+/*
+ * The regular latitude/longitude grid spanning the modeled cells, on which the NetCDF output and state files are
+ * written, and the position of every modeled cell on it.
+ *
+ * The grid is found once at startup, in O(n log n): the distinct latitudes (and longitudes) of the cells are sorted,
+ * and the step is the smallest difference between neighbouring ones, adjusted so that a whole number of steps spans
+ * the grid. Each cell is then given integer row and column indices by rounding, not truncating, its offset from the
+ * start of the grid in steps, so the indices do not depend on the last digits of the coordinates in the soil file.
+ * A cell that is not on the grid (off by more than GRID_OFFSET_TOLERANCE steps), or that shares its grid point with
+ * another cell, is an error.
+ */
+class GridTopology {
+public:
+  // Coordinates closer than this (degrees) are the same row or column of the grid.
+  static const double GRID_COORDINATE_TOLERANCE;
+  // Largest distance of a cell from its grid point, as a fraction of the grid step.
+  static const double GRID_OFFSET_TOLERANCE;
+
+  GridTopology();
+  // Finds the grid of the cells at the given coordinates (one per cell, in cell order). Throws a VICException if
+  // there are no cells or they are not on a regular grid.
+  void build(const std::vector<double>& lats, const std::vector<double>& lons);
+
+  int numLat() const { return latAxis.count; }
+  int numLon() const { return lonAxis.count; }
+  size_t numPoints() const { return (size_t) latAxis.count * lonAxis.count; }
+  double startLat() const { return latAxis.start; }
+  double startLon() const { return lonAxis.start; }
+  double stepLat() const { return latAxis.step; }
+  double stepLon() const { return lonAxis.step; }
+  double endLat() const { return latitude(latAxis.count - 1); }
+  double endLon() const { return longitude(lonAxis.count - 1); }
+  // Coordinates of the rows and columns of the grid
+  double latitude(int row) const { return latAxis.start + row * latAxis.step; }
+  double longitude(int column) const { return lonAxis.start + column * lonAxis.step; }
+
+  // Nearest row (column) of the grid to a coordinate
+  int latitudeToIndex(double lat) const { return latAxis.toIndex(lat); }
+  int longitudeToIndex(double lon) const { return lonAxis.toIndex(lon); }
+
+  // Position of a cell (by its index in the cell list) on the grid, flattened row by row (latitude-major)
+  size_t flatIndex(int cellIndex) const { return cellFlatIndices[cellIndex]; }
+  const std::vector<size_t>& flatIndices() const { return cellFlatIndices; }
+  // Whether each grid point (by flat index) is a modeled cell
+  const std::vector<bool>& modeledMask() const { return mask; }
+
+  // The modeled grid points in mask order (by flat index): the land cells of a gathered (OUTPUT_LAYOUT GATHERED)
+  // file, whose "landcell" index variable holds these flat indices.
+  const std::vector<size_t>& gatheredPoints() const { return landPoints; }
+  // Position of a cell (by its index in the cell list) among the gathered points
+  size_t gatheredIndex(int cellIndex) const { return cellGatheredIndices[cellIndex]; }
+  const std::vector<size_t>& gatheredIndices() const { return cellGatheredIndices; }
+  // Position of a grid point (by flat index) among the gathered points, or -1 if it is not a modeled cell
+  int gatheredIndexOfPoint(size_t flat) const;
+
+private:
+  struct Axis {
+    double start;
+    double step;     // 0 if the grid has a single row (column)
+    int count;
+    Axis() : start(0), step(0), count(0) {}
+    int toIndex(double coordinate) const;
+    void build(const std::vector<double>& coordinates, const char* name);
+  };
+
+  Axis latAxis;
+  Axis lonAxis;
+  std::vector<size_t> cellFlatIndices;
+  std::vector<bool> mask;
+  std::vector<size_t> landPoints;
+  std::vector<size_t> cellGatheredIndices;
+};
+
+#endif /* GRIDTOPOLOGY_H_ */
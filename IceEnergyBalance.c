@@ -173,3 +173,6 @@ double IceEnergyBalance::calculate(double TSurf)
   
   return RestTerm;
 }
+
+// The root search of this solver, compiled here so that calculate() can be inlined into it
+template class RootBrent<IceEnergyBalance>;
@@ -3,7 +3,7 @@
 #ifndef ICEENERGYBALANCE_H_
 #define ICEENERGYBALANCE_H_
 
-class IceEnergyBalance : public RootBrent {
+class IceEnergyBalance : public RootBrent<IceEnergyBalance> {
 public:
   IceEnergyBalance( double Dt,                  /* Model time step (hours) */
                     double Ra,                  /* Aerodynamic resistance (s/m) */
@@ -50,6 +50,8 @@ public:
       SensibleHeat(SensibleHeat), LongRadOut(LongRadOut) {}
 
   double calculate(double);
+
+  SolverId solver() const { return SOLVER_ICE_ENERGY_BALANCE; }
 private:
   double Dt;
   double Ra;
@@ -89,6 +91,9 @@ private:
   double* LongRadOut;
 };
 
+// Instantiated in IceEnergyBalance.c
+extern template class RootBrent<IceEnergyBalance>;
+
 #endif /* ICEENERGYBALANCE_H_ */
 
 
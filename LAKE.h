@@ -108,7 +108,7 @@ int lakeice(double *, double, double, double, double, int,
 void latsens(double,double, double, double, double, double, double, double,
 	     double *, double *, double);
 float lkdrag(float, double, double, double, double);
-lake_con_struct read_lakeparam(FILE *, soil_con_struct, std::vector<HRU>&, const ProgramState*);
+lake_con_struct read_lakeparam(FILE *, const CellFileIndex *, soil_con_struct, std::vector<HRU>&, const ProgramState*);
 void rescale_soil_veg_fluxes(double, double, hru_data_struct *, veg_var_struct *, const ProgramState*);
 void rescale_snow_energy_fluxes(double, double, snow_data_struct *, energy_bal_struct *);
 void rescale_snow_storage(double, double, snow_data_struct *);
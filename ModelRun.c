@@ -0,0 +1,1004 @@
+#include "ModelRun.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vicNl.h"
+#include "global.h"
+#include "StateIOContext.h"
+#include "BlowingSnowTable.h"
+#include "FastKernels.h"
+#include <assert.h>
+#include <omp.h>
+#include <unistd.h>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <exception>
+
+#include <chrono>
+#include <ctime>
+
+#include "OutputData.h"
+#include "OutputAccumulator.h"
+#include "ReadForcingNetCDF.h"
+#include "AtmosStream.h"
+#include "CellScheduler.h"
+#include "RadiationGeometryCache.h"
+#include "CellFileIndex.h"
+#include "WriteOutputAscii.h"
+#include "WriteOutputBinary.h"
+#include "WriteOutputNetCDF.h"
+#include "WriteOutputAsync.h"
+#include "EventLog.h"
+#include "BinaryForcing.h"
+
+void readSoilData(std::vector<cell_info_struct>& cell_data_structs,
+    filep_struct filep, filenames_struct filenames,
+    dmy_struct* dmy, ProgramState& state);
+
+int initializeCell(cell_info_struct& cell,
+    filep_struct filep, dmy_struct* dmy, filenames_struct filenames,
+    const ProgramState* state);
+
+// Is the date of a time step before the given day?
+static bool isBeforeDay(const dmy_struct& date, const dmy_struct& day) {
+  if (date.year != day.year) return date.year < day.year;
+  if (date.month != day.month) return date.month < day.month;
+  return date.day < day.day;
+}
+
+ModelRun::ModelRun(int argc, char* argv[])
+  : dmy(NULL), out_data_list(NULL), out_data_files(NULL), atmosStream(NULL), scheduler(NULL), nextRec(0),
+    finished(false), elapsedRun(0) {
+
+  /** Read Model Options **/
+  state.initialize_global();
+
+  cmd_proc(argc, argv, filenames.global, &state);
+
+#if VERBOSE
+  state.display_current_settings(DISP_VERSION, (filenames_struct*) NULL);
+#endif
+  /* Build input forcing variable name mappings */
+  state.build_forcing_variable_mapping();
+  /* Build default output variable name mappings */
+  state.build_output_variable_mapping();
+  /** Read Global Control File **/
+  state.init_global_param(&filenames, filenames.global);
+  if (state.options.FAST_KERNELS) {
+    FastKernels::instance().enable();
+  }
+  if (state.options.BLOWING && state.options.BLOWING_TABLE) {
+    BlowingSnowTable::instance().enable(filenames.blowing_table);
+  }
+  /** Set up output data structures **/
+  out_data_list = create_output_list(&state);
+  out_data_files = set_output_defaults(out_data_list, &state);
+  parse_output_info(filenames.global, out_data_files, out_data_list, &state);
+
+  /** Check and Open Files **/
+  filep = get_files(&filenames, &state);
+
+  if (!state.options.OUTPUT_FORCE) {
+#if LINK_DEBUG
+  state.open_debug();
+#endif
+  /** Read Vegetation Library File **/
+  state.veg_lib = read_veglib(filep.veglib, &state.num_veg_types, state.options.LAI_SRC);
+  }
+
+  /** Make Date Data Structure **/
+  dmy = make_dmy(&state.global_param, &state);
+
+  /** Simulation time step interval (the output intervals are in the output streams) **/
+  state.dt_sec = state.global_param.dt*SECPHOUR;
+
+  /** Initialize state **/
+  readSoilData(cell_data_structs, filep, filenames, dmy, state); // Read soil file and add elements to cell_data_structs
+  state.initGrid(cell_data_structs); // Calculate the grid cell parameters and the grid point of each cell. This is used for NetCDF outputs.
+  initializeNetCDFOutput(&filenames, out_data_files, out_data_list, &state); // Create and initialize a NetCDF output file
+
+  if (!state.options.OUTPUT_FORCE) {
+    /** Read Grid Cell Vegetation Parameters **/
+    for (unsigned int cellidx = 0; cellidx < cell_data_structs.size(); cellidx++) {
+      int numHRUs = read_vegparam(filep.vegparam, filep.vegparam_index, cell_data_structs[cellidx], &state);
+      if (numHRUs > state.max_num_HRUs) {
+        state.update_max_num_HRUs(numHRUs);
+      }
+    }
+    /** Tabulate the aerodynamic terms of each HRU, once the vegetation parameters of every cell (which may change
+        the vegetation library) have been read **/
+    for (unsigned int cellidx = 0; cellidx < cell_data_structs.size(); cellidx++) {
+      cell_info_struct& cell = cell_data_structs[cellidx];
+      for (std::vector<HRU>::iterator hru = cell.prcp.hruList.begin(); hru != cell.prcp.hruList.end(); ++hru) {
+        build_aero_table(*hru, &cell.soil_con, &state);
+      }
+    }
+    // Initialize state input/output if necessary.
+    if (state.options.INIT_STATE)
+      check_state_file(filenames.init_state, &state);
+    /** open state file if model state is to be saved **/
+    if (state.options.SAVE_STATE && strcmp(filenames.statefile, "NONE") != 0) {
+      StateIOContext context(filenames.statefile, StateIO::Writer, &state);
+      context.stream->initializeOutput();
+    }
+  }
+  // Set the number of parallel threads allowed during the simulation run or forcing disaggregation
+#if PARALLEL_AVAILABLE
+  omp_set_num_threads(state.global_param.num_threads);
+  omp_set_dynamic(0);
+#endif
+
+  initializeCells();
+}
+
+ModelRun::~ModelRun() {
+  finish();
+}
+
+void ModelRun::initializeCells() {
+
+  // One output stream per aggregation interval of the output files. Its writer takes care of writing all cells' data
+  // of its files at a given output record. Only used if OUTPUT_FORCE=FALSE
+  const std::vector<int> intervals = output_intervals(out_data_files, &state);
+  outputStreams.resize(intervals.size());
+  for (unsigned int i = 0; i < outputStreams.size(); i++) {
+    OutputStream& stream = outputStreams[i];
+    stream.out_dt = intervals[i];
+    stream.out_step_ratio = stream.out_dt*SECPHOUR/state.dt_sec;
+    stream.step_count = 0;
+    stream.writer = new WriteOutputNetCDF(&state, stream.out_dt);
+    stream.writer->openFile();
+    // asyncwriter hands each output record to a writer thread so that the next time step can be computed while it is written
+    stream.asyncwriter = NULL;
+    if (!state.options.OUTPUT_FORCE && state.global_param.output_buffer_frames > 0) {
+      stream.asyncwriter = new WriteOutputAsync(stream.writer, state.global_param.output_buffer_frames, &state);
+    }
+    stream.accumulator = NULL;
+  }
+
+  // The events reported by the threads running the cells are written by this thread, between blocks of time steps
+#if PARALLEL_AVAILABLE
+  EventLog::instance().open(filenames.event_log, state.global_param.num_threads);
+#else
+  EventLog::instance().open(filenames.event_log, 1);
+#endif
+
+  /* Performance timing: the time spent initializing the cells is printed when done (VERBOSE); with OUTPUT_FORCE=TRUE,
+   * the time spent initializing and writing each cell is printed as it is written, and the total as the run time */
+  std::chrono::time_point<std::chrono::system_clock> init_start = std::chrono::system_clock::now();
+
+  // NetCDF forcing files are opened once; their readers load tiles of neighbouring cells that are shared between cells
+  for (int file_num = 0; file_num < 2; file_num++) {
+    filep.forcing_nc[file_num] = NULL;
+    if (state.param_set.FORCE_FORMAT[file_num] == NETCDF && strcasecmp(filenames.f_path_pfx[file_num], "MISSING") != 0) {
+      filep.forcing_nc[file_num] = new ReadForcingNetCDF(filenames.f_path_pfx[file_num], file_num, &state);
+    }
+  }
+
+  // The initial state file is opened once, and each cell's state is found in it without scanning the file
+  StateIOContext *initStateContext = NULL;
+  filep.init_state = NULL;
+  if (!state.options.OUTPUT_FORCE && state.options.INIT_STATE) {
+    initStateContext = new StateIOContext(filenames.init_state, StateIO::Reader, &state);
+    filep.init_state = initStateContext->stream;
+  }
+
+  // With ATMOS_WINDOW_RECORDS, the forcings are moved to a scratch file after initialization and streamed back in windows
+  atmosStream = NULL;
+  if (!state.options.OUTPUT_FORCE && state.global_param.atmos_window_records > 0) {
+    atmosStream = new AtmosStream(filenames.result_dir, cell_data_structs.size(), state.global_param.atmos_window_records, &state);
+  }
+
+  // Initializations
+  if (!state.options.OUTPUT_FORCE) {
+    for (unsigned int cellidx = 0; cellidx < cell_data_structs.size(); cellidx++) {
+      // Read in forcings, veg params, snowband, atmospheric forcings, and initial state (if applicable) for this cell
+      int initError = 0;
+      initError = initializeCell(cell_data_structs[cellidx], filep, dmy, filenames, &state);
+      if (initError == ERROR) {
+        cell_data_structs[cellidx].isValid = FALSE;
+      }
+
+      // Copy the format of the out_data_files and allocate in cell_data_structs[cellidx].outputFormat->dataFiles
+      copy_data_file_format(out_data_files, cell_data_structs[cellidx].outputFormat->dataFiles, &state);
+
+      /* Create output filename(s), and open (if already created, just open for appending).
+         ASCII/binary output format will make two files per grid cell; NetCDF will make one file to rule them all */
+      make_out_files(&filep, &filenames, &cell_data_structs[cellidx].soil_con, cell_data_structs[cellidx].outputFormat, &state);
+
+      /* Copy the format of the out_data_list (which is specific to this model run) and allocate space elements of
+         current_output_data for this cell's output data */
+      // allocating one current_output_data vector element per cell (i.e. we write once per time step)
+      copy_output_data(current_output_data, out_data_list, &state);
+
+      // Keep only the current window of this cell's forcings in memory from here on
+      if (atmosStream != NULL && cell_data_structs[cellidx].atmos != NULL) {
+        atmosStream->storeCell(cellidx, cell_data_structs[cellidx].atmos);
+        free_atmos(state.global_param.nrecs, &cell_data_structs[cellidx].atmos);
+        cell_data_structs[cellidx].atmos = NULL;
+      }
+    } // for - grid cell loop
+  }
+  else {
+    /* If OUTPUT_FORCE is set to TRUE in the global parameters file then the full disaggregated
+       forcing data array is written to file(s), and the full model run is skipped.
+
+       The forcings of different cells are disaggregated (initializeCell) in parallel, while the output
+       is written by one thread at a time in cell order (the ordered block below), reusing the same chunk
+       of current_output_data for every cell.  A thread that has finished its cell waits for its turn to
+       write before it takes another cell, so at most one cell per thread holds its atmos arrays. */
+    // allocate current_output_data vector elements for write-out of a chunk of time steps'
+    for (int i = 0; i < state.global_param.disagg_write_chunk_size; i++){
+      copy_output_data(current_output_data, out_data_list, &state);
+    }
+
+    /* Exceptions cannot leave an OpenMP region: each cell keeps its own error, the first one in cell order
+       is recorded in the ordered block (which also skips the output of the remaining cells) and rethrown
+       on the main thread after the loop. */
+    std::exception_ptr forceError;
+#if PARALLEL_AVAILABLE
+#pragma omp parallel for schedule(dynamic, 1) ordered
+#endif
+    for (unsigned int cellidx = 0; cellidx < cell_data_structs.size(); cellidx++) {
+#if VERBOSE
+      std::chrono::time_point<std::chrono::system_clock> cell_init_start = std::chrono::system_clock::now();
+#endif
+
+      // Read in and disaggregate the atmospheric forcings for this cell
+      std::exception_ptr cellError;
+      try {
+        int initError = initializeCell(cell_data_structs[cellidx], filep, dmy, filenames, &state);
+        if (initError == ERROR) {
+          cell_data_structs[cellidx].isValid = FALSE;
+        }
+      } catch (...) {
+        cellError = std::current_exception();
+      }
+
+#if VERBOSE
+      std::chrono::duration<double> cell_elapsed_init = std::chrono::system_clock::now() - cell_init_start;
+#endif
+
+#if PARALLEL_AVAILABLE
+#pragma omp ordered
+#endif
+      {
+        if (cellError && !forceError) {
+          forceError = cellError;
+        }
+        if (!forceError) {
+          try {
+            // Copy the format of the out_data_files and allocate in cell_data_structs[cellidx].outputFormat->dataFiles
+            copy_data_file_format(out_data_files, cell_data_structs[cellidx].outputFormat->dataFiles, &state);
+
+            /* Create output filename(s), and open (if already created, just open for appending).
+               ASCII/binary output format will make two files per grid cell; NetCDF will make one file to rule them all */
+            make_out_files(&filep, &filenames, &cell_data_structs[cellidx].soil_con, cell_data_structs[cellidx].outputFormat, &state);
+
+#if VERBOSE
+            fprintf(stderr, "Elapsed time loading input forcings and allocating memory for cell %d: %.3f seconds\n", cell_data_structs[cellidx].soil_con.gridcel, cell_elapsed_init.count());
+            fprintf(stderr, "Writing to output forcing file...\n");
+            std::chrono::time_point<std::chrono::system_clock> cell_write_start = std::chrono::system_clock::now();
+#endif
+            // The forcing readers may be loading another cell's forcings on a different thread
+            std::exception_ptr writeError;
+#if PARALLEL_AVAILABLE
+#pragma omp critical(forcing_io)
+#endif
+            {
+              try {
+                int chunk_step_count = 0; // count how many time steps' output have been chunked together for write out
+                int chunk_start_rec = 0;
+                for (int rec = 0; rec < state.global_param.nrecs; rec++) {
+                  // copy forcing data to current_output_data for writeout (write_forcing_file does not actually write anything to file)
+                  write_forcing_file(&cell_data_structs[cellidx], rec, cell_data_structs[cellidx].outputFormat, current_output_data[chunk_step_count], &state, dmy);
+                  chunk_step_count++;
+                  if (rec >= state.global_param.nrecs-1) { // write this last output data chunk to disk (handles case if chunk_size does not divide evenly into nrecs)
+                    cell_data_structs[cellidx].outputFormat->write_data_one_cell(current_output_data, out_data_files, chunk_start_rec, state.global_param.nrecs-chunk_start_rec, &state);
+                  }
+                  else if (chunk_step_count >= state.global_param.disagg_write_chunk_size) { // write this output data chunk to disk
+                    cell_data_structs[cellidx].outputFormat->write_data_one_cell(current_output_data, out_data_files, chunk_start_rec, state.global_param.disagg_write_chunk_size, &state);
+                    chunk_step_count = 0;
+                    chunk_start_rec = rec+1;
+                  }
+                }
+              } catch (...) {
+                writeError = std::current_exception();
+              }
+            }
+            if (writeError) {
+              std::rethrow_exception(writeError);
+            }
+
+#if VERBOSE
+            std::chrono::duration<double> cell_elapsed_write = std::chrono::system_clock::now() - cell_write_start;
+            fprintf(stderr, "Done. Elapsed time writing forcings for this cell: %.3f seconds\n", cell_elapsed_write.count());
+#endif
+          } catch (...) {
+            forceError = std::current_exception();
+          }
+        }
+        // Free all memory allocated for processing this cell
+        if (cell_data_structs[cellidx].atmos != NULL) {
+          free_atmos(state.global_param.nrecs, &cell_data_structs[cellidx].atmos);
+        }
+        delete cell_data_structs[cellidx].outputFormat;
+      }
+    } // for - grid cell loop
+    if (forceError) {
+      std::rethrow_exception(forceError);
+    }
+  }
+
+  delete initStateContext;
+  filep.init_state = NULL;
+
+#if VERBOSE
+  for (int file_num = 0; file_num < 2; file_num++) {
+    if (filep.forcing_nc[file_num] != NULL) {
+      filep.forcing_nc[file_num]->printStatistics();
+    }
+  }
+  RadiationGeometryCache::instance().printStatistics();
+#endif
+
+  std::chrono::duration<double> elapsed_init = std::chrono::system_clock::now() - init_start;
+  if (!state.options.OUTPUT_FORCE) {
+#if VERBOSE
+    fprintf(stderr, "Done. Elapsed time loading input forcings and initializing the model: %.3f seconds\n\n",  elapsed_init.count());
+    fprintf(stderr, "Running Model...\n");
+#endif
+  }
+  else {
+    elapsedRun = elapsed_init;
+  }
+
+  // Each cell runs through a block of time_block_steps time steps before the next cell is run (1 = one time step at a time)
+  const int block_steps = state.global_param.time_block_steps;
+
+  // Aggregates the output variables of each stream that are written, for all cells and every output record of a block
+  // (only used if OUTPUT_FORCE=FALSE)
+  if (!state.options.OUTPUT_FORCE) {
+    for (unsigned int i = 0; i < outputStreams.size(); i++) {
+      outputStreams[i].accumulator = new OutputAccumulator(out_data_list, out_data_files, outputStreams[i].out_dt,
+          cell_data_structs.size(), (block_steps - 1) / outputStreams[i].out_step_ratio + 2, &state);
+    }
+  }
+
+  // Orders the cells of each block by their measured cost and tracks the load balance of the threads
+#if PARALLEL_AVAILABLE
+  scheduler = new CellScheduler(cell_data_structs, state.global_param.num_threads, state.global_param.cell_schedule);
+#else
+  scheduler = new CellScheduler(cell_data_structs, 1, state.global_param.cell_schedule);
+#endif
+}
+
+int ModelRun::advance(const dmy_struct& until) {
+  // If OUTPUT_FORCE=TRUE then we have already generated disaggregated meteorological forcings, and there is nothing to run
+  if (isFinished()) {
+    return 0;
+  }
+  int endRec = nextRec;
+  while (endRec < state.global_param.nrecs && isBeforeDay(dmy[endRec], until)) {
+    endRec++;
+  }
+
+  std::chrono::time_point<std::chrono::system_clock> start = std::chrono::system_clock::now();
+  const int firstRec = nextRec;
+  /********************************************************
+     Run Model for all Grid Cells, one block of Time Steps at a time
+  ********************************************************/
+  // Blocks stay on the grid of time_block_steps time steps that starts at the first one (a segment may end within a
+  // block, which is then run in two parts), so that no block spans two forcing windows of the AtmosStream
+  const int block_steps = state.global_param.time_block_steps;
+  while (nextRec < endRec) {
+    const int blockEnd = std::min((nextRec / block_steps + 1) * block_steps, endRec);
+    runBlock(nextRec, blockEnd);
+    nextRec = blockEnd;
+  }
+  elapsedRun += std::chrono::system_clock::now() - start;
+
+  return nextRec - firstRec;
+}
+
+int ModelRun::advanceToEnd() {
+  if (isFinished()) {
+    return 0;
+  }
+  dmy_struct afterEnd = dmy[state.global_param.nrecs - 1];
+  afterEnd.year++;
+  return advance(afterEnd);
+}
+
+bool ModelRun::isFinished() const {
+  return state.options.OUTPUT_FORCE || nextRec >= state.global_param.nrecs;
+}
+
+const dmy_struct& ModelRun::currentDate() const {
+  return dmy[std::max(nextRec - 1, 0)];
+}
+
+void ModelRun::setHRUFraction(int cellIndex, int hruIndex, double fraction) {
+  std::vector<HRU>& hruList = cell_data_structs.at(cellIndex).prcp.hruList;
+  if (hruIndex < 0 || hruIndex >= (int) hruList.size() || fraction < 0 || fraction > 1) {
+    char ErrStr[MAXSTRING];
+    sprintf(ErrStr, "ModelRun::setHRUFraction: HRU %d of cell %d (of %d HRUs) cannot be given an area fraction of %f.",
+        hruIndex, cell_data_structs[cellIndex].soil_con.gridcel, (int) hruList.size(), fraction);
+    nrerror(ErrStr);
+  }
+  hruList[hruIndex].veg_con.Cv = fraction;
+}
+
+void ModelRun::setBandElevations(int cellIndex, const std::vector<double>& areaFractions, const std::vector<double>& elevations) {
+  soil_con_struct& soil_con = cell_data_structs.at(cellIndex).soil_con;
+  const int numBands = state.options.SNOW_BAND;
+  if ((int) areaFractions.size() != numBands || (int) elevations.size() != numBands) {
+    char ErrStr[MAXSTRING];
+    sprintf(ErrStr, "ModelRun::setBandElevations: %d area fractions and %d elevations given for cell %d, which has %d snow bands.",
+        (int) areaFractions.size(), (int) elevations.size(), soil_con.gridcel, numBands);
+    nrerror(ErrStr);
+  }
+  // As read_snowband() does, relative to the (unchanged) elevation of the cell
+  double total = 0;
+  for (int band = 0; band < numBands; band++) {
+    soil_con.AreaFract[band] = areaFractions[band];
+    soil_con.BandElev[band] = elevations[band];
+    soil_con.Tfactor[band] = (soil_con.elevation - soil_con.BandElev[band]) / 1000. * soil_con.T_LAPSE;
+    soil_con.Pfactor[band] = (1.0 + soil_con.PGRAD * (soil_con.BandElev[band] - soil_con.elevation)) * soil_con.AreaFract[band];
+    total += soil_con.Pfactor[band];
+  }
+  for (int band = 0; band < numBands; band++) {
+    if (soil_con.AreaFract[band] > 0 && total > 0)
+      soil_con.Pfactor[band] /= total * soil_con.AreaFract[band];
+    else
+      soil_con.Pfactor[band] = 0.;
+  }
+}
+
+void ModelRun::runBlock(int block_start, int block_end) {
+
+  /* The output schedule of the block is the same for every cell, so it is worked out here in advance for each output
+     stream: for each time step, the output record of the accumulator it is aggregated into, and whether it starts or
+     ends an output interval.  output_recs holds the file record of each accumulator record that is completed. */
+  for (std::vector<OutputStream>::iterator stream = outputStreams.begin(); stream != outputStreams.end(); ++stream) {
+    stream->step_record.resize(block_end - block_start);
+    stream->step_starts_interval.resize(block_end - block_start);
+    stream->step_ends_interval.resize(block_end - block_start);
+    stream->output_recs.clear();
+  }
+  int save_state_rec = -1;
+  for (int rec = block_start; rec < block_end; rec++) {
+    for (std::vector<OutputStream>::iterator stream = outputStreams.begin(); stream != outputStreams.end(); ++stream) {
+      // Increment the intra-record time step count (important when writing out at lower frequency than the simulation time step)
+      (stream->step_count)++;
+      stream->step_record[rec - block_start] = stream->output_recs.size();
+      stream->step_starts_interval[rec - block_start] = (stream->step_count == 1);
+      stream->step_ends_interval[rec - block_start] = (stream->step_count == stream->out_step_ratio);
+
+      // Output data for all cells is written if we have completed an output interval (OUT_STEP or that of the OUTFILE)
+      if ((rec >= state.global_param.skipyear) && (stream->step_count == stream->out_step_ratio)) {
+        stream->output_recs.push_back(rec/stream->out_step_ratio);
+        // Reset the step count
+        stream->step_count = 0;
+      }
+    }
+
+    // Save model state at assigned date (after the final time step of the assigned date)
+    if (state.options.SAVE_STATE == TRUE
+        && (dmy[rec].year == state.global_param.stateyear
+        && dmy[rec].month == state.global_param.statemonth
+        && dmy[rec].day == state.global_param.stateday
+        && (rec + 1 == state.global_param.nrecs
+        || dmy[rec + 1].day != state.global_param.stateday))) {
+      save_state_rec = rec;
+    }
+  }
+
+  // Point the cells at the window of forcings holding this block (the next window is read in the background)
+  if (atmosStream != NULL) {
+    atmosStream->advance(block_start, cell_data_structs);
+  }
+
+  /* Each cell stages its state here from inside the cell loop. The staged states are written in batches of
+     STATE_WRITE_BATCH_CELLS consecutive cells, each by the thread that finishes its last cell, so that only the
+     batches with unfinished cells are held in memory. */
+  std::vector<StateIOStaging*> staged_states;
+  std::vector<int> batch_cells_left;
+  StateIOContext* state_context = NULL;
+  std::exception_ptr state_error;  // exceptions cannot leave the critical section, so a failed write is rethrown after the loop
+  double state_seconds = 0;
+  if (save_state_rec >= 0) {
+    staged_states.resize(cell_data_structs.size(), NULL);
+    for (unsigned int first = 0; first < cell_data_structs.size(); first += STATE_WRITE_BATCH_CELLS) {
+      batch_cells_left.push_back(std::min((unsigned int) STATE_WRITE_BATCH_CELLS, (unsigned int) cell_data_structs.size() - first));
+    }
+    // No output writes may be in flight in the NetCDF library while the cell loop writes the state file
+    for (std::vector<OutputStream>::iterator stream = outputStreams.begin(); stream != outputStreams.end(); ++stream) {
+      if (stream->asyncwriter != NULL) {
+        stream->asyncwriter->drain();
+      }
+    }
+    state_context = new StateIOContext(filenames.statefile, StateIO::Writer, &state);
+  }
+
+  const std::vector<int>& cell_order = scheduler->order();
+  std::chrono::time_point<std::chrono::steady_clock> loop_start = std::chrono::steady_clock::now();
+#if PARALLEL_AVAILABLE
+#pragma omp parallel for schedule(runtime)
+#endif
+  for (unsigned int orderidx = 0; orderidx < cell_order.size(); orderidx++) {
+    //printThreadInformation();
+    const unsigned int cellidx = cell_order[orderidx];
+    std::chrono::time_point<std::chrono::steady_clock> cell_start = std::chrono::steady_clock::now();
+
+    for (int rec = block_start; rec < block_end; rec++) {
+
+      // If this cell has been deemed invalid due to an error in an earlier time step, we don't process it.
+      // Its output values are 0 from here on (the accumulator reuses its records without clearing them).
+      if (cell_data_structs[cellidx].isValid == FALSE) {
+        for (std::vector<OutputStream>::iterator stream = outputStreams.begin(); stream != outputStreams.end(); ++stream) {
+          stream->accumulator->clearCell(cellidx, stream->step_record[rec - block_start] + (stream->step_starts_interval[rec - block_start] ? 0 : 1));
+        }
+        break;
+      }
+
+      // Events reported while running this time step of the cell are recorded for it
+      EventLog::setContext(cell_data_structs[cellidx].soil_con.gridcel, rec);
+
+      // Initialize storage terms on first time step
+      if (rec == 0) {
+        // Initialize the storage terms in the water and energy balances
+        int putDataError = put_data(&cell_data_structs[cellidx], cell_data_structs[cellidx].outputFormat, current_output_data[cellidx], &dmy[0],
+                    -state.global_param.nrecs, &state);
+
+        // Skip the rest of this cell if there is an error here.
+        if (putDataError == ERROR) {
+          cell_data_structs[cellidx].isValid = FALSE;
+          if (state.options.CONTINUEONERROR == TRUE) {
+            EventLog::instance().report(EVENT_CELL_ERROR, EventLog::NO_SOLVER, "Error initializing storage terms (method put_data).  Cell has been marked as invalid and will be skipped for remainder of model run.");
+            break;
+          }
+          else {
+            sprintf(cell_data_structs[cellidx].ErrStr, "Error initializing storage terms for cell %d (method put_data).  Exiting.\n", cell_data_structs[cellidx].soil_con.gridcel);
+            vicerror(cell_data_structs[cellidx].ErrStr);
+          }
+        }
+      }
+
+      int distPrecError = dist_prec(&cell_data_structs[cellidx], dmy, &filep, cell_data_structs[cellidx].outputFormat, current_output_data[cellidx], rec, FALSE, &state);
+      for (std::vector<OutputStream>::iterator stream = outputStreams.begin(); stream != outputStreams.end(); ++stream) {
+        stream->accumulator->accumulate(cellidx, stream->step_record[rec - block_start], current_output_data[cellidx],
+            stream->step_starts_interval[rec - block_start], stream->step_ends_interval[rec - block_start], &state);
+      }
+
+      if (distPrecError == ERROR) {
+        cell_data_structs[cellidx].isValid = FALSE;
+        if (state.options.CONTINUEONERROR == TRUE) {
+          // Handle grid cell solution error
+          EventLog::instance().report(EVENT_CELL_ERROR, EventLog::NO_SOLVER,
+              "Error processing cell (method dist_prec).  Cell has been marked as invalid and will be skipped for remainder of model run.  An incomplete output file has been generated, check your inputs before re-running the simulation.");
+        } else {
+          // Else exit program on cell solution error as in previous versions
+          sprintf(cell_data_structs[cellidx].ErrStr,
+              "Error processing cell %d (method dist_prec) at record (time step) %d so the simulation has ended. Check your inputs before re-running the simulation.\n",
+              cell_data_structs[cellidx].soil_con.gridcel, rec);
+          vicerror(cell_data_structs[cellidx].ErrStr);
+        }
+      }
+
+      // FIXME: should accumulateGlacierMassBalance have error checking?
+      if (cell_data_structs[cellidx].isValid)
+        accumulateGlacierMassBalance(&(cell_data_structs[cellidx].gmbEquation), dmy, rec, &(cell_data_structs[cellidx].prcp), &(cell_data_structs[cellidx].soil_con), &state);
+
+      /************************************
+       Save model state at assigned date
+       (after the final time step of the assigned date)
+       ************************************/
+      if (rec == save_state_rec)
+      {
+        staged_states[cellidx] = new StateIOStaging(&state);
+        write_model_state(&cell_data_structs[cellidx], staged_states[cellidx], &state);
+      }
+
+#if QUICK_FS
+      if(options.FROZEN_SOIL) {
+        for(int i=0;i<MAX_LAYERS;i++) {
+          for(int j=0;j<6;j++)
+          free((char *)cell_data_structs[cellidx].soil_con.ufwc_table_layer[i][j]);
+          free((char *)cell_data_structs[cellidx].soil_con.ufwc_table_layer[i]);
+        }
+        for(int i=0;i<MAX_NODES;i++) {
+          for(int j=0;j<6;j++)
+          free((char *)cell_data_structs[cellidx].soil_con.ufwc_table_node[i][j]);
+          free((char *)cell_data_structs[cellidx].soil_con.ufwc_table_node[i]);
+        }
+      }
+#endif /* QUICK_FS */
+    } // for - time steps of the block
+    EventLog::setContext(-1, -1);
+
+    std::chrono::duration<double> cell_elapsed = std::chrono::steady_clock::now() - cell_start;
+    scheduler->recordCell(cellidx, cell_elapsed.count());
+
+    // The last cell of a batch to finish writes the staged states of the batch to the state file
+    if (save_state_rec >= 0) {
+      const unsigned int batch = cellidx / STATE_WRITE_BATCH_CELLS;
+      int cells_left;
+#if PARALLEL_AVAILABLE
+#pragma omp atomic capture
+#endif
+      cells_left = --batch_cells_left[batch];
+      if (cells_left == 0) {
+#if PARALLEL_AVAILABLE
+#pragma omp critical(state_file)
+#endif
+        {
+          std::chrono::time_point<std::chrono::steady_clock> state_start = std::chrono::steady_clock::now();
+          if (!state_error) {
+            try {
+              write_staged_model_states(staged_states, batch * STATE_WRITE_BATCH_CELLS, STATE_WRITE_BATCH_CELLS, state_context->stream, &state);
+            } catch (...) {
+              state_error = std::current_exception();
+            }
+          }
+          std::chrono::duration<double> state_elapsed = std::chrono::steady_clock::now() - state_start;
+          state_seconds += state_elapsed.count();
+        }
+      }
+    }
+  } // for - grid cell loop
+  std::chrono::duration<double> loop_elapsed = std::chrono::steady_clock::now() - loop_start;
+  scheduler->endBlock(loop_elapsed.count());
+  EventLog::instance().drain();
+
+  // Close the state file
+  if (state_context != NULL) {
+    delete state_context;
+    for (unsigned int cellidx = 0; cellidx < staged_states.size(); cellidx++) {
+      delete staged_states[cellidx];  // only left if a write failed
+    }
+    if (state_error) {
+      std::rethrow_exception(state_error);
+    }
+#if VERBOSE
+    fprintf(stderr, "Wrote model state file %s in %.3f seconds\n", filenames.statefile, state_seconds);
+#endif
+  }
+
+  for (std::vector<OutputStream>::iterator stream = outputStreams.begin(); stream != outputStreams.end(); ++stream) {
+    // Write the output records of the stream completed in this block, as runs of consecutive records
+    const std::vector<int>& output_recs = stream->output_recs;
+    for (unsigned int first = 0; first < output_recs.size(); ) {
+      unsigned int num = 1;
+      while (first + num < output_recs.size() && output_recs[first + num] == output_recs[first] + (int) num) {
+        num++;
+      }
+      if (stream->asyncwriter != NULL) {
+        stream->asyncwriter->write_data_all_cells(*stream->accumulator, first, num, output_recs[first], &state);
+      }
+      else {
+        stream->writer->write_data_all_cells(*stream->accumulator, first, num, output_recs[first], &state);
+      }
+      first += num;
+    }
+
+    // Carry the aggregated values of an output interval that continues into the next block over, and clear the rest
+    // (including those of variables that written variables are derived from)
+    stream->accumulator->startNextBlock(output_recs.size());
+  }
+}
+
+void ModelRun::finish() {
+  if (finished) {
+    return;
+  }
+  finished = true;
+
+  for (std::vector<OutputStream>::iterator stream = outputStreams.begin(); stream != outputStreams.end(); ++stream) {
+    // Finish writing any output records still queued for the writer thread
+    if (stream->asyncwriter != NULL) {
+      stream->asyncwriter->drain();
+#if VERBOSE
+      stream->asyncwriter->printStatistics();
+#endif
+      delete stream->asyncwriter;
+    }
+
+#if VERBOSE
+    if (stream->accumulator != NULL) {
+      stream->accumulator->printStatistics();
+    }
+#endif
+    delete stream->accumulator;
+    delete stream->writer;
+  }
+
+  // Write the remaining events and their summary
+  EventLog::instance().close();
+
+  if (atmosStream != NULL) {
+#if VERBOSE
+    atmosStream->printStatistics();
+#endif
+    atmosStream->release(cell_data_structs);
+    delete atmosStream;
+  }
+
+  if (!state.options.OUTPUT_FORCE) {
+#if VERBOSE
+#if PARALLEL_AVAILABLE
+    if (state.global_param.num_threads > 1){
+      fprintf(stderr, "\nVIC model run done. Model execution time (parallel): %.3f seconds\n", elapsedRun.count());
+    }
+    else {
+      fprintf(stderr, "\nVIC model run done. Model execution time (serial): %.3f seconds\n", elapsedRun.count());
+    }
+#else
+    fprintf(stderr, "\nVIC model run done. Model execution time (serial): %.3f seconds\n", elapsedRun.count());
+#endif
+    fprintf(stderr, "Throughput: %.1f time steps per second, %.1f cell time steps per second (TIME_BLOCK_STEPS %d)\n",
+        nextRec / elapsedRun.count(), (double) nextRec * cell_data_structs.size() / elapsedRun.count(),
+        state.global_param.time_block_steps);
+    scheduler->printStatistics();
+
+    SolverCounters solverWork;
+    for (std::vector<cell_info_struct>::const_iterator cell = cell_data_structs.begin(); cell != cell_data_structs.end(); ++cell) {
+      for (std::vector<HRU>::const_iterator hru = cell->prcp.hruList.begin(); hru != cell->prcp.hruList.end(); ++hru) {
+        solverWork.add(hru->solverCounters);
+      }
+    }
+    solverWork.print();
+  }
+  else {
+#if PARALLEL_AVAILABLE
+    fprintf(stderr, "\nVIC disaggregated forcings generation done. Total processing time (%d threads): %.3f seconds\n", state.global_param.num_threads, elapsedRun.count());
+#else
+    fprintf(stderr, "\nVIC disaggregated forcings generation done. Total processing time (serial): %.3f seconds\n", elapsedRun.count());
+#endif
+  }
+#endif // VERBOSE
+  delete scheduler;
+
+  // Close the NetCDF forcing readers, each opened if its own forcing file is NetCDF
+  for (int file_num = 0; file_num < 2; file_num++) {
+    if (state.param_set.FORCE_FORMAT[file_num] == NETCDF) {
+      delete filep.forcing_nc[file_num];
+      filep.forcing_nc[file_num] = NULL;
+    }
+  }
+  if(state.param_set.FORCE_FORMAT[0] == NETCDF)
+    close_files(&filep, &filenames, state.options.COMPRESS, &state);
+
+  // Free up cell_data_structs
+  for (unsigned int cellidx = 0; cellidx < cell_data_structs.size(); cellidx++) {
+    cell_data_structs[cellidx].writeDebug.cleanup(cell_data_structs[cellidx].prcp.hruList.size(), &state);
+    if (!state.options.OUTPUT_FORCE) { // this will have been already freed otherwise
+      free_atmos(state.global_param.nrecs, &cell_data_structs[cellidx].atmos);
+      delete cell_data_structs[cellidx].outputFormat;
+    }
+    free_vegcon(cell_data_structs[cellidx]);
+    free(cell_data_structs[cellidx].soil_con.AreaFract);
+    free(cell_data_structs[cellidx].soil_con.BandElev);
+    free(cell_data_structs[cellidx].soil_con.Tfactor);
+    free(cell_data_structs[cellidx].soil_con.Pfactor);
+    free(cell_data_structs[cellidx].soil_con.AboveTreeLine);
+
+  }
+
+  /** cleanup **/
+  free_dmy(&dmy);
+  delete [] out_data_files;
+  if (!state.options.OUTPUT_FORCE) {
+    free_veglib(&state.veg_lib);
+    fclose(filep.vegparam);
+    fclose(filep.veglib);
+    if (state.options.SNOW_BAND > 1)
+      fclose(filep.snowband);
+    if (state.options.LAKES)
+      fclose(filep.lakeparam);
+    delete filep.vegparam_index;
+    delete filep.snowband_index;
+    delete filep.lakeparam_index;
+  }
+  fclose(filep.soilparam);
+}
+
+//This method produces a warning based on the number of cells, and the specified RAM limit of the computer
+//This warning is relevant only when running in image mode (where all cells should fit in memory).
+//If the model is just being run sequentially, then only a single cell is in memory at a time so
+//the amount of RAM available shouldn't be an issue (although it may still take a while).
+void sanityCheckNumberOfCells(const int nCells, const ProgramState* state) {
+  double GigsOfRam = state->options.MAX_MEMORY;
+  const double approxBytesPerCell = 96000; //excluding the atmos forcing data
+  double estimatedGigsOfRamUsed = approxBytesPerCell * nCells / (1024 * 1024 * 1024);
+  if (GigsOfRam == 0.0) {
+    fprintf(stderr, "Unlimited memory assumed.\n");
+    return;
+  }
+  fprintf(stderr, "\nRAM limitation: %f Gb, estimated amount required: %f Gb, for %d cells\n", GigsOfRam, estimatedGigsOfRamUsed, nCells);
+  if (estimatedGigsOfRamUsed > GigsOfRam) {
+    fprintf(stderr, "Only continue if you know what you are doing, or you are not running in image mode.\n");
+    fprintf(stderr, "Otherwise, consider running again using fewer cells.\nContinue anyways? [y/n] ");
+    char c = getchar();
+    if (c != 'y' && c != 'Y') {
+      exit(0);
+    }
+  }
+}
+
+void readSoilData(std::vector<cell_info_struct>& cell_data_structs,
+    filep_struct filep, filenames_struct filenames,
+    dmy_struct* dmy, ProgramState& state) {
+
+  /*****************************************
+   * Read soil for all "active" grid cells *
+   *****************************************/
+  char ErrStr[MAXSTRING];
+  char done_reading_soil_file = FALSE, is_valid_soil_cell;
+  int nallocatedcells = 10; /* arbitrary */
+  int currentCellNumber = 0;
+
+  double *lat = NULL;
+  double *lng = NULL;
+  int    *cellnum = NULL;
+  int cells_loaded = 0;
+  soil_con_struct temp_soil_con;
+  cell_info_struct lastCell;
+  std::vector<std::tuple<double, double>> modeled_cell_coords;
+
+  while (!done_reading_soil_file) {
+    if (state.options.ARC_SOIL) {
+      assert(0); // presently unsupported; maybe support vector functionality later?
+      int  Ncells = 0;  // This will be initialized in read_soilparam_arc
+      temp_soil_con = read_soilparam_arc(filep.soilparam, filenames.soil_dir, &Ncells, &is_valid_soil_cell, currentCellNumber, lat, lng, cellnum, &state);
+      currentCellNumber++;
+      if (currentCellNumber == Ncells)
+        done_reading_soil_file = TRUE;
+    } else {
+      temp_soil_con = read_soilparam(filep.soilparam, filenames.soil_dir, &is_valid_soil_cell, &done_reading_soil_file, &state);
+    }
+    if (is_valid_soil_cell) {
+      cell_info_struct currentCell;
+      currentCell.soil_con = temp_soil_con;
+      if (cells_loaded > 0){
+        // Cells must be provided in groups of increasing latitude
+        if (currentCell.soil_con.lat < lastCell.soil_con.lat){
+          sprintf(ErrStr,"ERROR: soil file grid cells must be ordered by increasing latitude by increasing longitude.\n");
+          nrerror(ErrStr);
+        }
+        // Within a given latitude group, cells must be ordered by increasing longitude
+        else if (currentCell.soil_con.lat == lastCell.soil_con.lat && currentCell.soil_con.lng < lastCell.soil_con.lng){
+          sprintf(ErrStr,"ERROR: soil file grid cells must be ordered by increasing latitude by increasing longitude.\n");
+          nrerror(ErrStr);
+        }
+      }
+      modeled_cell_coords.push_back(std::make_tuple(currentCell.soil_con.lat, currentCell.soil_con.lng));
+      cells_loaded++;
+      lastCell = currentCell;
+      currentCell.outputFormat = new WriteOutputNetCDF(&state);
+      cell_data_structs.push_back(currentCell); // add an element to cell_data_structs vector
+    }
+  }
+  // Copy the modeled_cell_coords vector into the state.modeled_cell_coordinates set
+  std::copy(modeled_cell_coords.begin(), modeled_cell_coords.end(), std::inserter(state.modeled_cell_coordinates, state.modeled_cell_coordinates.end()));
+  sanityCheckNumberOfCells(cell_data_structs.size(), &state);
+}
+
+int initializeCell(cell_info_struct& cell,
+    filep_struct filep, dmy_struct* dmy, filenames_struct filenames,
+    const ProgramState* state) {
+
+  const int Ndist = state->options.DIST_PRCP ? 2 : 1;
+
+  #if LINK_DEBUG
+      if (state->debug.PRT_SOIL)
+        write_soilparam(&cell.soil_con, state);
+  #endif
+
+  #if QUICK_FS
+      /** Allocate Unfrozen Water Content Table **/
+      if(state->options.FROZEN_SOIL) {
+        for(int i=0;i<MAX_LAYERS;i++) {
+          cell.soil_con.ufwc_table_layer[i] = (double **)malloc((QUICK_FS_TEMPS+1)*sizeof(double *));
+          for(int j=0;j<QUICK_FS_TEMPS+1;j++)
+          cell.soil_con.ufwc_table_layer[i][j] = (double *)malloc(2*sizeof(double));
+        }
+        for(int i=0;i<MAX_NODES;i++) {
+          cell.soil_con.ufwc_table_node[i] = (double **)malloc((QUICK_FS_TEMPS+1)*sizeof(double *));
+
+          for(int j=0;j<QUICK_FS_TEMPS+1;j++)
+          cell.soil_con.ufwc_table_node[i][j] = (double *)malloc(2*sizeof(double));
+        }
+      }
+  #endif /* QUICK_FS */
+
+  if (!state->options.OUTPUT_FORCE) {
+    make_in_files(&filep, &filenames, &cell.soil_con, state);
+    calc_root_fractions(cell.prcp.hruList, &cell.soil_con, state);
+#if LINK_DEBUG
+    if (state->debug.PRT_VEGE) {
+      write_vegparam(cell, state);
+    }
+#endif /* LINK_DEBUG*/
+    if (state->options.LAKES) {
+      cell.lake_con = read_lakeparam(filep.lakeparam, filep.lakeparam_index, cell.soil_con, cell.prcp.hruList, state);
+    }
+  }
+  else if (state->options.OUTPUT_FORCE) {
+    make_in_files(&filep, &filenames, &cell.soil_con, state);
+  }
+  if (!state->options.OUTPUT_FORCE) {
+    /** Read Elevation Band Data if Used **/
+    read_snowband(filep.snowband, filep.snowband_index, &cell.soil_con, state->options.SNOW_BAND);
+  }
+      /**************************************************
+       Initialize Meteorological Forcing Values That
+       Have not Been Specifically Set
+       **************************************************/
+#if VERBOSE
+  fprintf(stderr, "\nInitialising Forcing Data for cell at %4.5f %4.5f...\n", cell.soil_con.lat, cell.soil_con.lng);
+#endif
+// NOTE: this should only be done for valid cells
+  /** read in meteorological data **/
+  ForcingData forcing_data(state);
+  // The NetCDF forcing readers (and the NetCDF library) are shared by all cells, which are initialized in parallel in OUTPUT_FORCE mode
+  // An exception must not leave the critical section, so it is rethrown once the lock is released
+  std::exception_ptr readError;
+#if PARALLEL_AVAILABLE
+#pragma omp critical(forcing_io)
+#endif
+  {
+    try {
+      read_forcing_data(filep.forcing, filep.forcing_nc, &filenames, state->global_param, &cell.soil_con, &forcing_data, state);
+    } catch (...) {
+      readError = std::current_exception();
+    }
+  }
+  if (readError) {
+    std::rethrow_exception(readError);
+  }
+  for (int file_num = 0; file_num < 2; file_num++) {
+    if (filep.forcing[file_num] != NULL) {
+      fclose(filep.forcing[file_num]);  // this cell's own ASCII/binary forcing file
+    }
+  }
+  fprintf(stderr,"Finished reading meteorological forcing file\n");
+
+  /** allocate memory for the atmos_data_struct **/
+  cell.atmos = alloc_atmos(state->global_param.nrecs, state->NR);
+  initialize_atmos(cell.atmos, dmy, forcing_data.columns, &cell.soil_con, state);
+
+#if LINK_DEBUG
+  if (state->debug.PRT_ATMOS)
+    write_atmosdata(cell.atmos, state->global_param.nrecs, state);
+#endif
+  cell.writeDebug.initialize(cell.prcp.hruList.size(), state);
+  /**************************************************
+   Initialize Energy Balance and Snow Variables
+   **************************************************/
+  if (!state->options.OUTPUT_FORCE) {
+#if VERBOSE
+    fprintf(stderr, "\nInitialising Model State\n");
+#endif
+    int ErrorFlag = initialize_model_state(&cell, dmy[0], filep, Ndist, state);
+
+    if (ErrorFlag == ERROR) {
+      if (state->options.CONTINUEONERROR == TRUE) {
+        // Handle grid cell solution error
+        fprintf(stderr,
+            "Error initializing the model state (energy balance, water balance, and snow components) for cell %d (method initialize_model_state).  Cell has been marked as invalid and will be skipped for remainder of model run.\n",
+            cell.soil_con.gridcel);
+        return ERROR;
+      } else {
+        // Else exit program on cell solution error as in previous versions
+        sprintf(cell.ErrStr,
+            "Error initializing cell %d (method initialize_model_state).  Check your inputs before rerunning the simulation.  Exiting.\n",
+            cell.soil_con.gridcel);
+        vicerror(cell.ErrStr);
+      }
+    }
+  }
+  return 0;
+}
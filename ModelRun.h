@@ -0,0 +1,108 @@
+#ifndef MODELRUN_H_
+#define MODELRUN_H_
+
+#include <vector>
+#include <chrono>
+
+#include "vicNl_def.h"
+
+class OutputAccumulator;
+class WriteOutputNetCDF;
+class WriteOutputAsync;
+class AtmosStream;
+class CellScheduler;
+
+/*
+ * A VIC run that can be advanced through the simulation period in segments, for coupling VIC with another model in
+ * the same process, in particular a glacier dynamics model (GLACIER_DYNAMICS, GLACIER_ACCUM_INTERVAL):
+ *
+ *   ModelRun run(argc, argv);
+ *   while (!run.isFinished()) {
+ *     run.advance(startOfNextInterval);
+ *     ... read run.massBalanceEquation(c) for each cell, run the glacier model, and pass its new glacier
+ *         extent back with run.setHRUFraction() and run.setBandElevations() ...
+ *   }
+ *   run.finish();
+ *
+ * The constructor does everything vicNl does before its time loop (reads the global parameter file, the soil,
+ * vegetation, snow band and lake parameters and the forcings, and initializes the model state of every cell), once.
+ * Between advance() calls the cells stay in memory, so there is no restart: no state file is read or written and
+ * the output files stay open. Running the whole period with one advance() call is what vicNl does.
+ *
+ * With OUTPUT_FORCE the disaggregated forcings are written by the constructor, and there is nothing to advance.
+ */
+class ModelRun {
+public:
+  // Takes the command line arguments of vicNl (-g global_parameter_file, ...).
+  ModelRun(int argc, char* argv[]);
+  ~ModelRun();
+
+  // Runs all cells through the time steps before the given day (year, month, day; the time steps of that day are run
+  // by the next advance()), or to the end of the simulation period. Returns the number of time steps run.
+  int advance(const dmy_struct& until);
+  // Runs all cells to the end of the simulation period.
+  int advanceToEnd();
+  bool isFinished() const;
+  // The date of the last time step that was run, or of the first one before any were run.
+  const dmy_struct& currentDate() const;
+
+  const ProgramState& programState() const { return state; }
+  int numCells() const { return cell_data_structs.size(); }
+  cell_info_struct& cell(int cellIndex) { return cell_data_structs[cellIndex]; }
+  // The glacier mass balance versus elevation polynomial of a cell, from its last complete GLACIER_ACCUM_INTERVAL.
+  const GraphingEquation& massBalanceEquation(int cellIndex) const { return cell_data_structs[cellIndex].gmbEquation; }
+
+  // Changes the area fraction (Cv, as in the vegetation parameter file) of an HRU of a cell, e.g. of a glacier HRU and
+  // of the open ground HRU it retreats to. The fractions must add up as in the vegetation parameter file before the
+  // next advance().
+  void setHRUFraction(int cellIndex, int hruIndex, double fraction);
+  // Changes the area fractions and the elevations of the snow bands of a cell, and updates the temperature and
+  // precipitation factors that are derived from them as read_snowband() does.
+  void setBandElevations(int cellIndex, const std::vector<double>& areaFractions, const std::vector<double>& elevations);
+
+  // Writes the output still buffered, prints the run statistics (VERBOSE), and releases the run. Also done by the
+  // destructor if not called.
+  void finish();
+
+private:
+  ModelRun(const ModelRun&);
+  ModelRun& operator=(const ModelRun&);
+
+  void initializeCells();
+  void runBlock(int block_start, int block_end);
+
+  ProgramState state;
+  filenames_struct filenames;
+  filep_struct filep;
+  dmy_struct* dmy;
+  OutputData* out_data_list;
+  out_data_file_struct* out_data_files;
+  std::vector<cell_info_struct> cell_data_structs;
+
+  // The output files (OUTFILE) of one aggregation interval, aggregated by their own accumulator from the same
+  // put_data() pass as the other intervals, and written to their own NetCDF file
+  struct OutputStream {
+    int out_dt;                       // aggregation interval in hours
+    int out_step_ratio;               // time steps per output record
+    int step_count;                   // time steps of the current output interval that have been run
+    WriteOutputNetCDF* writer;
+    WriteOutputAsync* asyncwriter;    // NULL unless OUTPUT_BUFFER_FRAMES > 0
+    OutputAccumulator* accumulator;   // NULL with OUTPUT_FORCE
+    // The output schedule of the block being run (see runBlock())
+    std::vector<int> step_record;
+    std::vector<char> step_starts_interval;
+    std::vector<char> step_ends_interval;
+    std::vector<int> output_recs;
+  };
+
+  std::vector<OutputData*> current_output_data;
+  std::vector<OutputStream> outputStreams;  // OUT_STEP first
+  AtmosStream* atmosStream;         // NULL unless ATMOS_WINDOW_RECORDS > 0
+  CellScheduler* scheduler;
+
+  int nextRec;                      // first time step not run yet
+  bool finished;
+  std::chrono::duration<double> elapsedRun;   // time spent in advance()
+};
+
+#endif /* MODELRUN_H_ */
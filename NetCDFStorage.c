@@ -0,0 +1,90 @@
+#include "NetCDFStorage.h"
+
+#if NETCDF_OUTPUT_AVAILABLE
+
+#include <algorithm>
+#include <netcdf>
+
+// Hash table slots of a chunk cache: a prime, about 100 per chunk the cache holds (as HDF5 recommends), in this range
+static const size_t MIN_CACHE_SLOTS = 521;
+static const size_t MAX_CACHE_SLOTS = 1000003;
+// HDF5's default: evict fully read or written chunks before the others most of the time
+static const float CACHE_PREEMPTION = 0.75;
+
+static bool isPrime(size_t n) {
+  for (size_t d = 2; d * d <= n; d++) {
+    if (n % d == 0) {
+      return false;
+    }
+  }
+  return n > 1;
+}
+
+NetCDFStorage::NetCDFStorage(const netcdf_storage_struct& settings) : settings(settings) {
+}
+
+std::vector<size_t> NetCDFStorage::chunkShape(const std::vector<size_t>& sizes, int numSpatial) const {
+  std::vector<size_t> shape;
+  if (settings.chunking == NetCDFChunking::DEFAULT_CHUNKS || sizes.size() <= (size_t) numSpatial) {
+    return shape;
+  }
+  const size_t firstSpatial = sizes.size() - numSpatial;
+  shape.assign(sizes.size(), 1);   // one record per chunk along time (TIME_SLAB) and along depth
+  if (settings.chunking == NetCDFChunking::TIME_SERIES_CHUNKS) {
+    shape[0] = std::min((size_t) settings.chunk_time, sizes[0]);
+  }
+  // A square of chunk_space x chunk_space grid points, which is chunk_space^2 land cells in the GATHERED layout
+  const size_t edge = numSpatial == 1 ? (size_t) settings.chunk_space * settings.chunk_space : settings.chunk_space;
+  for (size_t i = firstSpatial; i < sizes.size(); i++) {
+    shape[i] = settings.chunking == NetCDFChunking::TIME_SLAB_CHUNKS ? sizes[i] : std::min(edge, sizes[i]);
+    shape[i] = std::max(shape[i], (size_t) 1);
+  }
+  shape[0] = std::max(shape[0], (size_t) 1);
+  return shape;
+}
+
+size_t NetCDFStorage::chunkRowBytes(const std::vector<size_t>& sizes, int numSpatial) const {
+  const std::vector<size_t> shape = chunkShape(sizes, numSpatial);
+  if (shape.empty()) {
+    return 0;
+  }
+  size_t bytes = shape[0] * VALUE_BYTES;
+  for (size_t i = 1; i < sizes.size(); i++) {
+    bytes *= (sizes[i] + shape[i] - 1) / shape[i] * shape[i];
+  }
+  return bytes;
+}
+
+void NetCDFStorage::define(const netCDF::NcVar& variable, const std::vector<size_t>& sizes, int numSpatial, bool compress) const {
+  std::vector<size_t> shape = chunkShape(sizes, numSpatial);
+  if (!shape.empty()) {
+    variable.setChunking(netCDF::NcVar::nc_CHUNKED, shape);
+  }
+  if (compress && settings.deflate_level > 0) {
+    variable.setCompression(settings.shuffle, true, settings.deflate_level);
+  }
+}
+
+void NetCDFStorage::setChunkCache(const netCDF::NcVar& variable) const {
+  if (settings.chunk_cache_mb <= 0) {
+    return;
+  }
+  netCDF::NcVar::ChunkMode mode;
+  std::vector<size_t> shape;
+  variable.getChunkingParameters(mode, shape);
+  if (mode != netCDF::NcVar::nc_CHUNKED || shape.empty()) {
+    return;
+  }
+  size_t chunkBytes = VALUE_BYTES;
+  for (unsigned int i = 0; i < shape.size(); i++) {
+    chunkBytes *= shape[i];
+  }
+  const size_t cacheBytes = (size_t) (settings.chunk_cache_mb * 1024 * 1024);
+  size_t slots = std::min(std::max(100 * (cacheBytes / chunkBytes), MIN_CACHE_SLOTS), MAX_CACHE_SLOTS);
+  while (!isPrime(slots)) {
+    slots++;
+  }
+  variable.setChunkCache(cacheBytes, slots, CACHE_PREEMPTION);
+}
+
+#endif /* NETCDF_OUTPUT_AVAILABLE */
@@ -0,0 +1,46 @@
+#ifndef NETCDFSTORAGE_H_
+#define NETCDFSTORAGE_H_
+
+#include <stddef.h>
+#include <vector>
+
+#include "vicNl_def.h"
+
+#if NETCDF_OUTPUT_AVAILABLE
+
+namespace netCDF {
+  class NcVar;
+}
+
+/*
+ * Applies the storage settings of a NetCDF output stream (netcdf_storage_struct: OUTPUT_CHUNKING and the other
+ * OUTPUT_* keys for the output file, STATE_* for the state file) to its variables: the chunk shape and the deflate
+ * and shuffle filters when a variable is defined, and the chunk cache when the file is opened for writing.
+ *
+ * The dimensions of a variable are given by their sizes: time first, then any depth dimension, then numSpatial grid
+ * dimensions, (lat, lon) or landcell (OUTPUT_LAYOUT GATHERED). Variables without a time dimension (numSpatial equal
+ * to the number of dimensions, as in the state file) keep the library's default chunking.
+ */
+class NetCDFStorage {
+public:
+  // Bytes of the values of NetCDF output variables (ncFloat)
+  static const size_t VALUE_BYTES = sizeof(float);
+
+  explicit NetCDFStorage(const netcdf_storage_struct& settings);
+  // Chunk shape of a variable, or an empty shape for the library's default chunking.
+  std::vector<size_t> chunkShape(const std::vector<size_t>& sizes, int numSpatial) const;
+  // Bytes of all the chunks that one time record of a variable is written to, which the chunk cache has to hold so
+  // that the partly written chunks are not written out and read back for every record. 0 for the default chunking.
+  size_t chunkRowBytes(const std::vector<size_t>& sizes, int numSpatial) const;
+  // Sets the chunking and the filters of a newly defined variable (the filters only with compress, i.e. COMPRESS).
+  void define(const netCDF::NcVar& variable, const std::vector<size_t>& sizes, int numSpatial, bool compress) const;
+  // Sets the chunk cache of a variable of a file that is open for writing, if a chunk cache size is set.
+  void setChunkCache(const netCDF::NcVar& variable) const;
+
+private:
+  netcdf_storage_struct settings;
+};
+
+#endif /* NETCDF_OUTPUT_AVAILABLE */
+
+#endif /* NETCDFSTORAGE_H_ */
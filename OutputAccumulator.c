@@ -0,0 +1,236 @@
+#include "OutputAccumulator.h"
+
+#include <stdio.h>
+#include <omp.h>
+#include <algorithm>
+#include <chrono>
+
+#include "vicNl.h"
+
+// Output variables whose value is derived from another aggregated variable (see accumulate()).
+static const int RESISTANCE_VARIABLES[] = { OUT_AERO_RESIST, OUT_AERO_RESIST1, OUT_AERO_RESIST2 };
+static const int CONDUCTANCE_VARIABLES[] = { OUT_AERO_COND, OUT_AERO_COND1, OUT_AERO_COND2 };
+static const int NUM_RESISTANCE_VARIABLES = 3;
+
+// ALMA unit conversions of the first element, at the end of an output interval. OUT_SUB_SNOW is handled separately.
+static const int ALMA_PER_SECOND_VARIABLES[] = {
+  OUT_BASEFLOW, OUT_EVAP, OUT_EVAP_BARE, OUT_EVAP_CANOP, OUT_INFLOW,
+  OUT_LAKE_BF_IN, OUT_LAKE_BF_IN_V, OUT_LAKE_BF_OUT, OUT_LAKE_BF_OUT_V, OUT_LAKE_CHAN_IN, OUT_LAKE_CHAN_IN_V,
+  OUT_LAKE_CHAN_OUT, OUT_LAKE_CHAN_OUT_V, OUT_LAKE_DSTOR, OUT_LAKE_DSTOR_V, OUT_LAKE_DSWE, OUT_LAKE_DSWE_V,
+  OUT_LAKE_EVAP, OUT_LAKE_EVAP_V, OUT_LAKE_PREC_V, OUT_LAKE_RCHRG, OUT_LAKE_RCHRG_V, OUT_LAKE_RO_IN, OUT_LAKE_RO_IN_V,
+  OUT_LAKE_VAPFLX, OUT_LAKE_VAPFLX_V, OUT_PREC, OUT_RAINF, OUT_REFREEZE, OUT_RUNOFF, OUT_SNOW_MELT, OUT_SNOWF,
+  OUT_SUB_BLOWING, OUT_SUB_CANOP, OUT_SUB_SURFACE, OUT_TRANSP_VEG
+};
+static const int ALMA_KELVIN_VARIABLES[] = {
+  OUT_LAKE_ICE_TEMP, OUT_LAKE_SURF_TEMP, OUT_BARESOILT, OUT_SNOW_PACK_TEMP, OUT_SNOW_SURF_TEMP, OUT_SURF_TEMP,
+  OUT_VEGT, OUT_AIR_TEMP
+};
+static const int ALMA_CM_TO_M_VARIABLES[] = { OUT_FDEPTH, OUT_TDEPTH };
+static const int ALMA_TIMES_SECONDS_VARIABLES[] = { OUT_DELTACC, OUT_DELTAH };
+static const int ALMA_KPA_TO_PA_VARIABLES[] = { OUT_PRESSURE, OUT_VP, OUT_VPD };
+
+#define NUM_ELEMENTS(array) (sizeof(array) / sizeof(array[0]))
+
+OutputAccumulator::OutputAccumulator(const OutputData* out_data_list, const out_data_file_struct* out_data_files_template, int out_dt, int numCells, int numRecords, const ProgramState* state)
+  : outDtSec(out_dt * SECPHOUR), outStepRatio(outDtSec / state->dt_sec), numCells(numCells), numRecords(numRecords), firstRecord(0), slotOfVarid(N_OUTVAR_TYPES, -1), subSnow(-1), subCanopy(-1) {
+
+  for (int file_idx = 0; file_idx < state->options.Noutfiles; file_idx++) {
+    if (out_data_files_template[file_idx].out_dt != out_dt) {
+      continue;
+    }
+    for (int var_idx = 0; var_idx < out_data_files_template[file_idx].nvars; var_idx++) {
+      written.push_back(addVariable(out_data_list, out_data_files_template[file_idx].varid[var_idx]));
+    }
+  }
+
+  // Variables that are not written themselves, but that written variables are derived from
+  for (int i = 0; i < NUM_RESISTANCE_VARIABLES; i++) {
+    if (slotOfVarid[RESISTANCE_VARIABLES[i]] >= 0) {
+      resistances.push_back(std::make_pair(slotOfVarid[RESISTANCE_VARIABLES[i]], addVariable(out_data_list, CONDUCTANCE_VARIABLES[i])));
+    }
+  }
+  if (state->options.ALMA_OUTPUT && slotOfVarid[OUT_SUB_SNOW] >= 0) {
+    subSnow = slotOfVarid[OUT_SUB_SNOW];
+    subCanopy = addVariable(out_data_list, OUT_SUB_CANOP);
+  }
+
+  // One list per aggregation type (other types are not aggregated)
+  for (unsigned int slot = 0; slot < variables.size(); slot++) {
+    if (variables[slot].aggtype == AGG_TYPE_END) {
+      endVariables.push_back(slot);
+    }
+    else if (variables[slot].aggtype == AGG_TYPE_SUM) {
+      sumVariables.push_back(slot);
+    }
+    else if (variables[slot].aggtype == AGG_TYPE_AVG) {
+      avgVariables.push_back(slot);
+    }
+  }
+
+  if (state->options.ALMA_OUTPUT) {
+    const double out_dt_sec = outDtSec;
+    for (unsigned int i = 0; i < NUM_ELEMENTS(ALMA_PER_SECOND_VARIABLES); i++) {
+      addConversion(ALMA_PER_SECOND_VARIABLES[i], 1, 1, out_dt_sec, 0);
+    }
+    for (unsigned int i = 0; i < NUM_ELEMENTS(ALMA_KELVIN_VARIABLES); i++) {
+      addConversion(ALMA_KELVIN_VARIABLES[i], 1, 1, 1, KELVIN);
+    }
+    addConversion(OUT_SOIL_TEMP, state->options.Nlayer, 1, 1, KELVIN);
+    addConversion(OUT_SOIL_TNODE, state->options.Nnode, 1, 1, KELVIN);
+    addConversion(OUT_SOIL_TNODE_WL, state->options.Nnode, 1, 1, KELVIN);
+    for (unsigned int i = 0; i < NUM_ELEMENTS(ALMA_CM_TO_M_VARIABLES); i++) {
+      addConversion(ALMA_CM_TO_M_VARIABLES[i], 1, 1, 100, 0);
+    }
+    for (unsigned int i = 0; i < NUM_ELEMENTS(ALMA_TIMES_SECONDS_VARIABLES); i++) {
+      addConversion(ALMA_TIMES_SECONDS_VARIABLES[i], 1, out_dt_sec, 1, 0);
+    }
+    for (unsigned int i = 0; i < NUM_ELEMENTS(ALMA_KPA_TO_PA_VARIABLES); i++) {
+      addConversion(ALMA_KPA_TO_PA_VARIABLES[i], 1, 1000, 1, 0);
+    }
+  }
+
+#if PARALLEL_AVAILABLE
+  threadTimes.resize(std::max(state->global_param.num_threads, 1));
+#else
+  threadTimes.resize(1);
+#endif
+  for (unsigned int t = 0; t < threadTimes.size(); t++) {
+    threadTimes[t].seconds = 0;
+  }
+}
+
+int OutputAccumulator::addVariable(const OutputData* out_data_list, int varid) {
+  if (slotOfVarid[varid] < 0) {
+    Variable variable;
+    variable.varid = varid;
+    variable.varname = out_data_list[varid].varname;
+    variable.aggtype = out_data_list[varid].aggtype;
+    variable.nelem = out_data_list[varid].nelem;
+    variable.values.assign(numRecords * variable.nelem * numCells, 0.0);
+    slotOfVarid[varid] = variables.size();
+    variables.push_back(variable);
+  }
+  return slotOfVarid[varid];
+}
+
+void OutputAccumulator::addConversion(int varid, int nelem, double multiplier, double divisor, double offset) {
+  if (slotOfVarid[varid] >= 0) {
+    Conversion conversion = { slotOfVarid[varid], nelem, multiplier, divisor, offset };
+    almaConversions.push_back(conversion);
+  }
+}
+
+void OutputAccumulator::accumulate(int cellIndex, int record, const OutputData* out_data, bool startOfInterval, bool endOfInterval, const ProgramState* state) {
+#if VERBOSE
+  // Only timed when the time is reported: reading the clock costs about as much as accumulating a cell
+  std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+#endif
+  const int out_step_ratio = outStepRatio;
+
+  /********************
+    Temporal Aggregation
+    ********************/
+  for (std::vector<int>::const_iterator slot = endVariables.begin(); slot != endVariables.end(); ++slot) {
+    const Variable& var = variables[*slot];
+    const double* data = out_data[var.varid].data;
+    double* aggdata = value(*slot, record, cellIndex);
+    for (int i = 0; i < var.nelem; i++) {
+      aggdata[i * numCells] = data[i];
+    }
+  }
+  for (std::vector<int>::const_iterator slot = sumVariables.begin(); slot != sumVariables.end(); ++slot) {
+    const Variable& var = variables[*slot];
+    const double* data = out_data[var.varid].data;
+    double* aggdata = value(*slot, record, cellIndex);
+    if (startOfInterval) {
+      for (int i = 0; i < var.nelem; i++) {
+        aggdata[i * numCells] = data[i];
+      }
+    }
+    else {
+      for (int i = 0; i < var.nelem; i++) {
+        aggdata[i * numCells] += data[i];
+      }
+    }
+  }
+  for (std::vector<int>::const_iterator slot = avgVariables.begin(); slot != avgVariables.end(); ++slot) {
+    const Variable& var = variables[*slot];
+    const double* data = out_data[var.varid].data;
+    double* aggdata = value(*slot, record, cellIndex);
+    if (startOfInterval) {
+      for (int i = 0; i < var.nelem; i++) {
+        aggdata[i * numCells] = data[i]/out_step_ratio;
+      }
+    }
+    else {
+      for (int i = 0; i < var.nelem; i++) {
+        aggdata[i * numCells] += data[i]/out_step_ratio;
+      }
+    }
+  }
+  for (std::vector<std::pair<int, int> >::const_iterator pair = resistances.begin(); pair != resistances.end(); ++pair) {
+    *value(pair->first, record, cellIndex) = 1/(*value(pair->second, record, cellIndex));
+  }
+
+  /***********************************************
+    Change of units for ALMA-compliant output
+    (only at the end of an output interval)
+  ***********************************************/
+  if (endOfInterval && state->options.ALMA_OUTPUT) {
+    convertToALMA(cellIndex, record);
+  }
+
+#if VERBOSE
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+#if PARALLEL_AVAILABLE
+  const unsigned int thread = omp_get_thread_num();
+#else
+  const unsigned int thread = 0;
+#endif
+  if (thread < threadTimes.size()) {
+    threadTimes[thread].seconds += elapsed.count();
+  }
+#endif
+}
+
+void OutputAccumulator::convertToALMA(int cellIndex, int record) {
+  const int out_dt_sec = outDtSec;
+
+  // Canopy sublimation is added to the snow sublimation after both have been converted
+  if (subSnow >= 0) {
+    double* aggdata = value(subSnow, record, cellIndex);
+    *aggdata /= out_dt_sec;
+    *aggdata += *value(subCanopy, record, cellIndex) / out_dt_sec;
+  }
+  for (std::vector<Conversion>::const_iterator conversion = almaConversions.begin(); conversion != almaConversions.end(); ++conversion) {
+    double* aggdata = value(conversion->slot, record, cellIndex);
+    for (int i = 0; i < conversion->nelem; i++) {
+      aggdata[i * numCells] = aggdata[i * numCells] * conversion->multiplier / conversion->divisor + conversion->offset;
+    }
+  }
+}
+
+void OutputAccumulator::startNextBlock(int openRecord) {
+  firstRecord = storedRecord(openRecord);
+}
+
+void OutputAccumulator::clearCell(int cellIndex, int firstClearedRecord) {
+  for (unsigned int slot = 0; slot < variables.size(); slot++) {
+    for (int record = firstClearedRecord; record < numRecords; record++) {
+      double* aggdata = value(slot, record, cellIndex);
+      for (int i = 0; i < variables[slot].nelem; i++) {
+        aggdata[i * numCells] = 0;
+      }
+    }
+  }
+}
+
+void OutputAccumulator::printStatistics() const {
+  double seconds = 0;
+  for (unsigned int t = 0; t < threadTimes.size(); t++) {
+    seconds += threadTimes[t].seconds;
+  }
+  fprintf(stderr, "Output aggregation (%d hour interval): %.3f seconds (summed over the threads) aggregating %d variables (%d END, %d SUM, %d AVG, %d ALMA conversions) of %d cells\n",
+      outDtSec / SECPHOUR, seconds, (int) variables.size(), (int) endVariables.size(), (int) sumVariables.size(), (int) avgVariables.size(),
+      (int) almaConversions.size(), numCells);
+}
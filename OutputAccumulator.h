@@ -0,0 +1,107 @@
+#ifndef OUTPUTACCUMULATOR_H_
+#define OUTPUTACCUMULATOR_H_
+
+#include <string>
+#include <vector>
+#include <utility>
+
+#include "vicNl_def.h"
+
+/*
+ * Temporal aggregation of the output variables of all cells, for the variables listed in the output files only.
+ *
+ * put_data() still fills the per-cell OutputData data arrays for every variable each time step, but instead of
+ * aggregating all N_OUTVAR_TYPES variables into each cell's aggdata, accumulate() aggregates the requested variables
+ * (plus the few variables that their output values are derived from) into one array per variable holding every
+ * cell.  The values of a variable are stored as [record][elem][cell], the (t, z, y, x) order of the NetCDF output
+ * variables, so each element of each record is one contiguous run of the modeled cells.  The ALMA unit conversions
+ * at the end of an output interval are applied here too.  The results are identical to aggregating in each cell's
+ * OutputData.
+ *
+ * There is room for numRecords output records, so that with TIME_BLOCK_STEPS each cell can run through a block of
+ * time steps spanning several output intervals before the records of the block are written.
+ *
+ * Each accumulator aggregates the output files of one aggregation interval (out_dt, see OUTFILE); with several
+ * intervals, ModelRun feeds one accumulator per interval from the same put_data() pass.
+ *
+ * The requested variables are compiled into one list per aggregation type (and one list of ALMA unit conversions)
+ * at construction, so each time step runs a tight loop per list. The first time step of an output interval assigns
+ * instead of adding, so the records never have to be cleared: when a block has been written, the records are
+ * rotated (a record index offset) so that the open record becomes record 0, and the others are reused as they are.
+ */
+class OutputAccumulator {
+public:
+  struct Variable {
+    int varid;                   // index into the out_data array
+    std::string varname;
+    int aggtype;
+    int nelem;
+    std::vector<double> values;  // values[(record * nelem + elem) * numCells + cell]
+  };
+
+  // Aggregates the variables of the files of out_data_files_template whose aggregation interval is out_dt hours.
+  OutputAccumulator(const OutputData* out_data_list, const out_data_file_struct* out_data_files_template, int out_dt, int numCells, int numRecords, const ProgramState* state);
+
+  // Aggregates this time step's data values of one cell into the given output record; startOfInterval is TRUE on
+  // the first and endOfInterval on the last time step of an output interval. Different cells may be accumulated by
+  // different threads.
+  void accumulate(int cellIndex, int record, const OutputData* out_data, bool startOfInterval, bool endOfInterval, const ProgramState* state);
+  // Makes record openRecord, whose output interval has not ended yet, record 0. The records before it have been
+  // written and are reused for the records after it.
+  void startNextBlock(int openRecord);
+  // Sets the values of a cell that is no longer run (see cell_info_struct.isValid) to 0 in the given record and
+  // those after it.
+  void clearCell(int cellIndex, int firstClearedRecord);
+  // Time spent aggregating, summed over the threads (VERBOSE).
+  void printStatistics() const;
+
+  int getNumCells() const { return numCells; }
+  int getNumRecords() const { return numRecords; }
+  // The variables of the aggregated output files, in out_data_files_template order (a variable listed in two files appears twice).
+  unsigned int numWrittenVariables() const { return written.size(); }
+  const Variable& writtenVariable(unsigned int i) const { return variables[written[i]]; }
+  // The aggregated values of element elem of a variable in an output record, one per cell.
+  const double* values(const Variable& variable, int record, int elem) const { return &variable.values[(storedRecord(record) * variable.nelem + elem) * numCells]; }
+
+private:
+  // value = value * multiplier / divisor + offset, for the first nelem elements of a variable
+  struct Conversion {
+    int slot;
+    int nelem;
+    double multiplier;
+    double divisor;
+    double offset;
+  };
+  // Per-thread aggregation time (VERBOSE only), padded so that the threads do not share a cache line.
+  struct ThreadTime {
+    double seconds;
+    char padding[64 - sizeof(double)];
+  };
+
+  int addVariable(const OutputData* out_data_list, int varid);
+  void addConversion(int varid, int nelem, double multiplier, double divisor, double offset);
+  int storedRecord(int record) const { return (firstRecord + record) % numRecords; }
+  double* value(int slot, int record, int cellIndex) { return &variables[slot].values[storedRecord(record) * variables[slot].nelem * numCells + cellIndex]; }
+  void convertToALMA(int cellIndex, int record);
+
+  int outDtSec;                   // aggregation interval in seconds
+  int outStepRatio;               // time steps per aggregation interval
+  int numCells;
+  int numRecords;
+  int firstRecord;                // stored record of record 0
+  std::vector<Variable> variables;
+  std::vector<int> slotOfVarid;   // index into variables for each varid, or -1 if it is not aggregated
+  std::vector<int> written;       // indices into variables
+
+  // Compiled at construction: indices into variables
+  std::vector<int> endVariables;
+  std::vector<int> sumVariables;
+  std::vector<int> avgVariables;
+  std::vector<std::pair<int, int> > resistances;   // (resistance, conductance) pairs
+  int subSnow, subCanopy;         // OUT_SUB_SNOW and OUT_SUB_CANOP with ALMA_OUTPUT, or -1
+  std::vector<Conversion> almaConversions;
+
+  std::vector<ThreadTime> threadTimes;
+};
+
+#endif /* OUTPUTACCUMULATOR_H_ */
@@ -0,0 +1,258 @@
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+#include "vicNl.h"
+#include "mtclim_constants_vic.h"   /* physical constants */
+#include "RadiationGeometryCache.h"
+
+static char vcid[] = "$Id$";
+
+/* optical airmass by degrees */
+static const double optam[21] = {2.90,3.05,3.21,3.39,3.69,3.82,4.07,4.37,4.72,5.12,5.60,
+		      6.18,6.88,7.77,8.90,10.39,12.44,15.36,19.79,26.96,30.00};
+
+/* This is STEP (3) of calc_srad_humidity_iterative() (mtclim_vic.c), without the transmittance terms. */
+RadiationGeometry::RadiationGeometry(const RadiationGeometryKey& key) : key(key) {
+  int i, j;
+  int ami, tinystep;
+  double lat,coslat,sinlat,dt,h,dh;
+  double cosslp,sinslp,cosasp,sinasp;
+  double bsg1,bsg2,bsg3;
+  double decl,cosdecl,sindecl,cosegeom,sinegeom,coshss,hss;
+  double sc,dir_beam_topa;
+  double sum_slope_potrad;
+  double cosh,sinh;
+  double cza,cbsa,coszeh,coszwh;
+  double dir_flat_topa,am;
+
+  /* precalculate the transcendentals */
+  lat = key.lat;
+  /* check for (+/-) 90 degrees latitude, throws off daylength calc */
+  lat *= RADPERDEG;
+  if (lat > 1.5707)
+    lat = 1.5707;
+  if (lat < -1.5707)
+    lat = -1.5707;
+  coslat = cos(lat);
+  sinlat = sin(lat);
+  cosslp = cos(key.slope * RADPERDEG);
+  sinslp = sin(key.slope * RADPERDEG);
+  cosasp = cos(key.aspect * RADPERDEG);
+  sinasp = sin(key.aspect * RADPERDEG);
+  /* cosine of zenith angle for east and west horizons */
+  coszeh = cos(1.570796 - (key.ehoriz * RADPERDEG));
+  coszwh = cos(1.570796 - (key.whoriz * RADPERDEG));
+
+  /* sub-daily time and angular increment information */
+  dt = SRADDT;                /* set timestep */
+  dh = dt / SECPERRAD;        /* calculate hour-angle step */
+  tinystepspday = 86400/SRADDT;
+  tiny_radfract.assign(366 * tinystepspday, 0.0);
+
+  /* begin loop through yeardays */
+  for (i=0 ; i<365 ; i++) {
+    double* day_radfract = &tiny_radfract[i * tinystepspday];
+    dayStart[i] = flatSteps.size();
+
+    /* calculate cos and sin of declination */
+    decl = MINDECL * cos(((double)i + DAYSOFF) * RADPERDAY);
+    cosdecl = cos(decl);
+    sindecl = sin(decl);
+
+    /* do some precalculations for beam-slope geometry (bsg) */
+    bsg1 = -sinslp * sinasp * cosdecl;
+    bsg2 = (-cosasp * sinslp * sinlat + cosslp * coslat) * cosdecl;
+    bsg3 = (cosasp * sinslp * coslat + cosslp * sinlat) * sindecl;
+
+    /* calculate daylength as a function of lat and decl */
+    cosegeom = coslat * cosdecl;
+    sinegeom = sinlat * sindecl;
+    coshss = -(sinegeom) / cosegeom;
+    if (coshss < -1.0)
+      coshss = -1.0;  /* 24-hr daylight */
+    if (coshss > 1.0)
+      coshss = 1.0;    /* 0-hr daylight */
+    hss = acos(coshss);                /* hour angle at sunset (radians) */
+    /* daylength (seconds) */
+    daylength[i] = 2.0 * hss * SECPERRAD;
+
+    if (daylength[i] > 86400)
+      daylength[i] = 86400;
+
+    /* solar constant as a function of yearday (W/m^2) */
+    sc = 1368.0 + 45.5*sin((2.0*PI*(double)i/365.25) + 1.7);
+    /* extraterrestrial radiation perpendicular to beam, total over
+       the timestep (J) */
+    dir_beam_topa = sc * dt;
+
+    sum_flat_potrad[i] = 0.0;
+    sum_slope_potrad = 0.0;
+
+    /* begin sub-daily hour-angle loop, from -hss to hss */
+    for (h=-hss ; h<hss ; h+=dh) {
+      /* precalculate cos and sin of hour angle */
+      cosh = cos(h);
+      sinh = sin(h);
+
+      /* calculate cosine of solar zenith angle */
+      cza = cosegeom * cosh + sinegeom;
+
+      /* calculate cosine of beam-slope angle */
+      cbsa = sinh * bsg1 + cosh * bsg2 + bsg3;
+
+      /* check if sun is above a flat horizon */
+      if (cza > 0.0) {
+	/* potential radiation for this time period, flat surface,
+	   top of atmosphere */
+	dir_flat_topa = dir_beam_topa * cza;
+
+	/* determine optical air mass */
+	am = 1.0/(cza + 0.0000001);
+	ami = -1;
+	if (am > 2.9) {
+	  ami = (int)(acos(cza)/RADPERDEG) - 69;
+	  if (ami < 0)
+	    ami = 0;
+	  if (ami > 20)
+	    ami = 20;
+	  am = optam[ami];
+	}
+
+	/* the transmittance for this step is weighted by dir_flat_topa in transmittance() */
+	FlatStep step;
+	step.dir_flat_topa = dir_flat_topa;
+	step.am = am;
+	step.ami = ami;
+	flatSteps.push_back(step);
+
+	/* keep track of total potential radiation on a flat
+	   surface for ideal horizons */
+	sum_flat_potrad[i] += dir_flat_topa;
+
+	/* keep track of whether this time step contributes to
+	   component 1 (direct on slope) */
+	if ((h<0.0 && cza>coszeh && cbsa>0.0) ||
+	    (h>=0.0 && cza>coszwh && cbsa>0.0)) {
+
+	  /* sun between east and west horizons, and direct on
+	     slope. this period contributes to component 1 */
+	  sum_slope_potrad += dir_beam_topa * cbsa;
+	}
+
+      } /* end if sun above ideal horizon */
+      else dir_flat_topa = -1;
+
+      tinystep = (12L * 3600L + h * SECPERRAD)/SRADDT;
+      if (tinystep < 0)
+	tinystep = 0;
+      if (tinystep > tinystepspday-1)
+	tinystep = tinystepspday-1;
+      if (dir_flat_topa > 0)
+	day_radfract[tinystep] = dir_flat_topa;
+      else
+	day_radfract[tinystep] = 0;
+
+    } /* end of sub-daily hour-angle loop */
+
+    if (daylength[i] && sum_flat_potrad[i] > 0) {
+      for (j = 0; j < tinystepspday; j++)
+	day_radfract[j] /= sum_flat_potrad[i];
+    }
+
+    /* daylight average flux density for a flat surface and the slope */
+    if (daylength[i]) {
+      flat_potrad[i] = sum_flat_potrad[i] / daylength[i];
+      slope_potrad[i] = sum_slope_potrad / daylength[i];
+    }
+    else {
+      flat_potrad[i] = 0.0;
+      slope_potrad[i] = 0.0;
+    }
+
+  } /* end of i=365 days loop */
+  dayStart[365] = flatSteps.size();
+
+  /* force yearday 366 = yearday 365 */
+  flat_potrad[365] = flat_potrad[364];
+  slope_potrad[365] = slope_potrad[364];
+  daylength[365] = daylength[364];
+  sum_flat_potrad[365] = sum_flat_potrad[364];
+
+  for (j = 0 ; j < tinystepspday; j++)
+    tiny_radfract[365 * tinystepspday + j] = tiny_radfract[364 * tinystepspday + j];
+}
+
+void RadiationGeometry::transmittance(double trans1, double* ttmax0) const {
+  double optam_trans[21];
+  double sum_trans;
+
+  /* correct instantaneous transmittance for each optical air mass in the table */
+  for (int k = 0; k < 21; k++)
+    optam_trans[k] = pow(trans1, optam[k]);
+
+  for (int i = 0; i < 365; i++) {
+    /* calculate maximum daily total transmittance: instantaneous transmittance
+       weighted by potential radiation for flat surface at top of atmosphere */
+    if (daylength[i]) {
+      sum_trans = 0.0;
+      for (int s = dayStart[i]; s < dayStart[i + 1]; s++) {
+        const FlatStep& step = flatSteps[s];
+        double trans2 = (step.ami >= 0) ? optam_trans[step.ami] : pow(trans1, step.am);
+        sum_trans += trans2 * step.dir_flat_topa;
+      }
+      ttmax0[i] = sum_trans / sum_flat_potrad[i];
+    }
+    else {
+      ttmax0[i] = 0.0;
+    }
+  }
+
+  /* force yearday 366 = yearday 365 */
+  ttmax0[365] = ttmax0[364];
+}
+
+RadiationGeometryCache::RadiationGeometryCache() : hits(0), misses(0), secondsComputing(0) {
+}
+
+RadiationGeometryCache& RadiationGeometryCache::instance() {
+  static RadiationGeometryCache cache;
+  return cache;
+}
+
+std::shared_ptr<const RadiationGeometry> RadiationGeometryCache::get(const RadiationGeometryKey& key) {
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    for (std::list<std::shared_ptr<const RadiationGeometry> >::iterator it = entries.begin(); it != entries.end(); ++it) {
+      if ((*it)->key == key) {
+        hits++;
+        entries.splice(entries.begin(), entries, it);   // move to the front
+        return entries.front();
+      }
+    }
+  }
+
+  // Computed without holding the lock, so other threads can still use the cache.  Two threads missing on the
+  // same key at the same time both compute it, which is harmless.
+  std::chrono::time_point<std::chrono::system_clock> start = std::chrono::system_clock::now();
+  std::shared_ptr<const RadiationGeometry> geometry(new RadiationGeometry(key));
+  std::chrono::duration<double> elapsed = std::chrono::system_clock::now() - start;
+
+  std::lock_guard<std::mutex> guard(lock);
+  misses++;
+  secondsComputing += elapsed.count();
+  entries.push_front(geometry);
+  while (entries.size() > MTCLIM_GEOMETRY_CACHE_ENTRIES) {
+    entries.pop_back();
+  }
+  return geometry;
+}
+
+void RadiationGeometryCache::printStatistics() {
+  std::lock_guard<std::mutex> guard(lock);
+  long lookups = hits + misses;
+  if (lookups == 0) {
+    return;
+  }
+  fprintf(stderr, "MTCLIM radiation geometry cache: %ld lookups, %.1f%% hits; %.3f seconds computing geometry for %ld misses\n",
+      lookups, 100.0 * hits / lookups, secondsComputing, misses);
+}
@@ -0,0 +1,81 @@
+#ifndef RADIATIONGEOMETRYCACHE_H_
+#define RADIATIONGEOMETRYCACHE_H_
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/*
+ * The site geometry that the MTCLIM solar radiation tables depend on.
+ */
+struct RadiationGeometryKey {
+  RadiationGeometryKey(double lat, double slope, double aspect, double ehoriz, double whoriz)
+    : lat(lat), slope(slope), aspect(aspect), ehoriz(ehoriz), whoriz(whoriz) {}
+  bool operator==(const RadiationGeometryKey& other) const {
+    return lat == other.lat && slope == other.slope && aspect == other.aspect && ehoriz == other.ehoriz && whoriz == other.whoriz;
+  }
+  double lat;
+  double slope;
+  double aspect;
+  double ehoriz;
+  double whoriz;
+};
+
+/*
+ * The 366-day solar geometry tables built by STEP (3) of calc_srad_humidity_iterative(): daylength, daylight
+ * average potential radiation on a flat surface and on the slope, and the fraction of the daily flat-surface
+ * potential radiation falling in each SRADDT interval (tiny_radfract).
+ *
+ * The maximum daily transmittance (ttmax0) also depends on the site elevation, so instead of the table itself
+ * the flat-surface time steps it is integrated over are kept, and transmittance() evaluates it for a given
+ * elevation-corrected base transmittance.  The results are identical to computing everything per cell.
+ */
+class RadiationGeometry {
+public:
+  RadiationGeometry(const RadiationGeometryKey& key);
+  // Fills ttmax0[366] for the given base transmittance corrected for elevation (trans1).
+  void transmittance(double trans1, double* ttmax0) const;
+
+  const RadiationGeometryKey key;
+  int tinystepspday;
+  double daylength[366];
+  double flat_potrad[366];
+  double slope_potrad[366];
+  std::vector<double> tiny_radfract;   // tiny_radfract[day * tinystepspday + tinystep]
+
+private:
+  // A time step with the sun above the flat horizon.
+  struct FlatStep {
+    double dir_flat_topa;   // potential radiation on a flat surface at the top of the atmosphere (J)
+    double am;              // optical air mass
+    int ami;                // index into the optical air mass table, or -1 if am was computed from the zenith angle
+  };
+  std::vector<FlatStep> flatSteps;
+  int dayStart[366];              // flatSteps of day i are [dayStart[i], dayStart[i+1]), for the 365 days that are computed
+  double sum_flat_potrad[366];
+};
+
+/*
+ * Shares RadiationGeometry tables between cells with the same site geometry, e.g. flat cells on the same
+ * latitude row.  The cache holds the MTCLIM_GEOMETRY_CACHE_ENTRIES most recently used tables and may be
+ * used from several threads at once.
+ */
+class RadiationGeometryCache {
+public:
+  static RadiationGeometryCache& instance();
+  std::shared_ptr<const RadiationGeometry> get(const RadiationGeometryKey& key);
+  void printStatistics();
+
+private:
+  RadiationGeometryCache();
+  std::mutex lock;
+  std::list<std::shared_ptr<const RadiationGeometry> > entries;   // most recently used first
+
+  // Reported by printStatistics() when VERBOSE is TRUE.
+  long hits;
+  long misses;
+  double secondsComputing;
+};
+
+#endif /* RADIATIONGEOMETRYCACHE_H_ */
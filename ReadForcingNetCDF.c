@@ -0,0 +1,256 @@
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <netcdf.h>
+
+#include "vicNl.h"
+#include "ReadForcingNetCDF.h"
+
+static char vcid[] = "$Id$";
+
+// Throws a VICException describing a failed NetCDF library call on this forcing file.
+static void checkNetCDF(int ncerr, const std::string& what, const std::string& filename) {
+  if (ncerr != NC_NOERR) {
+    throw VICException("Error reading NetCDF forcing file " + filename + " (" + what + "): " + nc_strerror(ncerr));
+  }
+}
+
+ReadForcingNetCDF::ReadForcingNetCDF(const char* filename, int file_num, const ProgramState* state)
+  : filename(filename), ncid(-1), fileNum(file_num), tileSize(state->global_param.forcing_tile_size),
+    timeDimid(-1), latDimid(-1), lonDimid(-1), nTimes(0), nLats(0), nLons(0),
+    tilesLoaded(0), cellsRead(0), readCalls(0), bytesRead(0), secondsReading(0) {
+
+  checkNetCDF(nc_open(filename, NC_NOWRITE, &ncid), "nc_open", this->filename);
+
+  int timevarid;
+  checkNetCDF(nc_inq_varid(ncid, "time", &timevarid), "time variable", this->filename);
+  checkNetCDF(nc_inq_vardimid(ncid, timevarid, &timeDimid), "time dimension", this->filename);
+  checkNetCDF(nc_inq_dimlen(ncid, timeDimid, &nTimes), "time dimension length", this->filename);
+
+  readCoordinates("lat", &latDimid, latIndex, &nLats);
+  readCoordinates("lon", &lonDimid, lonIndex, &nLons);
+  inspectVariables(state);
+  countTileCells(state);
+}
+
+ReadForcingNetCDF::~ReadForcingNetCDF() {
+  if (ncid >= 0) {
+    nc_close(ncid);
+  }
+}
+
+/*
+ * Reads a 1-D coordinate variable once and builds a value -> index lookup for it.
+ * Matching is exact, as it was when each cell rescanned the coordinate arrays; where a
+ * coordinate value is repeated the first index wins.
+ */
+void ReadForcingNetCDF::readCoordinates(const char* dimName, int* dimid, std::map<double, size_t>& index, size_t* len) {
+  int varid, ndims;
+  nc_type vartype;
+  checkNetCDF(nc_inq_varid(ncid, dimName, &varid), std::string(dimName) + " variable", filename);
+  checkNetCDF(nc_inq_vartype(ncid, varid, &vartype), std::string(dimName) + " type", filename);
+  checkNetCDF(nc_inq_varndims(ncid, varid, &ndims), std::string(dimName) + " dimensions", filename);
+  if ((vartype != NC_DOUBLE && vartype != NC_FLOAT) || ndims != 1) {
+    throw VICException("Error: NetCDF forcing coordinate variable " + std::string(dimName) + " in " + filename + " must be a 1-D float or double variable.");
+  }
+  checkNetCDF(nc_inq_vardimid(ncid, varid, dimid), std::string(dimName) + " dimension", filename);
+  checkNetCDF(nc_inq_dimlen(ncid, *dimid, len), std::string(dimName) + " dimension length", filename);
+
+  std::vector<double> values(*len);
+  size_t start = 0;
+  checkNetCDF(nc_get_vara_double(ncid, varid, &start, len, &values[0]), std::string(dimName) + " values", filename);
+  for (size_t i = 0; i < *len; i++) {
+    index.insert(std::make_pair(values[i], i));
+  }
+}
+
+void ReadForcingNetCDF::inspectVariables(const ProgramState* state) {
+  const int Nfields = state->param_set.N_TYPES[fileNum];
+  for (int varidx = 0; varidx < Nfields; varidx++) {
+    VariableInfo var;
+    var.forceIndex = state->param_set.FORCE_INDEX[fileNum][varidx];
+    std::string variableKey = std::string(state->param_set.TYPE[var.forceIndex].varname);
+    if (state->forcing_mapping.find(variableKey) == state->forcing_mapping.end()) {
+      throw VICException("Error: could not find forcing variable in forcing_mapping: " + variableKey);
+    }
+    var.name = state->forcing_mapping.at(variableKey);
+    checkNetCDF(nc_inq_varid(ncid, var.name.c_str(), &var.varid), "variable " + var.name, filename);
+
+    int ndims, vardimids[3];
+    checkNetCDF(nc_inq_varndims(ncid, var.varid, &ndims), "dimensions of " + var.name, filename);
+    if (ndims != 3) {
+      throw VICException("Error: NetCDF forcing variable " + var.name + " must have dimensions (time, lat, lon).");
+    }
+    checkNetCDF(nc_inq_vardimid(ncid, var.varid, vardimids), "dimensions of " + var.name, filename);
+    if (vardimids[0] != timeDimid || vardimids[1] != latDimid || vardimids[2] != lonDimid) {
+      throw VICException("Error: NetCDF forcing variable " + var.name + " must have dimensions (time, lat, lon).");
+    }
+
+    nc_type vartype;
+    checkNetCDF(nc_inq_vartype(ncid, var.varid, &vartype), "type of " + var.name, filename);
+    var.vartype = vartype;
+    checkNetCDF(nc_inq_type(ncid, vartype, NULL, &var.typeSize), "type of " + var.name, filename);
+
+    var.isPacked = false;
+    var.hasInverseScaleFactor = false;
+    var.scaleFactor = NAN;
+    var.inverseScaleFactor = NAN;
+    switch (vartype) {
+      case NC_SHORT:    // Legacy VIC integer type input with scaling factors, for backward compatibility
+      case NC_USHORT:
+        var.isPacked = true;
+        if (nc_get_att_float(ncid, var.varid, "inverse_scale_factor", &var.inverseScaleFactor) == NC_NOERR) {
+          var.hasInverseScaleFactor = true;
+        } else {
+          checkNetCDF(nc_get_att_float(ncid, var.varid, "scale_factor", &var.scaleFactor), "scale_factor of " + var.name, filename);
+        }
+        break;
+      case NC_FLOAT:    // Supports new disaggregated forcing input types
+      case NC_DOUBLE:
+        break;
+      default:
+        throw VICException("Error reading NetCDF forcing variable " + var.name + ". Type not supported.");
+    }
+    variables.push_back(var);
+  }
+}
+
+// Counts the modeled cells falling in each tile, so that a tile can be released as soon as its last cell has been read.
+void ReadForcingNetCDF::countTileCells(const ProgramState* state) {
+  for (std::set<std::tuple<double, double> >::const_iterator it = state->modeled_cell_coordinates.begin();
+      it != state->modeled_cell_coordinates.end(); ++it) {
+    std::map<double, size_t>::const_iterator lat = latIndex.find(std::get<0>(*it));
+    std::map<double, size_t>::const_iterator lon = lonIndex.find(std::get<1>(*it));
+    if (lat != latIndex.end() && lon != lonIndex.end()) {
+      unreadCellsPerTile[tileKeyFor(lat->second, lon->second)]++;
+    }
+  }
+}
+
+size_t ReadForcingNetCDF::findIndex(const std::map<double, size_t>& index, double value, const char* dimName) const {
+  std::map<double, size_t>::const_iterator it = index.find(value);
+  if (it == index.end()) {
+    char ErrStr[MAXSTRING];
+    sprintf(ErrStr, "Error: %s value %f of a modeled cell was not found in NetCDF forcing file %s", dimName, value, filename.c_str());
+    throw VICException(ErrStr);
+  }
+  return it->second;
+}
+
+ReadForcingNetCDF::TileKey ReadForcingNetCDF::tileKeyFor(size_t latIdx, size_t lonIdx) const {
+  return std::make_pair((latIdx / tileSize) * tileSize, (lonIdx / tileSize) * tileSize);
+}
+
+/*
+ * Reads every variable for one tile, FORCE_TILE_MAX_RECORDS time records per hyperslab, and
+ * transposes the time-major (time, lat, lon) slabs into one contiguous time series per cell.
+ * Packed integer input is unpacked here exactly as the per-cell reader did.
+ */
+ReadForcingNetCDF::Tile& ReadForcingNetCDF::loadTile(const TileKey& key, int skip_recs, int nforcesteps) {
+  if ((size_t)skip_recs + (size_t)nforcesteps > nTimes) {
+    char ErrStr[MAXSTRING];
+    sprintf(ErrStr, "Not enough records in NetCDF forcing file %s (%d) to skip %d records and read the %d records needed for the simulation.  Check forcing file time step, and global file",
+        filename.c_str(), (int) nTimes, skip_recs, nforcesteps);
+    throw VICException(ErrStr);
+  }
+
+  std::chrono::time_point<std::chrono::system_clock> read_start = std::chrono::system_clock::now();
+
+  tiles.erase(key);
+  Tile& tile = tiles[key];
+  tile.latStart = key.first;
+  tile.lonStart = key.second;
+  tile.nLat = std::min(tileSize, nLats - tile.latStart);
+  tile.nLon = std::min(tileSize, nLons - tile.lonStart);
+  tile.skipRecs = skip_recs;
+  tile.nSteps = nforcesteps;
+  tile.data.resize(variables.size());
+
+  const size_t cellsInTile = tile.nLat * tile.nLon;
+  const size_t maxWindow = std::min((size_t) FORCE_TILE_MAX_RECORDS, (size_t) nforcesteps);
+  std::vector<double> slab(maxWindow * cellsInTile);
+
+#if VERBOSE
+  fprintf(stderr, "Reading NetCDF forcing tile lat [%d..%d] lon [%d..%d], records [%d..%d] ... ",
+      (int) tile.latStart, (int) (tile.latStart + tile.nLat - 1), (int) tile.lonStart, (int) (tile.lonStart + tile.nLon - 1),
+      skip_recs, skip_recs + nforcesteps - 1);
+#endif
+
+  for (size_t varidx = 0; varidx < variables.size(); varidx++) {
+    const VariableInfo& var = variables[varidx];
+    std::vector<double>& series = tile.data[varidx];
+    series.resize(cellsInTile * nforcesteps);
+
+    for (size_t window = 0; window < (size_t) nforcesteps; window += maxWindow) {
+      const size_t nrecs = std::min(maxWindow, (size_t) nforcesteps - window);
+      size_t starts[3] = { (size_t) skip_recs + window, tile.latStart, tile.lonStart };
+      size_t counts[3] = { nrecs, tile.nLat, tile.nLon };
+      checkNetCDF(nc_get_vara_double(ncid, var.varid, starts, counts, &slab[0]), "data of " + var.name, filename);
+      readCalls++;
+      bytesRead += (double) (nrecs * cellsInTile * var.typeSize);
+
+      for (size_t cell = 0; cell < cellsInTile; cell++) {
+        double* dst = &series[cell * nforcesteps + window];
+        const double* src = &slab[cell];
+        if (!var.isPacked) {
+          for (size_t rec = 0; rec < nrecs; rec++)
+            dst[rec] = src[rec * cellsInTile];
+        }
+        else if (var.hasInverseScaleFactor) {
+          /* Implemented for numerically-identical operation to classic VIC input */
+          for (size_t rec = 0; rec < nrecs; rec++)
+            dst[rec] = src[rec * cellsInTile] / var.inverseScaleFactor;
+        }
+        else {
+          for (size_t rec = 0; rec < nrecs; rec++)
+            dst[rec] = src[rec * cellsInTile] * var.scaleFactor;
+        }
+      }
+    }
+  }
+#if VERBOSE
+  fprintf(stderr, "done\n");
+#endif
+
+  tilesLoaded++;
+  std::chrono::duration<double> elapsed = std::chrono::system_clock::now() - read_start;
+  secondsReading += elapsed.count();
+  return tile;
+}
+
+void ReadForcingNetCDF::read(double** forcing_data, double lat, double lng, int skip_recs, int nforcesteps) {
+  const size_t latIdx = findIndex(latIndex, lat, "lat");
+  const size_t lonIdx = findIndex(lonIndex, lng, "lon");
+  const TileKey key = tileKeyFor(latIdx, lonIdx);
+
+  std::map<TileKey, Tile>::iterator it = tiles.find(key);
+  Tile* tile;
+  if (it == tiles.end() || it->second.skipRecs != skip_recs || it->second.nSteps != nforcesteps) {
+    tile = &loadTile(key, skip_recs, nforcesteps);
+  } else {
+    tile = &it->second;
+  }
+
+  const size_t cell = (latIdx - tile->latStart) * tile->nLon + (lonIdx - tile->lonStart);
+  for (size_t varidx = 0; varidx < variables.size(); varidx++) {
+    memcpy(forcing_data[variables[varidx].forceIndex], &tile->data[varidx][cell * nforcesteps], nforcesteps * sizeof(double));
+  }
+  cellsRead++;
+
+  // Only the cells that have never read this tile keep it in memory, so a reloaded tile is released as soon as they are served
+  int& unread = unreadCellsPerTile[key];
+  if (cellsServed.insert(std::make_pair(latIdx, lonIdx)).second && unread > 0) {
+    unread--;
+  }
+  if (unread <= 0) {
+    tiles.erase(key);
+  }
+}
+
+void ReadForcingNetCDF::printStatistics() const {
+  fprintf(stderr, "NetCDF forcing file %d (%s): %ld cells served from %ld tiles of up to %dx%d cells\n",
+      fileNum + 1, filename.c_str(), cellsRead, tilesLoaded, (int) tileSize, (int) tileSize);
+  fprintf(stderr, "  %ld hyperslab reads, %.1f MB, %.3f seconds\n",
+      readCalls, bytesRead / (1024. * 1024.), secondsReading);
+}
@@ -0,0 +1,77 @@
+#ifndef READFORCINGNETCDF_H_
+#define READFORCINGNETCDF_H_
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+class ProgramState;
+
+/*
+ * Reads NetCDF (time, lat, lon) forcing files in rectangular lat/lon tiles.
+ *
+ * The file is opened and its lat/lon coordinate variables are read and indexed
+ * once per model run.  When a cell asks for its forcings, the whole tile of
+ * FORCE_TILE_SIZE x FORCE_TILE_SIZE grid points containing it is read with one
+ * nc_get_vara call per variable per time window, transposed to cell-major
+ * (cell, time) order and kept in memory until every modeled cell in that tile
+ * has been served, after which the tile is released.  A FORCE_TILE_SIZE of 1
+ * reproduces the original one-column-per-cell access pattern.
+ */
+class ReadForcingNetCDF {
+public:
+  ReadForcingNetCDF(const char* filename, int file_num, const ProgramState* state);
+  ~ReadForcingNetCDF();
+  // Fill forcing_data[FORCE_INDEX][0..nforcesteps-1] for the cell at (lat, lng), skipping the first skip_recs file records.
+  void read(double** forcing_data, double lat, double lng, int skip_recs, int nforcesteps);
+  void printStatistics() const;
+
+private:
+  struct VariableInfo {
+    std::string name;
+    int varid;
+    int forceIndex;
+    int vartype;
+    size_t typeSize;
+    bool isPacked;                  // legacy integer-packed input with a (inverse_)scale_factor attribute
+    bool hasInverseScaleFactor;
+    float scaleFactor;
+    float inverseScaleFactor;
+  };
+  struct Tile {
+    size_t latStart, lonStart, nLat, nLon;
+    int skipRecs, nSteps;
+    std::vector<std::vector<double> > data;  // per variable, indexed [cell in tile * nSteps + step]
+  };
+  typedef std::pair<size_t, size_t> TileKey;
+
+  void readCoordinates(const char* dimName, int* dimid, std::map<double, size_t>& index, size_t* len);
+  void inspectVariables(const ProgramState* state);
+  void countTileCells(const ProgramState* state);
+  size_t findIndex(const std::map<double, size_t>& index, double value, const char* dimName) const;
+  TileKey tileKeyFor(size_t latIdx, size_t lonIdx) const;
+  Tile& loadTile(const TileKey& key, int skip_recs, int nforcesteps);
+
+  std::string filename;
+  int ncid;
+  int fileNum;
+  size_t tileSize;
+  int timeDimid, latDimid, lonDimid;
+  size_t nTimes, nLats, nLons;
+  std::map<double, size_t> latIndex, lonIndex;
+  std::vector<VariableInfo> variables;
+  std::map<TileKey, int> unreadCellsPerTile;       // modeled cells of each tile that have not been read yet
+  std::set<std::pair<size_t, size_t> > cellsServed;  // (lat, lon) indices of the cells read so far
+  std::map<TileKey, Tile> tiles;
+
+  // Read statistics, reported by printStatistics() when VERBOSE is TRUE.
+  long tilesLoaded;
+  long cellsRead;
+  long readCalls;
+  double bytesRead;
+  double secondsReading;
+};
+
+#endif /* READFORCINGNETCDF_H_ */
@@ -196,3 +196,5 @@ double SnowPackEnergyBalance::calculate(double TSurf)
   return RestTerm;
 }
 
+// The root search of this solver, compiled here so that calculate() can be inlined into it
+template class RootBrent<SnowPackEnergyBalance>;
@@ -4,7 +4,7 @@
 #ifndef SNOWPACKENERGYBALANCE_H_
 #define SNOWPACKENERGYBALANCE_H_
 
-class SnowPackEnergyBalance : public RootBrent {
+class SnowPackEnergyBalance : public RootBrent<SnowPackEnergyBalance> {
 public:
   SnowPackEnergyBalance(  double Dt,      /* Model time step (sec) */
       double Ra,                          /* Aerodynamic resistance (s/m) */
@@ -52,6 +52,8 @@ public:
   }
 
   double calculate(double);
+
+  SolverId solver() const { return SOLVER_SNOW_PACK_ENERGY_BALANCE; }
 private:
 
   double Dt;
@@ -91,6 +93,9 @@ private:
   double* surface_flux;
 };
 
+// Instantiated in SnowPackEnergyBalance.c
+extern template class RootBrent<SnowPackEnergyBalance>;
+
 #endif /* SNOWPACKENERGYBALANCE_H_ */
 
 
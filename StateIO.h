@@ -565,6 +565,10 @@ public:
   virtual int read(char* data, int numValues, const StateVariables::StateMetaDataVariableIndices id) = 0;
   virtual void flush() = 0;
   virtual void rewindFile() = 0;
+  // Writers may hold back the data written between beginBatch() and endBatch() and write it out in
+  // larger pieces when endBatch() is called. By default every write goes straight to the file.
+  virtual void beginBatch() {}
+  virtual void endBatch() {}
   IOType getType() { return ioType; }
 protected:
   std::string filename;
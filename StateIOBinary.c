@@ -4,8 +4,12 @@
 #include <stdio.h>
 
 #include "vicNl.h"
+#include "CellFileIndex.h"
 
-StateIOBinary::StateIOBinary(std::string filename, IOType ioType, const ProgramState* state) : StateIO(filename, ioType, state) {
+// The header written by initializeOutput(): state year, month, day, Nlayer and Nnode.
+static const long STATE_HEADER_BYTES = 5 * sizeof(int);
+
+StateIOBinary::StateIOBinary(std::string filename, IOType ioType, const ProgramState* state) : StateIO(filename, ioType, state), cellIndex(NULL) {
   std::string openType = "rb";
   if (ioType == StateIO::Writer) {
     openType = "ab";
@@ -14,6 +18,7 @@ StateIOBinary::StateIOBinary(std::string filename, IOType ioType, const ProgramS
 }
 
 StateIOBinary::~StateIOBinary() {
+  delete cellIndex;
   if (file != NULL) {
     fclose(file);
   }
@@ -123,25 +128,20 @@ StateHeader StateIOBinary::readHeader() {
   return StateHeader(year, month, day, nLayer, nNode);
 }
 
+// The file is indexed once, so each cell is found with a single seek instead of reading through the cells before it.
 int StateIOBinary::seekToCell(int cellid, int* nVeg, int* nBand) {
   int tmpCellNum, tmpNVeg, tmpNBand, tmpNBytes;
-  char tmpByte;
+  if (cellIndex == NULL) {
+    cellIndex = CellFileIndex::forBinaryStateFile(file, STATE_HEADER_BYTES);
+  }
+  if (!cellIndex->seekToCell(file, cellid)) {
+    return -1;
+  }
   /* read cell information */
   fread(&tmpCellNum, sizeof(int), 1, file);
   fread(&tmpNVeg, sizeof(int), 1, file);
   fread(&tmpNBand, sizeof(int), 1, file);
   fread(&tmpNBytes, sizeof(int), 1, file);
-  // Skip over unused cell information
-  while (tmpCellNum != cellid && !feof(file)) {
-    // skip rest of current cells info
-    for (int byte = 0; byte < tmpNBytes; byte++)
-      fread(&tmpByte, 1, 1, file);
-    // read info for next cell
-    fread(&tmpCellNum, sizeof(int), 1, file);
-    fread(&tmpNVeg, sizeof(int), 1, file);
-    fread(&tmpNBand, sizeof(int), 1, file);
-    fread(&tmpNBytes, sizeof(int), 1, file);
-  } //end while
 
   *nVeg = tmpNVeg;
   *nBand = tmpNBand;
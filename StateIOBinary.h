@@ -5,6 +5,8 @@
 
 #include "StateIO.h"
 
+class CellFileIndex;
+
 class StateIOBinary: public StateIO {
 public:
   StateIOBinary(std::string filename, IOType ioType, const ProgramState* state);
@@ -27,6 +29,7 @@ public:
 private:
   FILE* file;
   std::string dataToWrite;
+  CellFileIndex* cellIndex;   // built by the first seekToCell()
 };
 
 #endif /* STATEIOBINARY_H_ */
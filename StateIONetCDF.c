@@ -3,6 +3,7 @@
 
 #if NETCDF_OUTPUT_AVAILABLE
 
+#include <algorithm>
 #include <netcdf>
 #include <sstream>
 
@@ -15,7 +16,7 @@ using netCDF::ncFloat;
 using netCDF::ncInt;
 
 // The following functions are defined in the WriteOutputNetCDF.c file.
-void addGlobalAttributes(NcFile* netCDF, const ProgramState* state);
+void addGlobalAttributes(NcFile* netCDF, int out_dt, const ProgramState* state);
 void verifyGlobalAttributes(const NcFile& file);
 
 // List of strings that are used in more than one place (prevents spelling mistakes in separate places and is more maintainable).
@@ -30,8 +31,13 @@ const std::string GRID_CELL_STR = "GRID_CELL";
 const std::string VEG_TYPE_NUM_STR = "VEG_TYPE_NUM";
 const std::string NUM_BANDS_STR = "NUM_BANDS";
 const std::string NUM_GLAC_MASS_BALANCE_EQN_TERMS_STR = "state_nglac_mass_balance_eqn_terms";
+const std::string LANDCELL_DIM_STR = "landcell";
 
-StateIONetCDF::StateIONetCDF(std::string filename, IOType ioType, const ProgramState* state) : StateIO(filename, ioType, state), netCDF(NULL) {
+// Upper bound on the number of values held in memory for one write of a variable by endBatch().
+const size_t MAX_BATCH_WRITE_VALUES = 16 * 1024 * 1024;
+
+StateIONetCDF::StateIONetCDF(std::string filename, IOType ioType, const ProgramState* state) : StateIO(filename, ioType, state), netCDF(NULL), batching(false),
+    gathered(false), fileNumLat(0), fileNumLon(0), storage(state->global_param.state_storage) {
   populateMetaData();
   populateMetaDimensions();
   initializeDimensionIndices();
@@ -72,7 +78,56 @@ void StateIONetCDF::openFile() {
       // Ignored. This is expected the first time an instance of this class is created without calling initializeOutput.
     }
   }
+  findLayout();
+}
+
+// Finds whether the open file has the GATHERED layout, and if so reads its land cells.
+void StateIONetCDF::findLayout() {
+  gathered = false;
+  if (netCDF == NULL || netCDF->getDim(LANDCELL_DIM_STR).isNull()) {
+    return;
+  }
+  std::vector<int> points(netCDF->getDim(LANDCELL_DIM_STR).getSize());
+  if (!points.empty()) {
+    netCDF->getVar(LANDCELL_DIM_STR).getVar(&points[0]);
+  }
+  setLandCells(std::vector<size_t>(points.begin(), points.end()), netCDF->getDim(LAT_DIM_STR).getSize(),
+      netCDF->getDim(LON_DIM_STR).getSize());
+}
 
+void StateIONetCDF::setLandCells(const std::vector<size_t>& points, size_t numLat, size_t numLon) {
+  gathered = true;
+  fileNumLat = numLat;
+  fileNumLon = numLon;
+  landPoints = points;
+  landCellOfPoint.assign(numLat * numLon, -1);
+  for (unsigned int land = 0; land < points.size(); land++) {
+    if (points[land] >= landCellOfPoint.size()) {
+      throw VICException("Error: a land cell of the gathered state file \"" + filename + "\" is outside its lat/lon grid.");
+    }
+    landCellOfPoint[points[land]] = land;
+  }
+}
+
+bool StateIONetCDF::isInFile(int latIndex, int lonIndex) const {
+  if (gathered) {
+    return latIndex < (int)fileNumLat && lonIndex < (int)fileNumLon && landCellOfPoint[latIndex * fileNumLon + lonIndex] >= 0;
+  }
+  return latIndex < (int)netCDF->getDim(LAT_DIM_STR).getSize() && lonIndex < (int)netCDF->getDim(LON_DIM_STR).getSize();
+}
+
+std::vector<size_t> StateIONetCDF::fileIndices(const std::vector<size_t>& start) const {
+  if (!gathered) {
+    return start;
+  }
+  if (start[0] >= fileNumLat || start[1] >= fileNumLon || landCellOfPoint[start[0] * fileNumLon + start[1]] < 0) {
+    std::stringstream ss;
+    ss << "Error: the grid point at latIndex " << start[0] << ", lonIndex " << start[1] << " is not a land cell of the gathered state file.";
+    throw VICException(ss.str());
+  }
+  std::vector<size_t> indices(start.begin() + 1, start.end());
+  indices[0] = landCellOfPoint[start[0] * fileNumLon + start[1]];
+  return indices;
 }
 
 // Specific steps for lat/long dimensions and variables.
@@ -125,7 +180,7 @@ void StateIONetCDF::initializeOutput() {
 
   netCDF = new NcFile(filename.c_str(), NcFile::replace, NcFile::nc4);
 
-  addGlobalAttributes(netCDF, state);
+  addGlobalAttributes(netCDF, state->global_param.out_dt, state);
 
   /* Write save state date information */
   netCDF->putAtt(stateYear, netCDF::ncInt, state->global_param.stateyear);
@@ -151,6 +206,21 @@ void StateIONetCDF::initializeOutput() {
 
   initializeLatLonDims();
 
+  // The land cells of the GATHERED layout, in mask order
+  NcDim landDim;
+  if (state->options.STATE_LAYOUT == OutputLayout::GATHERED_LAYOUT) {
+    const std::vector<size_t>& points = state->grid.gatheredPoints();
+    landDim = netCDF->addDim(LANDCELL_DIM_STR, points.size());
+    NcVar landVar = netCDF->addVar(LANDCELL_DIM_STR, ncInt, landDim);
+    landVar.putAtt("compress", "lat lon");
+    landVar.putAtt("long_name", "grid point of each land cell");
+    std::vector<int> indices(points.begin(), points.end());
+    landVar.putVar(&indices[0]);
+    setLandCells(points, state->grid.numLat(), state->grid.numLon());
+  } else {
+    gathered = false;
+  }
+
   // Add all variables found in the metaData map.
   for (std::map<StateMetaDataVariableIndices, StateVariableMetaData>::iterator it = metaData.begin();
       it != metaData.end(); ++it) {
@@ -164,7 +234,11 @@ void StateIONetCDF::initializeOutput() {
     for (std::vector<StateVariableDimensionId>::iterator dimIt =
         it->second.dimensions.begin(); dimIt != it->second.dimensions.end();
         ++dimIt) {
-      if (*dimIt != StateVariables::NO_DIM) {
+      if (gathered && *dimIt == StateVariables::LAT_DIM) {
+        dimensions.push_back(landDim);
+      } else if (gathered && *dimIt == StateVariables::LON_DIM) {
+        continue;
+      } else if (*dimIt != StateVariables::NO_DIM) {
         dimensions.push_back(allDynamicDimensions[*dimIt]);
       }
     }
@@ -172,9 +246,12 @@ void StateIONetCDF::initializeOutput() {
     try {
       NcVar data = netCDF->addVar(varName, netCDF::NcType(it->second.type), dimensions);
       data.putAtt("internal_id", ncInt, id); // This is basically just for reference, it might change between versions.
-      if (state->options.COMPRESS) {
-        data.setCompression(false, true, 1); // Some reasonable compression level - not too intensive. Hard-coded to 1 here.
+      // The state variables have no time dimension, so only the filters of STATE_DEFLATE_LEVEL and STATE_SHUFFLE apply.
+      std::vector<size_t> sizes;
+      for (unsigned int i = 0; i < dimensions.size(); i++) {
+        sizes.push_back(dimensions[i].getSize());
       }
+      storage.define(data, sizes, sizes.size(), state->options.COMPRESS);
     } catch (const netCDF::exceptions::NcException& except) {
       fprintf(stderr, "Error adding variable: %s with id: %d Internal netCDF exception\n", varName.c_str(), id);
       throw;
@@ -198,9 +275,31 @@ template<typename T> int StateIONetCDF::generalWrite(const T* data, int numValue
       }
     }
     count[count.size() - 1] = numValues;  // Assumes that the list of values will go to the last dimension.
+    const std::vector<size_t> indices = fileIndices(start);
+    if (gathered) {
+      count.erase(count.begin());
+    }
+
+    if (batching) {
+      std::vector<size_t> sizes = getDimensionSizes(id);
+      if (indices[indices.size() - 1] + numValues > sizes[sizes.size() - 1]) {
+        throw VICException("Error: too many values for the last dimension of this variable.");
+      }
+      BatchedVariable& var = batch[id];
+      BatchedRun run;
+      run.varOffset = 0;
+      for (unsigned int i = 0; i < indices.size(); i++) {
+        run.varOffset = run.varOffset * sizes[i] + indices[i];
+      }
+      run.valuesOffset = var.values.size();
+      run.numValues = numValues;
+      var.runs.push_back(run);
+      var.values.insert(var.values.end(), data, data + numValues);
+      return numValues;
+    }
 
     NcVar variable = netCDF->getVar(metaData[id].name);
-    variable.putVar(start, count, data);
+    variable.putVar(indices, count, data);
 
   } catch (std::exception& e) {
     fprintf(stderr, "Error writing variable: %s, at latIndex: %d, lonIndex: %d. numValues = %d, last dimensionId = %d, last dimension length = %d\n",
@@ -211,11 +310,11 @@ template<typename T> int StateIONetCDF::generalWrite(const T* data, int numValue
   return numValues;
 }
 
-// This template function means that we don't have to copy and paste the same code just for different types.
-// The only type sensitive code in this function is the variable.getVar() call and this is overloaded for each type.
+// Reads are served from a band of whole lat rows of the variable (see readBand), so a warm start reads each
+// variable with a few large getVar calls instead of one per cell. Values are held as doubles, which represent
+// every value of the int and double variables of the state file exactly.
 template<typename T> int StateIONetCDF::generalRead(T* data, int numValues, const StateVariables::StateMetaDataVariableIndices id) {
   std::vector<size_t> start;
-  std::vector<size_t> count;
   StateVariables::StateVariableDimensionId lastDimensionId = StateVariables::NO_DIM;
   try {
     for (std::vector<StateVariables::StateVariableDimensionId>::iterator it = metaData[id].dimensions.begin();
@@ -223,13 +322,28 @@ template<typename T> int StateIONetCDF::generalRead(T* data, int numValues, cons
       if (*it != StateVariables::NO_DIM) {
         lastDimensionId = *it;
         start.push_back(curDimensionIndices[*it]);
-        count.push_back(1);
       }
     }
-    count[count.size() - 1] = numValues;  // Assumes that the list of values will go to the last dimension.
 
-    NcVar variable = netCDF->getVar(metaData[id].name);
-    variable.getVar(start, count, data);
+    const std::vector<size_t> indices = fileIndices(start);
+    const CachedBand& band = readBand(id, indices[0]);
+    if (indices.size() != band.sizes.size()) {
+      throw VICException("Error: the number of dimensions of this variable in the state file does not match its metadata.");
+    }
+    size_t varOffset = 0;
+    for (unsigned int i = 0; i < indices.size(); i++) {
+      if (indices[i] >= band.sizes[i]) {
+        throw VICException("Error: index out of range for a dimension of this variable in the state file.");
+      }
+      varOffset = varOffset * band.sizes[i] + indices[i];
+    }
+    if (indices[indices.size() - 1] + numValues > band.sizes[band.sizes.size() - 1]) {  // Assumes that the list of values will go to the last dimension.
+      throw VICException("Error: too many values for the last dimension of this variable.");
+    }
+    const double* values = &band.values[varOffset - band.firstRow * band.rowValues];
+    for (int i = 0; i < numValues; i++) {
+      data[i] = static_cast<T>(values[i]);
+    }
   } catch (netCDF::exceptions::NcRange &e) {
     fprintf(stderr, "Error reading variable: %s, at latIndex: %d, lonIndex: %d. numValues = %d, last dimensionId = %d, last dimension length = %d\n",
         metaData[id].name.c_str(), (int)start[0], (int)start[1], numValues,
@@ -245,6 +359,46 @@ template<typename T> int StateIONetCDF::generalRead(T* data, int numValues, cons
   return numValues;
 }
 
+// Returns the cached band of lat rows of a variable holding the given row, reading a band of at most
+// MAX_BATCH_WRITE_VALUES values from that row on (or up to that row, if the cells are going down the rows) if it is
+// not cached. Cells are usually initialized in lat order, so each variable is read in one pass over the file.
+const StateIONetCDF::CachedBand& StateIONetCDF::readBand(const StateVariables::StateMetaDataVariableIndices id, size_t row) {
+  std::map<StateVariables::StateMetaDataVariableIndices, CachedBand>::iterator cached = readCache.find(id);
+  if (cached != readCache.end() && row >= cached->second.firstRow && row < cached->second.firstRow + cached->second.numRows) {
+    return cached->second;
+  }
+
+  NcVar variable = netCDF->getVar(metaData[id].name);
+  if (variable.isNull()) {
+    throw VICException("Error: variable " + metaData[id].name + " is not in the state file.");
+  }
+  CachedBand& band = readCache[id];
+  band.sizes.clear();
+  std::vector<NcDim> dims = variable.getDims();
+  for (unsigned int i = 0; i < dims.size(); i++) {
+    band.sizes.push_back(dims[i].getSize());
+  }
+  band.rowValues = 1;
+  for (unsigned int i = 1; i < band.sizes.size(); i++) {
+    band.rowValues *= band.sizes[i];
+  }
+  const size_t rowsPerBand = std::max((size_t)1, MAX_BATCH_WRITE_VALUES / std::max((size_t)1, band.rowValues));
+  // Cells going down the lat rows (e.g. a soil file ordered from north to south) get the band ending at the row
+  const bool descending = (cached != readCache.end() && row < cached->second.firstRow);
+  band.firstRow = (descending && row + 1 > rowsPerBand) ? row + 1 - rowsPerBand : (descending ? 0 : row);
+  band.numRows = (band.firstRow < band.sizes[0]) ? std::min(rowsPerBand, band.sizes[0] - band.firstRow) : 0;
+  band.values.resize(band.numRows * band.rowValues);
+
+  if (band.numRows > 0) {
+    std::vector<size_t> start(band.sizes.size(), 0);
+    std::vector<size_t> count(band.sizes);
+    start[0] = band.firstRow;
+    count[0] = band.numRows;
+    variable.getVar(start, count, &band.values[0]);
+  }
+  return band;
+}
+
 int StateIONetCDF::write(const int* data, int numValues, const StateVariables::StateMetaDataVariableIndices id) {
   return generalWrite(data, numValues, id);
 }
@@ -334,31 +488,54 @@ void StateIONetCDF::notifyDimensionUpdate(StateVariables::StateVariableDimension
   curDimensionIndices[dimension] = newValue;
 }
 
+// The cell is normally at the lat/lon index given with notifyDimensionUpdate, so it is found without searching.
+// Otherwise (a state file of a different grid) the cells are located with a single read of the GRID_CELL variable,
+// and the lat/lon indices are moved to where the cell is.
 int StateIONetCDF::seekToCell(int cellid, int* nVeg, int* nBand) {
-  NcDim latDim = netCDF->getDim(LAT_DIM_STR);
-  NcDim lonDim = netCDF->getDim(LON_DIM_STR);
-  int latSize = latDim.getSize();
-  int lonSize = lonDim.getSize();
-  NcVar cellIds = netCDF->getVar(GRID_CELL_STR);
-  // Iterate through the lat/lng grid until the correct cellId is found.
-  // Then read the veg and band vars at this cell.
+  int cellIdRead = -1;
+  if (isInFile(curDimensionIndices[StateVariables::LAT_DIM], curDimensionIndices[StateVariables::LON_DIM])) {
+    generalRead(&cellIdRead, 1, StateVariables::GRID_CELL);
+  }
+  if (cellIdRead != cellid) {
+    if (cellLocations.empty()) {
+      findCellLocations();
+    }
+    std::map<int, std::pair<int, int> >::const_iterator location = cellLocations.find(cellid);
+    if (location == cellLocations.end()) {
+      return -1;
+    }
+    curDimensionIndices[StateVariables::LAT_DIM] = location->second.first;
+    curDimensionIndices[StateVariables::LON_DIM] = location->second.second;
+  }
+  generalRead(nVeg, 1, StateVariables::VEG_TYPE_NUM);
+  generalRead(nBand, 1, StateVariables::NUM_BANDS);
+  return 0;
+}
+
+// Where a cell number appears more than once, the first one in (lat, lon) order wins, as it did when seekToCell
+// searched the grid.
+void StateIONetCDF::findCellLocations() {
+  if (gathered) {
+    std::vector<int> cellIds(landPoints.size(), -1);
+    if (!cellIds.empty()) {
+      netCDF->getVar(GRID_CELL_STR).getVar(&cellIds[0]);
+    }
+    for (unsigned int land = 0; land < landPoints.size(); land++) {
+      cellLocations.insert(std::make_pair(cellIds[land], std::make_pair((int)(landPoints[land] / fileNumLon), (int)(landPoints[land] % fileNumLon))));
+    }
+    return;
+  }
+  const int latSize = netCDF->getDim(LAT_DIM_STR).getSize();
+  const int lonSize = netCDF->getDim(LON_DIM_STR).getSize();
+  std::vector<int> cellIds(latSize * lonSize, -1);
+  if (!cellIds.empty()) {
+    netCDF->getVar(GRID_CELL_STR).getVar(&cellIds[0]);
+  }
   for (int i = 0; i < latSize; i++) {
     for (int j = 0; j < lonSize; j++) {
-      double cellIdRead = -1;
-      std::vector<size_t> start;
-      start.push_back((size_t)i);
-      start.push_back((size_t)j);
-      cellIds.getVar(start, &cellIdRead);
-      if ((int)cellIdRead == cellid) {
-        NcVar veg = netCDF->getVar(VEG_TYPE_NUM_STR);
-        NcVar band = netCDF->getVar(NUM_BANDS_STR);
-        veg.getVar(start, nVeg);
-        band.getVar(start, nBand);
-        return 0;
-      }
+      cellLocations.insert(std::make_pair(cellIds[i * lonSize + j], std::make_pair(i, j)));
     }
   }
-  return -1;
 }
 
 void StateIONetCDF::flush() {
@@ -369,6 +546,84 @@ void StateIONetCDF::rewindFile() {
 // This is not applicable to netCDF.
 }
 
+// Writes are collected in memory from here on (see generalWrite) instead of going to the file one cell at a time.
+void StateIONetCDF::beginBatch() {
+  batching = true;
+}
+
+// Writes out everything collected since beginBatch() with a few large writes per variable: one for each
+// band of lat rows between the first and last row written to, where a band is at most MAX_BATCH_WRITE_VALUES
+// values. Elements of a band that were not written to get the netCDF default fill value for the variable's type,
+// which is what an element of a freshly initialized state file that is never written to contains, unless the
+// band holds rows written by an earlier batch: the band is then read back first, so that those rows are kept.
+void StateIONetCDF::endBatch() {
+  batching = false;
+  for (std::map<StateVariables::StateMetaDataVariableIndices, BatchedVariable>::iterator it = batch.begin(); it != batch.end(); ++it) {
+    BatchedVariable& var = it->second;
+    if (var.runs.empty()) {
+      continue;
+    }
+    std::stable_sort(var.runs.begin(), var.runs.end());  // stable, so that a later write to the same element wins
+
+    std::vector<size_t> sizes = getDimensionSizes(it->first);
+    size_t rowValues = 1;   // values per lat row: lon and all inner dimensions
+    for (unsigned int i = 1; i < sizes.size(); i++) {
+      rowValues *= sizes[i];
+    }
+    const size_t rowsPerBand = std::max((size_t)1, MAX_BATCH_WRITE_VALUES / rowValues);
+    const double fill = (metaData[it->first].type == netCDF::NcType::nc_INT) ? NC_FILL_INT : NC_FILL_DOUBLE;
+    NcVar variable = netCDF->getVar(metaData[it->first].name);
+    std::vector<bool>& written = rowsWritten[it->first];
+    written.resize(sizes[0], false);
+
+    std::vector<double> band;
+    std::vector<BatchedRun>::const_iterator run = var.runs.begin();
+    while (run != var.runs.end()) {
+      const size_t firstRow = run->varOffset / rowValues;
+      const size_t lastRow = std::min(var.runs.back().varOffset / rowValues, firstRow + rowsPerBand - 1);
+      const size_t bandStart = firstRow * rowValues;
+      std::vector<size_t> start(sizes.size(), 0);
+      std::vector<size_t> count(sizes);
+      start[0] = firstRow;
+      count[0] = lastRow - firstRow + 1;
+      band.assign((lastRow - firstRow + 1) * rowValues, fill);
+      if (std::find(written.begin() + firstRow, written.begin() + lastRow + 1, true) != written.begin() + lastRow + 1) {
+        variable.getVar(start, count, &band[0]);
+      }
+      std::fill(written.begin() + firstRow, written.begin() + lastRow + 1, true);
+      for (; run != var.runs.end() && run->varOffset / rowValues <= lastRow; ++run) {
+        std::copy(var.values.begin() + run->valuesOffset, var.values.begin() + run->valuesOffset + run->numValues,
+            band.begin() + (run->varOffset - bandStart));
+      }
+
+      try {
+        variable.putVar(start, count, &band[0]);
+      } catch (std::exception& e) {
+        fprintf(stderr, "Error writing variable: %s, at latIndex: %d to %d.\n", metaData[it->first].name.c_str(), (int)firstRow, (int)lastRow);
+        throw;
+      }
+    }
+  }
+  batch.clear();
+}
+
+// Sizes of the dimensions of a variable, in the order they are stored in the file (with the land cells in place of
+// (lat, lon) in the GATHERED layout).
+std::vector<size_t> StateIONetCDF::getDimensionSizes(const StateVariables::StateMetaDataVariableIndices id) {
+  std::vector<size_t> sizes;
+  for (std::vector<StateVariables::StateVariableDimensionId>::iterator it = metaData[id].dimensions.begin();
+      it != metaData[id].dimensions.end(); ++it) {
+    if (gathered && *it == StateVariables::LAT_DIM) {
+      sizes.push_back(landPoints.size());
+    } else if (gathered && *it == StateVariables::LON_DIM) {
+      continue;
+    } else if (*it != StateVariables::NO_DIM) {
+      sizes.push_back(metaDimensions[*it].size);
+    }
+  }
+  return sizes;
+}
+
 // Reset all dimension indices to zero.
 void StateIONetCDF::initializeDimensionIndices() {
   for (std::map<StateVariables::StateVariableDimensionId, StateVariableDimension>::iterator it = metaDimensions.begin();
@@ -6,8 +6,10 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include "StateIO.h"
+#include "NetCDFStorage.h"
 
 namespace netCDF {
   class NcFile;
@@ -35,6 +37,8 @@ public:
   int seekToCell(int cellid, int* nVeg, int* nBand);
   void flush();
   void rewindFile();
+  void beginBatch();
+  void endBatch();
 
 private:
   template<typename T> int generalWrite(const T* data, int numValues, const StateVariables::StateMetaDataVariableIndices id);
@@ -51,6 +55,58 @@ private:
 
   netCDF::NcFile* netCDF;
   std::map<StateVariables::StateVariableDimensionId, int> curDimensionIndices;
+
+  // Values written while batching, per variable. Each run of values is stored with its offset into
+  // the whole (lat, lon, ...) variable, and the runs are written out in lat bands by endBatch().
+  struct BatchedRun {
+    size_t varOffset;
+    size_t valuesOffset;
+    int numValues;
+    bool operator<(const BatchedRun& other) const { return varOffset < other.varOffset; }
+  };
+  struct BatchedVariable {
+    std::vector<BatchedRun> runs;
+    std::vector<double> values;
+  };
+  bool batching;
+  std::map<StateVariables::StateMetaDataVariableIndices, BatchedVariable> batch;
+  // Lat rows (land cells in the GATHERED layout) of each variable written by an earlier endBatch(), which a
+  // later batch reads back before writing the band that holds them.
+  std::map<StateVariables::StateMetaDataVariableIndices, std::vector<bool> > rowsWritten;
+  std::vector<size_t> getDimensionSizes(const StateVariables::StateMetaDataVariableIndices id);
+
+  // Values read from the file, per variable: a band of whole lat rows, so that the cells of a warm start are
+  // read with one getVar per band instead of one per cell (see generalRead).
+  struct CachedBand {
+    size_t firstRow;
+    size_t numRows;
+    size_t rowValues;               // values per lat row: lon and all inner dimensions
+    std::vector<size_t> sizes;      // dimension sizes of the variable in the file
+    std::vector<double> values;
+  };
+  std::map<StateVariables::StateMetaDataVariableIndices, CachedBand> readCache;
+  const CachedBand& readBand(const StateVariables::StateMetaDataVariableIndices id, size_t row);
+  // Grid cell number -> (lat, lon) index of the cell in the file, built the first time a cell is not found
+  // at the lat/lon index given with notifyDimensionUpdate.
+  std::map<int, std::pair<int, int> > cellLocations;
+  void findCellLocations();
+
+  // STATE_LAYOUT GATHERED: the variables are stored for the land cells only, along a "landcell" dimension in place
+  // of (lat, lon), and the "landcell" variable (CF compress = "lat lon") gives the grid point of each. The lat/lon
+  // indices given with notifyDimensionUpdate are translated to land cells. The layout of a file that is read is
+  // found from the file.
+  bool gathered;
+  size_t fileNumLat;
+  size_t fileNumLon;
+  std::vector<size_t> landPoints;     // grid point (lat index * fileNumLon + lon index) of each land cell
+  std::vector<int> landCellOfPoint;   // land cell of each grid point, or -1
+  NetCDFStorage storage;   // compression of the variables (STATE_DEFLATE_LEVEL, STATE_SHUFFLE)
+
+  void setLandCells(const std::vector<size_t>& points, size_t numLat, size_t numLon);
+  void findLayout();
+  bool isInFile(int latIndex, int lonIndex) const;
+  // The indices of a value in the file, from its (lat, lon, ...) indices
+  std::vector<size_t> fileIndices(const std::vector<size_t>& start) const;
 };
 
 #endif // NETCDF_OUTPUT_AVAILABLE
@@ -0,0 +1,141 @@
+#include "StateIOStaging.h"
+
+#include "vicNl.h"
+
+StateIOStaging::StateIOStaging(const ProgramState* state) : StateIO("", StateIO::Writer, state) {
+}
+
+StateIOStaging::~StateIOStaging() {
+}
+
+void StateIOStaging::initializeOutput() {
+  throw VICException("Error: StateIOStaging::initializeOutput is not supported, initialize the state file that the staged cells are replayed to instead.");
+}
+
+void StateIOStaging::addOperation(OperationType type, int id, int numValues) {
+  Operation op;
+  op.type = type;
+  op.id = id;
+  op.numValues = numValues;
+  op.offset = data.size();
+  operations.push_back(op);
+}
+
+template<typename T> int StateIOStaging::stage(OperationType type, const T* values, int numValues, const StateVariables::StateMetaDataVariableIndices id) {
+  addOperation(type, id, numValues);
+  data.append((const char*)values, numValues * sizeof(T));
+  return numValues;
+}
+
+int StateIOStaging::write(const int* data, int numValues, const StateVariables::StateMetaDataVariableIndices id) {
+  return stage(WRITE_INT, data, numValues, id);
+}
+
+int StateIOStaging::write(const double* data, int numValues, const StateVariables::StateMetaDataVariableIndices id) {
+  return stage(WRITE_DOUBLE, data, numValues, id);
+}
+
+int StateIOStaging::write(const float* data, int numValues, const StateVariables::StateMetaDataVariableIndices id) {
+  return stage(WRITE_FLOAT, data, numValues, id);
+}
+
+int StateIOStaging::write(const bool* data, int numValues, const StateVariables::StateMetaDataVariableIndices id) {
+  return stage(WRITE_BOOL, data, numValues, id);
+}
+
+int StateIOStaging::write(const char* data, int numValues, const StateVariables::StateMetaDataVariableIndices id) {
+  return stage(WRITE_CHAR, data, numValues, id);
+}
+
+int StateIOStaging::processNewline() {
+  addOperation(NEWLINE, 0, 0);
+  return 0;
+}
+
+void StateIOStaging::notifyDimensionUpdate(StateVariables::StateVariableDimensionId dimension, int value) {
+  // Validation of the new index is left to the writer that this is replayed to.
+  addOperation(DIMENSION_UPDATE, dimension, value);
+  curDimensionIndices[dimension] = (value < 0) ? curDimensionIndices[dimension] + 1 : value;
+}
+
+void StateIOStaging::initializeDimensionIndices() {
+  addOperation(INITIALIZE_DIMENSIONS, 0, 0);
+  curDimensionIndices.clear();
+}
+
+int StateIOStaging::getCurrentDimensionIndex(StateVariables::StateVariableDimensionId dimension) {
+  return curDimensionIndices[dimension];
+}
+
+void StateIOStaging::flush() {
+  addOperation(FLUSH, 0, 0);
+}
+
+void StateIOStaging::replay(StateIO* writer) const {
+  for (std::vector<Operation>::const_iterator it = operations.begin(); it != operations.end(); ++it) {
+    const char* values = data.data() + it->offset;
+    StateVariables::StateMetaDataVariableIndices id = (StateVariables::StateMetaDataVariableIndices)it->id;
+    switch (it->type) {
+    case WRITE_INT:
+      writer->write((const int*)values, it->numValues, id);
+      break;
+    case WRITE_DOUBLE:
+      writer->write((const double*)values, it->numValues, id);
+      break;
+    case WRITE_FLOAT:
+      writer->write((const float*)values, it->numValues, id);
+      break;
+    case WRITE_BOOL:
+      writer->write((const bool*)values, it->numValues, id);
+      break;
+    case WRITE_CHAR:
+      writer->write((const char*)values, it->numValues, id);
+      break;
+    case NEWLINE:
+      writer->processNewline();
+      break;
+    case DIMENSION_UPDATE:
+      writer->notifyDimensionUpdate((StateVariables::StateVariableDimensionId)it->id, it->numValues);
+      break;
+    case INITIALIZE_DIMENSIONS:
+      writer->initializeDimensionIndices();
+      break;
+    case FLUSH:
+      writer->flush();
+      break;
+    }
+  }
+}
+
+// The following are not applicable to a write-only, in-memory stream.
+
+StateHeader StateIOStaging::readHeader() {
+  throw VICException("Error: StateIOStaging cannot be used to read a state file.");
+}
+
+int StateIOStaging::seekToCell(int cellid, int* nVeg, int* nBand) {
+  throw VICException("Error: StateIOStaging cannot be used to read a state file.");
+}
+
+int StateIOStaging::read(int* data, int numValues, const StateVariables::StateMetaDataVariableIndices id) {
+  throw VICException("Error: StateIOStaging cannot be used to read a state file.");
+}
+
+int StateIOStaging::read(double* data, int numValues, const StateVariables::StateMetaDataVariableIndices id) {
+  throw VICException("Error: StateIOStaging cannot be used to read a state file.");
+}
+
+int StateIOStaging::read(float* data, int numValues, const StateVariables::StateMetaDataVariableIndices id) {
+  throw VICException("Error: StateIOStaging cannot be used to read a state file.");
+}
+
+int StateIOStaging::read(bool* data, int numValues, const StateVariables::StateMetaDataVariableIndices id) {
+  throw VICException("Error: StateIOStaging cannot be used to read a state file.");
+}
+
+int StateIOStaging::read(char* data, int numValues, const StateVariables::StateMetaDataVariableIndices id) {
+  throw VICException("Error: StateIOStaging cannot be used to read a state file.");
+}
+
+void StateIOStaging::rewindFile() {
+}
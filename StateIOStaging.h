@@ -0,0 +1,63 @@
+#ifndef STATEIOSTAGING_H_
+#define STATEIOSTAGING_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "StateIO.h"
+
+/*
+ * An in-memory StateIO writer. Every call made on it (writes, newlines, dimension updates, flushes) is
+ * recorded in order, and can later be replayed onto a real StateIO writer with replay().
+ *
+ * This lets worker threads serialize their cells through processCellForStateFile() without touching
+ * the state file (each thread owns the StateIOStaging objects of the cells it processes), after which
+ * they are replayed, one batch of cells at a time, through one open StateIO stream. The resulting file
+ * is the same as if the cells had been written one at a time, in the order in which they are replayed.
+ */
+class StateIOStaging: public StateIO {
+public:
+  StateIOStaging(const ProgramState* state);
+  virtual ~StateIOStaging();
+  void initializeOutput();
+  int write(const int* data, int numValues, const StateVariables::StateMetaDataVariableIndices id);
+  int write(const double* data, int numValues, const StateVariables::StateMetaDataVariableIndices id);
+  int write(const float* data, int numValues, const StateVariables::StateMetaDataVariableIndices id);
+  int write(const bool* data, int numValues, const StateVariables::StateMetaDataVariableIndices id);
+  int write(const char* data, int numValues, const StateVariables::StateMetaDataVariableIndices id);
+  int processNewline();
+  StateHeader readHeader();
+  void notifyDimensionUpdate(StateVariables::StateVariableDimensionId dimension, int value = -1);
+  void initializeDimensionIndices();
+  int getCurrentDimensionIndex(StateVariables::StateVariableDimensionId dimension);
+  int seekToCell(int cellid, int* nVeg, int* nBand);
+  int read(int* data, int numValues, const StateVariables::StateMetaDataVariableIndices id);
+  int read(double* data, int numValues, const StateVariables::StateMetaDataVariableIndices id);
+  int read(float* data, int numValues, const StateVariables::StateMetaDataVariableIndices id);
+  int read(bool* data, int numValues, const StateVariables::StateMetaDataVariableIndices id);
+  int read(char* data, int numValues, const StateVariables::StateMetaDataVariableIndices id);
+  void flush();
+  void rewindFile();
+
+  // Repeats every recorded call, in order, on the given writer.
+  void replay(StateIO* writer) const;
+  size_t sizeInBytes() const { return data.size(); }
+
+private:
+  enum OperationType { WRITE_INT, WRITE_DOUBLE, WRITE_FLOAT, WRITE_BOOL, WRITE_CHAR, NEWLINE, DIMENSION_UPDATE, INITIALIZE_DIMENSIONS, FLUSH };
+  struct Operation {
+    OperationType type;
+    int id;          // variable id for writes, dimension id for dimension updates
+    int numValues;   // number of values for writes, new index for dimension updates
+    size_t offset;   // start of the values in data
+  };
+  template<typename T> int stage(OperationType type, const T* values, int numValues, const StateVariables::StateMetaDataVariableIndices id);
+  void addOperation(OperationType type, int id, int numValues);
+
+  std::vector<Operation> operations;
+  std::string data;
+  std::map<StateVariables::StateVariableDimensionId, int> curDimensionIndices;  // only used for error messages
+};
+
+#endif /* STATEIOSTAGING_H_ */
@@ -0,0 +1,116 @@
+#include "WriteOutputAsync.h"
+
+#if NETCDF_OUTPUT_AVAILABLE
+
+#include <chrono>
+
+std::mutex WriteOutputAsync::libraryLock;
+
+WriteOutputAsync::WriteOutputAsync(WriteOutputNetCDF* writer, int numFrames, const ProgramState* state)
+  : writer(writer), state(state), frames(numFrames), head(0), count(0), stopping(false),
+    recordsWritten(0), secondsPacking(0), secondsWaiting(0), secondsWriting(0) {
+  thread = std::thread(&WriteOutputAsync::writerLoop, this);
+}
+
+WriteOutputAsync::~WriteOutputAsync() {
+  {
+    std::unique_lock<std::mutex> guard(lock);
+    stopping = true;
+  }
+  frameQueued.notify_one();
+  thread.join();
+}
+
+// Packs this output record into the next free frame and queues it for the writer thread.
+void WriteOutputAsync::write_data_all_cells(const OutputAccumulator& accumulator, const int first_record, const int num_recs, const int output_rec, const ProgramState *state) {
+
+  if (writer->netCDF == NULL) {
+    writer->write_data_all_cells(accumulator, first_record, num_recs, output_rec, state);  // prints the usual warning
+    return;
+  }
+
+  unsigned int tail;
+  {
+    std::chrono::time_point<std::chrono::system_clock> wait_start = std::chrono::system_clock::now();
+    std::unique_lock<std::mutex> guard(lock);
+    while (count == frames.size() && !writerError) {
+      frameWritten.wait(guard);
+    }
+    std::chrono::duration<double> waited = std::chrono::system_clock::now() - wait_start;
+    secondsWaiting += waited.count();
+    rethrowWriterError();
+    tail = (head + count) % frames.size();
+  }
+
+  // The frame at tail is not touched by the writer thread until it is queued below.
+  std::chrono::time_point<std::chrono::system_clock> pack_start = std::chrono::system_clock::now();
+  writer->pack_frame(accumulator, first_record, num_recs, output_rec, frames[tail], state);
+  std::chrono::duration<double> packed = std::chrono::system_clock::now() - pack_start;
+  secondsPacking += packed.count();
+
+  {
+    std::unique_lock<std::mutex> guard(lock);
+    count++;
+  }
+  frameQueued.notify_one();
+}
+
+void WriteOutputAsync::drain() {
+  std::unique_lock<std::mutex> guard(lock);
+  while (count > 0 && !writerError) {
+    frameWritten.wait(guard);
+  }
+  rethrowWriterError();
+}
+
+// Must be called with the lock held.  An error on the writer thread ends the run the same way it would have synchronously.
+void WriteOutputAsync::rethrowWriterError() {
+  if (writerError) {
+    std::rethrow_exception(writerError);
+  }
+}
+
+void WriteOutputAsync::writerLoop() {
+  while (true) {
+    unsigned int current;
+    {
+      std::unique_lock<std::mutex> guard(lock);
+      while (count == 0 && !stopping) {
+        frameQueued.wait(guard);
+      }
+      if (count == 0) {
+        return;  // stopping, and every queued frame has been written
+      }
+      current = head;
+    }
+
+    std::chrono::time_point<std::chrono::system_clock> write_start = std::chrono::system_clock::now();
+    try {
+      std::unique_lock<std::mutex> libraryGuard(libraryLock);
+      writer->write_frame(frames[current], state);
+    } catch (...) {
+      std::unique_lock<std::mutex> guard(lock);
+      writerError = std::current_exception();
+      count = 0;
+      frameWritten.notify_all();
+      return;
+    }
+    std::chrono::duration<double> written = std::chrono::system_clock::now() - write_start;
+
+    {
+      std::unique_lock<std::mutex> guard(lock);
+      secondsWriting += written.count();
+      recordsWritten += frames[current].num_recs;
+      head = (head + 1) % frames.size();
+      count--;
+    }
+    frameWritten.notify_all();
+  }
+}
+
+void WriteOutputAsync::printStatistics() const {
+  fprintf(stderr, "Output writer thread (%d frames): %ld records written; %.3f seconds writing, %.3f seconds packing on the main thread, %.3f seconds waiting for a free frame\n",
+      (int) frames.size(), recordsWritten, secondsWriting, secondsPacking, secondsWaiting);
+}
+
+#endif /* NETCDF_OUTPUT_AVAILABLE */
@@ -0,0 +1,64 @@
+#ifndef WRITEOUTPUTASYNC_H_
+#define WRITEOUTPUTASYNC_H_
+
+#include "vicNl_def.h"
+
+#if NETCDF_OUTPUT_AVAILABLE
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "WriteOutputNetCDF.h"
+
+/*
+ * Hands whole-grid output records to a dedicated writer thread, so that the model can compute
+ * the next time step while the previous one is being written (and compressed) by the NetCDF library.
+ *
+ * The main thread packs the output records of each block of time steps (a single record unless
+ * TIME_BLOCK_STEPS is set) into a free frame of a bounded ring (this must happen before the
+ * accumulator is reused) and queues it; the writer thread calls WriteOutputNetCDF::write_frame() on the
+ * queued frames in order, so the file is identical to one written synchronously.  When the ring is
+ * full the main thread waits for the writer.  Only the writer thread makes NetCDF calls on the output
+ * file between construction and drain(); call drain() before anything else uses the NetCDF library.
+ * The NetCDF library is not thread safe, so the writer threads of several output streams (one per
+ * OUTFILE aggregation interval) take turns writing their frames.
+ */
+class WriteOutputAsync {
+public:
+  WriteOutputAsync(WriteOutputNetCDF* writer, int numFrames, const ProgramState* state);
+  ~WriteOutputAsync();  // Writes out any queued frames before returning.
+  void write_data_all_cells(const OutputAccumulator& accumulator, const int first_record, const int num_recs, const int output_rec, const ProgramState *state);
+  void drain();         // Blocks until every queued frame has been written.
+  void printStatistics() const;
+
+private:
+  void writerLoop();
+  void rethrowWriterError();
+
+  static std::mutex libraryLock;  // held by a writer thread while it makes NetCDF calls
+
+  WriteOutputNetCDF* writer;
+  const ProgramState* state;
+  std::vector<OutputFrame> frames;
+  unsigned int head;    // next frame to write
+  unsigned int count;   // frames queued but not yet written
+  bool stopping;
+  std::exception_ptr writerError;
+  std::mutex lock;
+  std::condition_variable frameQueued;
+  std::condition_variable frameWritten;
+  std::thread thread;
+
+  // Timing, reported by printStatistics() when VERBOSE is TRUE.
+  long recordsWritten;
+  double secondsPacking;
+  double secondsWaiting;  // main thread blocked on a full ring
+  double secondsWriting;  // writer thread inside write_frame()
+};
+
+#endif /* NETCDF_OUTPUT_AVAILABLE */
+
+#endif /* WRITEOUTPUTASYNC_H_ */
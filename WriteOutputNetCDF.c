@@ -10,15 +10,43 @@
 
 #include <netcdf>
 #include <ctime>
+#include <algorithm>
 //#include <map>
 #include <sstream>
 
 using namespace netCDF;
 
-WriteOutputNetCDF::WriteOutputNetCDF(const ProgramState* state) : WriteOutputFormat(state), netCDF(NULL) {
+// Dimension and index variable of the land cells in the GATHERED output layout
+const std::string LANDCELL_DIM_STR = "landcell";
+
+// The grid (OUTPUT_LAYOUT GRID) or land cell (GATHERED) dimensions of the output variables, after time (and depth).
+static std::vector<size_t> spatialDimensionSizes(const ProgramState* state) {
+  std::vector<size_t> sizes;
+  if (state->options.OUTPUT_LAYOUT == OutputLayout::GATHERED_LAYOUT) {
+    sizes.push_back(state->grid.gatheredPoints().size());
+  } else {
+    sizes.push_back(state->grid.numLat());
+    sizes.push_back(state->grid.numLon());
+  }
+  return sizes;
+}
+
+WriteOutputNetCDF::WriteOutputNetCDF(const ProgramState* state) : WriteOutputNetCDF(state, state->global_param.out_dt) {
+}
+
+WriteOutputNetCDF::WriteOutputNetCDF(const ProgramState* state, int out_dt) : WriteOutputFormat(state), netCDF(NULL),
+    outDt(out_dt), storage(state->global_param.output_storage) {
   netCDFOutputFileName = state->options.NETCDF_FULL_FILE_PATH;
+  if (out_dt != state->global_param.out_dt) {
+    const size_t fileStart = netCDFOutputFileName.find_last_of('/') + 1;
+    size_t extension = netCDFOutputFileName.find_last_of('.');
+    if (extension == std::string::npos || extension < fileStart) {
+      extension = netCDFOutputFileName.size();
+    }
+    netCDFOutputFileName.insert(extension, "_" + std::to_string(out_dt) + "h");
+  }
   // The divisor will convert the difference to sub-daily (e.g. hourly, 3/4/6/8/12-hourly) or daily, respectively.
-  timeIndexDivisor = state->global_param.out_dt < 24 ? (60 * 60 * state->global_param.out_dt) : (60 * 60 * 24); //new (*state->global_param.dt)
+  timeIndexDivisor = outDt < 24 ? (60 * 60 * outDt) : (60 * 60 * 24); //new (*state->global_param.dt)
 }
 
 WriteOutputNetCDF::~WriteOutputNetCDF() {
@@ -36,6 +64,11 @@ void WriteOutputNetCDF::openFile() {
   // Do not specify the type of file that will be read here (NcFile::nc4). The library will throw an exception
   // if it is provided for open types read or write (since the file was already created with a certain format).
   netCDF = new NcFile(netCDFOutputFileName.c_str(), NcFile::write);
+
+  std::multimap<std::string, NcVar> allVars = netCDF->getVars();
+  for (std::multimap<std::string, NcVar>::const_iterator it = allVars.begin(); it != allVars.end(); ++it) {
+    storage.setChunkCache(it->second);
+  }
 }
 
 // The source version is set by the makefile at compile time based on the hg version control values.
@@ -107,7 +140,7 @@ void verifyGlobalAttributes(const NcFile& file) {
   }
 }
 
-void addGlobalAttributes(NcFile* netCDF, const ProgramState* state) {
+void addGlobalAttributes(NcFile* netCDF, int out_dt, const ProgramState* state) {
   // Add global attributes here. (These could potentially be overwritten by inputs from the global file)
   if(state->options.OUTPUT_FORCE){
 	  netCDF->putAtt("title", "VIC meteorological forcing disaggregator mode output.");
@@ -143,8 +176,8 @@ void addGlobalAttributes(NcFile* netCDF, const ProgramState* state) {
 
   netCDF->putAtt("source", source.c_str());
   netCDF->putAtt("history", history.c_str());
-  std::string frequency = std::to_string(state->global_param.out_dt);
-  netCDF->putAtt("frequency", state->global_param.out_dt < 24 ? frequency+=" hour" : "day");
+  std::string frequency = std::to_string(out_dt);
+  netCDF->putAtt("frequency", out_dt < 24 ? frequency+=" hour" : "day");
   netCDF->putAtt("Conventions", "CF-1.6");
 }
 
@@ -164,7 +197,7 @@ void WriteOutputNetCDF::initializeFile(const ProgramState* state, const OutputDa
 
 	NcFile ncFile(netCDFOutputFileName.c_str(), NcFile::replace, NcFile::nc4);
 
-  addGlobalAttributes(&ncFile, state);
+  addGlobalAttributes(&ncFile, outDt, state);
 
   ncFile.putAtt("model_end_year", netCDF::ncInt, state->global_param.endyear);
   ncFile.putAtt("model_end_month", netCDF::ncInt, state->global_param.endmonth);
@@ -219,13 +252,13 @@ void WriteOutputNetCDF::initializeFile(const ProgramState* state, const OutputDa
   }
 
   std::stringstream ss;
-  if (state->global_param.out_dt < 24) {
+  if (outDt < 24) {
     ss << "hours since ";
   } else {
     ss << "days since ";
   }
   ss << state->global_param.startyear << "-" << state->global_param.startmonth << "-" << state->global_param.startday;
-  if (state->global_param.out_dt < 24)
+  if (outDt < 24)
     ss << " " << state->global_param.starthour << ":00";
 
   timeVar.putAtt("axis", "T");
@@ -239,7 +272,7 @@ void WriteOutputNetCDF::initializeFile(const ProgramState* state, const OutputDa
   count.push_back(1);
   for (int i = 0; i < timeSize; i++) {
     start[0] = i;
-    float index = state->global_param.out_dt < 24 ? (i * state->global_param.out_dt) : i;
+    float index = outDt < 24 ? (i * outDt) : i;
     timeVar.putVar(start, count, &index);
   }
 
@@ -254,13 +287,42 @@ void WriteOutputNetCDF::initializeFile(const ProgramState* state, const OutputDa
 
   // Define dimension orders.
   // If you change the ordering, make sure you also change the order that variables are written in the WriteOutputNetCDF::write_data() method.
-  const NcDim dim3Vals [] = { timeDim, latDim, lonDim };
-  const NcDim dim4Vals [] = { timeDim, valuesDim, latDim, lonDim };
-  std::vector<NcDim> dimensions3(dim3Vals, dim3Vals + 3);
-  std::vector<NcDim> dimensions4(dim4Vals, dim4Vals + 4);
+  // In the GATHERED layout, the (lat, lon) dimensions are replaced by the land cells, with the CF "compress" index
+  // variable giving the grid point (lat index * number of lons + lon index) of each.
+  std::vector<NcDim> dimensions3(1, timeDim);
+  std::vector<NcDim> dimensions4(1, timeDim);
+  dimensions4.push_back(valuesDim);
+  if (state->options.OUTPUT_LAYOUT == OutputLayout::GATHERED_LAYOUT) {
+    const std::vector<size_t>& points = state->grid.gatheredPoints();
+    NcDim landDim = ncFile.addDim(LANDCELL_DIM_STR, points.size());
+    NcVar landVar = ncFile.addVar(LANDCELL_DIM_STR, ncInt, landDim);
+    landVar.putAtt("compress", "lat lon");
+    landVar.putAtt("long_name", "grid point of each land cell");
+    std::vector<int> indices(points.begin(), points.end());
+    landVar.putVar(&indices[0]);
+    dimensions3.push_back(landDim);
+    dimensions4.push_back(landDim);
+  } else {
+    dimensions3.push_back(latDim);
+    dimensions3.push_back(lonDim);
+    dimensions4.push_back(latDim);
+    dimensions4.push_back(lonDim);
+  }
+
+  // Dimension sizes of the variables, for their chunk shapes
+  const std::vector<size_t> spatialSizes = spatialDimensionSizes(state);
+  std::vector<size_t> sizes3(1, timeSize), sizes4(1, timeSize);
+  sizes4.push_back(valuesSize);
+  sizes3.insert(sizes3.end(), spatialSizes.begin(), spatialSizes.end());
+  sizes4.insert(sizes4.end(), spatialSizes.begin(), spatialSizes.end());
+  size_t largestChunkRowBytes = 0;
+  std::string largestChunkRowVariable;
 
-  // Define a netCDF variable. For example, fluxes, snow.
+  // Define a netCDF variable. For example, fluxes, snow. The files of other aggregation intervals have their own output file.
   for (unsigned int file_idx = 0; file_idx < dataFiles.size(); file_idx++) {
+    if (dataFiles[file_idx]->out_dt != outDt) {
+      continue;
+    }
     for (int var_idx = 0; var_idx < dataFiles[file_idx]->nvars; var_idx++) {
       const std::string varName = out_data_defaults[dataFiles[file_idx]->varid[var_idx]].varname;
       bool use4Dimensions = out_data_defaults[dataFiles[file_idx]->varid[var_idx]].nelem > 1;
@@ -284,8 +346,10 @@ void WriteOutputNetCDF::initializeFile(const ProgramState* state, const OutputDa
           data.putAtt("_FillValue", ncFloat, NETCDF_FILL_VALUE);
           data.putAtt("internal_vic_name", varName); // This should be the same as that given next to OUTVAR in the global file (and the key used to find variable metadata in state->mapping)
           data.putAtt("category", dataFiles[file_idx]->prefix);
-          if (state->options.COMPRESS) {
-            data.setCompression(false, true, 5); // Some reasonable compression level - not too intensive.
+          storage.define(data, use4Dimensions ? sizes4 : sizes3, spatialSizes.size(), state->options.COMPRESS);
+          if (storage.chunkRowBytes(use4Dimensions ? sizes4 : sizes3, spatialSizes.size()) > largestChunkRowBytes) {
+            largestChunkRowBytes = storage.chunkRowBytes(use4Dimensions ? sizes4 : sizes3, spatialSizes.size());
+            largestChunkRowVariable = metaData.name;
           }
         } catch (const netCDF::exceptions::NcException& except) {
           fprintf(stderr, "Error adding variable: %s with name: %s Internal netCDF exception\n", varName.c_str(), metaData.name.c_str());
@@ -294,6 +358,15 @@ void WriteOutputNetCDF::initializeFile(const ProgramState* state, const OutputDa
       }
     }
   }
+
+  // With TIME_SERIES chunks, each record is written to every chunk of a chunk row of time records; if they do not all
+  // fit in the chunk cache, they are written out and read back for every record.
+  if (state->global_param.output_storage.chunking == NetCDFChunking::TIME_SERIES_CHUNKS
+      && state->global_param.output_storage.chunk_cache_mb * 1024 * 1024 < largestChunkRowBytes) {
+    fprintf(stderr, "Warning: the chunks of one OUTPUT_CHUNK_TIME row of records of the output variable %s take %.1f MB, "
+        "more than the chunk cache (OUTPUT_CHUNK_CACHE); set OUTPUT_CHUNK_CACHE to at least that, or writing the output will be slow.\n",
+        largestChunkRowVariable.c_str(), largestChunkRowBytes / (1024. * 1024.));
+  }
 }
 
 // Returns either the number of hours since the start time (if dt < 24)
@@ -324,22 +397,33 @@ void WriteOutputNetCDF::write_data_one_cell(std::vector<OutputData*>& all_out_da
   const size_t numTimeRecords = size_t(num_recs);
   const size_t lonIndex = longitudeToIndex(this->lon, state);
   const size_t latIndex = latitudeToIndex(this->lat, state);
+  const bool gathered = state->options.OUTPUT_LAYOUT == OutputLayout::GATHERED_LAYOUT;
+  const int landIndex = gathered ? state->grid.gatheredIndexOfPoint(latIndex * state->grid.numLon() + lonIndex) : 0;
 
-  if (IS_INVALID((int)timeIndex) || IS_INVALID((int)lonIndex) || IS_INVALID((int)latIndex)) {
+  if (IS_INVALID((int)timeIndex) || IS_INVALID((int)lonIndex) || IS_INVALID((int)latIndex) || landIndex < 0) {
     std::stringstream s;
-    s << "Error: Invalid index. timeIndex=" << timeIndex << ", lonIndex=" << lonIndex << ", latIndex=" << latIndex;
+    s << "Error: Invalid index. timeIndex=" << timeIndex << ", lonIndex=" << lonIndex << ", latIndex=" << latIndex << ", landIndex=" << landIndex;
     throw VICException(s.str());
   }
 
   // Defines the dimension order of how variables are written. Only variables which have more than one value have the extra values dimension.
   // If you change the dimension ordering here, make sure that it is also changed in the WriteOutputNetCDF::initializeFile() method.
   // If the z dimension position changes also change the count4 vector update inside the nested loop below.
-  const size_t start3Vals [] = { timeIndex, latIndex, lonIndex };     // (t, y, x)
-  const size_t count3Vals [] = { numTimeRecords,1,1 };
-  const size_t start4Vals [] = { timeIndex, 0, latIndex, lonIndex };  // (t, z, y, x)
-  const size_t count4Vals [] = { numTimeRecords,1,1,1 };
-  std::vector<size_t> start3(start3Vals, start3Vals + 3), count3(count3Vals, count3Vals + 3);
-  std::vector<size_t> start4(start4Vals, start4Vals + 4), count4(count4Vals, count4Vals + 4);
+  std::vector<size_t> start3(1, timeIndex), count3(1, numTimeRecords);        // (t, y, x) or (t, landcell)
+  std::vector<size_t> start4(start3), count4(count3);                         // (t, z, y, x) or (t, z, landcell)
+  start4.push_back(0);
+  count4.push_back(1);
+  if (gathered) {
+    start3.push_back(landIndex);
+    start4.push_back(landIndex);
+  } else {
+    start3.push_back(latIndex);
+    start3.push_back(lonIndex);
+    start4.push_back(latIndex);
+    start4.push_back(lonIndex);
+  }
+  count3.resize(start3.size(), 1);
+  count4.resize(start4.size(), 1);
 
   std::multimap<std::string, netCDF::NcVar> allVars = netCDF->getVars();
 
@@ -383,8 +467,8 @@ void WriteOutputNetCDF::write_data_one_cell(std::vector<OutputData*>& all_out_da
   }
 }
 
-// This is called for all cells at once (intended for multithreading), writing data for one time record to file.
-void WriteOutputNetCDF::write_data_all_cells(std::vector<OutputData*>& all_out_data, out_data_file_struct *out_data_files_template, const int output_rec, const ProgramState* state) {
+// This is called for all cells at once (intended for multithreading), writing data for num_recs consecutive time records to file.
+void WriteOutputNetCDF::write_data_all_cells(const OutputAccumulator& accumulator, const int first_record, const int num_recs, const int output_rec, const ProgramState* state) {
 
   if (netCDF == NULL) {
 	  fprintf(stderr, "Warning: could not write to netCDF file. Record %04i\t Lat: %f, Lon: %f. File: \"%s\".\n",
@@ -392,64 +476,81 @@ void WriteOutputNetCDF::write_data_all_cells(std::vector<OutputData*>& all_out_d
     return;
   }
 
-	const size_t timeIndex = size_t(output_rec);
-	const size_t start3Vals [] = { timeIndex, 0, 0 };     // (t, y, x)
-	const size_t count3Vals [] = { 1,(size_t) state->global_param.gridNumLatDivisions,(size_t) state->global_param.gridNumLonDivisions };
-	const size_t start4Vals [] = { timeIndex, 0, 0, 0 };  // (t, z, y, x)
-	const size_t count4Vals [] = { 1,1,(size_t) state->global_param.gridNumLatDivisions,(size_t) state->global_param.gridNumLonDivisions };
-	std::vector<size_t> start3(start3Vals, start3Vals + 3), count3(count3Vals, count3Vals + 3);
-	std::vector<size_t> start4(start4Vals, start4Vals + 4), count4(count4Vals, count4Vals + 4);
+  pack_frame(accumulator, first_record, num_recs, output_rec, frame, state);
+  write_frame(frame, state);
+}
 
-	std::multimap<std::string, netCDF::NcVar> allVars = netCDF->getVars();
-	int num_cells = state->global_param.gridNumLatDivisions * state->global_param.gridNumLonDivisions;
-	bool *modeled_cell_mask_ptr;
-
-	// Loop through (legacy) out_data_files_template for listing of output variables
-	for (int file_idx = 0; file_idx < state->options.Noutfiles; file_idx++) {
-		// Loop over this output file's data variables
-		for (int var_idx = 0; var_idx < out_data_files_template[file_idx].nvars; var_idx++) {
-			// Create temporary array of data for this variable across all cells
-			float *vardata, *vardata_ptr;
-			int varnumelem = all_out_data[0][out_data_files_template[file_idx].varid[var_idx]].nelem;
-			bool use4Dimensions = varnumelem > 1;
-			int vardatasize = varnumelem * num_cells;
-			int modeled_cell_idx = 0; // index among modeled cells
-
-			vardata = new float [vardatasize];
-			vardata_ptr = vardata;
-
-			// Interleave data from each cell for this variable in temporary array vardata
-			for (int elem=0; elem<varnumelem; elem++) {
-				modeled_cell_mask_ptr = state->modeled_cell_mask;
-				modeled_cell_idx = 0;
-				for (int cell_idx = 0; cell_idx < num_cells; cell_idx++) {
-					if (*modeled_cell_mask_ptr) { // Check if this cell is marked as modeled in modeled_cell_mask
-						*vardata_ptr = all_out_data[modeled_cell_idx][out_data_files_template[file_idx].varid[var_idx]].aggdata[elem];
-						modeled_cell_idx++;
-					}
-					else {
-						*vardata_ptr = NETCDF_FILL_VALUE;
-					}
-					modeled_cell_mask_ptr++;
-					vardata_ptr++;
+// Scatters num_recs output records of every cell onto full-grid arrays, one per output variable. The frame's buffers are
+// reused between calls, so only the first call for a given frame (or a frame with more records) allocates.
+void WriteOutputNetCDF::pack_frame(const OutputAccumulator& accumulator, const int first_record, const int num_recs, const int output_rec, OutputFrame& frame, const ProgramState* state) {
+
+	// Grid points of the cells (GRID layout, the other points being filled), or their land cell indices (GATHERED)
+	const bool gathered = state->options.OUTPUT_LAYOUT == OutputLayout::GATHERED_LAYOUT;
+	const size_t num_cells = gathered ? state->grid.gatheredPoints().size() : state->grid.numPoints();
+	const std::vector<size_t>& flat_indices = gathered ? state->grid.gatheredIndices() : state->grid.flatIndices();
+
+	frame.output_rec = output_rec;
+	frame.num_recs = num_recs;
+	frame.variables.resize(accumulator.numWrittenVariables());
+
+	// The variables are in (legacy) out_data_files_template order
+	for (unsigned int frame_var_idx = 0; frame_var_idx < accumulator.numWrittenVariables(); frame_var_idx++) {
+		const OutputAccumulator::Variable& accumulated = accumulator.writtenVariable(frame_var_idx);
+		OutputFrame::Variable& variable = frame.variables[frame_var_idx];
+		variable.vicName = accumulated.varname;
+		variable.ncName = state->output_mapping.at(variable.vicName).name;
+		variable.nelem = accumulated.nelem;
+		variable.data.resize(num_recs * accumulated.nelem * num_cells);
+		float *vardata_ptr = &variable.data[0];
+
+		// The modeled cells of each element are contiguous in the accumulator, in cell order; each goes to its grid point
+		for (int rec = first_record; rec < first_record + num_recs; rec++) {
+			for (int elem=0; elem<accumulated.nelem; elem++) {
+				const double *aggdata_ptr = accumulator.values(accumulated, rec, elem);
+				if (!gathered) {
+					std::fill(vardata_ptr, vardata_ptr + num_cells, (float) NETCDF_FILL_VALUE);
 				}
-			}
-			// Write data to file for this variable
-			try {
-				NcVar variable = allVars.find(state->output_mapping.at(all_out_data[0][out_data_files_template[file_idx].varid[var_idx]].varname).name)->second;
-
-				if (use4Dimensions) {
-					count4.at(1) = varnumelem;  // Set the number of values to write to the z dimension
-					variable.putVar(start4, count4, vardata);
-				} else {
-					variable.putVar(start3, count3, vardata);
+				for (size_t cell_idx = 0; cell_idx < flat_indices.size(); cell_idx++) {
+					vardata_ptr[flat_indices[cell_idx]] = aggdata_ptr[cell_idx];
 				}
-			} catch (std::exception& e) {
-				fprintf(stderr, "Error writing variable: %s, at timeIndex: %d\n", all_out_data[0][out_data_files_template[file_idx].varid[var_idx]].varname.c_str(), (int)timeIndex);
+				vardata_ptr += num_cells;
+			}
+		}
+	}
+}
+
+// Writes a frame produced by pack_frame() to the output file, one putVar per variable covering all of its records.
+void WriteOutputNetCDF::write_frame(const OutputFrame& frame, const ProgramState* state) {
+
+	const size_t timeIndex = size_t(frame.output_rec);
+	const std::vector<size_t> spatialSizes = spatialDimensionSizes(state);
+	std::vector<size_t> start3(1, timeIndex), count3(1, (size_t) frame.num_recs);  // (t, y, x) or (t, landcell)
+	std::vector<size_t> start4(start3), count4(count3);                             // (t, z, y, x) or (t, z, landcell)
+	start4.push_back(0);
+	count4.push_back(1);
+	start3.resize(start3.size() + spatialSizes.size(), 0);
+	start4.resize(start4.size() + spatialSizes.size(), 0);
+	count3.insert(count3.end(), spatialSizes.begin(), spatialSizes.end());
+	count4.insert(count4.end(), spatialSizes.begin(), spatialSizes.end());
 
-				throw;
+	std::multimap<std::string, netCDF::NcVar> allVars = netCDF->getVars();
+
+	for (unsigned int var_idx = 0; var_idx < frame.variables.size(); var_idx++) {
+		const OutputFrame::Variable& frameVariable = frame.variables[var_idx];
+		// Write data to file for this variable
+		try {
+			NcVar variable = allVars.find(frameVariable.ncName)->second;
+
+			if (frameVariable.nelem > 1) {
+				count4.at(1) = frameVariable.nelem;  // Set the number of values to write to the z dimension
+				variable.putVar(start4, count4, &frameVariable.data[0]);
+			} else {
+				variable.putVar(start3, count3, &frameVariable.data[0]);
 			}
-			delete [] vardata;
+		} catch (std::exception& e) {
+			fprintf(stderr, "Error writing variable: %s, at timeIndex: %d\n", frameVariable.vicName.c_str(), (int)timeIndex);
+
+			throw;
 		}
 	}
 }
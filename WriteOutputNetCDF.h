@@ -4,6 +4,8 @@
 #include <string>
 #include "user_def.h"
 #include "WriteOutputFormat.h"
+#include "OutputAccumulator.h"
+#include "NetCDFStorage.h"
 
 #if NETCDF_OUTPUT_AVAILABLE
 
@@ -11,9 +13,26 @@ namespace netCDF {
   class NcFile;
 }
 
+// Consecutive output records for every variable being written, scattered to the full grid (or gathered to the land
+// cells, OUTPUT_LAYOUT GATHERED) and packed ready for putVar.
+struct OutputFrame {
+  struct Variable {
+    std::string ncName;       // NetCDF variable name (after output_mapping)
+    std::string vicName;      // VIC output variable name, for error messages
+    int nelem;
+    std::vector<float> data;  // (rec, elem, lat, lon), unmodeled cells holding NETCDF_FILL_VALUE; or (rec, elem, landcell)
+  };
+  int output_rec;             // first output record
+  int num_recs;
+  std::vector<Variable> variables;
+};
+
 class WriteOutputNetCDF: public WriteOutputFormat {
 public:
   WriteOutputNetCDF(const ProgramState* state);
+  // The output file of the OUTFILEs aggregated over out_dt hours: NETCDF_OUTPUT_FILENAME for OUT_STEP, and that name
+  // with "_<out_dt>h" inserted before its extension for other intervals.
+  WriteOutputNetCDF(const ProgramState* state, int out_dt);
   ~WriteOutputNetCDF();
   const char* getDescriptionOfOutputType();
   // This should only be called once per invocation of VIC. It creates a fresh netCDF output file.
@@ -21,12 +40,20 @@ public:
   void openFile();
   void compressFiles();
   void write_data_one_cell(std::vector<OutputData*>& all_out_data, out_data_file_struct *out_data_files_template, const int chunk_start_rec, const int num_recs, const ProgramState* state);
-  void write_data_all_cells(std::vector<OutputData*>& all_out_data, out_data_file_struct *out_data_files_template, const int output_rec, const ProgramState *state);
+  // Writes records [first_record, first_record + num_recs) of the accumulator as output records output_rec onwards.
+  void write_data_all_cells(const OutputAccumulator& accumulator, const int first_record, const int num_recs, const int output_rec, const ProgramState *state);
+  // write_data_all_cells() split in two, so that packing and writing can happen on different threads (see WriteOutputAsync).
+  void pack_frame(const OutputAccumulator& accumulator, const int first_record, const int num_recs, const int output_rec, OutputFrame& frame, const ProgramState *state);
+  void write_frame(const OutputFrame& frame, const ProgramState *state);
   void write_header(OutputData *out_data, const dmy_struct *dmy, const ProgramState* state);
   int getLengthOfTimeDimension(const ProgramState* state);
   int getTimeIndex(const dmy_struct* curTime, const int timeIndexDivisor, const ProgramState* state);
   netCDF::NcFile* netCDF;
   int timeIndexDivisor;
+  int outDt;          // aggregation interval of the records in hours
+private:
+  OutputFrame frame;  // reused by write_data_all_cells() between records
+  NetCDFStorage storage;  // chunking, filters and chunk cache of the variables (OUTPUT_CHUNKING etc.)
 };
 
 #endif /* NETCDF_OUTPUT_AVAILABLE */
@@ -3,7 +3,7 @@
 #ifndef ATMOS_ENERGY_BAL_H_
 #define ATMOS_ENERGY_BAL_H_
 
-class AtmosEnergyBal : public RootBrent {
+class AtmosEnergyBal : public RootBrent<AtmosEnergyBal> {
 public:
   AtmosEnergyBal(double LatentHeat, double NetRadiation, double Ra, double Tair,
       double atmos_density, double InSensible, double *SensibleHeat) :
@@ -11,6 +11,7 @@ public:
           atmos_density), InSensible(InSensible), SensibleHeat(SensibleHeat) {
   }
   double calculate(double Tcanopy);
+  SolverId solver() const { return SOLVER_ATMOS_ENERGY_BAL; }
 
 private:
   double  LatentHeat;
@@ -22,5 +23,8 @@ private:
   double *SensibleHeat;
 };
 
+// Instantiated in func_atmos_energy_bal.c
+extern template class RootBrent<AtmosEnergyBal>;
+
 
 #endif /* ATMOS_ENERGY_BAL_H_ */
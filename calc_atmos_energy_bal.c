@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "vicNl.h"
+#include "EventLog.h"
 
 static char vcid[] = "$Id$";
 
@@ -56,6 +57,8 @@ double calc_atmos_energy_bal(double  InOverSensible,
   2009-Jun-19 Added T fbflag to indicate whether TFALLBACK occurred.	TJB
   2009-Sep-19 Added T fbcount to count TFALLBACK occurrences.		TJB
   2009-Dec-11 Replaced "assert" statements with "if" statements.	TJB
+  2026-Oct-17 The error dumps are reported as solver error events to the
+	      EventLog instead of being printed to stderr.	AG
 ************************************************************************/
 
   double AtmosLatent;
@@ -169,18 +172,21 @@ double error_print_atmos_energy_bal(double Tcanopy, double LatentHeat,
     double InSensible, double *SensibleHeat, char *ErrorString) {
 
   // print variable values
-  fprintf(stderr, "%s", ErrorString);
-  fprintf(stderr, "ERROR: calc_atmos_energy_bal failed to converge to a solution in root_brent.  Variable values will be dumped to the screen, check for invalid values.\n");
-  fprintf(stderr, "LatentHeat = %f\n",  LatentHeat);
-  fprintf(stderr, "NetRadiation = %f\n",  NetRadiation);
-  fprintf(stderr, "Ra = %f\n",  Ra);
-  fprintf(stderr, "Tair = %f\n",  Tair);
-  fprintf(stderr, "atmos_density = %f\n",  atmos_density);
-  fprintf(stderr, "InSensible = %f\n",  InSensible);
-
-  fprintf(stderr, "*SensibleHeat = %f\n", *SensibleHeat);
+  EventMessage message;
+  FILE* out = message.stream();
+  fprintf(out, "%s", ErrorString);
+  fprintf(out, "ERROR: calc_atmos_energy_bal failed to converge to a solution in root_brent.  Variable values will be dumped to the screen, check for invalid values.\n");
+  fprintf(out, "LatentHeat = %f\n",  LatentHeat);
+  fprintf(out, "NetRadiation = %f\n",  NetRadiation);
+  fprintf(out, "Ra = %f\n",  Ra);
+  fprintf(out, "Tair = %f\n",  Tair);
+  fprintf(out, "atmos_density = %f\n",  atmos_density);
+  fprintf(out, "InSensible = %f\n",  InSensible);
+
+  fprintf(out, "*SensibleHeat = %f\n", *SensibleHeat);
  
-  fprintf(stderr, "Finished writing calc_atmos_energy_bal variables.\nTry increasing CANOPY_DT to get model to complete cell.\nThen check output for instabilities.\n");
+  fprintf(out, "Finished writing calc_atmos_energy_bal variables.\nTry increasing CANOPY_DT to get model to complete cell.\nThen check output for instabilities.\n");
+  EventLog::instance().report(EVENT_SOLVER_ERROR, SOLVER_ATMOS_ENERGY_BAL, message.text());
 
   return( ERROR );
 }
@@ -190,14 +196,17 @@ double error_print_atmos_moist_bal(double VPcanopy, double InLatent, double Lv,
     double *AtmosLatent, char *ErrorString) {
 
   // print variable values
-  fprintf(stderr, "%s", ErrorString);
-  fprintf(stderr, "InLatent = %f\n",  InLatent);
-  fprintf(stderr, "Lv = %f\n",  Lv);
-  fprintf(stderr, "Ra = %f\n",  Ra);
-  fprintf(stderr, "atmos_density = %f\n",  atmos_density);
-  fprintf(stderr, "gamma = %f\n",  gamma);
-  fprintf(stderr, "vp = %f\n", vp);
-  fprintf(stderr, "AtmosLatent = %f\n", *AtmosLatent);
+  EventMessage message;
+  FILE* out = message.stream();
+  fprintf(out, "%s", ErrorString);
+  fprintf(out, "InLatent = %f\n",  InLatent);
+  fprintf(out, "Lv = %f\n",  Lv);
+  fprintf(out, "Ra = %f\n",  Ra);
+  fprintf(out, "atmos_density = %f\n",  atmos_density);
+  fprintf(out, "gamma = %f\n",  gamma);
+  fprintf(out, "vp = %f\n", vp);
+  fprintf(out, "AtmosLatent = %f\n", *AtmosLatent);
+  EventLog::instance().report(EVENT_SOLVER_ERROR, SOLVER_ATMOS_ENERGY_BAL, message.text());
  
   vicerror("Finished writing calc_atmos_moist_bal variables.\nTry increasing CANOPY_VP to get model to complete cell.\nThen check output for instabilities.");
 
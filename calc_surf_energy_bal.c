@@ -1,9 +1,56 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "vicNl.h"
+#include "EventLog.h"
 
 static char vcid[] = "$Id$";
 
+/*****************************************************************
+  Solves for the surface temperature.  With TSURF_WARM_START the
+  root is first looked for in a bracket around the previous
+  surface temperature, twice as wide as its last change (at least
+  SURF_WARM_DT_MIN, at most SURF_DT); if that does not bracket the
+  root, the default bounds T_lower and T_upper are used.
+*****************************************************************/
+static double solve_surf_temperature(SurfEnergyBal     &solver,
+                                     double             Ts_old,
+                                     double             T_lower,
+                                     double             T_upper,
+                                     int                INCLUDE_SNOW,
+                                     energy_bal_struct *energy,
+                                     char              *ErrorString,
+                                     const ProgramState *state)
+{
+  if (!state->options.TSURF_WARM_START) {
+    return solver.root_brent(T_lower, T_upper, ErrorString);
+  }
+
+  double half_width = 2 * energy->Tsurf_dT;
+  if (half_width < SURF_WARM_DT_MIN) half_width = SURF_WARM_DT_MIN;
+  if (half_width > SURF_DT) half_width = SURF_DT;
+
+  double lower = Ts_old - half_width;
+  double upper = Ts_old + half_width;
+  if ( INCLUDE_SNOW ) {
+    /** snow surface temperature cannot exceed 0C **/
+    if (Ts_old > 0) lower = -half_width;
+    if (upper > 0) upper = 0.;
+  }
+
+  SolverCounters *counters = SolverCounters::current();
+  if (counters != NULL) counters->warmStarts++;
+
+  double Tsurf = solver.root_brent_in_bracket(lower, upper, ErrorString);
+  if (solver.resultIsError(Tsurf)) {
+    if (counters != NULL) counters->warmStartFallbacks++;
+    Tsurf = solver.root_brent(T_lower, T_upper, ErrorString);
+  }
+  if (!solver.resultIsError(Tsurf)) {
+    energy->Tsurf_dT = fabs(Tsurf - Ts_old);
+  }
+  return Tsurf;
+}
+
 double calc_surf_energy_bal(double             latent_heat_Le,
 			    double             LongUnderIn,
 			    double             NetLongSnow, // net LW at snow surface
@@ -159,6 +206,9 @@ double calc_surf_energy_bal(double             latent_heat_Le,
 	      ground flux are always computed.				TJB
   2011-Aug-09 Now initialize soil thermal properties for all modes of
 	      operation.						TJB
+  2026-Oct-17 Added options.TSURF_WARM_START: the surface temperature
+	      is first searched for in a narrow bracket around the
+	      previous one.	AG
 ***************************************************************/
 {
   int      FIRST_SOLN[2];
@@ -343,7 +393,8 @@ double calc_surf_energy_bal(double             latent_heat_Le,
         &energy->deltaH, &energy->fusion, &energy->grnd_flux,
         &energy->latent, &energy->latent_sub,
         &energy->sensible, &energy->snow_flux, &energy->error, state);
-    Tsurf = surfEnergyBalIterative.root_brent(T_lower, T_upper, ErrorString);
+    Tsurf = solve_surf_temperature(surfEnergyBalIterative, Ts_old, T_lower, T_upper,
+                                   INCLUDE_SNOW, energy, ErrorString, state);
  
     if(surfEnergyBalIterative.resultIsError(Tsurf)) {
       if (state->options.TFALLBACK) {
@@ -352,7 +403,6 @@ double calc_surf_energy_bal(double             latent_heat_Le,
         Tsurf_fbcount++;
       }
       else {
-        fprintf(stderr, "SURF_DT = %.2f\n", SURF_DT);
         error = error_print_surf_energy_bal(Tsurf, dmy->year, dmy->month, dmy->day, dmy->hour, VEG,
 					   veg_class, delta_t, Cs1, Cs2, D1, D2, 
 					   T1_old, T2, Ts_old, 
@@ -421,7 +471,8 @@ double calc_surf_energy_bal(double             latent_heat_Le,
           &energy->grnd_flux, &energy->latent, &energy->latent_sub,
           &energy->sensible, &energy->snow_flux, &energy->error, state);
       
-      Tsurf = surfEnergyBalIter2.root_brent(T_lower, T_upper, ErrorString);
+      Tsurf = solve_surf_temperature(surfEnergyBalIter2, Ts_old, T_lower, T_upper,
+                                     INCLUDE_SNOW, energy, ErrorString, state);
 
 
       if(surfEnergyBalIter2.resultIsError(Tsurf)) {
@@ -739,143 +790,149 @@ double error_print_surf_energy_bal(double Ts, int year, int month, int day, int
   Modifications:
   2009-Mar-03 Fixed format string for print statement, eliminates
 	      compiler WARNING.						KAC via TJB
+  2026-Oct-17 The dump is reported as a solver error event to the
+	      EventLog instead of being printed to stderr.	AG
 **********************************************************************/
 
-  fprintf(stderr, "%s", ErrorString);
-  fprintf(stderr, "ERROR: calc_surf_energy_bal failed to converge to a solution in root_brent.  Variable values will be dumped to the screen, check for invalid values.\n");
+  EventMessage message;
+  FILE* out = message.stream();
+  fprintf(out, "%s", ErrorString);
+  fprintf(out, "ERROR: calc_surf_energy_bal failed to converge to a solution in root_brent.  Variable values will be dumped to the screen, check for invalid values.\n");
 
   /* Print Variables */
   /* general model terms */
-  fprintf(stderr, "year = %i\n", year);
-  fprintf(stderr, "month = %i\n", month);
-  fprintf(stderr, "day = %i\n", day);
-  fprintf(stderr, "hour = %i\n", hour);
-  fprintf(stderr, "VEG = %i\n", VEG);
-  fprintf(stderr, "veg_class = %i\n", veg_class);
-  fprintf(stderr, "delta_t = %f\n",  delta_t);
+  fprintf(out, "year = %i\n", year);
+  fprintf(out, "month = %i\n", month);
+  fprintf(out, "day = %i\n", day);
+  fprintf(out, "hour = %i\n", hour);
+  fprintf(out, "VEG = %i\n", VEG);
+  fprintf(out, "veg_class = %i\n", veg_class);
+  fprintf(out, "delta_t = %f\n",  delta_t);
+  fprintf(out, "SURF_DT = %.2f\n", SURF_DT);
 
   /* soil layer terms */
-  fprintf(stderr, "Cs1 = %f\n",  Cs1);
-  fprintf(stderr, "Cs2 = %f\n",  Cs2);
-  fprintf(stderr, "D1 = %f\n",  D1);
-  fprintf(stderr, "D2 = %f\n",  D2);
-  fprintf(stderr, "T1_old = %f\n",  T1_old);
-  fprintf(stderr, "T2 = %f\n",  T2);
-  fprintf(stderr, "Ts_old = %f\n",  Ts_old);
-  fprintf(stderr, "b_infilt = %f\n",  soil_con->b_infilt);
-  fprintf(stderr, "bubble = %f\n",  bubble);
-  fprintf(stderr, "dp = %f\n",  dp);
-  fprintf(stderr, "expt = %f\n",  expt);
-  fprintf(stderr, "ice0 = %f\n",  ice0);
-  fprintf(stderr, "kappa1 = %f\n",  kappa1);
-  fprintf(stderr, "kappa2 = %f\n",  kappa2);
-  fprintf(stderr, "max_infil = %f\n",  soil_con->max_infil);
-  fprintf(stderr, "max_moist = %f\n",  max_moist);
-  fprintf(stderr, "moist = %f\n",  moist);
-
-  fprintf(stderr, "*Wcr = %f\n",  *soil_con->Wcr);
-  fprintf(stderr, "*Wpwp = %f\n",  *soil_con->Wpwp);
-  fprintf(stderr, "*depth = %f\n",  *soil_con->depth);
-  fprintf(stderr, "*resid_moist = %f\n",  *soil_con->resid_moist);
-
-  fprintf(stderr, "*root = %f\n",  *root);
+  fprintf(out, "Cs1 = %f\n",  Cs1);
+  fprintf(out, "Cs2 = %f\n",  Cs2);
+  fprintf(out, "D1 = %f\n",  D1);
+  fprintf(out, "D2 = %f\n",  D2);
+  fprintf(out, "T1_old = %f\n",  T1_old);
+  fprintf(out, "T2 = %f\n",  T2);
+  fprintf(out, "Ts_old = %f\n",  Ts_old);
+  fprintf(out, "b_infilt = %f\n",  soil_con->b_infilt);
+  fprintf(out, "bubble = %f\n",  bubble);
+  fprintf(out, "dp = %f\n",  dp);
+  fprintf(out, "expt = %f\n",  expt);
+  fprintf(out, "ice0 = %f\n",  ice0);
+  fprintf(out, "kappa1 = %f\n",  kappa1);
+  fprintf(out, "kappa2 = %f\n",  kappa2);
+  fprintf(out, "max_infil = %f\n",  soil_con->max_infil);
+  fprintf(out, "max_moist = %f\n",  max_moist);
+  fprintf(out, "moist = %f\n",  moist);
+
+  fprintf(out, "*Wcr = %f\n",  *soil_con->Wcr);
+  fprintf(out, "*Wpwp = %f\n",  *soil_con->Wpwp);
+  fprintf(out, "*depth = %f\n",  *soil_con->depth);
+  fprintf(out, "*resid_moist = %f\n",  *soil_con->resid_moist);
+
+  fprintf(out, "*root = %f\n",  *root);
 
   /* meteorological forcing terms */
-  fprintf(stderr, "UnderStory = %i\n", UnderStory);
-  fprintf(stderr, "overstory = %i\n", overstory);
-
-  fprintf(stderr, "NetShortBare = %f\n",  NetShortBare); 
-  fprintf(stderr, "NetShortGrnd = %f\n",  NetShortGrnd); 
-  fprintf(stderr, "NetShortSnow = %f\n",  NetShortSnow); 
-  fprintf(stderr, "Tair = %f\n",  Tair);
-  fprintf(stderr, "atmos_density = %f\n",  atmos_density);
-  fprintf(stderr, "atmos_pressure = %f\n",  atmos_pressure);
-  fprintf(stderr, "elevation = %f\n",  soil_con->elevation);
-  fprintf(stderr, "emissivity = %f\n",  emissivity);
-  fprintf(stderr, "LongBareIn = %f\n",  LongBareIn); 
-  fprintf(stderr, "LongSnowIn = %f\n",  LongSnowIn); 
-  fprintf(stderr, "mu = %f\n",  precipitation_mu);
-  fprintf(stderr, "surf_atten = %f\n",  surf_atten);
-  fprintf(stderr, "vp = %f\n",  vp);
-  fprintf(stderr, "vpd = %f\n",  vpd);
-
-  fprintf(stderr, "*Wdew = %f\n",  *Wdew);
-  fprintf(stderr, "*displacement = %f\n",  displacement.snowCovered);
-  fprintf(stderr, "*ra = %f\n",  aero_resist.snowCovered);
-  fprintf(stderr, "*ra_used = %f\n",  ra_used.surface);
-  fprintf(stderr, "*rainfall = %f\n",  *rainfall);
-  fprintf(stderr, "*ref_height = %f\n",  ref_height.snowCovered);
-  fprintf(stderr, "*roughness = %f\n",  roughness.snowCovered);
-  fprintf(stderr, "*wind = %f\n",  wind_speed.snowCovered);
+  fprintf(out, "UnderStory = %i\n", UnderStory);
+  fprintf(out, "overstory = %i\n", overstory);
+
+  fprintf(out, "NetShortBare = %f\n",  NetShortBare); 
+  fprintf(out, "NetShortGrnd = %f\n",  NetShortGrnd); 
+  fprintf(out, "NetShortSnow = %f\n",  NetShortSnow); 
+  fprintf(out, "Tair = %f\n",  Tair);
+  fprintf(out, "atmos_density = %f\n",  atmos_density);
+  fprintf(out, "atmos_pressure = %f\n",  atmos_pressure);
+  fprintf(out, "elevation = %f\n",  soil_con->elevation);
+  fprintf(out, "emissivity = %f\n",  emissivity);
+  fprintf(out, "LongBareIn = %f\n",  LongBareIn); 
+  fprintf(out, "LongSnowIn = %f\n",  LongSnowIn); 
+  fprintf(out, "mu = %f\n",  precipitation_mu);
+  fprintf(out, "surf_atten = %f\n",  surf_atten);
+  fprintf(out, "vp = %f\n",  vp);
+  fprintf(out, "vpd = %f\n",  vpd);
+
+  fprintf(out, "*Wdew = %f\n",  *Wdew);
+  fprintf(out, "*displacement = %f\n",  displacement.snowCovered);
+  fprintf(out, "*ra = %f\n",  aero_resist.snowCovered);
+  fprintf(out, "*ra_used = %f\n",  ra_used.surface);
+  fprintf(out, "*rainfall = %f\n",  *rainfall);
+  fprintf(out, "*ref_height = %f\n",  ref_height.snowCovered);
+  fprintf(out, "*roughness = %f\n",  roughness.snowCovered);
+  fprintf(out, "*wind = %f\n",  wind_speed.snowCovered);
  
   /* latent heat terms */
-  fprintf(stderr, "Le = %f\n",   Le);
+  fprintf(out, "Le = %f\n",   Le);
 
   /* snowpack terms */
-  fprintf(stderr, "Advection = %f\n",  Advection);
-  fprintf(stderr, "OldTSurf = %f\n",  OldTSurf);
-  fprintf(stderr, "TPack = %f\n",  TPack);
-  fprintf(stderr, "Tsnow_surf = %f\n",  Tsnow_surf);
-  fprintf(stderr, "kappa_snow = %f\n",  kappa_snow);
-  fprintf(stderr, "melt_energy = %f\n",  melt_energy);
-  fprintf(stderr, "snow_coverage = %f\n",  snow_coverage);
-  fprintf(stderr, "snow_density = %f\n",  snow_density);
-  fprintf(stderr, "snow_swq = %f\n",  snow_swq);
-  fprintf(stderr, "snow_water = %f\n",  snow_water);
-
-  fprintf(stderr, "*deltaCC = %f\n",  *deltaCC);
-  fprintf(stderr, "*refreeze_energy = %f\n",  *refreeze_energy);
-  fprintf(stderr, "*VaporMassFlux = %f\n",  *VaporMassFlux);
+  fprintf(out, "Advection = %f\n",  Advection);
+  fprintf(out, "OldTSurf = %f\n",  OldTSurf);
+  fprintf(out, "TPack = %f\n",  TPack);
+  fprintf(out, "Tsnow_surf = %f\n",  Tsnow_surf);
+  fprintf(out, "kappa_snow = %f\n",  kappa_snow);
+  fprintf(out, "melt_energy = %f\n",  melt_energy);
+  fprintf(out, "snow_coverage = %f\n",  snow_coverage);
+  fprintf(out, "snow_density = %f\n",  snow_density);
+  fprintf(out, "snow_swq = %f\n",  snow_swq);
+  fprintf(out, "snow_water = %f\n",  snow_water);
+
+  fprintf(out, "*deltaCC = %f\n",  *deltaCC);
+  fprintf(out, "*refreeze_energy = %f\n",  *refreeze_energy);
+  fprintf(out, "*VaporMassFlux = %f\n",  *VaporMassFlux);
 
   /* soil node terms */
-  fprintf(stderr, "Nnodes = %i\n", Nnodes);
+  fprintf(out, "Nnodes = %i\n", Nnodes);
 
   /* spatial frost terms */
 #if SPATIAL_FROST    
-  fprintf(stderr, "*frost_fract = %f\n",  *frost_fract);
+  fprintf(out, "*frost_fract = %f\n",  *frost_fract);
 #endif
 
   /* control flags */
-  fprintf(stderr, "INCLUDE_SNOW = %i\n", INCLUDE_SNOW);
-  fprintf(stderr, "FS_ACTIVE = %i\n", soil_con->FS_ACTIVE);
-  fprintf(stderr, "NOFLUX = %i\n", NOFLUX);
-  fprintf(stderr, "EXP_TRANS = %i\n", EXP_TRANS);
-  fprintf(stderr, "SNOWING = %i\n", SNOWING);
+  fprintf(out, "INCLUDE_SNOW = %i\n", INCLUDE_SNOW);
+  fprintf(out, "FS_ACTIVE = %i\n", soil_con->FS_ACTIVE);
+  fprintf(out, "NOFLUX = %i\n", NOFLUX);
+  fprintf(out, "EXP_TRANS = %i\n", EXP_TRANS);
+  fprintf(out, "SNOWING = %i\n", SNOWING);
 
-  fprintf(stderr, "*FIRST_SOLN = %i\n", *FIRST_SOLN);
+  fprintf(out, "*FIRST_SOLN = %i\n", *FIRST_SOLN);
 
   /* returned energy balance terms */
-  fprintf(stderr, "*NetLongBare = %f\n",  *NetLongBare); 
-  fprintf(stderr, "*NetLongSnow = %f\n",  *NetLongSnow); 
-  fprintf(stderr, "*T1 = %f\n",  *T1);
-  fprintf(stderr, "*deltaH = %f\n",  *deltaH);
-  fprintf(stderr, "*fusion = %f\n",  *fusion);
-  fprintf(stderr, "*grnd_flux = %f\n",  *grnd_flux);
-  fprintf(stderr, "*latent_heat = %f\n",  *latent_heat);
-  fprintf(stderr, "*latent_heat_sub = %f\n",  *latent_heat_sub);
-  fprintf(stderr, "*sensible_heat = %f\n",  *sensible_heat);
-  fprintf(stderr, "*snow_flux = %f\n",  *snow_flux);
-  fprintf(stderr, "*store_error = %f\n",  *store_error);
-
-  write_layer(layer_wet, veg_class, state->options.Nlayer, soil_con->frost_fract);
+  fprintf(out, "*NetLongBare = %f\n",  *NetLongBare); 
+  fprintf(out, "*NetLongSnow = %f\n",  *NetLongSnow); 
+  fprintf(out, "*T1 = %f\n",  *T1);
+  fprintf(out, "*deltaH = %f\n",  *deltaH);
+  fprintf(out, "*fusion = %f\n",  *fusion);
+  fprintf(out, "*grnd_flux = %f\n",  *grnd_flux);
+  fprintf(out, "*latent_heat = %f\n",  *latent_heat);
+  fprintf(out, "*latent_heat_sub = %f\n",  *latent_heat_sub);
+  fprintf(out, "*sensible_heat = %f\n",  *sensible_heat);
+  fprintf(out, "*snow_flux = %f\n",  *snow_flux);
+  fprintf(out, "*store_error = %f\n",  *store_error);
+
+  write_layer(layer_wet, veg_class, state->options.Nlayer, soil_con->frost_fract, out);
 
   if(state->options.DIST_PRCP)
-    write_layer(layer_dry, veg_class, state->options.Nlayer, soil_con->frost_fract);
+    write_layer(layer_dry, veg_class, state->options.Nlayer, soil_con->frost_fract, out);
 
-  write_vegvar(&(veg_var_wet[0]),veg_class);
+  write_vegvar(&(veg_var_wet[0]),veg_class, out);
   if(state->options.DIST_PRCP)
-    write_vegvar(&(veg_var_dry[0]),veg_class);
+    write_vegvar(&(veg_var_dry[0]),veg_class, out);
 
   if(!state->options.QUICK_FLUX) {
-    fprintf(stderr,"Node\tT\tTnew\tZsum\tkappa\tCs\tmoist\tbubble\texpt\tmax_moist\tice\n");
+    fprintf(out,"Node\tT\tTnew\tZsum\tkappa\tCs\tmoist\tbubble\texpt\tmax_moist\tice\n");
     for(int i=0;i<Nnodes;i++)
-      fprintf(stderr,"%i\t%.4f\t%.4f\t%.4f\t%.4f\t%.4f\t%.4f\t%.4f\t%.4f\t%.4f\t%.4f\n",
+      fprintf(out,"%i\t%.4f\t%.4f\t%.4f\t%.4f\t%.4f\t%.4f\t%.4f\t%.4f\t%.4f\t%.4f\n",
 	      i, T_node[i], Tnew_node[i], soil_con->Zsum_node[i], kappa_node[i],
 	      Cs_node[i], moist_node[i], soil_con->bubble_node[i], soil_con->expt_node[i],
 	      soil_con->max_moist_node[i], ice_node[i]);
   }
   
-  fprintf(stderr,"**********\n**********\nFinished writing calc_surf_energy_bal variables.\nTry increasing SURF_DT to get model to complete cell.\nThen check output for instabilities.\n**********\n**********\n");
+  fprintf(out,"**********\n**********\nFinished writing calc_surf_energy_bal variables.\nTry increasing SURF_DT to get model to complete cell.\nThen check output for instabilities.\n**********\n**********\n");
+  EventLog::instance().report(EVENT_SOLVER_ERROR, SOLVER_SURF_ENERGY_BAL, message.text());
 
   return (ERROR);
     
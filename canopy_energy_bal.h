@@ -3,7 +3,7 @@
 #ifndef CANOPY_ENERGY_BAL_H_
 #define CANOPY_ENERGY_BAL_H_
 
-class CanopyEnergyBal : public RootBrent {
+class CanopyEnergyBal : public RootBrent<CanopyEnergyBal> {
 public:
   CanopyEnergyBal(int month, int rec, double delta_t,
       const double elevation, const double* Wcr, const double* Wpwp, const double* depth,
@@ -32,6 +32,8 @@ public:
   }
 
   double calculate(double);
+
+  SolverId solver() const { return SOLVER_CANOPY_ENERGY_BAL; }
 private:
   int month;
   int rec;
@@ -83,5 +85,8 @@ private:
 
 };
 
+// Instantiated in func_canopy_energy_bal.c
+extern template class RootBrent<CanopyEnergyBal>;
+
 
 #endif /* CANOPY_ENERGY_BAL_H_ */
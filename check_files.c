@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "vicNl.h"
+#include "CellFileIndex.h"
 #include "WriteOutputNetCDF.h"
 
 static char vcid[] = "$Id$";
@@ -14,9 +15,13 @@ void initializeNetCDFOutput(const filenames_struct *fnames, const out_data_file_
 
   if (state->options.OUTPUT_FORMAT == OutputFormat::NETCDF_FORMAT) {
 #if NETCDF_OUTPUT_AVAILABLE
-    WriteOutputNetCDF output(state);
-    copy_data_file_format(outFiles, output.dataFiles, state);
-    output.initializeFile(state, outData);  // This is only done once per invocation of VIC. It creates a fresh netcdf output file.
+    // One output file per aggregation interval of the OUTFILEs
+    const std::vector<int> intervals = output_intervals(outFiles, state);
+    for (unsigned int i = 0; i < intervals.size(); i++) {
+      WriteOutputNetCDF output(state, intervals[i]);
+      copy_data_file_format(outFiles, output.dataFiles, state);
+      output.initializeFile(state, outData);  // This is only done once per invocation of VIC. It creates a fresh netcdf output file.
+    }
 
 #endif /* NETCDF_OUTPUT_AVAILABLE */
   }
@@ -33,20 +38,30 @@ filep_struct get_files(const filenames_struct *fnames, ProgramState* state)
   2005-Apr-13 Added logic for OUTPUT_FORCE option.			TJB
   2006-Oct-16 Merged infiles and outfiles structs into filep_struct.	TJB
   2006-Nov-07 Removed LAKE_MODEL option.				TJB
+  2026-Oct-17 Builds the grid cell indices of the vegparam, snowband and lakeparam
+	      files, so that cells can be located without rescanning.	AG
 
 **********************************************************************/
 {
   filep_struct file_pointers;
 
   file_pointers.soilparam   = open_file(fnames->soil, "r");
+  file_pointers.lakeparam_index = NULL;
+  file_pointers.snowband_index  = NULL;
+  file_pointers.vegparam_index  = NULL;
 
   if (!state->options.OUTPUT_FORCE) {
     file_pointers.veglib      = open_file(fnames->veglib, "r");
     file_pointers.vegparam    = open_file(fnames->veg, "r");
-    if(state->options.SNOW_BAND>1)
+    file_pointers.vegparam_index = CellFileIndex::forVegparamFile(file_pointers.vegparam, state->options.VEGPARAM_LAI ? 2 : 1);
+    if(state->options.SNOW_BAND>1) {
       file_pointers.snowband    = open_file(fnames->snowband, "r");
-    if ( state->options.LAKES )
+      file_pointers.snowband_index = CellFileIndex::forSnowbandFile(file_pointers.snowband);
+    }
+    if ( state->options.LAKES ) {
       file_pointers.lakeparam = open_file(fnames->lakeparam,"r");
+      file_pointers.lakeparam_index = CellFileIndex::forLakeparamFile(file_pointers.lakeparam);
+    }
   }
 
   return file_pointers;
@@ -2,7 +2,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "vicNl.h"
-#include <netcdf.h>
+#include "ReadForcingNetCDF.h"
  
 static char vcid[] = "$Id$";
 
@@ -28,6 +28,7 @@ void close_files(const filep_struct   *filep,
   2006-Sep-23 Implemented flexible output configuration; uses new
 	      out_data_files structure. TJB
   2006-Oct-16 Merged infiles and outfiles structs into filep_struct. TJB
+  2026-Oct-17 Closes the shared NetCDF forcing readers instead of per-cell ncids.	AG
 
 **********************************************************************/
 {
@@ -39,16 +40,15 @@ void close_files(const filep_struct   *filep,
 
   if(state->param_set.FORCE_FORMAT[0] != NETCDF)
     fclose(filep->forcing[0]);
-  else /* FIXME this should only happen ONCE per invokation of VIC! (below too) */
-    nc_close(filep->forcing_ncid[0]);
   if(compress) compress_files(fnames->forcing[0]);
   if(filep->forcing[1]!=NULL) {
-    if(state->param_set.FORCE_FORMAT[1] != NETCDF)
-      fclose(filep->forcing[1]);
-    else
-      nc_close(filep->forcing_ncid[1]);      
+    fclose(filep->forcing[1]);
     if(compress) compress_files(fnames->forcing[1]);
   }
+  /* The NetCDF forcing readers are shared by all cells and close their files here */
+  for (filenum = 0; filenum < 2; filenum++) {
+    delete filep->forcing_nc[filenum];
+  }
 
   if (!state->options.OUTPUT_FORCE) {
 
@@ -83,6 +83,8 @@ void ProgramState::display_current_settings(int mode,filenames_struct *names)
 #else
   fprintf(stderr,"NO_REWIND\t\tFALSE\n");
 #endif
+  fprintf(stderr,"FORCE_TILE_MAX_RECORDS\t%d\n",FORCE_TILE_MAX_RECORDS);
+  fprintf(stderr,"MTCLIM_GEOMETRY_CACHE_ENTRIES\t%d\n",MTCLIM_GEOMETRY_CACHE_ENTRIES);
 
   fprintf(stderr,"\n");
   fprintf(stderr,"Output Files:\n");
@@ -190,6 +192,10 @@ void ProgramState::display_current_settings(int mode,filenames_struct *names)
     fprintf(stderr,"BLOWING\t\t\tTRUE\n");
   else
     fprintf(stderr,"BLOWING\t\t\tFALSE\n");
+  if (options.BLOWING_TABLE)
+    fprintf(stderr,"BLOWING_TABLE\t\tTRUE\t%s\n",names->blowing_table);
+  else
+    fprintf(stderr,"BLOWING_TABLE\t\tFALSE\n");
   if (options.COMPUTE_TREELINE)
     fprintf(stderr,"COMPUTE_TREELINE\t\tTRUE\n");
   else
@@ -264,6 +270,14 @@ void ProgramState::display_current_settings(int mode,filenames_struct *names)
     fprintf(stderr,"QUICK_SOLVE\t\tTRUE\n");
   else
     fprintf(stderr,"QUICK_SOLVE\t\tFALSE\n");
+  if (options.TSURF_WARM_START)
+    fprintf(stderr,"TSURF_WARM_START\tTRUE\n");
+  else
+    fprintf(stderr,"TSURF_WARM_START\tFALSE\n");
+  if (options.FAST_KERNELS)
+    fprintf(stderr,"FAST_KERNELS\t\tTRUE\n");
+  else
+    fprintf(stderr,"FAST_KERNELS\t\tFALSE\n");
   if (options.SNOW_ALBEDO == USACE)
     fprintf(stderr,"SNOW_ALBEDO\t\tUSACE\n");
   else if (options.SNOW_ALBEDO == SUN1999)
@@ -326,6 +340,12 @@ void ProgramState::display_current_settings(int mode,filenames_struct *names)
         fprintf(stderr,"FORCE_FORMAT\t\tNETCDF\n");        
     }
   }
+  fprintf(stderr,"FORCE_TILE_SIZE\t\t%d\n",global_param.forcing_tile_size);
+  if (options.FORCE_SIDECAR)
+    fprintf(stderr,"FORCE_SIDECAR\t\tTRUE\n");
+  else
+    fprintf(stderr,"FORCE_SIDECAR\t\tFALSE\n");
+  fprintf(stderr,"ATMOS_WINDOW_RECORDS\t%d\n",global_param.atmos_window_records);
   fprintf(stderr,"GRID_DECIMAL\t\t%d\n",options.GRID_DECIMAL);
   if (options.ALMA_INPUT)
     fprintf(stderr,"ALMA_INPUT\t\tTRUE\n");
@@ -417,6 +437,15 @@ void ProgramState::display_current_settings(int mode,filenames_struct *names)
       fprintf(stderr,"STATE_FORMAT\tASCII\n");
     else
       fprintf(stderr,"STATE_FORMAT\tNETCDF_STATEFILE");
+    if (options.STATE_LAYOUT == OutputLayout::GATHERED_LAYOUT)
+      fprintf(stderr,"STATE_LAYOUT\t\tGATHERED\n");
+    else
+      fprintf(stderr,"STATE_LAYOUT\t\tGRID\n");
+    fprintf(stderr,"STATE_DEFLATE_LEVEL\t%d\n",global_param.state_storage.deflate_level);
+    if (global_param.state_storage.shuffle)
+      fprintf(stderr,"STATE_SHUFFLE\t\tTRUE\n");
+    else
+      fprintf(stderr,"STATE_SHUFFLE\t\tFALSE\n");
   }
   else {
     fprintf(stderr,"SAVE_STATE\t\tFALSE\n");
@@ -426,6 +455,8 @@ void ProgramState::display_current_settings(int mode,filenames_struct *names)
   fprintf(stderr,"Output Data:\n");
   fprintf(stderr,"Result dir:\t\t%s\n",names->result_dir);
   fprintf(stderr,"OUT_STEP\t\t%d\n",global_param.out_dt);
+  fprintf(stderr,"OUTPUT_BUFFER_FRAMES\t%d\n",global_param.output_buffer_frames);
+  fprintf(stderr,"EVENT_LOG\t\t%s\n",names->event_log);
   if (options.ALMA_OUTPUT)
     fprintf(stderr,"ALMA_OUTPUT\t\tTRUE\n");
   else
@@ -433,6 +464,10 @@ void ProgramState::display_current_settings(int mode,filenames_struct *names)
 
   WriteOutputContext context(this);
   fprintf(stderr, "OUTPUT_FORMAT\t\t%s\n", context.outputFormat->getDescriptionOfOutputType());
+  if (options.OUTPUT_LAYOUT == OutputLayout::GATHERED_LAYOUT)
+    fprintf(stderr, "OUTPUT_LAYOUT\t\tGATHERED\n");
+  else
+    fprintf(stderr, "OUTPUT_LAYOUT\t\tGRID\n");
 
   if (options.OUTPUT_FORCE)
   	fprintf(stderr, "OUTPUT_FORCE\t\tTRUE\n");
@@ -440,11 +475,31 @@ void ProgramState::display_current_settings(int mode,filenames_struct *names)
   	fprintf(stderr, "OUTPUT_FORCE\t\tFALSE\n");
 
   fprintf(stderr, "PARALLEL_THREADS\t%d\n", global_param.num_threads);
+  fprintf(stderr,"TIME_BLOCK_STEPS\t%d\n",global_param.time_block_steps);
+  if (global_param.cell_schedule == CELL_SCHEDULE_STATIC)
+    fprintf(stderr,"CELL_SCHEDULE\t\tSTATIC\n");
+  else
+    fprintf(stderr,"CELL_SCHEDULE\t\tCOST\n");
+  fprintf(stderr,"HRU_TASK_THRESHOLD\t%d\n",global_param.hru_task_threshold);
 
   if (options.COMPRESS)
     fprintf(stderr,"COMPRESS\t\tTRUE\n");
   else
     fprintf(stderr,"COMPRESS\t\tFALSE\n");
+  if (global_param.output_storage.chunking == NetCDFChunking::TIME_SLAB_CHUNKS)
+    fprintf(stderr,"OUTPUT_CHUNKING\t\tTIME_SLAB\n");
+  else if (global_param.output_storage.chunking == NetCDFChunking::TIME_SERIES_CHUNKS)
+    fprintf(stderr,"OUTPUT_CHUNKING\t\tTIME_SERIES\n");
+  else
+    fprintf(stderr,"OUTPUT_CHUNKING\t\tDEFAULT\n");
+  fprintf(stderr,"OUTPUT_CHUNK_TIME\t%d\n",global_param.output_storage.chunk_time);
+  fprintf(stderr,"OUTPUT_CHUNK_SPACE\t%d\n",global_param.output_storage.chunk_space);
+  fprintf(stderr,"OUTPUT_CHUNK_CACHE\t%.1f\n",global_param.output_storage.chunk_cache_mb);
+  fprintf(stderr,"OUTPUT_DEFLATE_LEVEL\t%d\n",global_param.output_storage.deflate_level);
+  if (global_param.output_storage.shuffle)
+    fprintf(stderr,"OUTPUT_SHUFFLE\t\tTRUE\n");
+  else
+    fprintf(stderr,"OUTPUT_SHUFFLE\t\tFALSE\n");
   if (options.MOISTFRACT)
     fprintf(stderr,"MOISTFRACT\t\tTRUE\n");
   else
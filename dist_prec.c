@@ -65,6 +65,9 @@ int  dist_prec(cell_info_struct* cell,
 	      return a single ERROR value if an error occurs.		KAC via TJB
   2009-Jun-19 Added T flag to indicate whether TFALLBACK occurred.	TJB
   2009-Sep-28 Added logic for initial (pre-simulation) call to put_data.TJB
+  2026-Oct-17 Forcings are looked up through atmos, which accounts for
+	      cell->atmos holding only a window of records when
+	      ATMOS_WINDOW_RECORDS is set.	AG
 
 **********************************************************************/
 
@@ -72,6 +75,7 @@ int  dist_prec(cell_info_struct* cell,
   int ErrorFlag, ErrorFlag2;
   double Wdmax;
   double NEW_MU;
+  atmos_data_struct *atmos = &cell->atmos[time_step_record - cell->atmos_first_rec];
 
   if (state->options.DIST_PRCP) {
 
@@ -79,13 +83,13 @@ int  dist_prec(cell_info_struct* cell,
      Controls Distributed Precipitation Model
      *******************************************/
 
-    NEW_MU = 1.0 - exp(-state->options.PREC_EXPT * cell->atmos[time_step_record].prec[state->NR]);
+    NEW_MU = 1.0 - exp(-state->options.PREC_EXPT * atmos->prec[state->NR]);
 
     // If any band in a vegetation index contains snow then set ANY_SNOW to be true.
     for (std::vector<HRU>::iterator it = cell->prcp.hruList.begin(); it != cell->prcp.hruList.end(); ++it) {
       /* Check for snow on ground or falling */
       bool ANY_SNOW = false;
-      if (it->snow.swq > 0 || it->snow.snow_canopy > 0. || cell->atmos[time_step_record].snowflag[state->NR]) {
+      if (it->snow.swq > 0 || it->snow.snow_canopy > 0. || atmos->snowflag[state->NR]) {
         ANY_SNOW = true;
 
         /* If snow present, mu must be set to 1. */
@@ -93,7 +97,7 @@ int  dist_prec(cell_info_struct* cell,
         if (time_step_record == 0) {
           /* Set model variables if first time step */
           it->mu = NEW_MU;
-          if (cell->atmos[time_step_record].prec[state->NR] > 0)
+          if (atmos->prec[state->NR] > 0)
             it->init_STILL_STORM = TRUE;
           else
             it->init_STILL_STORM = FALSE;
@@ -101,7 +105,7 @@ int  dist_prec(cell_info_struct* cell,
         }
       } else {
         if (time_step_record == 0) {
-          if (cell->atmos[time_step_record].prec[state->NR] == 0) {
+          if (atmos->prec[state->NR] == 0) {
             /* If first time step has no rain, than set mu to 1. */
             it->mu = 1;
             NEW_MU = 1.;
@@ -113,19 +117,19 @@ int  dist_prec(cell_info_struct* cell,
             it->init_STILL_STORM = TRUE;
             it->init_DRY_TIME = 0;
           }
-        } else if (cell->atmos[time_step_record].prec[state->NR] == 0 && it->init_DRY_TIME >= 24.) {
+        } else if (atmos->prec[state->NR] == 0 && it->init_DRY_TIME >= 24.) {
           /* Check if storm has ended */
           NEW_MU = it->mu;
           it->init_STILL_STORM = FALSE;
           it->init_DRY_TIME = 0;
-        } else if (cell->atmos[time_step_record].prec[state->NR] == 0) {
+        } else if (atmos->prec[state->NR] == 0) {
           /* May be pause in storm, keep track of pause length */
           NEW_MU = it->mu;
           it->init_DRY_TIME += state->global_param.dt;
         }
       }
 
-      if (!it->init_STILL_STORM && (cell->atmos[time_step_record].prec[state->NR] > STORM_THRES || ANY_SNOW)) {
+      if (!it->init_STILL_STORM && (atmos->prec[state->NR] > STORM_THRES || ANY_SNOW)) {
         /** Average soil moisture before a new storm **/
         ErrorFlag = initialize_new_storm(*it, time_step_record, NEW_MU, state);
         if (ErrorFlag == ERROR)
@@ -157,7 +161,7 @@ int  dist_prec(cell_info_struct* cell,
 
   /** Solve model time step **/
   ErrorFlag = full_energy(NEWCELL, time_step_record,
-      &cell->atmos[time_step_record], &cell->prcp, dmy, &cell->lake_con,
+      atmos, &cell->prcp, dmy, &cell->lake_con,
       &cell->soil_con, &cell->writeDebug, state);
 
   /**************************************************
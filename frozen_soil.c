@@ -2,8 +2,10 @@
 #include <stdlib.h>
 #include <strings.h>
 #include "vicNl.h"
+#include "EventLog.h"
 #include <stdarg.h>
 #include "newt_raph_func_fast.h"
+#include "FastKernels.h"
 
 #define MAXIT 1000
 
@@ -94,7 +96,7 @@ int calc_layer_average_thermal_props(energy_bal_struct *energy,
 #if LINK_DEBUG
   if(state->debug.PRT_BALANCE && state->debug.DEBUG) {
     printf("After Moisture Redistribution\n");
-    write_layer(layer, veg, state->options.Nlayer, soil_con->frost_fract);
+    write_layer(layer, veg, state->options.Nlayer, soil_con->frost_fract, stdout);
   } 
 #endif
 
@@ -145,6 +147,8 @@ int  solve_T_profile(double *T,
               solve_T_profile_implicit.                                         KAC
   2009-Jun-19 Added T fbflag to indicate whether TFALLBACK occurred.		TJB
   2009-Sep-19 Added T fbcount to count TFALLBACK occurrences.			TJB
+  2026-Oct-17 Convergence failures are reported as solver error events to
+	      the EventLog (see also error_print_solve_T_profile).	AG
 **********************************************************************/
   
   double A[MAX_NODES];
@@ -492,10 +496,12 @@ int calc_soil_thermal_fluxes(int     Nnodes,
       }
     }
     else {
-      fprintf(stderr,"ERROR: Temperature Profile Unable to Converge!!!\n");
-      fprintf(stderr,"Dumping Profile Temperatures (last, new).\n");
-      for(j=0;j<Nnodes;j++) fprintf(stderr,"%f\t%f\n",T0[j],T[j]);
-      fprintf(stderr,"ERROR: Cannot solve temperature profile:\n\tToo Many Iterations in solve_T_profile\n");
+      EventMessage message;
+      fprintf(message.stream(),"ERROR: Temperature Profile Unable to Converge!!!\n");
+      fprintf(message.stream(),"Dumping Profile Temperatures (last, new).\n");
+      for(j=0;j<Nnodes;j++) fprintf(message.stream(),"%f\t%f\n",T0[j],T[j]);
+      fprintf(message.stream(),"ERROR: Cannot solve temperature profile:\n\tToo Many Iterations in solve_T_profile\n");
+      EventLog::instance().report(EVENT_SOLVER_ERROR, SOLVER_SOIL_THERMAL_EQN, message.text());
       return ( ERROR );
     }
   }
@@ -509,25 +515,28 @@ double error_print_solve_T_profile(double T, double TL, double TU, double T0,
     double gamma, double A, double B, double C, double D, double E,
     char *ErrorString) {
   
-  fprintf(stderr, "%s", ErrorString);
-  fprintf(stderr, "ERROR: solve_T_profile failed to converge to a solution in root_brent.  Variable values will be dumped to the screen, check for invalid values.\n");
-
-  fprintf(stderr,"TL\t%f\n",TL);
-  fprintf(stderr,"TU\t%f\n",TU);
-  fprintf(stderr,"T0\t%f\n",T0);
-  fprintf(stderr,"moist\t%f\n",moist);
-  fprintf(stderr,"max_moist\t%f\n",max_moist);
-  fprintf(stderr,"bubble\t%f\n",bubble);
-  fprintf(stderr,"expt\t%f\n",expt);
-  fprintf(stderr,"ice0\t%f\n",ice0);
-  fprintf(stderr,"gamma\t%f\n",gamma);
-  fprintf(stderr,"A\t%f\n",A);
-  fprintf(stderr,"B\t%f\n",B);
-  fprintf(stderr,"C\t%f\n",C);
-  fprintf(stderr,"D\t%f\n",D);
-  fprintf(stderr,"E\t%f\n",E);
-
-  fprintf(stderr,"Finished dumping values for solve_T_profile.\nTry increasing SOIL_DT to get model to complete cell.\nThen check output for instabilities.\n");
+  EventMessage message;
+  FILE* out = message.stream();
+  fprintf(out, "%s", ErrorString);
+  fprintf(out, "ERROR: solve_T_profile failed to converge to a solution in root_brent.  Variable values will be dumped to the screen, check for invalid values.\n");
+
+  fprintf(out,"TL\t%f\n",TL);
+  fprintf(out,"TU\t%f\n",TU);
+  fprintf(out,"T0\t%f\n",T0);
+  fprintf(out,"moist\t%f\n",moist);
+  fprintf(out,"max_moist\t%f\n",max_moist);
+  fprintf(out,"bubble\t%f\n",bubble);
+  fprintf(out,"expt\t%f\n",expt);
+  fprintf(out,"ice0\t%f\n",ice0);
+  fprintf(out,"gamma\t%f\n",gamma);
+  fprintf(out,"A\t%f\n",A);
+  fprintf(out,"B\t%f\n",B);
+  fprintf(out,"C\t%f\n",C);
+  fprintf(out,"D\t%f\n",D);
+  fprintf(out,"E\t%f\n",E);
+
+  fprintf(out,"Finished dumping values for solve_T_profile.\nTry increasing SOIL_DT to get model to complete cell.\nThen check output for instabilities.\n");
+  EventLog::instance().report(EVENT_SOLVER_ERROR, SOLVER_SOIL_THERMAL_EQN, message.text());
 
   return(ERROR);
 
@@ -561,10 +570,14 @@ void NewtonRaphsonMethod::fda_heat_eqn(double T_2[], double res[], int n, int fo
 	      organic fraction into account.					TJB
   2011-Jun-10 Added bulk_dens_min and soil_dens_min to arglist of
 	      soil_conductivity() to fix bug in commputation of kappa.		TJB
+  2026-Oct-17 With FAST_KERNELS, the unfrozen water content of all nodes
+	      is evaluated in one vectorized call.	AG
   **********************************************************************/
   
   // locally used variables
   double ice_new[MAX_NODES], Cs_new[MAX_NODES], kappa_new[MAX_NODES];
+  double unfrozen[MAX_NODES];
+  const bool fastKernels = FastKernels::instance().isEnabled();
   double DT[MAX_NODES],DT_down[MAX_NODES],DT_up[MAX_NODES],T_up[MAX_NODES];
   double Dkappa[MAX_NODES];
   char PAST_BOTTOM;
@@ -580,12 +593,19 @@ void NewtonRaphsonMethod::fda_heat_eqn(double T_2[], double res[], int n, int fo
     Lsum = 0.;
     PAST_BOTTOM = FALSE;
 
+    if (fastKernels) {
+      FastKernels::unfrozenWater(n, T_2, &max_moist[1], &bubble[1], &expt[1], &unfrozen[1]);
+    }
+
     for (i = 0; i < n + 1; i++) {
       kappa_new[i] = kappa[i];
       if (i >= 1) {  //all but surface node
         // update ice contents
         if (T_2[i - 1] < 0) {
-          ice_new[i] = moist[i] - maximum_unfrozen_water(T_2[i - 1], max_moist[i], bubble[i], expt[i]);
+          if (fastKernels)
+            ice_new[i] = moist[i] - unfrozen[i];
+          else
+            ice_new[i] = moist[i] - maximum_unfrozen_water(T_2[i - 1], max_moist[i], bubble[i], expt[i]);
           if (ice_new[i] < 0)
             ice_new[i] = 0;
         } else
@@ -669,9 +689,11 @@ void NewtonRaphsonMethod::fda_heat_eqn(double T_2[], double res[], int n, int fo
             && fabs(flux_term1) > fabs(flux_term2)) {
           flux_term1 = 0;
 #if VERBOSE
-          fprintf(stderr,
-              "WARNING: resetting thermal flux term in soil heat solution to zero for node %d.\nT[i]=%.2f T[i-1]=%.2f T[i+1]=%.2f flux_term1=%.2f flux_term2=%.2f\n",
+          char message[MAXSTRING];
+          sprintf(message,
+              "resetting thermal flux term in soil heat solution to zero for node %d.\nT[i]=%.2f T[i-1]=%.2f T[i+1]=%.2f flux_term1=%.2f flux_term2=%.2f",
               i + 1, T_2[i], T_up[i], T_2[i + 1], flux_term1, flux_term2);
+          EventLog::instance().report(EVENT_WARNING, SOLVER_SOIL_THERMAL_EQN, message);
 #endif
         }
       }
@@ -694,10 +716,17 @@ void NewtonRaphsonMethod::fda_heat_eqn(double T_2[], double res[], int n, int fo
       right = focus + 1;
 
     // update ice content for node focus and its adjacents
+    if (fastKernels) {
+      FastKernels::unfrozenWater(right - left + 1, &T_2[left], &max_moist[left + 1], &bubble[left + 1],
+          &expt[left + 1], &unfrozen[left + 1]);
+    }
     for (i = left; i <= right; i++) {
       if (T_2[i] < 0) {
-        ice_new[i + 1] = moist[i + 1] - maximum_unfrozen_water(T_2[i], max_moist[i + 1], bubble[i + 1],
-                expt[i + 1]);
+        if (fastKernels)
+          ice_new[i + 1] = moist[i + 1] - unfrozen[i + 1];
+        else
+          ice_new[i + 1] = moist[i + 1] - maximum_unfrozen_water(T_2[i], max_moist[i + 1], bubble[i + 1],
+                  expt[i + 1]);
         if (ice_new[i + 1] < 0)
           ice_new[i + 1] = 0;
       } else
@@ -788,9 +817,11 @@ void NewtonRaphsonMethod::fda_heat_eqn(double T_2[], double res[], int n, int fo
               && fabs(flux_term1) > fabs(flux_term2)) {
             flux_term1 = 0;
 #if VERBOSE
-            fprintf(stderr,
-                "WARNING: resetting thermal flux term in soil heat solution to zero for node %d.\nT[i]=%.2f T[i-1]=%.2f T[i+1]=%.2f flux_term1=%.2f flux_term2=%.2f\n",
+            char message[MAXSTRING];
+            sprintf(message,
+                "resetting thermal flux term in soil heat solution to zero for node %d.\nT[i]=%.2f T[i-1]=%.2f T[i+1]=%.2f flux_term1=%.2f flux_term2=%.2f",
                 i + 1, T_2[i], T_up[i], T_2[i + 1], flux_term1, flux_term2);
+            EventLog::instance().report(EVENT_WARNING, SOLVER_SOIL_THERMAL_EQN, message);
 #endif
           }
         }
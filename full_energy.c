@@ -1,10 +1,300 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "vicNl.h"
+#include "EventLog.h"
 #include <math.h>
+#include <omp.h>
+#include <vector>
 
 static char vcid[] = "$Id: full_energy.c,v 5.8.2.28 2012/01/03 22:44:31 vicadmin Exp $";
 
+namespace {
+// An HRU's share of the cell's precipitation totals (atmos->out_prec, out_rain and out_snow).
+struct HRUPrecipitation {
+  double prec;
+  double rain;
+  double snow;
+};
+}
+
+/**********************************************************************
+  solve_hru
+
+  Solves the energy and water balance of one HRU for the current time
+  step.  It changes only the HRU itself, evap_prior_dry/wet and precip,
+  so the HRUs of a cell can be solved in any order, or in parallel
+  (HRU_TASK_THRESHOLD); full_energy() adds up their precipitation in
+  HRU order, so the cell totals do not depend on the order either.
+
+  modifications:
+  2026-Oct-17 Split out of the HRU loop of full_energy().	AG
+**********************************************************************/
+static int solve_hru(HRU                 &hru,
+                     double               lakefrac,
+                     int                  Ndist,
+                     int                  time_step_record,
+                     int                  SubsidenceUpdate,
+                     double              *gauge_correction,
+                     double              *evap_prior_dry,
+                     double              *evap_prior_wet,
+                     atmos_data_struct   *atmos,
+                     const dmy_struct    *dmy,
+                     const soil_con_struct *soil_con,
+                     HRUPrecipitation    *precip,
+                     const ProgramState  *state)
+{
+  char                   overstory;
+  int                    veg_class_index;
+  int                    Nbands;
+  int                    ErrorFlag;
+  double                 out_prec[2*MAX_BANDS];
+  double                 out_rain[2*MAX_BANDS];
+  double                 out_snow[2*MAX_BANDS];
+  double                 dp;
+  double                 ice0[MAX_BANDS];
+  double                 moist0[MAX_BANDS];
+  double                 surf_atten;
+  double                 height;
+  VegConditions          displacement;
+  VegConditions          roughness;
+  VegConditions          ref_height;
+  VegConditions          aero_resist[N_PET_TYPES + 1];
+  double                 Cv;
+  double                 latent_heat_Le;
+  double                 Melt[2*MAX_BANDS];
+  double                 bare_albedo;
+  double                 snow_inflow[MAX_BANDS];
+  VegConditions          wind_speed;
+#if LINK_DEBUG
+  double                 tmp_mu;
+#endif
+  float                  lag_one;
+  float                  sigma_slope;
+  float                  fetch;
+
+  precip->prec = 0;
+  precip->rain = 0;
+  precip->snow = 0;
+
+  /** Solve Veg Type only if Coverage Greater than 0% **/
+  if (!((hru.veg_con.Cv > 0.0) || (hru.isGlacier && state->options.GLACIER_DYNAMICS && hru.veg_con.Cv >= 0.0)))
+    return (0);
+
+  /** Set Damping Depth **/
+  dp = soil_con->dp;
+
+  Cv = hru.veg_con.Cv;
+  Nbands = state->options.SNOW_BAND;
+
+  /** Lake-specific processing: the wetland part of the lake tile **/
+  if (hru.veg_con.LAKE) {
+    Nbands = 1;
+    Cv *= (1 - lakefrac);
+
+    if (Cv == 0)
+      return (0);
+
+  }
+
+  /**************************************************
+   Initialize Model Parameters
+   **************************************************/
+
+  if (soil_con->AreaFract[hru.bandIndex] > 0) {
+
+    /* Initialize prcp->energy balance variables */
+    hru.energy.shortwave = 0;
+    hru.energy.longwave = 0.;
+
+    /* Initialize snow variables */
+    hru.snow.vapor_flux = 0.;
+    hru.snow.canopy_vapor_flux = 0.;
+    snow_inflow[hru.bandIndex] = 0.;
+    Melt[hru.bandIndex * 2] = 0.;
+
+  }
+
+  /* Initialize precipitation storage */
+  for (int j = 0; j < 2 * MAX_BANDS; j++) {
+    out_prec[j] = 0;
+    out_rain[j] = 0;
+    out_snow[j] = 0;
+  }
+
+  /** Define vegetation class number **/
+  veg_class_index = hru.veg_con.vegIndex;
+
+  /** Compute Surface Attenuation due to Vegetation Coverage. Note: not used in Glacier case. **/
+  surf_atten = exp(-state->veg_lib[veg_class_index].rad_atten * state->veg_lib[veg_class_index].LAI[dmy[time_step_record].month - 1]);
+
+  /* Initialize soil thermal properties for the top two layers */
+  prepare_full_energy(hru, state->options.Nnode, soil_con, moist0, ice0, state);
+
+  /** Compute Bare (free of snow) Albedo **/
+  if (hru.isGlacier) {
+    bare_albedo = soil_con->GLAC_ALBEDO;
+  } else {
+    bare_albedo = state->veg_lib[veg_class_index].albedo[dmy[time_step_record].month - 1];
+  }
+
+  /*************************************
+   Compute the aerodynamic resistance
+   for current veg cover and various
+   types of potential evap, from the
+   HRU's table of the terms that do not
+   depend on the wind speed
+   *************************************/
+  overstory = state->veg_lib[veg_class_index].overstory;
+  ErrorFlag = get_aero_terms(hru.aero_table, dmy[time_step_record].month,
+      atmos->wind[state->NR], aero_resist, wind_speed, displacement,
+      ref_height, roughness, &height);
+  if (ErrorFlag == ERROR)
+    return (ERROR);
+
+  /* Initialize final aerodynamic resistance values */
+  if (soil_con->AreaFract[hru.bandIndex] > 0) {
+    hru.cell[WET].aero_resist.surface = aero_resist[N_PET_TYPES].snowFree;
+    hru.cell[WET].aero_resist.overstory = aero_resist[N_PET_TYPES].canopyIfOverstory;
+  }
+
+
+  /**************************************************
+   Store Water Balance Terms for Debugging
+   **************************************************/
+
+#if LINK_DEBUG
+  if(state->debug.DEBUG || state->debug.PRT_MOIST || state->debug.PRT_BALANCE) {
+    /** Compute current total moisture for water balance check **/
+    if (hru.bandIndex == 0) {
+      store_moisture_for_debug(hru, soil_con, state);
+    }
+    if (state->debug.PRT_BALANCE) {
+      for (int j = 0; j < Ndist; j++) {
+        if (soil_con->AreaFract[hru.bandIndex] > 0) {
+          for (int i = 0; i < state->options.Nlayer + 3; i++) {
+            state->debug.inflow[j][hru.bandIndex][i] = 0;
+            state->debug.outflow[j][hru.bandIndex][i] = 0;
+          }
+
+        }
+      }
+    }
+  }
+#endif // LINK_DEBUG
+  /******************************
+   Solve ground surface fluxes
+   ******************************/
+
+	if ((soil_con->AreaFract[hru.bandIndex] > 0) || (hru.isGlacier && state->options.GLACIER_DYNAMICS && soil_con->AreaFract[hru.bandIndex] >= 0.0)) {
+
+    lag_one = hru.veg_con.lag_one;
+    sigma_slope = hru.veg_con.sigma_slope;
+    fetch = hru.veg_con.fetch;
+
+    /* Initialize pot_evap */
+    for (int p = 0; p < N_PET_TYPES; p++)
+      hru.cell[WET].pot_evap[p] = 0;
+
+    if (hru.isGlacier) {  // If this HRU contains glacier then perform different, glacier specific, calculations.
+
+      ErrorFlag = surface_fluxes_glac(bare_albedo, height,
+          ice0[hru.bandIndex], moist0[hru.bandIndex], SubsidenceUpdate,
+          evap_prior_dry, evap_prior_wet, hru,
+          &(Melt[hru.bandIndex * 2]), &latent_heat_Le, aero_resist,
+          displacement, gauge_correction, &out_prec[hru.bandIndex * 2],
+          &out_rain[hru.bandIndex * 2], &out_snow[hru.bandIndex * 2],
+          ref_height, roughness, &snow_inflow[hru.bandIndex], wind_speed,
+          Nbands, Ndist, state->options.Nlayer, time_step_record, veg_class_index,
+          atmos, dmy, soil_con, lag_one, sigma_slope, fetch, state);
+
+    } else {              // Otherwise, run the model calculations as normal.
+      ErrorFlag = surface_fluxes(overstory, bare_albedo, height,
+          ice0[hru.bandIndex], moist0[hru.bandIndex], SubsidenceUpdate,
+          evap_prior_dry, evap_prior_wet, hru,
+          surf_atten, &(Melt[hru.bandIndex * 2]), &latent_heat_Le,
+          aero_resist, displacement, gauge_correction,
+          &out_prec[hru.bandIndex * 2], &out_rain[hru.bandIndex * 2],
+          &out_snow[hru.bandIndex * 2], ref_height, roughness,
+          &snow_inflow[hru.bandIndex], wind_speed, hru.veg_con.root,
+          Nbands, Ndist, state->options.Nlayer, dp, time_step_record,
+          veg_class_index, atmos, dmy, &(hru.energy), &(hru.cell[DRY]),
+          &(hru.cell[WET]), &(hru.snow), soil_con, &(hru.veg_var[DRY]),
+          &(hru.veg_var[WET]), lag_one, sigma_slope, fetch, state);
+      }
+
+    if (ErrorFlag == ERROR)
+      return (ERROR);
+
+    precip->prec = out_prec[hru.bandIndex * 2] * Cv;
+    precip->rain = out_rain[hru.bandIndex * 2] * Cv;
+    precip->snow = out_snow[hru.bandIndex * 2] * Cv;
+
+    /********************************************************
+     Compute soil wetness and root zone soil moisture
+     ********************************************************/
+    // Loop through distributed precipitation fractions
+    for (int dist = 0; dist < Ndist; dist++) {
+      hru_data_struct& cellRef = hru.cell[dist];
+      cellRef.rootmoist = 0;
+      cellRef.wetness = 0;
+      for (int lidx = 0; lidx < state->options.Nlayer; lidx++) {
+        if (hru.veg_con.root[lidx] > 0) {
+          cellRef.rootmoist += cellRef.layer[lidx].moist;
+        }
+#if EXCESS_ICE
+        cellRef.wetness += (cellRef.layer[lidx].moist - soil_con->Wpwp[lidx])/(soil_con->effective_porosity[lidx]*soil_con->depth[lidx]*1000 - soil_con->Wpwp[lidx]);
+#else
+        cellRef.wetness +=
+            (cellRef.layer[lidx].moist - soil_con->Wpwp[lidx])
+                / (soil_con->porosity[lidx] * soil_con->depth[lidx] * 1000
+                    - soil_con->Wpwp[lidx]);
+#endif
+      }
+      cellRef.wetness /= state->options.Nlayer;
+    }
+  }
+
+  /****************************
+   Controls Debugging Output
+   ****************************/
+#if LINK_DEBUG
+
+  for(int j = 0; j < Ndist; j++) {
+    if(j == 0)
+    tmp_mu = hru.mu;
+    else
+    tmp_mu = 1. - hru.mu;
+    /** for debugging water balance: [0] = vegetation,
+     [1] = ground prcp->snow, [2..Nlayer+1] = soil layers **/
+    if (state->debug.PRT_BALANCE) {
+      if (soil_con->AreaFract[hru.bandIndex] > 0) {
+        state->debug.inflow[j][hru.bandIndex][state->options.Nlayer + 2] +=
+            out_prec[j + hru.bandIndex * 2] * soil_con->Pfactor[hru.bandIndex];
+        state->debug.inflow[j][hru.bandIndex][0] = 0.;
+        state->debug.inflow[j][hru.bandIndex][1] = 0.;
+        state->debug.outflow[j][hru.bandIndex][0] = 0.;
+        state->debug.outflow[j][hru.bandIndex][1] = 0.;
+        state->debug.inflow[j][hru.bandIndex][0] += out_prec[j + hru.bandIndex * 2]
+            * soil_con->Pfactor[hru.bandIndex];
+        state->debug.outflow[j][hru.bandIndex][0] +=
+            hru.veg_var[j].throughfall;
+        if (j == 0)
+          state->debug.inflow[j][hru.bandIndex][1] += snow_inflow[hru.bandIndex];
+        state->debug.outflow[j][hru.bandIndex][1] += Melt[hru.bandIndex * 2 + j];
+      }
+
+    }
+
+    //TODO: convert debug struct into local per element information!
+    //writeDebug->write_debug(atmos, soil_con, prcp->cell[j][iveg], prcp->energy[iveg],
+    //prcp->snow[iveg], prcp->veg_var[j][iveg], &(dmy[time_step_record]), out_short,
+    //tmp_mu, Nveg, iveg, time_step_record, j, NEWCELL, state);
+  }
+#endif // LINK_DEBUG
+
+  return (0);
+}
+
 int  full_energy(char                 NEWCELL,
                  int                  time_step_record,
                  atmos_data_struct   *atmos,
@@ -102,48 +392,29 @@ int  full_energy(char                 NEWCELL,
 	      organic fraction into account.					TJB
   2012-Jan-01 Modified condition for determining whether to simulate lakes
 	      to check whether lake_idx >= 0.					TJB
+  2026-Oct-17 Solver work is counted per HRU (SolverCounters).	AG
+  2026-Oct-17 The aerodynamic resistances are computed from the HRU's
+	      monthly table of wind-independent terms (get_aero_terms()).	AG
+  2026-Oct-17 The HRU loop body moved to solve_hru(); cells with at least
+	      HRU_TASK_THRESHOLD HRUs solve them as parallel tasks.	AG
 
 **********************************************************************/
 {
-  char                   overstory;
   int                    Ndist;
-  int                    veg_class_index;
   int                    Nbands;
   int                    ErrorFlag;
   int                    frost_area;
-  double                 out_prec[2*MAX_BANDS];
-  double                 out_rain[2*MAX_BANDS];
-  double                 out_snow[2*MAX_BANDS];
   double                 out_short=0;
-  double                 dp;
-  double                 ice0[MAX_BANDS];
-  double                 moist0[MAX_BANDS];
-  double                 surf_atten;
   double                 Tend_surf;
   double                 Tend_grnd;
-  double                 wind_h;
-  double                 height;
-  VegConditions          displacement;
-  VegConditions          roughness;
-  VegConditions          ref_height;
-  VegConditions          *aero_resist;
   double                 Cv;
-  double                 latent_heat_Le;
-  double                 Melt[2*MAX_BANDS];
-  double                 bare_albedo;
-  double                 snow_inflow[MAX_BANDS];
   double                 rainonly;
   double                 sum_runoff;
   double                 sum_baseflow;
-  VegConditions          wind_speed;
   double                 tmp_mu;
   double                 tmp_total_moist;
   double                 gauge_correction[2];
-  float 	               lag_one;
-  float 	               sigma_slope;
-  float  	               fetch;
-  int                    pet_veg_class;
-  double                 lakefrac;
+  double                 lakefrac = 0;
   double                 fraci;
   double                 wetland_runoff;
   double                 wetland_baseflow;
@@ -169,9 +440,6 @@ int  full_energy(char                 NEWCELL,
   double                 moist_prior[2][NUM_HRU][MAX_LAYERS]; //mm
   double                 evap_prior[2][NUM_HRU][MAX_LAYERS]; //mm
 
-  /* Allocate aero_resist array */
-  aero_resist = new VegConditions [N_PET_TYPES + 1];
-
   /* set variables for distributed precipitation */
   if (state->options.DIST_PRCP)
     Ndist = 2;
@@ -179,9 +447,6 @@ int  full_energy(char                 NEWCELL,
     Ndist = 1;
   Nbands = state->options.SNOW_BAND;
 
-  /** Set Damping Depth **/
-  dp = soil_con->dp;
-
   /* Compute gauge undercatch correction factors 
    - this assumes that the gauge is free of vegetation effects, so gauge
    correction is constant for the entire grid cell */
@@ -212,290 +477,88 @@ int  full_energy(char                 NEWCELL,
    Solve Energy and/or Water Balance for Each
    Vegetation Type
    **************************************************/
-  int hruIndex = 0;
-  for (std::vector<HRU>::iterator hru = prcp->hruList.begin(); hru != prcp->hruList.end(); ++hru, ++hruIndex) {
-
-    /** Solve Veg Type only if Coverage Greater than 0% **/
-
-  	if ((hru->veg_con.Cv > 0.0) || (hru->isGlacier && state->options.GLACIER_DYNAMICS && hru->veg_con.Cv >= 0.0)) {
-
-      Cv = hru->veg_con.Cv;
-      Nbands = state->options.SNOW_BAND;
-
-      /** Lake-specific processing **/
-      if (hru->veg_con.LAKE) {
-
-        /* Update areai to equal new ice area from previous time step. */
-        prcp->lake_var.areai = prcp->lake_var.new_ice_area;
-
-        /* Compute lake fraction and ice-covered fraction */
-        if (prcp->lake_var.areai < 0)
-          prcp->lake_var.areai = 0;
-        if (prcp->lake_var.sarea > 0) {
-          fraci = prcp->lake_var.areai / prcp->lake_var.sarea;
-          if (fraci > 1.0)
-            fraci = 1.0;
-        } else
-          fraci = 0.0;
-        lakefrac = prcp->lake_var.sarea / lake_con->basin[0];
-
-        Nbands = 1;
-        Cv *= (1 - lakefrac);
-
-        if (Cv == 0)
-          continue;
-
-      }
-
-      /**************************************************
-       Initialize Model Parameters
-       **************************************************/
-
-      if (soil_con->AreaFract[hru->bandIndex] > 0) {
-
-        /* Initialize prcp->energy balance variables */
-        hru->energy.shortwave = 0;
-        hru->energy.longwave = 0.;
-
-        /* Initialize snow variables */
-        hru->snow.vapor_flux = 0.;
-        hru->snow.canopy_vapor_flux = 0.;
-        snow_inflow[hru->bandIndex] = 0.;
-        Melt[hru->bandIndex * 2] = 0.;
-
-      }
-
-      /* Initialize precipitation storage */
-      for (int j = 0; j < 2 * MAX_BANDS; j++) {
-        out_prec[j] = 0;
-        out_rain[j] = 0;
-        out_snow[j] = 0;
-      }
-
-      /** Define vegetation class number **/
-      veg_class_index = hru->veg_con.vegIndex;
-
-      /** Assign wind_h **/
-      wind_h = state->veg_lib[veg_class_index].wind_h;
-
-      /** Compute Surface Attenuation due to Vegetation Coverage. Note: not used in Glacier case. **/
-      surf_atten = exp(-state->veg_lib[veg_class_index].rad_atten * state->veg_lib[veg_class_index].LAI[dmy[time_step_record].month - 1]);
-
-      /* Initialize soil thermal properties for the top two layers */
-      prepare_full_energy(*hru, state->options.Nnode, soil_con, moist0, ice0, state);
-
-      /** Compute Bare (free of snow) Albedo **/
-      if (hru->isGlacier) {
-        bare_albedo = soil_con->GLAC_ALBEDO;
-      } else {
-        bare_albedo = state->veg_lib[veg_class_index].albedo[dmy[time_step_record].month - 1];
-      }
-
-      /*************************************
-       Compute the aerodynamic resistance
-       for current veg cover and various
-       types of potential evap
-       *************************************/
-
-      /* Loop over types of potential evap, plus current veg */
-      /* Current veg will be last */
-      for (int p = 0; p < N_PET_TYPES + 1; p++) {
-
-        /* Set surface descriptive variables */
-        if (p < N_PET_TYPES_NON_NAT) {
-          pet_veg_class = state->veg_lib[0].NVegLibTypes + p;
-        } else {
-          pet_veg_class = veg_class_index;
-        }
-
-        //if ((hru->veg_con.vegClass == state->options.GLACIER_ID) && (pet_veg_class == veg_class_index)) {
-        if (pet_veg_class == state->options.GLACIER_ID)
-          roughness.snowFree = soil_con->GLAC_ROUGH;
-        else
-          roughness.snowFree = state->veg_lib[pet_veg_class].roughness[dmy[time_step_record].month - 1];
-
-        displacement.snowFree = state->veg_lib[pet_veg_class].displacement[dmy[time_step_record].month - 1];
-        overstory = state->veg_lib[pet_veg_class].overstory;
-        if (p >= N_PET_TYPES_NON_NAT)
-          if (roughness.snowFree == 0)
-            roughness.snowFree = soil_con->rough;
-
-        /* Estimate vegetation height */
-        height = calc_veg_height(displacement.snowFree, state->veg_lib[veg_class_index].LAI[dmy[time_step_record].month - 1]);
-
-        /* Estimate reference height */
-        if (displacement.snowFree < wind_h)
-          ref_height.snowFree = wind_h;
-        else
-          ref_height.snowFree = displacement.snowFree + wind_h + roughness.snowFree;
-
-        /* Adjust magnitude of 'measured' windspeed from nominal surface height to reference height (based on wind height given in vegetation library) */
-        /* Assume an open-ground logarithmic wind profile */
-        double tmp_z0 = soil_con->rough;
-        double tmp_d = 0.;
-        double tmp_zref = state->global_param.wind_h;	//nominal surface height
-        double wind_corr = log((ref_height.snowFree - tmp_d)/tmp_z0)/log((tmp_zref - tmp_d)/tmp_z0);
-
-        /* Initialize wind speeds */
-    	wind_speed.snowFree = atmos->wind[state->NR] * wind_corr;
-        wind_speed.canopyIfOverstory = INVALID;
-        wind_speed.snowCovered = INVALID;
-        wind_speed.glacierSurface = INVALID;
-
-        /* Compute aerodynamic resistance over various surface types */
-        /* Do this not only for current veg but also all types of PET */
-        int ErrorFlag = CalcAerodynamic(overstory, height,
-            state->veg_lib[pet_veg_class].trunk_ratio, soil_con->snow_rough,
-            soil_con->rough, state->veg_lib[pet_veg_class].wind_atten,
-            aero_resist[p], wind_speed, displacement, ref_height, roughness);
-        if (ErrorFlag == ERROR)
-          return (ERROR);
-
-      }
-      /* Initialize final aerodynamic resistance values */
-      if (soil_con->AreaFract[hru->bandIndex] > 0) {
-        hru->cell[WET].aero_resist.surface = aero_resist[N_PET_TYPES].snowFree;
-        hru->cell[WET].aero_resist.overstory = aero_resist[N_PET_TYPES].canopyIfOverstory;
-      }
-
-
-      /**************************************************
-       Store Water Balance Terms for Debugging
-       **************************************************/
-
-#if LINK_DEBUG
-      if(state->debug.DEBUG || state->debug.PRT_MOIST || state->debug.PRT_BALANCE) {
-        /** Compute current total moisture for water balance check **/
-        if (hru->bandIndex == 0) {
-          store_moisture_for_debug(*hru, soil_con, state);
-        }
-        if (state->debug.PRT_BALANCE) {
-          for (int j = 0; j < Ndist; j++) {
-            if (soil_con->AreaFract[hru->bandIndex] > 0) {
-              for (int i = 0; i < state->options.Nlayer + 3; i++) {
-                state->debug.inflow[j][hru->bandIndex][i] = 0;
-                state->debug.outflow[j][hru->bandIndex][i] = 0;
-              }
-
-            }
-          }
-        }
-      }
-#endif // LINK_DEBUG
-      /******************************
-       Solve ground surface fluxes
-       ******************************/
-
-    	if ((soil_con->AreaFract[hru->bandIndex] > 0) || (hru->isGlacier && state->options.GLACIER_DYNAMICS && soil_con->AreaFract[hru->bandIndex] >= 0.0)) {
-
-        lag_one = hru->veg_con.lag_one;
-        sigma_slope = hru->veg_con.sigma_slope;
-        fetch = hru->veg_con.fetch;
-
-        /* Initialize pot_evap */
-        for (int p = 0; p < N_PET_TYPES; p++)
-          hru->cell[WET].pot_evap[p] = 0;
-
-        if (hru->isGlacier) {  // If this HRU contains glacier then perform different, glacier specific, calculations.
-
-          ErrorFlag = surface_fluxes_glac(bare_albedo, height,
-              ice0[hru->bandIndex], moist0[hru->bandIndex], SubsidenceUpdate,
-              evap_prior[DRY][hruIndex], evap_prior[WET][hruIndex], *hru,
-              &(Melt[hru->bandIndex * 2]), &latent_heat_Le, aero_resist,
-              displacement, gauge_correction, &out_prec[hru->bandIndex * 2],
-              &out_rain[hru->bandIndex * 2], &out_snow[hru->bandIndex * 2],
-              ref_height, roughness, &snow_inflow[hru->bandIndex], wind_speed,
-              Nbands, Ndist, state->options.Nlayer, time_step_record, veg_class_index,
-              atmos, dmy, soil_con, lag_one, sigma_slope, fetch, state);
-
-        } else {              // Otherwise, run the model calculations as normal.
-          ErrorFlag = surface_fluxes(overstory, bare_albedo, height,
-              ice0[hru->bandIndex], moist0[hru->bandIndex], SubsidenceUpdate,
-              evap_prior[DRY][hruIndex], evap_prior[WET][hruIndex], *hru,
-              surf_atten, &(Melt[hru->bandIndex * 2]), &latent_heat_Le,
-              aero_resist, displacement, gauge_correction,
-              &out_prec[hru->bandIndex * 2], &out_rain[hru->bandIndex * 2],
-              &out_snow[hru->bandIndex * 2], ref_height, roughness,
-              &snow_inflow[hru->bandIndex], wind_speed, hru->veg_con.root,
-              Nbands, Ndist, state->options.Nlayer, dp, time_step_record,
-              veg_class_index, atmos, dmy, &(hru->energy), &(hru->cell[DRY]),
-              &(hru->cell[WET]), &(hru->snow), soil_con, &(hru->veg_var[DRY]),
-              &(hru->veg_var[WET]), lag_one, sigma_slope, fetch, state);
-          }
+  /** Lake-specific processing: the ice and surface area of the lake, used
+      for the wetland part of the lake tile and by the lake model below **/
+  for (std::vector<HRU>::iterator hru = prcp->hruList.begin(); hru != prcp->hruList.end(); ++hru) {
+    if (hru->veg_con.LAKE && ((hru->veg_con.Cv > 0.0) || (hru->isGlacier && state->options.GLACIER_DYNAMICS && hru->veg_con.Cv >= 0.0))) {
+
+      /* Update areai to equal new ice area from previous time step. */
+      prcp->lake_var.areai = prcp->lake_var.new_ice_area;
+
+      /* Compute lake fraction and ice-covered fraction */
+      if (prcp->lake_var.areai < 0)
+        prcp->lake_var.areai = 0;
+      if (prcp->lake_var.sarea > 0) {
+        fraci = prcp->lake_var.areai / prcp->lake_var.sarea;
+        if (fraci > 1.0)
+          fraci = 1.0;
+      } else
+        fraci = 0.0;
+      lakefrac = prcp->lake_var.sarea / lake_con->basin[0];
+    }
+  }
 
-        if (ErrorFlag == ERROR)
-          return (ERROR);
-
-        atmos->out_prec += out_prec[hru->bandIndex * 2] * Cv;
-        atmos->out_rain += out_rain[hru->bandIndex * 2] * Cv;
-        atmos->out_snow += out_snow[hru->bandIndex * 2] * Cv;
-
-        /********************************************************
-         Compute soil wetness and root zone soil moisture
-         ********************************************************/
-        // Loop through distributed precipitation fractions
-        for (int dist = 0; dist < Ndist; dist++) {
-          hru_data_struct& cellRef = hru->cell[dist];
-          cellRef.rootmoist = 0;
-          cellRef.wetness = 0;
-          for (int lidx = 0; lidx < state->options.Nlayer; lidx++) {
-            if (hru->veg_con.root[lidx] > 0) {
-              cellRef.rootmoist += cellRef.layer[lidx].moist;
-            }
-#if EXCESS_ICE
-            cellRef.wetness += (cellRef.layer[lidx].moist - soil_con->Wpwp[lidx])/(soil_con->effective_porosity[lidx]*soil_con->depth[lidx]*1000 - soil_con->Wpwp[lidx]);
-#else
-            cellRef.wetness +=
-                (cellRef.layer[lidx].moist - soil_con->Wpwp[lidx])
-                    / (soil_con->porosity[lidx] * soil_con->depth[lidx] * 1000
-                        - soil_con->Wpwp[lidx]);
+  /* Cells with at least HRU_TASK_THRESHOLD HRUs solve them as OpenMP tasks,
+     which the threads that have run out of cells pick up, unless the debug
+     output (which all HRUs write to) is on. */
+  bool hruTasks = FALSE;
+#if PARALLEL_AVAILABLE
+  hruTasks = state->global_param.hru_task_threshold > 0 && NUM_HRU >= state->global_param.hru_task_threshold
+      && omp_in_parallel();
 #endif
-          }
-          cellRef.wetness /= state->options.Nlayer;
-        }
-      }
-
-      /****************************
-       Controls Debugging Output
-       ****************************/
 #if LINK_DEBUG
+  if (state->debug.DEBUG || state->debug.PRT_MOIST || state->debug.PRT_BALANCE)
+    hruTasks = FALSE;
+#endif
 
-      for(int j = 0; j < Ndist; j++) {
-        if(j == 0)
-        tmp_mu = hru->mu;
-        else
-        tmp_mu = 1. - hru->mu;
-        /** for debugging water balance: [0] = vegetation,
-         [1] = ground prcp->snow, [2..Nlayer+1] = soil layers **/
-        if (state->debug.PRT_BALANCE) {
-          if (soil_con->AreaFract[hru->bandIndex] > 0) {
-            state->debug.inflow[j][hru->bandIndex][state->options.Nlayer + 2] +=
-                out_prec[j + hru->bandIndex * 2] * soil_con->Pfactor[hru->bandIndex];
-            state->debug.inflow[j][hru->bandIndex][0] = 0.;
-            state->debug.inflow[j][hru->bandIndex][1] = 0.;
-            state->debug.outflow[j][hru->bandIndex][0] = 0.;
-            state->debug.outflow[j][hru->bandIndex][1] = 0.;
-            state->debug.inflow[j][hru->bandIndex][0] += out_prec[j + hru->bandIndex * 2]
-                * soil_con->Pfactor[hru->bandIndex];
-            state->debug.outflow[j][hru->bandIndex][0] +=
-                hru->veg_var[j].throughfall;
-            if (j == 0)
-              state->debug.inflow[j][hru->bandIndex][1] += snow_inflow[hru->bandIndex];
-            state->debug.outflow[j][hru->bandIndex][1] += Melt[hru->bandIndex * 2 + j];
-          }
-
-        }
-
-        //TODO: convert debug struct into local per element information!
-        //writeDebug->write_debug(atmos, soil_con, prcp->cell[j][iveg], prcp->energy[iveg],
-        //prcp->snow[iveg], prcp->veg_var[j][iveg], &(dmy[time_step_record]), out_short,
-        //tmp_mu, Nveg, iveg, time_step_record, j, NEWCELL, state);
+  std::vector<HRUPrecipitation> hruPrecip(NUM_HRU);
+  if (hruTasks) {
+    std::vector<int> hruError(NUM_HRU, 0);
+    const EventLog::Context cellContext = EventLog::context();
+    for (int hruIndex = 0; hruIndex < NUM_HRU; hruIndex++) {
+#if PARALLEL_AVAILABLE
+#pragma omp task default(shared) firstprivate(hruIndex)
+#endif
+      {
+        HRU& hru = prcp->hruList[hruIndex];
+        /** The energy balance solvers count their work in this HRU's counters **/
+        SolverCounters::setCurrent(&hru.solverCounters);
+        /** Events are reported for this cell, also by a thread that picked up the task while waiting on its own cell **/
+        const EventLog::Context threadContext = EventLog::context();
+        EventLog::setContext(cellContext);
+        hruError[hruIndex] = solve_hru(hru, lakefrac, Ndist, time_step_record, SubsidenceUpdate, gauge_correction,
+            evap_prior[DRY][hruIndex], evap_prior[WET][hruIndex], atmos, dmy, soil_con, &hruPrecip[hruIndex], state);
+        EventLog::setContext(threadContext);
+        SolverCounters::setCurrent(NULL);
       }
-#endif // LINK_DEBUG
-    } /** end current vegetation type **/
-  } /** end of vegetation loop **/
+    }
+#if PARALLEL_AVAILABLE
+#pragma omp taskwait
+#endif
+    for (int hruIndex = 0; hruIndex < NUM_HRU; hruIndex++) {
+      if (hruError[hruIndex] == ERROR)
+        return (ERROR);
+    }
+  }
+  else {
+    for (int hruIndex = 0; hruIndex < NUM_HRU; hruIndex++) {
+      HRU& hru = prcp->hruList[hruIndex];
+      /** The energy balance solvers count their work in this HRU's counters **/
+      SolverCounters::setCurrent(&hru.solverCounters);
+      ErrorFlag = solve_hru(hru, lakefrac, Ndist, time_step_record, SubsidenceUpdate, gauge_correction,
+          evap_prior[DRY][hruIndex], evap_prior[WET][hruIndex], atmos, dmy, soil_con, &hruPrecip[hruIndex], state);
+      SolverCounters::setCurrent(NULL);
+      if (ErrorFlag == ERROR)
+        return (ERROR);
+    }
+  }
 
-  delete [] aero_resist;
+  /* Cell totals, in HRU order so that they do not depend on hruTasks */
+  for (int hruIndex = 0; hruIndex < NUM_HRU; hruIndex++) {
+    atmos->out_prec += hruPrecip[hruIndex].prec;
+    atmos->out_rain += hruPrecip[hruIndex].rain;
+    atmos->out_snow += hruPrecip[hruIndex].snow;
+  }
 
   /****************************
    Calculate Subsidence
@@ -28,3 +28,6 @@ double AtmosEnergyBal::calculate(double Tcanopy) {
   return ( Error );
 
 }
+
+// The root search of this solver, compiled here so that calculate() can be inlined into it
+template class RootBrent<AtmosEnergyBal>;
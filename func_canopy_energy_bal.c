@@ -147,3 +147,6 @@ double CanopyEnergyBal::calculate(double Tfoliage)
   return (RestTerm);
 
 }
+
+// The root search of this solver, compiled here so that calculate() can be inlined into it
+template class RootBrent<CanopyEnergyBal>;
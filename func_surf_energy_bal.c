@@ -402,3 +402,5 @@ double SurfEnergyBal::calculate(double Ts)
 
 }
 
+// The root search of this solver, compiled here so that calculate() can be inlined into it
+template class RootBrent<SurfEnergyBal>;
@@ -49,83 +49,33 @@ void finilizeForceTypes(ProgramState* state) {
 
 }
 
+// Nearest row of the output grid to a latitude
 int latitudeToIndex(double lat, const ProgramState* state) {
-  return std::abs(lat - state->global_param.gridStartLat) / state->global_param.gridStepLat;
+  return state->grid.latitudeToIndex(lat);
 }
 
+// Nearest column of the output grid to a longitude
 int longitudeToIndex(double lon, const ProgramState* state) {
-  return std::abs(lon - state->global_param.gridStartLon) / state->global_param.gridStepLon;
+  return state->grid.longitudeToIndex(lon);
 }
 
-// Calculate the grid cell parameters. This is used for NetCDF outputs
+// Calculate the grid cell parameters, and the grid point of each cell. This is used for NetCDF outputs
 void ProgramState::initGrid(const std::vector<cell_info_struct>& cells) {
-  if (cells.size() == 0) {
-    throw VICException("Error: cannot run the model with no cells! Make sure that some cells are enabled.");
-  } else if (cells.size() == 1) {
-    global_param.gridNumLatDivisions = 1;
-    global_param.gridNumLonDivisions = 1;
-    global_param.gridStartLat = cells[0].soil_con.lat;
-    global_param.gridStartLon = cells[0].soil_con.lng;
-    global_param.gridStepLat = 0;
-    global_param.gridStepLon = 0;
-  } else {
-    global_param.gridStartLat = cells[0].soil_con.lat;
-    global_param.gridStartLon = cells[0].soil_con.lng;
-    global_param.gridStepLat = INT_MAX;
-    global_param.gridStepLon = INT_MAX;
-    global_param.gridEndLat = cells[0].soil_con.lat;
-    global_param.gridEndLon = cells[0].soil_con.lng;
-
-    for (unsigned int i = 0; i < cells.size(); i++) {
-      // Find the minimum lat and long in the grid, use this as start of indices.
-      if (cells[i].soil_con.lat < global_param.gridStartLat) {
-        global_param.gridStartLat = cells[i].soil_con.lat;
-      }
-      if (cells[i].soil_con.lng < global_param.gridStartLon) {
-        global_param.gridStartLon = cells[i].soil_con.lng;
-      }
-      if (cells[i].soil_con.lat > global_param.gridEndLat) {
-      	global_param.gridEndLat = cells[i].soil_con.lat;
-      }
-      if (cells[i].soil_con.lng > global_param.gridEndLon) {
-      	global_param.gridEndLon = cells[i].soil_con.lng;
-      }
-      // Find the smallest distance between cells for lat and lon
-      for (unsigned int n = 0; n < cells.size(); n++) {
-        double distLat = std::abs(cells[i].soil_con.lat - cells[n].soil_con.lat);
-        double distLon = std::abs(cells[i].soil_con.lng - cells[n].soil_con.lng);
-        if (distLat != 0 && distLat < global_param.gridStepLat) {
-          global_param.gridStepLat = distLat;
-        }
-        if (distLon != 0 && distLon < global_param.gridStepLon) {
-          global_param.gridStepLon = distLon;
-        }
-      }
-    }
-    global_param.gridNumLatDivisions = ((global_param.gridEndLat - global_param.gridStartLat) / global_param.gridStepLat) + 1;
-    global_param.gridNumLonDivisions = ((global_param.gridEndLon - global_param.gridStartLon) / global_param.gridStepLon) + 1;
+  std::vector<double> lats, lons;
+  for (unsigned int i = 0; i < cells.size(); i++) {
+    lats.push_back(cells[i].soil_con.lat);
+    lons.push_back(cells[i].soil_con.lng);
   }
-}
-
-void ProgramState::initCellMask(const std::vector<cell_info_struct>& cells) {
-
-  char ErrStr[MAXSTRING];
-	int total_num_cells = global_param.gridNumLatDivisions * global_param.gridNumLonDivisions;
-	modeled_cell_mask = new bool [total_num_cells];
-  int cellidx = 0;
-  int count = 0;
+  grid.build(lats, lons);
 
-	// Check all possible lat/lon pairs in the grid and check if each exists within modeled_cell_coordinates set
-  for (float lat = global_param.gridStartLat; lat <= global_param.gridEndLat; lat += global_param.gridStepLat) {
-  	for (float lon = global_param.gridStartLon; lon <= global_param.gridEndLon; lon += global_param.gridStepLon){
-			count = modeled_cell_coordinates.count(std::make_tuple(lat, lon));
-			if (count == 1)
-				modeled_cell_mask[cellidx] = true;
-			else
-				modeled_cell_mask[cellidx] = false;
-		cellidx++;
-		}
-	}
+  global_param.gridStartLat = grid.startLat();
+  global_param.gridStartLon = grid.startLon();
+  global_param.gridEndLat = grid.endLat();
+  global_param.gridEndLon = grid.endLon();
+  global_param.gridStepLat = grid.stepLat();
+  global_param.gridStepLon = grid.stepLon();
+  global_param.gridNumLatDivisions = grid.numLat();
+  global_param.gridNumLonDivisions = grid.numLon();
 }
 
 void ProgramState::init_global_param(filenames_struct *names, const char* global_file_name)
@@ -281,9 +231,25 @@ void ProgramState::init_global_param(filenames_struct *names, const char* global
   strcpy(names->lakeparam,    "MISSING");
   strcpy(names->result_dir,   "MISSING");
   strcpy(names->netCDFOutputFileName, "results.nc");
+  strcpy(names->event_log,    "NONE");
+  strcpy(names->blowing_table, "NONE");
   global_param.out_dt        = INVALID_INT;
   global_param.num_threads        = 1;
   global_param.disagg_write_chunk_size = 1;
+  global_param.forcing_tile_size = 1;
+  global_param.output_buffer_frames = 2;
+  global_param.atmos_window_records = 0;
+  global_param.time_block_steps = 1;
+  global_param.cell_schedule = CELL_SCHEDULE_COST;
+  global_param.hru_task_threshold = 0;
+  global_param.output_storage.chunking = NetCDFChunking::DEFAULT_CHUNKS;
+  global_param.output_storage.chunk_time = 365;
+  global_param.output_storage.chunk_space = 4;
+  global_param.output_storage.deflate_level = 5; // Some reasonable compression level - not too intensive.
+  global_param.output_storage.shuffle = FALSE;
+  global_param.output_storage.chunk_cache_mb = 0;
+  global_param.state_storage = global_param.output_storage;
+  global_param.state_storage.deflate_level = 1;
 
   // Open the file
   FILE* gp = open_file(global_file_name, "r");
@@ -311,6 +277,25 @@ void ProgramState::init_global_param(filenames_struct *names, const char* global
       else if(strcasecmp("PARALLEL_THREADS",optstr)==0) {
         sscanf(cmdstr,"%*s %d",&global_param.num_threads);
       }
+      else if(strcasecmp("TIME_BLOCK_STEPS",optstr)==0) {
+        sscanf(cmdstr,"%*s %d",&global_param.time_block_steps);
+      }
+      else if(strcasecmp("CELL_SCHEDULE",optstr)==0) {
+        sscanf(cmdstr,"%*s %s",flgstr);
+        if(strcasecmp("STATIC",flgstr)==0) global_param.cell_schedule = CELL_SCHEDULE_STATIC;
+        else if(strcasecmp("COST",flgstr)==0) global_param.cell_schedule = CELL_SCHEDULE_COST;
+        else {
+          sprintf(ErrStr,"CELL_SCHEDULE must be either STATIC or COST, not %s.",flgstr);
+          nrerror(ErrStr);
+        }
+      }
+      else if(strcasecmp("HRU_TASK_THRESHOLD",optstr)==0) {
+        sscanf(cmdstr,"%*s %d",&global_param.hru_task_threshold);
+        if (global_param.hru_task_threshold < 0) {
+          sprintf(ErrStr,"HRU_TASK_THRESHOLD must be 0 (never split cells into HRU tasks) or a number of HRUs, not %d.",global_param.hru_task_threshold);
+          nrerror(ErrStr);
+        }
+      }
       else if(strcasecmp("NLAYER",optstr)==0) {
         sscanf(cmdstr,"%*s %d",&options.Nlayer);
       }
@@ -391,6 +376,16 @@ void ProgramState::init_global_param(filenames_struct *names, const char* global
         if(strcasecmp("TRUE",flgstr)==0) options.QUICK_SOLVE=TRUE;
         else options.QUICK_SOLVE = FALSE;
       }
+      else if(strcasecmp("TSURF_WARM_START",optstr)==0) {
+        sscanf(cmdstr,"%*s %s",flgstr);
+        if(strcasecmp("TRUE",flgstr)==0) options.TSURF_WARM_START=TRUE;
+        else options.TSURF_WARM_START = FALSE;
+      }
+      else if(strcasecmp("FAST_KERNELS",optstr)==0) {
+        sscanf(cmdstr,"%*s %s",flgstr);
+        if(strcasecmp("TRUE",flgstr)==0) options.FAST_KERNELS=TRUE;
+        else options.FAST_KERNELS = FALSE;
+      }
       else if( (strcasecmp("NOFLUX",optstr)==0) || (strcasecmp("NO_FLUX",optstr)==0) ) {
         sscanf(cmdstr,"%*s %s",flgstr);
         if(strcasecmp("TRUE",flgstr)==0) options.NOFLUX=TRUE;
@@ -421,6 +416,14 @@ void ProgramState::init_global_param(filenames_struct *names, const char* global
         if(strcasecmp("TRUE",flgstr)==0) options.BLOWING=TRUE;
         else options.BLOWING = FALSE;
       }
+      else if(strcasecmp("BLOWING_TABLE",optstr)==0) {
+        sscanf(cmdstr,"%*s %s",flgstr);
+        if(strcasecmp("TRUE",flgstr)==0) options.BLOWING_TABLE=TRUE;
+        else options.BLOWING_TABLE = FALSE;
+      }
+      else if(strcasecmp("BLOWING_TABLE_FILE",optstr)==0) {
+        sscanf(cmdstr,"%*s %s",names->blowing_table);
+      }
       else if(strcasecmp("DIST_PRCP",optstr)==0) {
         sscanf(cmdstr,"%*s %s",flgstr);
         if(strcasecmp("TRUE",flgstr)==0) options.DIST_PRCP=TRUE;
@@ -581,7 +584,16 @@ void ProgramState::init_global_param(filenames_struct *names, const char* global
           fprintf(stderr, "STATE_FORMAT will default to ASCII\n");
           options.STATE_FORMAT = StateOutputFormat::ASCII_STATEFILE;
         }
-
+      } else if (strcasecmp("STATE_LAYOUT", optstr) == 0) {
+        sscanf(cmdstr, "%*s %s", flgstr);
+        if (strcasecmp("GRID", flgstr) == 0) {
+          options.STATE_LAYOUT = OutputLayout::GRID_LAYOUT;
+        } else if (strcasecmp("GATHERED", flgstr) == 0) {
+          options.STATE_LAYOUT = OutputLayout::GATHERED_LAYOUT;
+        } else {
+          sprintf(ErrStr, "STATE_LAYOUT must be either GRID or GATHERED, but received: \"%s\".", flgstr);
+          nrerror(ErrStr);
+        }
 
       } else if (strcasecmp("MAX_MEMORY", optstr) == 0) {
         sscanf(cmdstr, "%*s %s", flgstr);
@@ -631,6 +643,17 @@ void ProgramState::init_global_param(filenames_struct *names, const char* global
       else if(strcasecmp("FORCE_DT",optstr)==0) {
         sscanf(cmdstr,"%*s %d ", &param_set.FORCE_DT[file_num]);
       }
+      else if(strcasecmp("FORCE_TILE_SIZE",optstr)==0) {
+        sscanf(cmdstr,"%*s %d",&global_param.forcing_tile_size);
+      }
+      else if(strcasecmp("FORCE_SIDECAR",optstr)==0) {
+        sscanf(cmdstr,"%*s %s",flgstr);
+        if(strcasecmp("TRUE",flgstr)==0) options.FORCE_SIDECAR=TRUE;
+        else options.FORCE_SIDECAR = FALSE;
+      }
+      else if(strcasecmp("ATMOS_WINDOW_RECORDS",optstr)==0) {
+        sscanf(cmdstr,"%*s %d",&global_param.atmos_window_records);
+      }
       else if(strcasecmp("FORCEYEAR",optstr)==0) {
         sscanf(cmdstr,"%*s %d",&global_param.forceyear[file_num]);
       }
@@ -779,12 +802,53 @@ void ProgramState::init_global_param(filenames_struct *names, const char* global
       else if (strcasecmp("NETCDF_OUTPUT_FILENAME", optstr) == 0) {
         sscanf(cmdstr, "%*s %s", names->netCDFOutputFileName);
       }
+      else if (strcasecmp("EVENT_LOG", optstr) == 0) {
+        sscanf(cmdstr, "%*s %s", names->event_log);
+      }
       else if(strcasecmp("OUT_STEP",optstr)==0) {
         sscanf(cmdstr,"%*s %d",&global_param.out_dt);
       }
       else if(strcasecmp("SKIPYEAR",optstr)==0) {
         sscanf(cmdstr,"%*s %d",&global_param.skipyear);
       }
+      else if(strcasecmp("OUTPUT_BUFFER_FRAMES",optstr)==0) {
+        sscanf(cmdstr,"%*s %d",&global_param.output_buffer_frames);
+      }
+      else if(strcasecmp("OUTPUT_CHUNKING",optstr)==0) {
+        sscanf(cmdstr,"%*s %s",flgstr);
+        if(strcasecmp("DEFAULT",flgstr)==0) global_param.output_storage.chunking = NetCDFChunking::DEFAULT_CHUNKS;
+        else if(strcasecmp("TIME_SLAB",flgstr)==0) global_param.output_storage.chunking = NetCDFChunking::TIME_SLAB_CHUNKS;
+        else if(strcasecmp("TIME_SERIES",flgstr)==0) global_param.output_storage.chunking = NetCDFChunking::TIME_SERIES_CHUNKS;
+        else {
+          sprintf(ErrStr,"OUTPUT_CHUNKING must be DEFAULT, TIME_SLAB or TIME_SERIES, not \"%s\".",flgstr);
+          nrerror(ErrStr);
+        }
+      }
+      else if(strcasecmp("OUTPUT_CHUNK_TIME",optstr)==0) {
+        sscanf(cmdstr,"%*s %d",&global_param.output_storage.chunk_time);
+      }
+      else if(strcasecmp("OUTPUT_CHUNK_SPACE",optstr)==0) {
+        sscanf(cmdstr,"%*s %d",&global_param.output_storage.chunk_space);
+      }
+      else if(strcasecmp("OUTPUT_CHUNK_CACHE",optstr)==0) {
+        sscanf(cmdstr,"%*s %lf",&global_param.output_storage.chunk_cache_mb);
+      }
+      else if(strcasecmp("OUTPUT_DEFLATE_LEVEL",optstr)==0) {
+        sscanf(cmdstr,"%*s %d",&global_param.output_storage.deflate_level);
+      }
+      else if(strcasecmp("OUTPUT_SHUFFLE",optstr)==0) {
+        sscanf(cmdstr,"%*s %s",flgstr);
+        if(strcasecmp("TRUE",flgstr)==0) global_param.output_storage.shuffle = TRUE;
+        else global_param.output_storage.shuffle = FALSE;
+      }
+      else if(strcasecmp("STATE_DEFLATE_LEVEL",optstr)==0) {
+        sscanf(cmdstr,"%*s %d",&global_param.state_storage.deflate_level);
+      }
+      else if(strcasecmp("STATE_SHUFFLE",optstr)==0) {
+        sscanf(cmdstr,"%*s %s",flgstr);
+        if(strcasecmp("TRUE",flgstr)==0) global_param.state_storage.shuffle = TRUE;
+        else global_param.state_storage.shuffle = FALSE;
+      }
       else if(strcasecmp("COMPRESS",optstr)==0) {
         sscanf(cmdstr,"%*s %s",flgstr);
         if(strcasecmp("TRUE",flgstr)==0) options.COMPRESS=TRUE;
@@ -821,6 +885,17 @@ void ProgramState::init_global_param(filenames_struct *names, const char* global
           options.OUTPUT_FORMAT = OutputFormat::ASCII_FORMAT;
         }
       }
+      else if (strcasecmp("OUTPUT_LAYOUT", optstr) == 0) {
+        sscanf(cmdstr, "%*s %s", flgstr);
+        if (strcasecmp("GRID", flgstr) == 0) {
+          options.OUTPUT_LAYOUT = OutputLayout::GRID_LAYOUT;
+        } else if (strcasecmp("GATHERED", flgstr) == 0) {
+          options.OUTPUT_LAYOUT = OutputLayout::GATHERED_LAYOUT;
+        } else {
+          sprintf(ErrStr, "OUTPUT_LAYOUT must be either GRID or GATHERED, but received: \"%s\".", flgstr);
+          nrerror(ErrStr);
+        }
+      }
       else if(strcasecmp("ALMA_OUTPUT",optstr)==0) {
         sscanf(cmdstr,"%*s %s",flgstr);
         if(strcasecmp("TRUE",flgstr)==0) options.ALMA_OUTPUT=TRUE;
@@ -960,6 +1035,23 @@ void ProgramState::init_global_param(filenames_struct *names, const char* global
   	if (global_param.out_dt != global_param.dt)
   		nrerror("Invalid output step specified.  Output step must be equal to the model time step when producing disaggregated forcings.");
   }
+  if (global_param.output_buffer_frames < 0) {
+    sprintf(ErrStr,"OUTPUT_BUFFER_FRAMES (%d) must be 0 (synchronous output) or a positive number of output records.",global_param.output_buffer_frames);
+    nrerror(ErrStr);
+  }
+  if (global_param.output_storage.chunk_time < 1 || global_param.output_storage.chunk_space < 1) {
+    sprintf(ErrStr,"OUTPUT_CHUNK_TIME (%d) and OUTPUT_CHUNK_SPACE (%d) must be at least 1.",global_param.output_storage.chunk_time,global_param.output_storage.chunk_space);
+    nrerror(ErrStr);
+  }
+  if (global_param.output_storage.chunk_cache_mb < 0) {
+    sprintf(ErrStr,"OUTPUT_CHUNK_CACHE (%f) must be 0 (the NetCDF library's default) or a size in MB.",global_param.output_storage.chunk_cache_mb);
+    nrerror(ErrStr);
+  }
+  if (global_param.output_storage.deflate_level < 0 || global_param.output_storage.deflate_level > 9
+      || global_param.state_storage.deflate_level < 0 || global_param.state_storage.deflate_level > 9) {
+    sprintf(ErrStr,"OUTPUT_DEFLATE_LEVEL (%d) and STATE_DEFLATE_LEVEL (%d) must be between 0 (not deflated) and 9.",global_param.output_storage.deflate_level,global_param.state_storage.deflate_level);
+    nrerror(ErrStr);
+  }
 
   // Validate SNOW_STEP and set NR and NF
   if (global_param.dt < 24 && global_param.dt != options.SNOW_STEP)
@@ -1059,6 +1151,22 @@ void ProgramState::init_global_param(filenames_struct *names, const char* global
       }
     }
   }
+  if(global_param.forcing_tile_size < 1) {
+    sprintf(ErrStr,"FORCE_TILE_SIZE (%d) must be at least 1.",global_param.forcing_tile_size);
+    nrerror(ErrStr);
+  }
+  if(global_param.atmos_window_records < 0) {
+    sprintf(ErrStr,"ATMOS_WINDOW_RECORDS (%d) must be 0 (keep all forcing records in memory) or a positive number of records.",global_param.atmos_window_records);
+    nrerror(ErrStr);
+  }
+  if(global_param.time_block_steps < 1) {
+    sprintf(ErrStr,"TIME_BLOCK_STEPS (%d) must be at least 1.",global_param.time_block_steps);
+    nrerror(ErrStr);
+  }
+  if(global_param.atmos_window_records > 0 && global_param.atmos_window_records % global_param.time_block_steps != 0) {
+    sprintf(ErrStr,"ATMOS_WINDOW_RECORDS (%d) must be a multiple of TIME_BLOCK_STEPS (%d), so that no block of time steps spans two forcing windows.",global_param.atmos_window_records,global_param.time_block_steps);
+    nrerror(ErrStr);
+  }
   if(IS_VALID(param_set.N_TYPES[1]) && IS_INVALID(global_param.forceyear[1])) {
     global_param.forceyear[1] = global_param.forceyear[0];
     global_param.forcemonth[1] = global_param.forcemonth[0];
@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+#include "vicNl.h"
+#include "ModelRun.h"
+
+/*
+ * vicGlacierDriver: runs VIC coupled in the same process with a glacier model, using the segmented run of ModelRun.
+ * It takes the same command line arguments as vicNl, and the global parameter file must set GLACIER_DYNAMICS and the
+ * GLACIER_ACCUM_* parameters.
+ *
+ * VIC is advanced one GLACIER_ACCUM_INTERVAL at a time. After each interval the glacier model is given the glacier
+ * mass balance polynomial of each cell, and its new glacier extent and surface elevations are passed back to the
+ * cells in memory before VIC continues, without a restart through state files.
+ *
+ * The glacier model here is a stub, standing in for a real one (e.g. RGM): the glacier of each band thins by its
+ * annual mass balance, and where the balance is negative, the glacier retreats to the open ground (non-glacier) HRU
+ * of the same band in proportion to the thinning.
+ */
+
+// Ice thickness (m) lost by a glacier HRU whose whole area retreats in one year, in the stub glacier model
+static const double STUB_RETREAT_THICKNESS = 50.;
+
+static void stubGlacierModel(ModelRun& run, int cellIndex, int years) {
+  const GraphingEquation& gmb = run.massBalanceEquation(cellIndex);
+  if (gmb.fitError < 0) {
+    return; // no mass balance from the last interval (no glacier in this cell)
+  }
+  cell_info_struct& cell = run.cell(cellIndex);
+  const int numBands = run.programState().options.SNOW_BAND;
+  std::vector<double> areaFractions(cell.soil_con.AreaFract, cell.soil_con.AreaFract + numBands);
+  std::vector<double> elevations(cell.soil_con.BandElev, cell.soil_con.BandElev + numBands);
+
+  for (unsigned int hruIndex = 0; hruIndex < cell.prcp.hruList.size(); hruIndex++) {
+    const HRU& glacier = cell.prcp.hruList[hruIndex];
+    if (!glacier.isGlacier || glacier.veg_con.Cv <= 0) {
+      continue;
+    }
+    const double z = cell.soil_con.BandElev[glacier.bandIndex];
+    // Mass balance (mm water equivalent) per year, as ice thickness (m)
+    const double thickness = (gmb.b0 + gmb.b1 * z + gmb.b2 * z * z) / years / 1000. * RHO_W / ice_density;
+    if (areaFractions[glacier.bandIndex] > 0) {
+      elevations[glacier.bandIndex] += thickness * glacier.veg_con.Cv / areaFractions[glacier.bandIndex];
+    }
+    if (thickness >= 0) {
+      continue;
+    }
+    for (unsigned int openIndex = 0; openIndex < cell.prcp.hruList.size(); openIndex++) {
+      const HRU& open = cell.prcp.hruList[openIndex];
+      if (!open.isGlacier && open.bandIndex == glacier.bandIndex) {
+        const double retreat = std::min(-thickness / STUB_RETREAT_THICKNESS, 1.) * glacier.veg_con.Cv;
+        run.setHRUFraction(cellIndex, openIndex, open.veg_con.Cv + retreat);
+        run.setHRUFraction(cellIndex, hruIndex, glacier.veg_con.Cv - retreat);
+        break;
+      }
+    }
+  }
+  run.setBandElevations(cellIndex, areaFractions, elevations);
+}
+
+int main(int argc, char *argv[]) {
+  ModelRun run(argc, argv);
+
+  const global_param_struct& global = run.programState().global_param;
+  if (!run.programState().options.GLACIER_DYNAMICS || IS_INVALID(global.glacierAccumStartYear)
+      || IS_INVALID(global.glacierAccumStartMonth) || IS_INVALID(global.glacierAccumStartDay)
+      || IS_INVALID(global.glacierAccumInterval) || global.glacierAccumInterval < 1) {
+    nrerror("vicGlacierDriver needs GLACIER_DYNAMICS TRUE and the GLACIER_ACCUM_* parameters in the global parameter file.");
+  }
+
+  // The glacier model runs at the end of each accumulation interval, which ends the day before the next one starts
+  dmy_struct until = run.currentDate();
+  until.year = global.glacierAccumStartYear;
+  until.month = global.glacierAccumStartMonth;
+  until.day = global.glacierAccumStartDay;
+  while (!run.isFinished()) {
+    until.year += global.glacierAccumInterval;
+    run.advance(until);
+    if (run.isFinished()) {
+      break;
+    }
+#if VERBOSE
+    fprintf(stderr, "Running the glacier model for the interval ending %04d-%02d-%02d\n",
+        run.currentDate().year, run.currentDate().month, run.currentDate().day);
+#endif
+    for (int cellIndex = 0; cellIndex < run.numCells(); cellIndex++) {
+      stubGlacierModel(run, cellIndex, global.glacierAccumInterval);
+    }
+  }
+  run.finish();
+
+  return EXIT_SUCCESS;
+}
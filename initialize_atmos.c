@@ -6,8 +6,7 @@ static char vcid[] = "$Id$";
 
 void initialize_atmos(atmos_data_struct        *atmos,
                       const dmy_struct         *dmy,
-                      FILE                    **infile,
-                      int                      *ncids,
+                      double                  **forcing_data,
                       soil_con_struct          *soil_con,
                       const ProgramState       *state)
 
@@ -96,6 +95,13 @@ void initialize_atmos(atmos_data_struct        *atmos,
   2011-Nov-04 Overhauled logic to fix several inconsistencies in timing of
 	      sub-daily data, and to correctly handle user-supplied observed
 	      shortwave and/or vapor pressure.					TJB
+  2026-Oct-17 The forcing data is now read by the caller (with
+	      read_forcing_data()) and passed in, so that cells can be
+	      initialized in parallel while the forcing files are read by
+	      one thread at a time.  The forcing_data arrays are freed here.	AG
+  2026-Oct-17 The forcing_data arrays are owned (and freed) by the
+	      caller's ForcingData, as they may point into a mapped
+	      forcing sidecar.	AG
 
 **********************************************************************/
 {
@@ -112,7 +118,6 @@ void initialize_atmos(atmos_data_struct        *atmos,
   int     Ndays;
   int     stepspday;
   double  sum, sum2;
-  double **forcing_data;
   double **local_forcing_data;
   int hour_offset_int;
   int local_startyear, local_startmonth, local_startday;
@@ -240,14 +245,6 @@ void initialize_atmos(atmos_data_struct        *atmos,
       daily_vp == NULL)
     nrerror("Memory allocation failure in initialize_atmos()");
   
-  /*******************************
-    read in meteorological data 
-  *******************************/
-
-  forcing_data = read_forcing_data(infile, ncids, state->global_param, soil_con, state);
-  
-  fprintf(stderr,"Finished reading meteorological forcing file\n");
-
   /*************************************************
     Pre-processing
   *************************************************/
@@ -1314,16 +1311,11 @@ void initialize_atmos(atmos_data_struct        *atmos,
   free(daily_vp);
 
   for(int i=0;i<N_FORCING_TYPES;i++)  {
-//    if (forcing_data[i] != NULL)
-//      free((char *)forcing_data[i]);
-      free(forcing_data[i]);
 //    if (local_forcing_data[i] != NULL)
 //      free((char *)local_forcing_data[i]);
       free(local_forcing_data[i]);
 //fprintf(stderr,"freed type %d\n",i);
   }
-//  free((char *)forcing_data);
-  free(forcing_data);
 //  free((char *)local_forcing_data);
   free(local_forcing_data);
   free((char *)dmy_local);
@@ -128,6 +128,7 @@ void ProgramState::initialize_global() {
   options.AboveTreelineVeg      = -1;
   options.AERO_RESIST_CANSNOW   = AR_406_FULL;
   options.BLOWING               = FALSE;
+  options.BLOWING_TABLE         = FALSE;
   options.COMPUTE_TREELINE      = FALSE;
   options.CONTINUEONERROR       = FALSE;
   options.CORRPREC              = FALSE;
@@ -151,6 +152,9 @@ void ProgramState::initialize_global() {
   options.PREC_EXPT             = 0.6;
   options.QUICK_FLUX            = TRUE;
   options.QUICK_SOLVE           = FALSE;
+  options.TSURF_WARM_START      = FALSE;
+  options.FAST_KERNELS          = FALSE;
+  options.FORCE_SIDECAR         = FALSE;
   options.ROOT_ZONES            = INVALID_INT;
   options.SNOW_ALBEDO           = USACE;
   options.SNOW_BAND             = 1;
@@ -173,6 +177,7 @@ void ProgramState::initialize_global() {
   options.GLACIER_ID            = -1;
   // state options
   options.STATE_FORMAT          = StateOutputFormat::ASCII_STATEFILE;
+  options.STATE_LAYOUT          = OutputLayout::GRID_LAYOUT;
   options.INIT_STATE            = FALSE;
   options.SAVE_STATE            = FALSE;
   options.MAX_MEMORY            = 0.0;    // Assume no restrictions on memory if none are given.
@@ -182,6 +187,7 @@ void ProgramState::initialize_global() {
   // output options
   options.ALMA_OUTPUT           = FALSE;
   options.OUTPUT_FORMAT         = OutputFormat::ASCII_FORMAT;
+  options.OUTPUT_LAYOUT         = OutputLayout::GRID_LAYOUT;
   options.COMPRESS              = FALSE;
   options.MOISTFRACT            = FALSE;
   options.Noutfiles             = 1; // Minimum case - there's only one output file per grid cell in ASCII mode when OUTPUT_FORCE=TRUE
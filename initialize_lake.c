@@ -233,6 +233,7 @@ int initialize_lake (lake_var_struct   *lake,
   lake->energy.Tsurf            = lake->temp[0];
   lake->energy.Tsurf_fbflag     = 0;
   lake->energy.Tsurf_fbcount    = 0;
+  lake->energy.Tsurf_dT         = SURF_DT;
   lake->energy.unfrozen         = 0.0;
   for (i=0; i<MAX_FRONTS; i++) {
     lake->energy.fdepth[i]      = 0.0;
@@ -9,7 +9,6 @@ int initialize_model_state(cell_info_struct* cell,
 			   dmy_struct           dmy,
 			   filep_struct         filep,
 			   int                  Ndist,
-			   const char*          initStateFilename,
 			   const ProgramState  *state)
 /**********************************************************************
   initialize_model_state      Keith Cherkauer	    April 17, 2000
@@ -104,6 +103,8 @@ int initialize_model_state(cell_info_struct* cell,
   2011-Jul-05 Changed logic initializing soil temperatures so that
 	      type of initialization depends solely on state->options.QUICK_FLUX;
 	      state->options.Nnodes is no longer automatically reset here.	TJB
+  2026-Oct-17 The initial state is read through the state file reader
+	      shared by all cells (filep.init_state).	AG
 **********************************************************************/
 {
 #if QUICK_FS
@@ -331,7 +332,7 @@ int initialize_model_state(cell_info_struct* cell,
 #endif
 
 
-    read_initial_model_state(initStateFilename, cell, cell->prcp.hruList.size(), Ndist, state);
+    read_initial_model_state(filep.init_state, cell, cell->prcp.hruList.size(), Ndist, state);
 
 #if EXCESS_ICE
     // calculate dynamic soil and veg properties if excess_ice is present
@@ -813,6 +814,7 @@ int initialize_model_state(cell_info_struct* cell,
     it->energy.Tfoliage_fbcount = 0;
     it->energy.Tcanopy_fbcount = 0;
     it->energy.Tsurf_fbcount = 0;
+    it->energy.Tsurf_dT = SURF_DT;
     for (int index = 0; index < state->options.Nnode - 1; index++) {
       it->energy.T_fbcount[index] = 0;
     }
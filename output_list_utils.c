@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include "vicNl.h"
 #include <string.h>
+#include <algorithm>
 
 static char vcid[] = "$Id$";
 
@@ -489,7 +490,7 @@ OutputData *create_output_list(const ProgramState* state) {
 
 }
 
-out_data_file_struct::out_data_file_struct() : fh(NULL), varid(NULL) {
+out_data_file_struct::out_data_file_struct() : fh(NULL), varid(NULL), out_dt(0) {
 
 }
 
@@ -506,6 +507,7 @@ void copy_data_file_format(const out_data_file_struct* out_template, std::vector
     strncpy(curData->filename, out_template[i].filename, MAXSTRING);
     strncpy(curData->prefix, out_template[i].prefix, OUT_DATA_FILE_STRUCT_PREFIX_LENGTH);
     curData->nvars = out_template[i].nvars;
+    curData->out_dt = out_template[i].out_dt;
     curData->varid = (int *)calloc(curData->nvars, sizeof(int));
     for (int curVar = 0; curVar < curData->nvars; curVar++) {
       curData->varid[curVar] = out_template[i].varid[curVar];
@@ -514,6 +516,18 @@ void copy_data_file_format(const out_data_file_struct* out_template, std::vector
   }
 }
 
+std::vector<int> output_intervals(const out_data_file_struct* out_template, const ProgramState* state) {
+  // OUT_STEP first (its stream is written to NETCDF_OUTPUT_FILENAME even if no file uses it), then the other
+  // intervals of the OUTFILEs in the order they first appear
+  std::vector<int> intervals(1, state->global_param.out_dt);
+  for (int i = 0; i < state->options.Noutfiles; i++) {
+    if (std::find(intervals.begin(), intervals.end(), out_template[i].out_dt) == intervals.end()) {
+      intervals.push_back(out_template[i].out_dt);
+    }
+  }
+  return intervals;
+}
+
 void init_output_list(OutputData *out_data, int write, const char *format, int type, float mult) {
 /*************************************************************
   init_output_list()      Ted Bohn     September 08, 2006
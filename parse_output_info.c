@@ -6,7 +6,7 @@
 static char vcid[] = "$Id$";
 
 void parse_output_info(const char*           input_file_name,
-                       out_data_file_struct  *out_data_files,
+                       out_data_file_struct  *&out_data_files,
                        OutputData       *out_data,
                        ProgramState          *state)
 /**********************************************************************
@@ -28,6 +28,9 @@ void parse_output_info(const char*           input_file_name,
   2009-Mar-15 Added default values for format, typestr, and
 	      multstr, so that they can be omitted from global
 	      param file.					TJB
+  2026-Oct-17 Added the optional aggregation interval of each OUTFILE;
+	      out_data_files is passed by reference so that the files
+	      allocated for N_OUTFILES reach the caller.	AG
 **********************************************************************/
 {
 
@@ -79,7 +82,22 @@ void parse_output_info(const char*           input_file_name,
           sprintf(ErrStr, "Error in global param file: number of output files specified in N_OUTFILES (%d) is less than actual number of output files defined in the global param file.",state->options.Noutfiles);
           nrerror(ErrStr);
         }
-        sscanf(cmdstr,"%*s %s %d",out_data_files[outfilenum].prefix,&(out_data_files[outfilenum].nvars));
+        // OUTFILE <prefix> <nvars> [<out_dt>]: files with an aggregation interval (hours) other than OUT_STEP are
+        // aggregated separately and written to their own NetCDF file
+        out_data_files[outfilenum].out_dt = 0;
+        sscanf(cmdstr,"%*s %s %d %d",out_data_files[outfilenum].prefix,&(out_data_files[outfilenum].nvars),&(out_data_files[outfilenum].out_dt));
+        if (out_data_files[outfilenum].out_dt != 0) {
+          const int dt = state->global_param.dt;
+          const int out_dt = out_data_files[outfilenum].out_dt;
+          if (out_dt < dt || out_dt > 24 || out_dt % dt != 0) {
+            sprintf(ErrStr, "Error in global param file: the output interval of OUTFILE %s (%d) must be an integer multiple of the model time step; >= model time step and <= 24.", out_data_files[outfilenum].prefix, out_dt);
+            nrerror(ErrStr);
+          }
+          if (state->options.OUTPUT_FORCE && out_dt != dt) {
+            sprintf(ErrStr, "Error in global param file: the output interval of OUTFILE %s (%d) must be equal to the model time step when producing disaggregated forcings.", out_data_files[outfilenum].prefix, out_dt);
+            nrerror(ErrStr);
+          }
+        }
         out_data_files[outfilenum].varid = (int *)calloc(out_data_files[outfilenum].nvars, sizeof(int));
         outvarnum = 0;
       }
@@ -115,4 +133,11 @@ void parse_output_info(const char*           input_file_name,
   }
   fclose(gp);
 
+  // Files without an output interval of their own are aggregated over OUT_STEP
+  for (fn = 0; fn < state->options.Noutfiles; fn++) {
+    if (out_data_files[fn].out_dt == 0) {
+      out_data_files[fn].out_dt = state->global_param.out_dt;
+    }
+  }
+
 }
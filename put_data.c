@@ -1,9 +1,39 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "vicNl.h"
+#include "EventLog.h"
 
 static char vcid[] = "$Id$";
 
+/* Reports the temperature solves of an HRU that fell back to the previous
+   step's temperature (TFALLBACK) in this time step. */
+static void report_fallbacks(const HRU& hru, int Nnode) {
+  char message[MAXSTRING];
+  sprintf(message, "vegetation class %d, band %d", hru.veg_con.vegClass, hru.bandIndex);
+  EventLog& log = EventLog::instance();
+  if (hru.energy.Tsurf_fbflag) {
+    log.report(EVENT_TFALLBACK, SOLVER_SURF_ENERGY_BAL, message);
+  }
+  for (int node = 0; node < Nnode; node++) {
+    if (hru.energy.T_fbflag[node]) {
+      log.report(EVENT_TFALLBACK, SOLVER_SOIL_THERMAL_EQN, message);
+      break;
+    }
+  }
+  if (hru.snow.surf_temp_fbflag) {
+    log.report(EVENT_TFALLBACK, SOLVER_SNOW_PACK_ENERGY_BALANCE, message);
+  }
+  if (hru.energy.Tfoliage_fbflag) {
+    log.report(EVENT_TFALLBACK, SOLVER_CANOPY_ENERGY_BAL, message);
+  }
+  if (hru.energy.Tcanopy_fbflag) {
+    log.report(EVENT_TFALLBACK, SOLVER_ATMOS_ENERGY_BAL, message);
+  }
+  if (hru.glacier.surf_temp_fbflag) {
+    log.report(EVENT_TFALLBACK, SOLVER_GLACIER_ENERGY_BALANCE, message);
+  }
+}
+
 int  put_data(cell_info_struct  *cell,
               WriteOutputFormat *output,
               OutputData   *out_data,
@@ -134,6 +164,14 @@ int  put_data(cell_info_struct  *cell,
   2011-Mar-01 Added OUT_ZWT2, OUT_ZWT3, and OUT_ZWTL.			TJB
   2011-Mar-31 Added frost_fract to collect_wb_terms() arglist.		TJB
   2011-Nov-04 Added OUT_TSKC.						TJB
+  2026-Oct-17 Record rec of the forcings is at rec - cell->atmos_first_rec,
+	      as cell->atmos may hold only a window of records.	AG
+  2026-Oct-17 Moved temporal aggregation and the ALMA unit conversions to
+	      OutputAccumulator, which only aggregates the variables that
+	      are written.	AG
+  2026-Oct-17 T fallbacks and the tree adjust warning are reported as
+	      events to the EventLog, instead of printing the fallback
+	      totals of each cell to stderr at the last record.	AG
 **********************************************************************/
 {
   int                     Ndist;
@@ -163,9 +201,8 @@ int  put_data(cell_info_struct  *cell,
   double                  ThisAreaFract;
   double                  ThisTreeAdjust;
   int                     dt_sec;
-  int                     out_dt_sec;
-  int                     out_step_ratio;
   int                     ErrorFlag;
+  char                    message[MAXSTRING];
 
 
   frost_fract = cell->soil_con.frost_fract;
@@ -174,8 +211,6 @@ int  put_data(cell_info_struct  *cell,
   dp = cell->soil_con.dp;
   skipyear = state->global_param.skipyear;
   dt_sec = state->dt_sec;
-  out_dt_sec = state->out_dt_sec;
-  out_step_ratio = state->out_step_ratio;
 
   if(state->options.DIST_PRCP)
     Ndist = 2;
@@ -208,7 +243,8 @@ int  put_data(cell_info_struct  *cell,
       TreeAdjustFactor[band] = 1.;
     }
     if (TreeAdjustFactor[band] != 1 && rec == 0) {
-      fprintf(stderr, "WARNING: Tree adjust factor for band %i is equal to %f.\n", band, TreeAdjustFactor[band]);
+      sprintf(message, "Tree adjust factor for band %i is equal to %f.", band, TreeAdjustFactor[band]);
+      EventLog::instance().report(EVENT_WARNING, EventLog::NO_SOLVER, message);
     }
   }
 
@@ -224,28 +260,29 @@ int  put_data(cell_info_struct  *cell,
   /* MPN */
   // Set output versions of input forcings
   if (rec >= 0) {
-    out_data[OUT_AIR_TEMP].data[0] = cell->atmos[rec].air_temp[state->NR];
-    out_data[OUT_DENSITY].data[0] = cell->atmos[rec].density[state->NR];
-    out_data[OUT_LONGWAVE].data[0] = cell->atmos[rec].longwave[state->NR];
-    out_data[OUT_PREC].data[0] = cell->atmos[rec].out_prec; // mm over grid cell
-    out_data[OUT_PRESSURE].data[0] = cell->atmos[rec].pressure[state->NR]
+    const atmos_data_struct *atmos = &cell->atmos[rec - cell->atmos_first_rec];
+    out_data[OUT_AIR_TEMP].data[0] = atmos->air_temp[state->NR];
+    out_data[OUT_DENSITY].data[0] = atmos->density[state->NR];
+    out_data[OUT_LONGWAVE].data[0] = atmos->longwave[state->NR];
+    out_data[OUT_PREC].data[0] = atmos->out_prec; // mm over grid cell
+    out_data[OUT_PRESSURE].data[0] = atmos->pressure[state->NR]
         / kPa2Pa;
-    out_data[OUT_QAIR].data[0] = EPS * cell->atmos[rec].vp[state->NR]
-        / cell->atmos[rec].pressure[state->NR];
-    out_data[OUT_RAINF].data[0] = cell->atmos[rec].out_rain; // mm over grid cell
-    out_data[OUT_REL_HUMID].data[0] = 100. * cell->atmos[rec].vp[state->NR]
-        / (cell->atmos[rec].vp[state->NR] + cell->atmos[rec].vpd[state->NR]);
+    out_data[OUT_QAIR].data[0] = EPS * atmos->vp[state->NR]
+        / atmos->pressure[state->NR];
+    out_data[OUT_RAINF].data[0] = atmos->out_rain; // mm over grid cell
+    out_data[OUT_REL_HUMID].data[0] = 100. * atmos->vp[state->NR]
+        / (atmos->vp[state->NR] + atmos->vpd[state->NR]);
     if (state->options.LAKES && cell->lake_con.Cl[0] > 0)
       out_data[OUT_LAKE_CHAN_IN].data[0] =
-          cell->atmos[rec].channel_in[state->NR]; // mm over grid cell
+          atmos->channel_in[state->NR]; // mm over grid cell
     else
       out_data[OUT_LAKE_CHAN_IN].data[0] = 0;
-    out_data[OUT_SHORTWAVE].data[0] = cell->atmos[rec].shortwave[state->NR];
-    out_data[OUT_SNOWF].data[0] = cell->atmos[rec].out_snow; // mm over grid cell
-    out_data[OUT_TSKC].data[0] = cell->atmos[rec].tskc[state->NR];
-    out_data[OUT_VP].data[0] = cell->atmos[rec].vp[state->NR] / kPa2Pa;
-    out_data[OUT_VPD].data[0] = cell->atmos[rec].vpd[state->NR] / kPa2Pa;
-    out_data[OUT_WIND].data[0] = cell->atmos[rec].wind[state->NR];
+    out_data[OUT_SHORTWAVE].data[0] = atmos->shortwave[state->NR];
+    out_data[OUT_SNOWF].data[0] = atmos->out_snow; // mm over grid cell
+    out_data[OUT_TSKC].data[0] = atmos->tskc[state->NR];
+    out_data[OUT_VP].data[0] = atmos->vp[state->NR] / kPa2Pa;
+    out_data[OUT_VPD].data[0] = atmos->vpd[state->NR] / kPa2Pa;
+    out_data[OUT_WIND].data[0] = atmos->wind[state->NR];
   }
   /****************************************
    Store Output for all Vegetation Types (except lakes)
@@ -359,6 +396,9 @@ int  put_data(cell_info_struct  *cell,
                            frost_fract,
                            frost_slope,
                            out_data, state);
+          if (rec >= 0) {
+            report_fallbacks(*hru, state->options.Nnode);
+          }
 
           // Store Wetland-Specific Variables
 
@@ -647,114 +687,11 @@ int  put_data(cell_info_struct  *cell,
 
 
 
-  /********************
-    Report T Fallback Occurrences
-  ********************/
-  if (rec == state->global_param.nrecs-1) {
-    fprintf(stderr,"Total number of fallbacks in Tfoliage: %d\n", cell->fallBackStats.Tfoliage_fbcount_total);
-    fprintf(stderr,"Total number of fallbacks in Tcanopy: %d\n", cell->fallBackStats.Tcanopy_fbcount_total);
-    fprintf(stderr,"Total number of fallbacks in Tsnowsurf: %d\n", cell->fallBackStats.Tsnowsurf_fbcount_total);
-    fprintf(stderr,"Total number of fallbacks in Tsurf: %d\n", cell->fallBackStats.Tsurf_fbcount_total);
-    fprintf(stderr,"Total number of fallbacks in soil T profile: %d\n", cell->fallBackStats.Tsoil_fbcount_total);
-    fprintf(stderr,"Total number of fallbacks in Tglac_surf: %d\n", cell->fallBackStats.Tglacsurf_fbcount_total);
-  }
-
-  /********************
-    Temporal Aggregation 
-    ********************/
-  for (int v=0; v<N_OUTVAR_TYPES; v++) {
-    if (out_data[v].aggtype == AGG_TYPE_END) {
-      for (int i=0; i<out_data[v].nelem; i++) {
-        out_data[v].aggdata[i] = out_data[v].data[i];
-      }
-    }
-    else if (out_data[v].aggtype == AGG_TYPE_SUM) {
-      for (int i=0; i<out_data[v].nelem; i++) {
-        out_data[v].aggdata[i] += out_data[v].data[i];
-      }
-    }
-    else if (out_data[v].aggtype == AGG_TYPE_AVG) {
-      for (int i=0; i<out_data[v].nelem; i++) {
-        out_data[v].aggdata[i] += out_data[v].data[i]/out_step_ratio;
-      }
-    }
-  }
-  out_data[OUT_AERO_RESIST].aggdata[0] = 1/out_data[OUT_AERO_COND].aggdata[0];
-  out_data[OUT_AERO_RESIST1].aggdata[0] = 1/out_data[OUT_AERO_COND1].aggdata[0];
-  out_data[OUT_AERO_RESIST2].aggdata[0] = 1/out_data[OUT_AERO_COND2].aggdata[0];
+  /* The T fallback occurrences are reported per time step as TFALLBACK events (report_fallbacks()), and counted
+     in the summary of the EventLog at the end of the run */
 
-  /********************
-    Output procedure
-    (only execute when we've completed an output interval)
-  ********************/
-  if (state->step_count == out_step_ratio) {
-
-    /***********************************************
-      Change of units for ALMA-compliant output
-    ***********************************************/
-    if (state->options.ALMA_OUTPUT) {
-      out_data[OUT_BASEFLOW].aggdata[0] /= out_dt_sec;
-      out_data[OUT_EVAP].aggdata[0] /= out_dt_sec;
-      out_data[OUT_EVAP_BARE].aggdata[0] /= out_dt_sec;
-      out_data[OUT_EVAP_CANOP].aggdata[0] /= out_dt_sec;
-      out_data[OUT_INFLOW].aggdata[0] /= out_dt_sec;
-      out_data[OUT_LAKE_BF_IN].aggdata[0] /= out_dt_sec;
-      out_data[OUT_LAKE_BF_IN_V].aggdata[0] /= out_dt_sec;
-      out_data[OUT_LAKE_BF_OUT].aggdata[0] /= out_dt_sec;
-      out_data[OUT_LAKE_BF_OUT_V].aggdata[0] /= out_dt_sec;
-      out_data[OUT_LAKE_CHAN_IN].aggdata[0] /= out_dt_sec;
-      out_data[OUT_LAKE_CHAN_IN_V].aggdata[0] /= out_dt_sec;
-      out_data[OUT_LAKE_CHAN_OUT].aggdata[0] /= out_dt_sec;
-      out_data[OUT_LAKE_CHAN_OUT_V].aggdata[0] /= out_dt_sec;
-      out_data[OUT_LAKE_DSTOR].aggdata[0] /= out_dt_sec;
-      out_data[OUT_LAKE_DSTOR_V].aggdata[0] /= out_dt_sec;
-      out_data[OUT_LAKE_DSWE].aggdata[0] /= out_dt_sec;
-      out_data[OUT_LAKE_DSWE_V].aggdata[0] /= out_dt_sec;
-      out_data[OUT_LAKE_EVAP].aggdata[0] /= out_dt_sec;
-      out_data[OUT_LAKE_EVAP_V].aggdata[0] /= out_dt_sec;
-      out_data[OUT_LAKE_ICE_TEMP].aggdata[0] += KELVIN;
-      out_data[OUT_LAKE_PREC_V].aggdata[0] /= out_dt_sec;
-      out_data[OUT_LAKE_RCHRG].aggdata[0] /= out_dt_sec;
-      out_data[OUT_LAKE_RCHRG_V].aggdata[0] /= out_dt_sec;
-      out_data[OUT_LAKE_RO_IN].aggdata[0] /= out_dt_sec;
-      out_data[OUT_LAKE_RO_IN_V].aggdata[0] /= out_dt_sec;
-      out_data[OUT_LAKE_VAPFLX].aggdata[0] /= out_dt_sec;
-      out_data[OUT_LAKE_VAPFLX_V].aggdata[0] /= out_dt_sec;
-      out_data[OUT_LAKE_SURF_TEMP].aggdata[0] += KELVIN;
-      out_data[OUT_PREC].aggdata[0] /= out_dt_sec;
-      out_data[OUT_RAINF].aggdata[0] /= out_dt_sec;
-      out_data[OUT_REFREEZE].aggdata[0] /= out_dt_sec;
-      out_data[OUT_RUNOFF].aggdata[0] /= out_dt_sec;
-      out_data[OUT_SNOW_MELT].aggdata[0] /= out_dt_sec;
-      out_data[OUT_SNOWF].aggdata[0] /= out_dt_sec;
-      out_data[OUT_SUB_BLOWING].aggdata[0] /= out_dt_sec;
-      out_data[OUT_SUB_CANOP].aggdata[0] /= out_dt_sec;
-      out_data[OUT_SUB_SNOW].aggdata[0] /= out_dt_sec;
-      out_data[OUT_SUB_SNOW].aggdata[0] += out_data[OUT_SUB_CANOP].aggdata[0];
-      out_data[OUT_SUB_SURFACE].aggdata[0] /= out_dt_sec;
-      out_data[OUT_TRANSP_VEG].aggdata[0] /= out_dt_sec;
-      out_data[OUT_BARESOILT].aggdata[0] += KELVIN;
-      out_data[OUT_SNOW_PACK_TEMP].aggdata[0] += KELVIN;
-      out_data[OUT_SNOW_SURF_TEMP].aggdata[0] += KELVIN;
-      for (int index=0; index<state->options.Nlayer; index++) {
-        out_data[OUT_SOIL_TEMP].aggdata[index] += KELVIN;
-      }
-      for (int index=0; index<state->options.Nnode; index++) {
-        out_data[OUT_SOIL_TNODE].aggdata[index] += KELVIN;
-        out_data[OUT_SOIL_TNODE_WL].aggdata[index] += KELVIN;
-      }
-      out_data[OUT_SURF_TEMP].aggdata[0] += KELVIN;
-      out_data[OUT_VEGT].aggdata[0] += KELVIN;
-      out_data[OUT_FDEPTH].aggdata[0] /= 100;
-      out_data[OUT_TDEPTH].aggdata[0] /= 100;
-      out_data[OUT_DELTACC].aggdata[0] *= out_dt_sec;
-      out_data[OUT_DELTAH].aggdata[0] *= out_dt_sec;
-      out_data[OUT_AIR_TEMP].aggdata[0] += KELVIN;
-      out_data[OUT_PRESSURE].aggdata[0] *= 1000;
-      out_data[OUT_VP].aggdata[0] *= 1000;
-      out_data[OUT_VPD].aggdata[0] *= 1000;
-    }
-  } // End of output procedure
+  /* Temporal aggregation, and the change of units for ALMA-compliant output,
+     are done for the requested output variables by OutputAccumulator::accumulate() */
 
   return (0);
 
@@ -3,11 +3,10 @@
 #include <string.h>
 #include <sstream>
 #include "vicNl.h"
-#include "StateIOContext.h"
 
 static char vcid[] = "$Id$";
 
-void read_initial_model_state(const char* initStateFilename, cell_info_struct *cell, int Nveg, int Ndist, const ProgramState *state)
+void read_initial_model_state(StateIO* reader, cell_info_struct *cell, int Nveg, int Ndist, const ProgramState *state)
 /*********************************************************************
   read_initial_model_state   Keith Cherkauer         April 14, 2000
 
@@ -78,6 +77,8 @@ void read_initial_model_state(const char* initStateFilename, cell_info_struct *c
 	      lake state data.  Now, if options.LAKES is TRUE, every grid cell
 	      will save lake state data.  If no lake is present, default NULL
 	      values will be stored.						TJB
+  2026-Oct-17 Reads from the given StateIO stream, which is opened once for
+	      all cells, instead of opening the state file for every cell.	AG
 *********************************************************************/
 {
   char   tmpstr[MAXSTRING];
@@ -92,9 +93,6 @@ void read_initial_model_state(const char* initStateFilename, cell_info_struct *c
   int    byte, Nbytes;
   int    tmp_int, node;
   int    frost_area;
-  
-  StateIOContext context(initStateFilename, StateIO::Reader, state);
-  StateIO* reader = context.stream;
 
 #if !NO_REWIND 
   reader->rewindFile();
@@ -1,11 +1,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "vicNl.h"
+#include "CellFileIndex.h"
 #include <string.h>
 
 static char vcid[] = "$Id$";
 
 lake_con_struct read_lakeparam(FILE            *lakeparam, 
+			       const CellFileIndex *lakeparam_index,
 			       soil_con_struct  soil_con, 
 			       std::vector<HRU>& hruList,
 			       const ProgramState* state)
@@ -63,6 +65,8 @@ lake_con_struct read_lakeparam(FILE            *lakeparam,
 	      mindepth.								TJB
   2012-Jan-02 Modified to turn off lakes in a grid cell if lake_idx is < 0.
 	      Added validation of parameter values.				TJB
+  2026-Oct-17 Seeks to the cell's record through lakeparam_index instead of
+	      rewinding and scanning the file for every cell.	AG
 **********************************************************************/
 
 {
@@ -78,8 +82,11 @@ lake_con_struct read_lakeparam(FILE            *lakeparam,
 
   lake_con_struct temp;
   
+  if (lakeparam_index != NULL)
+    lakeparam_index->seekToCell(lakeparam, soil_con.gridcel);  // at EOF if the cell is not in the file
 #if !NO_REWIND
-  rewind(lakeparam);
+  else
+    rewind(lakeparam);
 #endif // NO_REWIND
     
   /*******************************************************************/
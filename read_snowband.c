@@ -1,11 +1,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "vicNl.h"
+#include "CellFileIndex.h"
 #include <string.h>
 
 static char vcid[] = "$Id$";
 
 void read_snowband(FILE    *snowband,
+		   const CellFileIndex *snowband_index,
 		   soil_con_struct *soil_con,
 		   const int num_elevation_snow_bands)
 /**********************************************************************
@@ -25,6 +27,8 @@ void read_snowband(FILE    *snowband,
 	      the average of the band elevations.			TJB
   2009-Sep-28 Moved initialization of snow band parameters to the
 	      read_soilparam* functions.				TJB
+  2026-Oct-17 Seeks to the cell's record through snowband_index instead of
+	      rewinding and scanning the file for every cell.	AG
 **********************************************************************/
 {
   char    ErrStr[MAXSTRING];
@@ -38,8 +42,11 @@ void read_snowband(FILE    *snowband,
   if ( num_elevation_snow_bands > 1 ) {
 
     /** Find Current Grid Cell in SnowBand File **/
+    if (snowband_index != NULL)
+      snowband_index->seekToCell(snowband, soil_con->gridcel);  /* at EOF if the cell is not in the file */
 #if !NO_REWIND
-    rewind(snowband);
+    else
+      rewind(snowband);
 #endif
 
     fscanf(snowband, "%d", &cell);
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "vicNl.h"
+#include "CellFileIndex.h"
 #include <string.h>
 #include <string>
 #include <sstream>
@@ -51,6 +52,7 @@ int getVegIndex(int vegClass, const ProgramState* state) {
 // MDF: changed return type to int so we can return numHRUs for main program to calculate the max # of HRUs across all cells,
 // used to allocate space for in the state file
 int read_vegparam(FILE *vegparam,
+                   const CellFileIndex *vegparam_index,
                    cell_info_struct& cell,
                    const ProgramState* state)
 
@@ -93,6 +95,8 @@ int read_vegparam(FILE *vegparam,
   2009-Sep-14 Made error messages clearer.				TJB
   2009-Oct-01 Added error message for case of LAI==0 and overstory==1.	TJB
   2010-Apr-28 Replaced GLOBAL_LAI with VEGPARAM_LAI and LAI_SRC.	TJB
+  2026-Oct-17 Seeks to the cell's record through vegparam_index instead of
+	      rewinding and scanning the file for every cell.	AG
 **********************************************************************/
 {
   int             vegcel, numHRUs, skip;
@@ -110,8 +114,12 @@ int read_vegparam(FILE *vegparam,
 
   NoOverstory = 0;
 
+  vegcel = INVALID_INT;
+  if (vegparam_index != NULL)
+    vegparam_index->seekToCell(vegparam, cell.soil_con.gridcel);  // at EOF if the cell is not in the file
 #if !NO_REWIND
-  rewind(vegparam);
+  else
+    rewind(vegparam);
 #endif  
 
   while ( ( fscanf(vegparam, "%d %d", &vegcel, &numHRUs) == 2 ) && vegcel != cell.soil_con.gridcel ){
@@ -1,15 +1,460 @@
+/*
+ * SUMMARY:      root_brent.h - Determine surface temperature iteratively
+ * USAGE:        Part of DHSVM
+ *
+ * AUTHOR:       Bart Nijssen
+ * ORG:          University of Washington, Department of Civil Engineering
+ * E-MAIL:       nijssen@u.washington.edu
+ * ORIG-DATE:    Apr-96
+ * LAST-MOD: Mon Jan 24 12:06:38 2000 by Keith Cherkauer <cherkaue@u.washington.edu>
+ * DESCRIPTION:  Determine surface temperature iteratively using the Brent
+ *               method.  
+ * DESCRIP-END.
+ * FUNCTIONS:    RootBrent()
+ * COMMENTS:     
+ */
 
 #ifndef ROOT_BRENT_H_
 #define ROOT_BRENT_H_
 
-class RootBrent {
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+
+#include "vicNl_def.h"
+
+/*
+ * The parts of the Brent solver that do not depend on the residual function.
+ */
+class RootBrentBase {
 public:
-  RootBrent() {}
-  virtual ~RootBrent() {}
-  double root_brent(double LowerBound, double UpperBound, char* ErrorString);
-  virtual double calculate(double) = 0;
   //if the result of any calculation is less than -998 (ie -999) then there is an error
   static bool resultIsError(double result) { return result <= -998; }
+
+protected:
+  static const int MAXTRIES = 5;
+  static const int MAXITER = 1000;
+  static constexpr double MACHEPS = 3e-8;
+  static constexpr double TSTEP = 10;
+  static constexpr double TOLERANCE = 1e-7;
+
+  // Adds the wall time of a solve to the counters (VERBOSE only, since reading the clock costs about as much as
+  // a residual evaluation of the cheaper solvers). Nested solves are included in the time of the outer solver.
+  class SolverTimer {
+  public:
+#if VERBOSE
+    SolverTimer(SolverCounters* counters, SolverId solver) : counters(counters), solver(solver) {
+      if (counters != NULL) start = std::chrono::steady_clock::now();
+    }
+    ~SolverTimer() {
+      if (counters != NULL) {
+        counters->seconds[solver] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      }
+    }
+  private:
+    SolverCounters* counters;
+    SolverId solver;
+    std::chrono::steady_clock::time_point start;
+#else
+    SolverTimer(SolverCounters*, SolverId) {}
+#endif
+  };
 };
 
+/*
+ * Brent's root finder for the residual of an energy balance, e.g.
+ *
+ *   class SurfEnergyBal : public RootBrent<SurfEnergyBal> {
+ *   public:
+ *     double calculate(double Ts);             // the residual
+ *     SolverId solver() const { return SOLVER_SURF_ENERGY_BAL; }
+ *   };
+ *
+ * The residual class is a template parameter (CRTP) rather than a virtual function, so that calculate() can be
+ * inlined into the root search. The root search is instantiated explicitly next to the definition of calculate()
+ * (see func_surf_energy_bal.c), and declared extern in the residual's header, so that it is compiled once per
+ * solver where the residual is visible.
+ */
+template <class Residual>
+class RootBrent : public RootBrentBase {
+public:
+  RootBrent() : counters(NULL) {}
+  double root_brent(double LowerBound, double UpperBound, char* ErrorString);
+  // Brent's method on the given bracket only: returns ERROR, without an error message, if the function is
+  // undefined at either bound or the bounds do not bracket the root (no bracket expansion is attempted).
+  double root_brent_in_bracket(double LowerBound, double UpperBound, char* ErrorString);
+
+protected:
+  ~RootBrent() {}
+
+private:
+  Residual& residual() { return *static_cast<Residual*>(this); }
+  double iterate(double a, double b, double fa, double fb, char* ErrorString);
+  double evaluate(double x) {
+    if (counters != NULL) counters->evaluations[residual().solver()]++;
+    return residual().calculate(x);
+  }
+  SolverCounters* counters;
+};
+
+
+/*****************************************************************************
+  GENERAL DOCUMENTATION FOR THIS MODULE
+  -------------------------------------
+
+  Source: Brent, R. P., 1973, Algorithms for minimization without derivatives,
+                        Prentice Hall, Inc., Englewood Cliffs, New Jersey
+			Chapter 4
+  This source includes an implementation of the algorithm in ALGOL-60, which
+  was translated into C for this application.
+
+  The method is also discussed in:
+  Press, W. H., S. A. Teukolsky, W. T. Vetterling, B. P. Flannery, 1992,
+                Numerical Recipes in FORTRAN, The art of scientific computing,
+		Second edition, Cambridge University Press
+  (Be aware that this book discusses a Brent method for minimization (brent), 
+  and one for root finding (zbrent).  The latter one is similar to the one 
+  implemented here and is also copied from Brent [1973].)
+
+  The function returns the surface temperature, TSurf, for which the sum
+  of the energy balance terms is zero, with TSurf in the interval 
+  [MinTSurf, MaxTSurf].  The surface temperature is calculated to within
+  a tolerance (6 * MACHEPS * |TSurf| + 2 * TOLERANCE), where MACHEPS is the
+  relative machine precision and TOLERANCE is a positive tolerance, as
+  specified in RootBrentBase.
+
+  The function assures that f(MinTSurf) and f(MaxTSurf) have opposite signs.
+  If this is not the case the program will abort.  In addition the program
+  will perform not more than a certain number of iterations, as specified
+  in RootBrentBase, and will abort if more iterations are needed.
+******************************************************************************/
+  
+/*****************************************************************************
+  Function name: RootBrent()
+
+  Purpose      : Calculate the surface temperature
+
+  Required     :
+    double LowerBound     - Lower bound for root
+    double UpperBound     - Upper bound for root
+    char *ErrorString     - For storing description of errors (if any)
+
+  Returns      :
+    double b              - Effective surface temperature (C)
+
+  Modifies     : 
+    char *ErrorString     - Stores description of errors
+
+  Comments     :
+    04-Jun-04 Removed message announcing the dumping of variables,
+	      since that doesn't always happen when root_brent fails.
+	      Changed remaining message from ERROR to WARNING for
+	      the same reason.						TJB
+    21-Sep-04 No longer print warning to stderr from this routine;
+	      instead store warning messages in parameter ErrorString.	TJB
+  2007-Aug-31 Corrected handling of Function return value if Function returns
+	      ERROR.  This can happen if Function is func_surf_energy_bal.	JCA
+  2007-Sep-01 Removed the integer "eval" since it is never used for anything.	JCA
+  2009-May-22 Modified root-bracketing scheme to handle case when one bound
+	      yields garbage output from the target function.			TJB
+  2026-Oct-17 Moved the root search into iterate(), shared with
+	      root_brent_in_bracket(); calls and function evaluations are
+	      counted in the SolverCounters of the HRU being solved.	AG
+  2026-Oct-17 RootBrent is now a template over the residual class
+	      (CRTP), so that the residual can be inlined.	AG
+*****************************************************************************/
+template <class Residual>
+double RootBrent<Residual>::root_brent(double LowerBound, double UpperBound, char* ErrorString)
+{
+  const char *Routine = "RootBrent";
+  double a;
+  double b;
+  double c;
+  double fa;
+  double fb;
+  double fc;
+  double last_bad;
+  double last_good;
+  int which_err;
+  int i;
+  int j;
+
+  counters = SolverCounters::current();
+  if (counters != NULL) counters->solves[residual().solver()]++;
+  SolverTimer timer(counters, residual().solver());
+
+  /* initialize variable argument list */
+  a = LowerBound;
+  b = UpperBound;
+  fa = evaluate(a);
+  fb = evaluate(b);
+ 
+  which_err = 0;
+
+  // If Function returns values of ERROR for both bounds, give up
+  if (fa == ERROR && fb == ERROR) {
+    sprintf(ErrorString,"ERROR: %s: lower and upper bounds %f and %f failed to bracket the root because the given function was not defined at either point.\n",Routine,a,b);
+    return(ERROR);
+  }      
+
+  // If Function returns value of ERROR for one bound but not both bounds,
+  // move the offending bound until the Function returns a valid value
+  if(fa == ERROR || fb == ERROR) {
+
+    if (fa == ERROR) {
+      which_err = -1;
+      last_bad = a;
+      last_good = b;
+    }
+    else {
+      which_err = 1;
+      last_good = a;
+      last_bad = b;
+    }
+
+    c = 0.5*(last_bad+last_good);
+    fc = evaluate(c);
+
+    /* search for valid point via bisection */
+    j = 0;
+    while (fc == ERROR && j < MAXITER) {
+      last_bad = c;
+      c = 0.5*(last_bad+last_good);
+      fc = evaluate(c);
+      j++;
+    }
+
+    if (fc == ERROR) {
+      /* if we get here, we could not find a bound for which the function returns a valid value */
+      sprintf(ErrorString,"ERROR: %s: the given function produced undefined values while attempting to bracket the root between %f and %f.\n",Routine,LowerBound,UpperBound);
+      return(ERROR);
+    }
+    else {
+      if (which_err == -1) {
+        a = c;
+        fa = fc;
+      }
+      else {
+        b = c;
+        fb = fc;
+      }
+    }
+
+  }
+
+  // At this point, we have two bounds that yield valid values of the target function
+
+  /*  if root not bracketed attempt to bracket the root */
+  j = 0;
+  while ((fa * fb) >= 0  && j < MAXTRIES) {
+    /* Expansion of bounds depends on whether initial bounds encountered undefined function values */
+    if (which_err == 0) { // No undefined values were encountered
+      a -= TSTEP;
+      b += TSTEP;
+      fa = evaluate(a);
+      fb = evaluate(b);
+    }
+    else { // Undefined values were encountered
+      if (which_err == -1) { // Undefined values encountered in the lower direction
+        b += TSTEP;
+        fb = evaluate(b);
+        if (fb == ERROR) {
+          /* Undefined function values in both directions - give up */
+          sprintf(ErrorString,"ERROR: %s: the given function produced undefined values while attempting to bracket the root between %f and %f.\n",Routine,LowerBound,UpperBound);
+          return(ERROR);
+        }
+        last_good = a;
+      }
+      else { // Undefined values encountered in the upper direction
+        a -= TSTEP;
+        fa = evaluate(a);
+        if (fa == ERROR) {
+          /* Undefined function values in both directions - give up */
+          sprintf(ErrorString,"ERROR: %s: the given function produced undefined values while attempting to bracket the root between %f and %f.\n",Routine,LowerBound,UpperBound);
+          return(ERROR);
+        }
+        last_good = b;
+      }
+
+      /* search for valid point via bisection */
+      c = 0.5*(last_good+last_bad);
+      fc = evaluate(c);
+      i = 0;
+      while (fc == ERROR && i < MAXITER) {
+        last_bad = c;
+        c = 0.5*(last_bad+last_good);
+        fc = evaluate(c);
+        i++;
+      }
+
+      if (fc == ERROR) {
+        /* if we get here, we could not find a bound for which the function returns a valid value */
+        sprintf(ErrorString,"ERROR: %s: the given function produced undefined values while attempting to bracket the root between %f and %f.\n",Routine,LowerBound,UpperBound);
+        return(ERROR);
+      }
+      else {
+        if (which_err == -1) {
+          a = c;
+          fa = fc;
+        }
+        else {
+          b = c;
+          fb = fc;
+        }
+      }
+
+    }
+
+    j++;
+  }
+  if ((fa * fb) >= 0) {
+    /* if we get here, the lower and upper bounds did not bracket the root */
+    sprintf(ErrorString,"WARNING: %s: lower and upper bounds %f and %f failed to bracket the root.\n",Routine,a,b);
+    return(ERROR);
+  }
+
+  // At this point, we have bracketed the root
+  return iterate(a, b, fa, fb, ErrorString);
+}
+
+/*****************************************************************************
+  Function name: root_brent_in_bracket()
+
+  Purpose      : Brent's method on a bracket that is expected to hold the root,
+                 e.g. a narrow one around the solution of the previous time
+                 step.  Unlike root_brent() it does not try to repair or expand
+                 the bracket, so that the caller can fall back to root_brent()
+                 with its usual bounds instead.
+
+  Returns      : the root, or ERROR (with ErrorString untouched) if the
+                 function is undefined at a bound or the bounds do not bracket
+                 the root.
+*****************************************************************************/
+template <class Residual>
+double RootBrent<Residual>::root_brent_in_bracket(double LowerBound, double UpperBound, char* ErrorString)
+{
+  counters = SolverCounters::current();
+  if (counters != NULL) counters->solves[residual().solver()]++;
+  SolverTimer timer(counters, residual().solver());
+
+  double fa = evaluate(LowerBound);
+  if (fa == ERROR) {
+    return(ERROR);
+  }
+  double fb = evaluate(UpperBound);
+  if (fb == ERROR || (fa * fb) >= 0) {
+    return(ERROR);
+  }
+  return iterate(LowerBound, UpperBound, fa, fb, ErrorString);
+}
+
+/*****************************************************************************
+  Function name: iterate()
+
+  Purpose      : Brent's root search, given bounds a and b with function
+                 values fa and fb of opposite signs.
+*****************************************************************************/
+template <class Residual>
+double RootBrent<Residual>::iterate(double a, double b, double fa, double fb, char* ErrorString)
+{
+  const char *Routine = "RootBrent";
+  double c;
+  double d;
+  double e;
+  double fc;
+  double m;
+  double p;
+  double q;
+  double r;
+  double s;
+  double tol;
+  int i;
+
+  // Now search for the root
+
+  fc = fb;
+
+  for (i = 0; i < MAXITER; i++) {
+
+    if (fb*fc > 0) {
+      c = a;
+      fc = fa;
+      d = b - a;
+      e = d;
+    }
+    
+    if (fabs(fc) < fabs(fb)) {
+      a = b;
+      b = c;
+      c = a;
+      fa = fb;
+      fb = fc;
+      fc = fa;
+    }
+    
+    tol = 2 * MACHEPS * fabs(b) + TOLERANCE;
+    m = 0.5 * (c - b);
+    
+    if (fabs(m) <= tol || fb == 0) {
+      return b;
+    }
+    
+    else {
+      if (fabs(e) < tol || fabs(fa) <= fabs(fb)) {
+	d = m;
+	e = d;
+      }
+      else {
+	s = fb/fa;
+	
+	if (a == c) {
+	  
+	  /* linear interpolation */
+          
+	  p = 2 * m * s;
+	  q = 1 - s;
+	}
+	
+	else {
+	  
+	  /* inverse quadratic interpolation */
+	  
+	  q = fa/fc;
+	  r = fb/fc;
+	  p = s * (2 * m * q * (q - r) - (b - a) * (r - 1));
+	  q = (q - 1) * (r - 1) * (s - 1);
+	}
+	
+	if (p > 0)
+	  q = -q;
+	else
+	  p = -p;
+	s = e;
+	e = d;
+	if ((2 * p) < ( 3 * m * q - fabs(tol * q)) && p < fabs(0.5 * s * q))
+	  d = p/q;
+	else {
+	  d = m;
+	  e = d;
+	}
+      }
+      a = b;
+      fa = fb;
+      b += (fabs(d) > tol) ? d : ((m > 0) ? tol : -tol);
+      fb = evaluate(b);
+
+      // Catch ERROR values returned from Function
+      if(fb == ERROR){
+	sprintf(ErrorString,"ERROR returned to root_brent on iteration %d: temperature = %.4f\n",i+1,b);
+	return( ERROR );
+      }      
+
+    }
+  }
+  /* If we get here, there were too many iterations */
+  sprintf(ErrorString,"WARNING: %s: too many iterations.\n",Routine);
+  return(ERROR);
+
+}
+
 #endif /* ROOT_BRENT_H_ */
@@ -20,6 +20,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "vicNl.h"
+#include "EventLog.h"
 
 static char vcid[] = "$Id$";
 
@@ -77,6 +78,8 @@ static char vcid[] = "$Id$";
   2009-Dec-11 Replaced "assert" statements with "if" statements.	TJB
   2010-Apr-26 Replaced individual forcing variables with atmos_data
 	      in argument list.						TJB
+  2026-Oct-17 The error dump of error_print_canopy_energy_bal is
+	      reported as a solver error event to the EventLog.	AG
 *****************************************************************************/
 int snow_intercept(double  Dt,
 		   double  F,  
@@ -636,80 +639,83 @@ double error_print_canopy_energy_bal(double Tfoliage,
     const ProgramState* state)
 {
   /** Print variable info */
-  fprintf(stderr, "%s", ErrorString);
-  fprintf(stderr, "ERROR: snow_intercept failed to converge to a solution in root_brent.  Variable values will be dumped to the screen, check for invalid values.\n");
+  EventMessage message;
+  FILE* out = message.stream();
+  fprintf(out, "%s", ErrorString);
+  fprintf(out, "ERROR: snow_intercept failed to converge to a solution in root_brent.  Variable values will be dumped to the screen, check for invalid values.\n");
 
   /* General Model Parameters */
-  printf("month = %i\n",     month);
-  printf("rec = %i\n", rec);
+  fprintf(out, "month = %i\n",     month);
+  fprintf(out, "rec = %i\n", rec);
   
-  printf("delta_t = %f\n", delta_t);
-  printf("elevation = %f\n",  elevation);
+  fprintf(out, "delta_t = %f\n", delta_t);
+  fprintf(out, "elevation = %f\n",  elevation);
   
-  printf("*Wcr = %f\n", *Wcr);
-  printf("*Wpwp = %f\n", *Wpwp);
-  printf("*depth = %f\n", *depth);
+  fprintf(out, "*Wcr = %f\n", *Wcr);
+  fprintf(out, "*Wpwp = %f\n", *Wpwp);
+  fprintf(out, "*depth = %f\n", *depth);
 #if SPATIAL_FRoST
-  printf(" = %f\n", *frost_fract);
+  fprintf(out, " = %f\n", *frost_fract);
 #endif
   
   /* Atmopheric Condition and Forcings */
-  printf("AirDens = %f\n",  AirDens);
-  printf("EactAir = %f\n",  EactAir);
-  printf("Press = %f\n",  Press);
-  printf("latent_heat_Le = %f\n",  latent_heat_Le);
-  printf("Ra = [%f, %f]\n",  Ra.canopyIfOverstory, Ra[UnderStory]);
-  printf("Ra_used = %f\n",  Ra_used.surface);
-  printf("Tcanopy = %f\n",  Tcanopy);
-  printf("Vpd = %f\n",  Vpd);
-  printf("mu = %f\n",  mu);
-
-  printf("Evap = %f\n", *Evap);
-  printf("Rainfall = %f\n", *Rainfall);
-  printf("Wind = [%f, %f]\n",  wind_speed.canopyIfOverstory, wind_speed[UnderStory]);
+  fprintf(out, "AirDens = %f\n",  AirDens);
+  fprintf(out, "EactAir = %f\n",  EactAir);
+  fprintf(out, "Press = %f\n",  Press);
+  fprintf(out, "latent_heat_Le = %f\n",  latent_heat_Le);
+  fprintf(out, "Ra = [%f, %f]\n",  Ra.canopyIfOverstory, Ra[UnderStory]);
+  fprintf(out, "Ra_used = %f\n",  Ra_used.surface);
+  fprintf(out, "Tcanopy = %f\n",  Tcanopy);
+  fprintf(out, "Vpd = %f\n",  Vpd);
+  fprintf(out, "mu = %f\n",  mu);
+
+  fprintf(out, "Evap = %f\n", *Evap);
+  fprintf(out, "Rainfall = %f\n", *Rainfall);
+  fprintf(out, "Wind = [%f, %f]\n",  wind_speed.canopyIfOverstory, wind_speed[UnderStory]);
 
   /* Vegetation Terms */
-  printf("UnderStory = %i\n",     UnderStory);
-  printf("veg_class = %i\n",     veg_class);
+  fprintf(out, "UnderStory = %i\n",     UnderStory);
+  fprintf(out, "veg_class = %i\n",     veg_class);
 
-  printf("displacement = [%f, %f]\n",  displacement.canopyIfOverstory, displacement[UnderStory]);
-  printf("ref_height = [%f, %f]\n",  ref_height.canopyIfOverstory, ref_height[UnderStory]);
-  printf("roughness = [%f, %f]\n",  roughness.canopyIfOverstory, roughness[UnderStory]);
+  fprintf(out, "displacement = [%f, %f]\n",  displacement.canopyIfOverstory, displacement[UnderStory]);
+  fprintf(out, "ref_height = [%f, %f]\n",  ref_height.canopyIfOverstory, ref_height[UnderStory]);
+  fprintf(out, "roughness = [%f, %f]\n",  roughness.canopyIfOverstory, roughness[UnderStory]);
 
-  printf("root = %f\n", *root);
+  fprintf(out, "root = %f\n", *root);
 
   /* Water Flux Terms */
-  printf("IntRain = %f\n",  IntRain);
-  printf("IntSnow = %f\n",  IntSnow);
+  fprintf(out, "IntRain = %f\n",  IntRain);
+  fprintf(out, "IntSnow = %f\n",  IntSnow);
 
-  printf("Wdew = %f\n", *Wdew);
+  fprintf(out, "Wdew = %f\n", *Wdew);
 
-  write_layer(layer_wet, veg_class, state->options.Nlayer, frost_fract);
+  write_layer(layer_wet, veg_class, state->options.Nlayer, frost_fract, out);
 
   if(state->options.DIST_PRCP)
-    write_layer(layer_dry, veg_class, state->options.Nlayer, frost_fract);
+    write_layer(layer_dry, veg_class, state->options.Nlayer, frost_fract, out);
 
-  write_vegvar(&(veg_var_wet[0]),veg_class);
+  write_vegvar(&(veg_var_wet[0]),veg_class, out);
   if(state->options.DIST_PRCP)
-    write_vegvar(&(veg_var_dry[0]),veg_class);
+    write_vegvar(&(veg_var_dry[0]),veg_class, out);
 
   /* Energy Flux Terms */
-  fprintf(stderr, "LongOverIn = %f\n",  LongOverIn);
-  fprintf(stderr, "LongUnderOut = %f\n",  LongUnderOut);
-  fprintf(stderr, "NetShortOver = %f\n",  NetShortOver);
-
-  fprintf(stderr, "*AdvectedEnergy = %f\n", *AdvectedEnergy);
-  fprintf(stderr, "*LatentHeat = %f\n", *LatentHeat);
-  fprintf(stderr, "*LatentHeatSub = %f\n", *LatentHeatSub);
-  fprintf(stderr, "*LongOverOut = %f\n", *LongOverOut);
-  fprintf(stderr, "*NetLongOver = %f\n", *NetLongOver);
-  fprintf(stderr, "*NetRadiation = %f\n", *NetRadiation);
-  fprintf(stderr, "*RefreezeEnergy = %f\n", *RefreezeEnergy);
-  fprintf(stderr, "*SensibleHeat = %f\n", *SensibleHeat);
-  fprintf(stderr, "*VaporMassFlux = %f\n", *VaporMassFlux);
+  fprintf(out, "LongOverIn = %f\n",  LongOverIn);
+  fprintf(out, "LongUnderOut = %f\n",  LongUnderOut);
+  fprintf(out, "NetShortOver = %f\n",  NetShortOver);
+
+  fprintf(out, "*AdvectedEnergy = %f\n", *AdvectedEnergy);
+  fprintf(out, "*LatentHeat = %f\n", *LatentHeat);
+  fprintf(out, "*LatentHeatSub = %f\n", *LatentHeatSub);
+  fprintf(out, "*LongOverOut = %f\n", *LongOverOut);
+  fprintf(out, "*NetLongOver = %f\n", *NetLongOver);
+  fprintf(out, "*NetRadiation = %f\n", *NetRadiation);
+  fprintf(out, "*RefreezeEnergy = %f\n", *RefreezeEnergy);
+  fprintf(out, "*SensibleHeat = %f\n", *SensibleHeat);
+  fprintf(out, "*VaporMassFlux = %f\n", *VaporMassFlux);
 
   /* call error handling routine */
-  fprintf(stderr,"**********\n**********\nFinished dumping snow_intercept variables.\nTry increasing SNOW_DT to get model to complete cell.\nThen check output for instabilities.\n**********\n**********\n");
+  fprintf(out,"**********\n**********\nFinished dumping snow_intercept variables.\nTry increasing SNOW_DT to get model to complete cell.\nThen check output for instabilities.\n**********\n**********\n");
+  EventLog::instance().report(EVENT_SOLVER_ERROR, SOLVER_CANOPY_ENERGY_BAL, message.text());
 
   return( ERROR );
 
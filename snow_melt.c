@@ -374,7 +374,7 @@ int snow_melt(double latent_heat_Le,
 //        fprintf(stderr,"Snowpack is too thin to solve separately; it will be solved in conjunction with ground surface energy balance\n");
 	snow->surf_temp = INVALID;
       }
-      if (IS_VALID(snow->surf_temp) && RootBrent::resultIsError(snow->surf_temp) == false) {
+      if (IS_VALID(snow->surf_temp) && RootBrentBase::resultIsError(snow->surf_temp) == false) {
         SnowPackEnergyBalance snowPackEnergyBalanceSurfTemp(delta_t, aero_resist, aero_resist_used,
 					 displacement, z2, roughness, 
 					 density, vp, LongSnowIn, latent_heat_Le, pressure,
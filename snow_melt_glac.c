@@ -249,7 +249,7 @@ int snow_melt_glac(double latent_heat_Le,
       }
     }
 
-    if (IS_VALID(snow->surf_temp) && RootBrent::resultIsError(snow->surf_temp) == false) {
+    if (IS_VALID(snow->surf_temp) && RootBrentBase::resultIsError(snow->surf_temp) == false) {
       SnowPackEnergyBalance snowPackEnergyBalanceSurfTemp(delta_t, aero_resist,
           aero_resist_used, displacement, z2, roughness, density, vp, LongSnowIn,
           latent_heat_Le, pressure, RainFall, NetShortSnow, vpd, wind,
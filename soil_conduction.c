@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "vicNl.h"
+#include "FastKernels.h"
 
 static char vcid[] = "$Id$";
 
@@ -831,6 +832,24 @@ double maximum_unfrozen_water(double T,
                               double max_moist,
                               double bubble,
                               double expt) {
+/**********************************************************************
+  This subroutine computes the maximum amount of unfrozen water that
+  can exist at the current temperature, with the vectorized kernel if
+  the FAST_KERNELS option is set (see FastKernels.h).
+**********************************************************************/
+
+  if (FastKernels::instance().isEnabled()) {
+    double unfrozen;
+    FastKernels::unfrozenWater(1, &T, &max_moist, &bubble, &expt, &unfrozen);
+    return (unfrozen);
+  }
+  return maximum_unfrozen_water_exact(T, max_moist, bubble, expt);
+}
+
+double maximum_unfrozen_water_exact(double T,
+                                    double max_moist,
+                                    double bubble,
+                                    double expt) {
 /**********************************************************************
   This subroutine computes the maximum amount of unfrozen water that
   can exist at the current temperature.
@@ -843,6 +862,8 @@ double maximum_unfrozen_water(double T,
 	      the Cold Region Climate Study".				JCA
   2007-Aug-09 Added features for EXCESS_ICE option.			JCA
   2009-Feb-10 Modified to return max_moist if T > 0C.			KAC via TJB
+  2026-Oct-17 Renamed from maximum_unfrozen_water(), which now selects
+	      between this and the FAST_KERNELS kernel.	AG
 **********************************************************************/
 
   double unfrozen;
@@ -90,3 +90,6 @@ double SoilThermalEqn::calculate(double T) {
   return(value);
 
 }
+
+// The root search of this solver, compiled here so that calculate() can be inlined into it
+template class RootBrent<SoilThermalEqn>;
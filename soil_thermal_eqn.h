@@ -3,7 +3,7 @@
 #ifndef SOIL_THERMAL_EQN_H_
 #define SOIL_THERMAL_EQN_H_
 
-class SoilThermalEqn : public RootBrent {
+class SoilThermalEqn : public RootBrent<SoilThermalEqn> {
 public:
   SoilThermalEqn(double TL, double TU, double T0, double moist,
       double max_moist, double** ufwc_table, double bubble, double expt,
@@ -15,6 +15,8 @@ public:
   }
 
   double calculate(double);
+
+  SolverId solver() const { return SOLVER_SOIL_THERMAL_EQN; }
 private:
   double TL;
   double TU;
@@ -35,5 +37,8 @@ private:
   int node;
 };
 
+// Instantiated in soil_thermal_eqn.c
+extern template class RootBrent<SoilThermalEqn>;
+
 
 #endif /* SOIL_THERMAL_EQN_H_ */
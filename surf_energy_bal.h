@@ -4,7 +4,7 @@
 #ifndef SURF_ENERGY_BAL_H_
 #define SURF_ENERGY_BAL_H_
 
-class SurfEnergyBal : public RootBrent {
+class SurfEnergyBal : public RootBrent<SurfEnergyBal> {
 public:
   SurfEnergyBal(int rec, int nrecs, int month, int VEG, int veg_class,
       double delta_t, double Cs1, double Cs2, double D1, double D2,
@@ -65,6 +65,8 @@ public:
 
   double calculate(double);
 
+  SolverId solver() const { return SOLVER_SURF_ENERGY_BAL; }
+
 
   int rec;
   int nrecs;
@@ -164,4 +166,7 @@ public:
 
 };
 
+// Instantiated in func_surf_energy_bal.c
+extern template class RootBrent<SurfEnergyBal>;
+
 #endif /* SURF_ENERGY_BAL_H_ */
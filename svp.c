@@ -1,16 +1,32 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "vicNl.h"
+#include "FastKernels.h"
 
 static char vcid[] = "$Id$";
 
 double svp(double temp)
 /**********************************************************************
   This routine computes the saturated vapor pressure using Handbook
-  of Hydrology eqn 4.2.2
+  of Hydrology eqn 4.2.2, or interpolates it in a table if the
+  FAST_KERNELS option is set (see FastKernels.h).
 
   Pressure in Pa
 
+  2026-Oct-17 Added the FAST_KERNELS table.	AG
+**********************************************************************/
+{
+  const FastKernels& kernels = FastKernels::instance();
+  if (kernels.isEnabled())
+    return kernels.svp(temp);
+  return svp_exact(temp);
+}
+
+double svp_exact(double temp)
+/**********************************************************************
+  Saturated vapor pressure from Handbook of Hydrology eqn 4.2.2
+
+  Pressure in Pa
 **********************************************************************/
 {
   double SVP;
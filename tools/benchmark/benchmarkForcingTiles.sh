@@ -0,0 +1,86 @@
+#!/bin/bash
+
+# Compares the NetCDF forcing reader for several values of the FORCE_TILE_SIZE global parameter.
+# FORCE_TILE_SIZE 1 reads one cell at a time, like the original per-cell reader.
+#
+# VIC must be built with VERBOSE TRUE (user_def.h), which makes it report the reads of each NetCDF
+# forcing file and the time spent loading the forcings and initializing the model. The forcing
+# files of the given global parameter file must be NetCDF. Each run writes to the RESULT_DIR of the
+# given global parameter file, so the output of the last run is the one left there. The first run
+# may also pay for reading the forcing files into the page cache; list a tile size twice (e.g.
+# --tiles "1 1 4 16") to see the warm-cache figures.
+
+globalOptionsFile=""
+program="./vicNl"
+tileSizes="1 4 16 64"
+
+usage()
+{
+    echo "Usage: benchmarkForcingTiles.sh --global <global_options_file> [--program <path to vicNl>] [--tiles \"1 4 16 ...\"]"
+    exit 1
+}
+
+while [[ $# > 0 ]]
+do
+key="$1"
+shift
+
+case $key in
+    --global)
+        globalOptionsFile="$1"
+        shift
+    ;;
+    --program)
+        program="$1"
+        shift
+    ;;
+    --tiles)
+        tileSizes="$1"
+        shift
+    ;;
+    *)
+        usage
+    ;;
+esac
+done
+
+if [ -z "$globalOptionsFile" ] || [ ! -f "$globalOptionsFile" ]; then
+    usage
+fi
+
+runGlobalFile=$(mktemp)
+runLog=$(mktemp)
+trap "rm -f $runGlobalFile $runLog" EXIT
+
+printf "%-16s %-16s %-12s %-16s %-20s %s\n" "FORCE_TILE_SIZE" "hyperslab reads" "MB read" "reading (s)" "initialization (s)" "speedup"
+baseline=""
+for tileSize in $tileSizes
+do
+    # Use the global parameter file with FORCE_TILE_SIZE set to this tile size
+    grep -viE '^[[:space:]]*#?[[:space:]]*FORCE_TILE_SIZE' $globalOptionsFile > $runGlobalFile
+    echo -e "FORCE_TILE_SIZE\t$tileSize" >> $runGlobalFile
+
+    $program -g $runGlobalFile > $runLog 2>&1
+    if [ $? != 0 ]
+    then
+        echo "VIC FAILED with FORCE_TILE_SIZE $tileSize, see the end of its output:"
+        tail -20 $runLog
+        exit 1
+    fi
+
+    # "  <n> hyperslab reads, <MB> MB, <s> seconds", one line per NetCDF forcing file
+    reads=$(grep "hyperslab reads" $runLog | awk '{ n += $1; mb += $4; s += $6 } END { if (NR > 0) printf "%d %.1f %.3f", n, mb, s }')
+    initialization=$(grep "Elapsed time loading input forcings and initializing the model" $runLog | tail -1 | awk '{print $(NF-1)}')
+    if [ -z "$reads" ] || [ -z "$initialization" ]; then
+        echo "No forcing read statistics reported; build VIC with VERBOSE TRUE in user_def.h and use NetCDF forcing files"
+        exit 1
+    fi
+    readCalls=$(echo "$reads" | awk '{print $1}')
+    megabytes=$(echo "$reads" | awk '{print $2}')
+    secondsReading=$(echo "$reads" | awk '{print $3}')
+    if [ -z "$baseline" ]; then
+        baseline=$secondsReading
+    fi
+    speedup=$(awk -v a=$secondsReading -v b=$baseline 'BEGIN { if (a > 0) printf "%.2fx", b / a; else print "-" }')
+    printf "%-16s %-16s %-12s %-16s %-20s %s\n" "$tileSize" "$readCalls" "$megabytes" "$secondsReading" "$initialization" "$speedup"
+done
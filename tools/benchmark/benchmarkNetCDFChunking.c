@@ -0,0 +1,201 @@
+/*
+ * Writes a test grid to a NetCDF file and reads it back, for each chunking preset of the NetCDF output
+ * (OUTPUT_CHUNKING DEFAULT, TIME_SLAB and TIME_SERIES), with the same NetCDFStorage settings the model applies.
+ *
+ * The grid is written the way VIC writes its output, one time record of the whole grid per write. It is then read
+ * back both ways its users read it: whole maps of single time records, and whole time series of single grid points.
+ * The values read are checked against those written.
+ *
+ * Build with "make netcdfBenchmark", and run e.g.
+ *   ./benchmarkNetCDFChunking --lat 180 --lon 360 --records 2920 --deflate 5 --dir /scratch
+ * The chunk cache of the TIME_SERIES preset is sized to hold one row of chunks (see OUTPUT_CHUNK_CACHE), unless
+ * --cache is given.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <netcdf>
+
+#include "NetCDFStorage.h"
+
+using netCDF::NcDim;
+using netCDF::NcFile;
+using netCDF::NcVar;
+
+struct BenchmarkOptions {
+  int numLat;
+  int numLon;
+  int numRecords;
+  int chunkTime;
+  int chunkSpace;
+  int deflateLevel;
+  bool shuffle;
+  double cacheMB;        // < 0: sized to the chunk row of the TIME_SERIES preset
+  int numMapReads;
+  int numSeriesReads;
+  std::string dir;
+};
+
+static void usage() {
+  fprintf(stderr, "Usage: benchmarkNetCDFChunking [--lat n] [--lon n] [--records n] [--chunk-time n] [--chunk-space n]\n"
+      "    [--deflate level] [--shuffle] [--cache MB] [--map-reads n] [--series-reads n] [--dir directory]\n");
+  exit(1);
+}
+
+static double secondsSince(const std::chrono::steady_clock::time_point& start) {
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// A smooth field that changes with time, so that the deflate filter sees data like model output
+static float testValue(int rec, int lat, int lon) {
+  return 273.15f + 10.f * (float) lat / 100.f - 5.f * (float) lon / 100.f + (float) (rec % 24) * 0.25f;
+}
+
+static bool benchmarkPreset(const char* name, NetCDFChunking::Type chunking, const BenchmarkOptions& options) {
+  netcdf_storage_struct settings;
+  settings.chunking = chunking;
+  settings.chunk_time = options.chunkTime;
+  settings.chunk_space = options.chunkSpace;
+  settings.deflate_level = options.deflateLevel;
+  settings.shuffle = options.shuffle;
+  settings.chunk_cache_mb = 0;
+  std::vector<size_t> sizes;
+  sizes.push_back(options.numRecords);
+  sizes.push_back(options.numLat);
+  sizes.push_back(options.numLon);
+  if (options.cacheMB >= 0) {
+    settings.chunk_cache_mb = options.cacheMB;
+  } else if (chunking == NetCDFChunking::TIME_SERIES_CHUNKS) {
+    settings.chunk_cache_mb = NetCDFStorage(settings).chunkRowBytes(sizes, 2) / (1024. * 1024.) + 1;
+  }
+  const NetCDFStorage storage(settings);
+  const std::string fileName = options.dir + "/benchmarkNetCDFChunking_" + name + ".nc";
+
+  {
+    NcFile file(fileName, NcFile::replace, NcFile::nc4);
+    std::vector<NcDim> dims;
+    dims.push_back(file.addDim("time", options.numRecords));
+    dims.push_back(file.addDim("lat", options.numLat));
+    dims.push_back(file.addDim("lon", options.numLon));
+    NcVar variable = file.addVar("test", netCDF::ncFloat, dims);
+    storage.define(variable, sizes, 2, options.deflateLevel > 0);
+  }
+
+  // Write one time record of the whole grid at a time
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::vector<float> map(options.numLat * options.numLon);
+  {
+    NcFile file(fileName, NcFile::write);
+    NcVar variable = file.getVar("test");
+    storage.setChunkCache(variable);
+    std::vector<size_t> begin(3, 0), count(sizes);
+    count[0] = 1;
+    for (int rec = 0; rec < options.numRecords; rec++) {
+      for (int lat = 0; lat < options.numLat; lat++) {
+        for (int lon = 0; lon < options.numLon; lon++) {
+          map[lat * options.numLon + lon] = testValue(rec, lat, lon);
+        }
+      }
+      begin[0] = rec;
+      variable.putVar(begin, count, &map[0]);
+    }
+  }
+  const double writeSeconds = secondsSince(start);
+
+  bool valid = true;
+  NcFile file(fileName, NcFile::read);
+  NcVar variable = file.getVar("test");
+
+  // Maps of single time records, spread over the period
+  start = std::chrono::steady_clock::now();
+  std::vector<size_t> begin(3, 0), count(sizes);
+  count[0] = 1;
+  for (int i = 0; i < options.numMapReads; i++) {
+    const int rec = (int) ((long long) i * 7919 % options.numRecords);
+    begin[0] = rec;
+    variable.getVar(begin, count, &map[0]);
+    for (int lat = 0; lat < options.numLat && valid; lat += 7) {
+      for (int lon = 0; lon < options.numLon && valid; lon += 7) {
+        valid = map[lat * options.numLon + lon] == testValue(rec, lat, lon);
+      }
+    }
+  }
+  const double mapSeconds = secondsSince(start);
+
+  // Time series of single grid points, spread over the grid
+  start = std::chrono::steady_clock::now();
+  std::vector<float> series(options.numRecords);
+  count.assign(3, 1);
+  count[0] = options.numRecords;
+  begin[0] = 0;
+  for (int i = 0; i < options.numSeriesReads; i++) {
+    const int point = (int) ((long long) i * 104729 % (options.numLat * options.numLon));
+    begin[1] = point / options.numLon;
+    begin[2] = point % options.numLon;
+    variable.getVar(begin, count, &series[0]);
+    for (int rec = 0; rec < options.numRecords && valid; rec += 13) {
+      valid = series[rec] == testValue(rec, begin[1], begin[2]);
+    }
+  }
+  const double seriesSeconds = secondsSince(start);
+
+  struct stat status;
+  const double fileMB = stat(fileName.c_str(), &status) == 0 ? status.st_size / (1024. * 1024.) : 0;
+  remove(fileName.c_str());
+
+  printf("%-12s %10.2f %14.2f %16.2f %10.1f %10.1f %s\n", name, writeSeconds,
+      options.numMapReads > 0 ? 1000 * mapSeconds / options.numMapReads : 0.,
+      options.numSeriesReads > 0 ? 1000 * seriesSeconds / options.numSeriesReads : 0.,
+      fileMB, settings.chunk_cache_mb, valid ? "" : "VALUES DIFFER");
+  return valid;
+}
+
+int main(int argc, char* argv[]) {
+  BenchmarkOptions options;
+  options.numLat = 100;
+  options.numLon = 200;
+  options.numRecords = 1460;
+  options.chunkTime = 365;
+  options.chunkSpace = 4;
+  options.deflateLevel = 0;
+  options.shuffle = false;
+  options.cacheMB = -1;
+  options.numMapReads = 20;
+  options.numSeriesReads = 20;
+  options.dir = ".";
+
+  for (int i = 1; i < argc; i++) {
+    const bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--lat") == 0 && hasValue) options.numLat = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--lon") == 0 && hasValue) options.numLon = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--records") == 0 && hasValue) options.numRecords = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--chunk-time") == 0 && hasValue) options.chunkTime = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--chunk-space") == 0 && hasValue) options.chunkSpace = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--deflate") == 0 && hasValue) options.deflateLevel = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--shuffle") == 0) options.shuffle = true;
+    else if (strcmp(argv[i], "--cache") == 0 && hasValue) options.cacheMB = atof(argv[++i]);
+    else if (strcmp(argv[i], "--map-reads") == 0 && hasValue) options.numMapReads = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--series-reads") == 0 && hasValue) options.numSeriesReads = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--dir") == 0 && hasValue) options.dir = argv[++i];
+    else usage();
+  }
+  if (options.numLat < 1 || options.numLon < 1 || options.numRecords < 1 || options.chunkTime < 1
+      || options.chunkSpace < 1 || options.deflateLevel < 0 || options.deflateLevel > 9) {
+    usage();
+  }
+
+  printf("Grid of %d x %d points, %d records; deflate level %d%s; TIME_SERIES chunks of %d records x %d x %d points\n",
+      options.numLat, options.numLon, options.numRecords, options.deflateLevel, options.shuffle ? " with shuffle" : "",
+      options.chunkTime, options.chunkSpace, options.chunkSpace);
+  printf("%-12s %10s %14s %16s %10s %10s\n", "preset", "write (s)", "map read (ms)", "series read (ms)", "size (MB)",
+      "cache (MB)");
+  bool valid = benchmarkPreset("DEFAULT", NetCDFChunking::DEFAULT_CHUNKS, options);
+  valid = benchmarkPreset("TIME_SLAB", NetCDFChunking::TIME_SLAB_CHUNKS, options) && valid;
+  valid = benchmarkPreset("TIME_SERIES", NetCDFChunking::TIME_SERIES_CHUNKS, options) && valid;
+  return valid ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,125 @@
+#!/bin/bash
+
+# Times the energy balance solvers (the RootBrent residual classes: SurfEnergyBal, SnowPackEnergyBalance,
+# SoilThermalEqn, ...) on the inputs of a global parameter file, for one or two builds of VIC, e.g. a build
+# from before and one from after a change to the solvers:
+#
+#   benchmarkSolvers.sh --global global.param --program ./vicNl --baseline /path/to/old/vicNl
+#
+# For each build it shows the wall-clock time of the run, the throughput of the time loop and, per solver
+# class, the number of root_brent calls, residual evaluations and the time spent in them (the time of a solver
+# includes the solvers it calls, e.g. SurfEnergyBal includes SoilThermalEqn). Builds that predate the solver
+# timing show calls and evaluations only, and builds that predate the solver report or the throughput line
+# (e.g. a build from before TIME_BLOCK_STEPS) show the wall-clock time only. The speedup is that of the time
+# loop throughput over the baseline when both builds report it, and that of the wall-clock time of the whole
+# run (including initialization and output) otherwise.
+#
+# VIC should be built with VERBOSE TRUE (user_def.h) for the throughput and solver report. Each run writes to
+# the RESULT_DIR of the given global parameter file, so the output of the last run is the one left there.
+
+globalOptionsFile=""
+program="./vicNl"
+baseline=""
+runs=1
+
+usage()
+{
+    echo "Usage: benchmarkSolvers.sh --global <global_options_file> [--program <path to vicNl>] [--baseline <path to another vicNl>] [--runs N]"
+    exit 1
+}
+
+while [[ $# > 0 ]]
+do
+key="$1"
+shift
+
+case $key in
+    --global)
+        globalOptionsFile="$1"
+        shift
+    ;;
+    --program)
+        program="$1"
+        shift
+    ;;
+    --baseline)
+        baseline="$1"
+        shift
+    ;;
+    --runs)
+        runs="$1"
+        shift
+    ;;
+    *)
+        usage
+    ;;
+esac
+done
+
+if [ -z "$globalOptionsFile" ] || [ ! -f "$globalOptionsFile" ]; then
+    usage
+fi
+
+runLog=$(mktemp)
+trap "rm -f $runLog" EXIT
+
+# Runs a build $runs times and prints the report of its fastest run; sets stepsPerSecond (empty if the build
+# does not report its throughput) and wallSeconds.
+benchmark()
+{
+    local build="$1"
+    local best=""
+    local bestSeconds=""
+    local bestReport=""
+    for ((run = 1; run <= runs; run++))
+    do
+        local runStart=$(date +%s.%N)
+        $build -g $globalOptionsFile > $runLog 2>&1
+        if [ $? != 0 ]
+        then
+            echo "VIC FAILED ($build), see the end of its output:"
+            tail -20 $runLog
+            exit 1
+        fi
+        local seconds=$(awk -v a=$runStart -v b=$(date +%s.%N) 'BEGIN { printf "%.3f", b - a }')
+        local throughput=$(grep "^Throughput:" $runLog | tail -1)
+        local speed=$(echo "$throughput" | awk '{print $2}')
+        local faster
+        if [ -n "$speed" ]; then
+            faster=$([ -z "$best" ] || awk -v a=$speed -v b=$best 'BEGIN { exit !(a > b) }' && echo 1)
+        else
+            faster=$([ -z "$bestSeconds" ] || awk -v a=$seconds -v b=$bestSeconds 'BEGIN { exit !(a < b) }' && echo 1)
+        fi
+        if [ -n "$faster" ]; then
+            best=$speed
+            bestSeconds=$seconds
+            bestReport=$(echo "Wall-clock time: $seconds seconds"; [ -n "$throughput" ] && echo "$throughput"; sed -n '/^Energy balance solver work/,/^[^ ]/p' $runLog | grep -v "^[^ E]")
+        fi
+    done
+    if [ -z "$best" ]; then
+        bestReport=$(echo "$bestReport"; echo "No throughput reported by $build (a VERBOSE build from before TIME_BLOCK_STEPS, or not built with VERBOSE TRUE)")
+    fi
+    echo "$bestReport"
+    stepsPerSecond=$best
+    wallSeconds=$bestSeconds
+}
+
+if [ -n "$baseline" ]; then
+    echo "== Baseline: $baseline"
+    benchmark "$baseline"
+    baselineSpeed=$stepsPerSecond
+    baselineSeconds=$wallSeconds
+    echo
+fi
+
+echo "== Program: $program"
+benchmark "$program"
+
+if [ -n "$baseline" ]; then
+    echo
+    if [ -n "$stepsPerSecond" ] && [ -n "$baselineSpeed" ]; then
+        awk -v a=$stepsPerSecond -v b=$baselineSpeed 'BEGIN { printf "Speedup over the baseline (time loop throughput): %.2fx\n", a / b }'
+    else
+        awk -v a=$wallSeconds -v b=$baselineSeconds 'BEGIN { printf "Speedup over the baseline (wall-clock time of the run): %.2fx\n", b / a }'
+    fi
+fi
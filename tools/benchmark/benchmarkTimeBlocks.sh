@@ -0,0 +1,81 @@
+#!/bin/bash
+
+# Compares the throughput of the hydrological simulation time loop for several values of the
+# TIME_BLOCK_STEPS global parameter. TIME_BLOCK_STEPS 1 is the time-major loop (every cell is
+# advanced by one time step before the next time step is started).
+#
+# VIC must be built with VERBOSE TRUE (user_def.h), which makes it report the throughput of the
+# time loop. Each run writes to the RESULT_DIR of the given global parameter file, so the output
+# of the last run is the one left there.
+
+globalOptionsFile=""
+program="./vicNl"
+blockSizes="1 2 4 8 24 96"
+
+usage()
+{
+    echo "Usage: benchmarkTimeBlocks.sh --global <global_options_file> [--program <path to vicNl>] [--blocks \"1 2 4 ...\"]"
+    exit 1
+}
+
+while [[ $# > 0 ]]
+do
+key="$1"
+shift
+
+case $key in
+    --global)
+        globalOptionsFile="$1"
+        shift
+    ;;
+    --program)
+        program="$1"
+        shift
+    ;;
+    --blocks)
+        blockSizes="$1"
+        shift
+    ;;
+    *)
+        usage
+    ;;
+esac
+done
+
+if [ -z "$globalOptionsFile" ] || [ ! -f "$globalOptionsFile" ]; then
+    usage
+fi
+
+runGlobalFile=$(mktemp)
+runLog=$(mktemp)
+trap "rm -f $runGlobalFile $runLog" EXIT
+
+printf "%-18s %-22s %-26s %s\n" "TIME_BLOCK_STEPS" "time steps/second" "cell time steps/second" "speedup"
+baseline=""
+for blockSteps in $blockSizes
+do
+    # Use the global parameter file with TIME_BLOCK_STEPS set to this block size
+    grep -viE '^[[:space:]]*#?[[:space:]]*TIME_BLOCK_STEPS' $globalOptionsFile > $runGlobalFile
+    echo -e "TIME_BLOCK_STEPS\t$blockSteps" >> $runGlobalFile
+
+    $program -g $runGlobalFile > $runLog 2>&1
+    if [ $? != 0 ]
+    then
+        echo "VIC FAILED with TIME_BLOCK_STEPS $blockSteps, see the end of its output:"
+        tail -20 $runLog
+        exit 1
+    fi
+
+    throughput=$(grep "^Throughput:" $runLog | tail -1)
+    if [ -z "$throughput" ]; then
+        echo "No throughput reported; build VIC with VERBOSE TRUE in user_def.h"
+        exit 1
+    fi
+    stepsPerSecond=$(echo "$throughput" | awk '{print $2}')
+    cellStepsPerSecond=$(echo "$throughput" | awk '{print $7}')
+    if [ -z "$baseline" ]; then
+        baseline=$stepsPerSecond
+    fi
+    speedup=$(awk -v a=$stepsPerSecond -v b=$baseline 'BEGIN { printf "%.2fx", a / b }')
+    printf "%-18s %-22s %-26s %s\n" "$blockSteps" "$stepsPerSecond" "$cellStepsPerSecond" "$speedup"
+done
@@ -59,6 +59,23 @@
        order as the soil parameter file *****/
 #define NO_REWIND FALSE
 
+/***** Maximum number of time records read per NetCDF hyperslab when a
+       tile of cells is loaded from a NetCDF forcing file (see the
+       FORCE_TILE_SIZE global parameter).  This bounds the scratch buffer
+       used to transpose time-major forcings into per-cell series. *****/
+#define FORCE_TILE_MAX_RECORDS 8784
+
+/***** Number of consecutive grid cells (in soil file order) whose saved
+       model states are written to the state file together.  The states
+       of a batch are held in memory from the time step of SAVE_STATE
+       until the last cell of the batch has been processed. *****/
+#define STATE_WRITE_BATCH_CELLS 1024
+
+/***** Number of MTCLIM solar geometry tables (one per distinct site
+       latitude, slope, aspect and horizons) kept for reuse by the cells
+       that follow.  Each table takes about 20 MB. *****/
+#define MTCLIM_GEOMETRY_CACHE_ENTRIES 8
+
 /***** If TRUE VIC computes the mean, standard deviation, and sum
        and finds the minimum and maximum values of the forcing 
        variables for each grid cell and outputs the results to 
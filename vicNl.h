@@ -115,6 +115,7 @@
 #include "canopy_energy_bal.h"
 #include "SnowPackEnergyBalance.h"
 #include "StateIO.h"
+#include "StateIOStaging.h"
 #include "VegConditions.h"
 #include "WriteOutputContext.h"
 #include "OutputData.h"
@@ -130,6 +131,9 @@ unsigned char average_moisture_for_storm(double *, double *, double, double);
 
 int   CalcAerodynamic(char, double, double, double, double, double,
     VegConditions&, VegConditions&, VegConditions&, VegConditions&, VegConditions&);
+void  build_aero_table(HRU&, const soil_con_struct*, const ProgramState*);
+int   get_aero_terms(const aero_table_struct&, int, double, VegConditions*, VegConditions&,
+    VegConditions&, VegConditions&, VegConditions&, double*);
 void   calc_cloud_cover_fraction(atmos_data_struct *, dmy_struct *, int,
 				 int, int, double *);
 void   calc_energy_balance_error(int, double, double, double, double, double, double, int, CellBalanceErrors*);
@@ -357,11 +361,12 @@ void   hermite(int, double *, double *, double *, double *, double *);
 void   HourlyT(int, int, int *, double *, int *, double *, double *);
 
 void copy_data_file_format(const out_data_file_struct* out_template, std::vector<out_data_file_struct*>& list, const ProgramState* state);
+std::vector<int> output_intervals(const out_data_file_struct* out_template, const ProgramState* state);
 void copy_output_format(const WriteOutputFormat* context, std::vector<WriteOutputFormat*>& format, const ProgramState* state);
 void   init_output_list(OutputData *, int, const char *, int, float);
-void   initialize_atmos(atmos_data_struct *, const dmy_struct *, FILE **, int *ncids, soil_con_struct *, const ProgramState*);
+void   initialize_atmos(atmos_data_struct *, const dmy_struct *, double **, soil_con_struct *, const ProgramState*);
 
-int initialize_model_state(cell_info_struct*, dmy_struct, filep_struct, int, const char*, const ProgramState *);
+int initialize_model_state(cell_info_struct*, dmy_struct, filep_struct, int, const ProgramState *);
 
 int    initialize_new_storm(HRU&, int, double, const ProgramState*);
 void   initialize_snow(std::vector<HRU>&);
@@ -385,6 +390,7 @@ void make_in_files(filep_struct *, filenames_struct *, soil_con_struct *, const
 void make_out_files(filep_struct *, filenames_struct *, soil_con_struct *, WriteOutputFormat *, const ProgramState*);
 void   MassRelease(double *,double *,double *,double *);
 double maximum_unfrozen_water(double, double, double, double);
+double maximum_unfrozen_water_exact(double, double, double, double);
 double maximum_unfrozen_water_quick(double, double, double **);
 double modify_Ksat(double, const ProgramState*);
 void mtclim_wrapper(int, int, double, const soil_con_struct*,
@@ -396,23 +402,23 @@ void   nrerror(const char *);
 
 FILE  *open_file(const char *string, const char *type);
 
-void parse_output_info(const char*, out_data_file_struct *, OutputData *, ProgramState*);
+void parse_output_info(const char*, out_data_file_struct *&, OutputData *, ProgramState*);
 double penman(double, double, double, double, double, double, double);
 void   prepare_full_energy(HRU&, int, const soil_con_struct *, double *, double *, const ProgramState*);
 double priestley(double, double);
 int put_data(cell_info_struct *, WriteOutputFormat*, OutputData*, const dmy_struct *, int, const ProgramState*);
 double read_arcinfo_value(char *, double, double);
 int    read_arcinfo_info(char *, double **, double **, int **);
-void   read_atmos_data(FILE *, int ncid, int, int, double **, soil_con_struct *, const ProgramState*);
-double **read_forcing_data(FILE **, int *ncids, global_param_struct, soil_con_struct *, const ProgramState*);
-void read_initial_model_state(const char* initStateFilename, cell_info_struct *cell, int Nveg, int Ndist, const ProgramState *state);
-void   read_snowband(FILE *, soil_con_struct *, const int);
+void   read_atmos_data(FILE *, const char *, ReadForcingNetCDF *, int, int, ForcingData *, soil_con_struct *, const ProgramState*);
+void   read_forcing_data(FILE **, ReadForcingNetCDF **, const filenames_struct *, global_param_struct, soil_con_struct *, ForcingData *, const ProgramState*);
+void read_initial_model_state(StateIO* reader, cell_info_struct *cell, int Nveg, int Ndist, const ProgramState *state);
+void   read_snowband(FILE *, const CellFileIndex *, soil_con_struct *, const int);
 void   read_snowmodel(atmos_data_struct *, FILE *, int, int, int, int);
 soil_con_struct read_soilparam(FILE *, char *, char *, char *, ProgramState*);
 soil_con_struct read_soilparam_arc(FILE *, char *, int *, char *, int,
     double *lat, double *lng, int *cellnum, ProgramState*);
 veg_lib_struct *read_veglib(FILE *, int *, char);
-int read_vegparam(FILE *, cell_info_struct&, const ProgramState*);
+int read_vegparam(FILE *, const CellFileIndex *, cell_info_struct&, const ProgramState*);
 int redistribute_during_storm(HRU& hru, int rec, double Wdmax, double new_mu,
     double *max_moist, const ProgramState* state);
 void   redistribute_moisture(layer_data_struct *, double *, double *,
@@ -541,6 +547,7 @@ int surface_fluxes_glac(double BareAlbedo, double height, double ice0,
     float fetch, const ProgramState *state);
 
 double svp(double);
+double svp_exact(double);
 double svp_slope(double);
 
 void transpiration(layer_data_struct *, int, int, double, double, double,
@@ -559,12 +566,13 @@ void wrap_compute_zwt(const soil_con_struct *, hru_data_struct *, const ProgramS
 void write_atmosdata(atmos_data_struct *, int, const ProgramState*);
 void write_dist_prcp(dist_prcp_struct *);
 void write_forcing_file(cell_info_struct*, int, WriteOutputFormat *, OutputData *, const ProgramState*, dmy_struct*);
-void write_layer(layer_data_struct *, int, int, const double*);
-void write_model_state(cell_info_struct* cell, const char* filename, const ProgramState  *state);
+void write_layer(layer_data_struct *, int, int, const double*, FILE *);
+void write_model_state(cell_info_struct* cell, StateIO* writer, const ProgramState  *state);
+void write_staged_model_states(std::vector<StateIOStaging*>& stagedCells, unsigned int first, unsigned int numCells, StateIO* writer, const ProgramState *state);
 void processCellForStateFile(cell_info_struct* cell, StateIO* stream, const ProgramState *state);
 void write_snow_data(snow_data_struct, int, int);
 void write_soilparam(soil_con_struct *, const ProgramState*);
 void write_vegparam(const cell_info_struct&, const ProgramState*);
-void write_vegvar(veg_var_struct *, int);
+void write_vegvar(veg_var_struct *, int, FILE *);
 
 void zero_output_list(OutputData *);
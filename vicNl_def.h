@@ -4,7 +4,7 @@
   It also contains "extern" declarations for global variables.  For such
   variables, a single declaration/definition of the global variable, not
   containing the word "extern", must exist in global.h.  This is because
-  global.h is only included by one file (vicNl.c), while vicNl_def.h is
+  global.h is only included by one file (ModelRun.c), while vicNl_def.h is
   included multiple times (all *.c files) via vicNl.h.
 
   Modifications:
@@ -134,6 +134,8 @@
 #include <map>
 #include "GraphingEquation.h"
 #include "OutputData.h"
+#include "VegConditions.h"
+#include "GridTopology.h"
 
 /***** Model Constants *****/
 #define MAXSTRING    2048
@@ -171,6 +173,10 @@ inline bool IS_VALID(int a) { return (!IS_INVALID(a)); }
 #define DENS_BRAS   0
 #define DENS_SNTHRM 1
 
+/***** Cell loop schedules (CELL_SCHEDULE) *****/
+#define CELL_SCHEDULE_STATIC 0
+#define CELL_SCHEDULE_COST   1
+
 /***** Baseflow parametrizations *****/
 #define ARNO        0
 #define NIJSSEN2001 1
@@ -302,6 +308,7 @@ extern const char ref_veg_ref_crop[];
 #define STORM_THRES  0.001  /* thresehold at which a new storm is decalred */
 #define SNOW_DT       5.0	/* Used to bracket snow surface temperatures while computing the snow surface energy balance (C) */
 #define SURF_DT       1.0	/* Used to bracket soil surface temperatures while computing energy balance (C) */
+#define SURF_WARM_DT_MIN 0.05	/* Smallest half-width of the TSURF_WARM_START surface temperature bracket (C) */
 #define SOIL_DT       0.25  /* Used to bracket soil temperatures while solving the soil thermal flux (C) */
 #define CANOPY_DT    1.0	/* Used to bracket canopy air temperatures while computing energy balance (C) */
 #define CANOPY_VP    25.0	/* Used to bracket canopy vapor pressures while computing moisture balance (Pa) */
@@ -609,6 +616,10 @@ DISP_ALL,
 
 /***** Data Structures *****/
 class WriteOutputFormat;
+class ReadForcingNetCDF;
+class ForcingData;
+class CellFileIndex;
+class StateIO;
 
 /* The types of (stability-corrected) aerodynamic resistance (s/m) that were actually used in flux calculations. */
 struct AeroResistUsed {
@@ -620,13 +631,17 @@ struct AeroResistUsed {
 /** file structures **/
 typedef struct {
   FILE *forcing[2];     /* atmospheric forcing data files */
-  int forcing_ncid[2];
+  ReadForcingNetCDF *forcing_nc[2];  /* tiled NetCDF forcing readers, opened once and shared by all cells */
   FILE *globalparam;    /* global parameters file */
   FILE *lakeparam;      /* lake parameter file */
   FILE *snowband;       /* snow elevation band data file */
   FILE *soilparam;      /* soil parameters for all grid cells */
   FILE *veglib;         /* vegetation parameters for all vege types */
   FILE *vegparam;       /* fractional coverage info for grid cell */
+  CellFileIndex *lakeparam_index;  /* grid cell -> record offset in lakeparam */
+  CellFileIndex *snowband_index;   /* grid cell -> record offset in snowband */
+  CellFileIndex *vegparam_index;   /* grid cell -> record offset in vegparam */
+  StateIO *init_state;             /* initial model state reader, opened once and shared by all cells */
 } filep_struct;
 
 typedef struct {
@@ -643,6 +658,8 @@ typedef struct {
   char  veg[MAXSTRING];         	/* vegetation grid coverage file */
   char  veglib[MAXSTRING];      	/* vegetation parameter library file */
   char netCDFOutputFileName[MAXSTRING]; /* name of the single output file if options.OUTPUT_TYPE==NETCDF */
+  char  event_log[MAXSTRING];   	/* file the events of the time loop are written to (EVENT_LOG), or NONE for stderr */
+  char  blowing_table[MAXSTRING];	/* file the blowing snow table is loaded from or saved to (BLOWING_TABLE_FILE), or NONE */
 } filenames_struct;
 
 namespace OutputFormat {
@@ -657,6 +674,33 @@ enum Type {
 };
 }
 
+// Layout of the cells in NetCDF output and state files
+namespace OutputLayout {
+enum Type {
+  GRID_LAYOUT,      // (lat, lon) arrays over the bounding box of the cells, unmodeled grid points filled
+  GATHERED_LAYOUT   // a "landcell" dimension of the modeled cells only, with a CF "compress" index variable
+};
+}
+
+// Chunk shapes of the variables of NetCDF output files
+namespace NetCDFChunking {
+enum Type {
+  DEFAULT_CHUNKS,       // the NetCDF library's default chunking
+  TIME_SLAB_CHUNKS,     // one time record of the whole grid per chunk, for reading maps
+  TIME_SERIES_CHUNKS    // many time records of a few grid points per chunk, for reading time series at points
+};
+}
+
+/* Storage settings of the variables of a NetCDF output stream (the output file, or the state file) */
+typedef struct {
+  NetCDFChunking::Type chunking;
+  int    chunk_time;      /* TIME_SERIES: time records per chunk */
+  int    chunk_space;     /* TIME_SERIES: grid points per chunk along lat and along lon (squared along landcell) */
+  int    deflate_level;   /* Deflate level (1-9) of the variables when COMPRESS is TRUE; 0 = not deflated */
+  char   shuffle;         /* TRUE = apply the shuffle filter before deflating */
+  double chunk_cache_mb;  /* HDF5 chunk cache of each variable while the file is written (MB); 0 = library default */
+} netcdf_storage_struct;
+
 typedef struct {
 
   // simulation modes
@@ -694,6 +738,7 @@ typedef struct {
 					    aero_resist for ET;
 					    i.e. 406_FULL AND 410 */
   char   BLOWING;        /* TRUE = calculate sublimation from blowing snow */
+  char   BLOWING_TABLE;  /* TRUE = Interpolate the blowing snow integrals over the suspension layer in a table (BlowingSnowTable.h) */
   char   COMPUTE_TREELINE; /* TRUE = Determine treeline and exclude overstory vegetation from higher elevations */
   char   CONTINUEONERROR;/* TRUE = VIC will continue to run after a cell has an error */
   char   CORRPREC;       /* TRUE = correct precipitation for gage undercatch */
@@ -728,6 +773,9 @@ typedef struct {
   int    ROOT_ZONES;     /* Number of root zones used in simulation */
   char   QUICK_FLUX;     /* TRUE = Use Liang et al., 1999 formulation for ground heat flux, if FALSE use explicit finite difference method */
   char   QUICK_SOLVE;    /* TRUE = Use Liang et al., 1999 formulation for iteration, but explicit finite difference method for final step. */
+  char   TSURF_WARM_START; /* TRUE = Solve for the surface temperature on a narrow bracket around the previous step's value first */
+  char   FAST_KERNELS;   /* TRUE = Use the tabulated svp() and the vectorized unfrozen water content (FastKernels.h) */
+  char   FORCE_SIDECAR;  /* TRUE = Map the preprocessed native-double sidecars of BINARY forcing files, writing them first if needed (BinaryForcing.h) */
   char   SNOW_ALBEDO;    /* USACE: Use algorithm of US Army Corps of Engineers, 1956; SUN1999: Use algorithm of Sun et al., JGR, 1999 */
   char   SNOW_DENSITY;   /* DENS_BRAS: Use algorithm of Bras, 1990; DENS_SNTHRM: Use algorithm of SNTHRM89 adapted for 1-layer pack */
   int    SNOW_BAND;      /* Number of elevation bands over which to solve the snow model */
@@ -769,6 +817,7 @@ typedef struct {
 
   // state options
   StateOutputFormat::Type STATE_FORMAT; /* The output format of the state files (if any) */
+  OutputLayout::Type STATE_LAYOUT; /* Layout of the cells in NETCDF state files */
   char   INIT_STATE;     /* TRUE = initialize model state from file */
   char   SAVE_STATE;     /* TRUE = save state file */       
   double MAX_MEMORY;     /* Amount of RAM (in Gb) available to run the model with. The user will be warned if the projected memory use exceeds this limit.
@@ -783,6 +832,7 @@ typedef struct {
                            directory defined in the global control file, and are binary
                            or ASCII based on the BINARY_OUTPUT flag. */
   OutputFormat::Type OUTPUT_FORMAT;  /* Format of output files, see OutputFormat enum for values */
+  OutputLayout::Type OUTPUT_LAYOUT;  /* Layout of the cells in NETCDF output files */
   char   COMPRESS;       /* TRUE = Compress all output files */
   char   MOISTFRACT;     /* TRUE = output soil moisture as fractional moisture content */
   int    Noutfiles;      /* Number of output files (not including state files) */
@@ -891,13 +941,21 @@ typedef struct {
   double gridStartLon;
   double gridEndLat;
   double gridEndLon;
-  double gridStepLat;   // The gridSteps are defined by the smallest difference in position between cells.
+  double gridStepLat;   // The gridSteps are defined by the smallest difference in position between cells (see GridTopology).
   double gridStepLon;
   double gridNumLatDivisions;
   double gridNumLonDivisions;
   std::vector<std::pair<std::string, std::string> > netCDFGlobalAttributes;
 
   int num_threads; /* Number of parallel threads that can be run when PARALLEL_AVAILABLE is TRUE */
+  int forcing_tile_size; /* Number of grid points along each side of the lat/lon tiles read from NetCDF forcing files */
+  int output_buffer_frames; /* Number of output records that may be queued for the NetCDF writer thread (0 = write synchronously) */
+  int atmos_window_records; /* Number of forcing records per cell kept in memory during the time loop (0 = the whole simulation period) */
+  int time_block_steps; /* Number of time steps each cell is run through before moving on to the next cell (1 = one time step at a time) */
+  int cell_schedule; /* How the cells of the time loop are shared among the threads (CELL_SCHEDULE_STATIC or CELL_SCHEDULE_COST) */
+  int hru_task_threshold; /* Cells with at least this many HRUs solve them as parallel tasks (0 = never) */
+  netcdf_storage_struct output_storage; /* Chunking, compression and chunk cache of the NetCDF output file (OUTPUT_*) */
+  netcdf_storage_struct state_storage;  /* Compression of the NetCDF state file (STATE_*) */
 } global_param_struct;
 
 /***********************************************************
@@ -1179,6 +1237,7 @@ typedef struct {
   double  Tsurf;                 /* temperature of the understory */
   char    Tsurf_fbflag;          /* flag indicating if previous step's temperature was used */
   int     Tsurf_fbcount;         /* running total number of times that previous step's temperature was used */
+  double  Tsurf_dT;              /* change in surface temperature over the last time step, sizes the TSURF_WARM_START bracket (C) */
   double  unfrozen;              /* frozen layer water content that is unfrozen */
   // Fluxes
   double  advected_sensible;     /* net sensible heat flux advected to snowpack (Wm-2) */
@@ -1386,6 +1445,66 @@ struct glac_data_struct {
   double inflow;              /* glacier water inflow */
 };
 
+/***********************************************************
+  This structure stores the terms of CalcAerodynamic() that do not
+  depend on the wind speed, for one month and one type of potential
+  evaporation (see aero_table_struct).
+  ***********************************************************/
+typedef struct {
+  char          error;        /* TRUE if CalcAerodynamic() failed for these inputs */
+  double        wind_corr;    /* ratio of the wind speed at the reference height to the measured wind speed */
+  VegConditions aero_resist;  /* aerodynamic resistances (s/m) for a unit wind speed at the reference height */
+  VegConditions wind_speed;   /* adjusted wind speeds (m/s) for a unit wind speed at the reference height */
+} aero_terms_struct;
+
+/***********************************************************
+  This structure stores the aerodynamic terms of an HRU for each
+  month, which only depend on its vegetation class, the month and
+  the soil roughness.  The wind speed scales them: see
+  build_aero_table() and get_aero_terms().
+  ***********************************************************/
+typedef struct {
+  aero_terms_struct terms[12][N_PET_TYPES + 1];  /* per PET type, the HRU's own vegetation last */
+  VegConditions     displacement[12];            /* of the HRU's own vegetation (m) */
+  VegConditions     ref_height[12];              /* of the HRU's own vegetation (m) */
+  VegConditions     roughness[12];               /* of the HRU's own vegetation (m) */
+  double            height[12];                  /* vegetation height (m) */
+} aero_table_struct;
+
+/***********************************************************
+  This struct counts the work of the root_brent energy balance
+  solvers: for each solver, the number of root_brent calls and of
+  residual evaluations (each of which may solve the soil thermal
+  profile), and the time spent in them.  Each HRU keeps its own
+  counts; see root_brent.c.
+  ***********************************************************/
+enum SolverId {
+  SOLVER_SURF_ENERGY_BAL,
+  SOLVER_SNOW_PACK_ENERGY_BALANCE,
+  SOLVER_CANOPY_ENERGY_BAL,
+  SOLVER_GLACIER_ENERGY_BALANCE,
+  SOLVER_SOIL_THERMAL_EQN,
+  SOLVER_ICE_ENERGY_BALANCE,
+  SOLVER_ATMOS_ENERGY_BAL,
+  NUM_SOLVERS
+};
+
+struct SolverCounters {
+  SolverCounters();
+  void add(const SolverCounters& other);
+  void print() const;
+  // The counters of the HRU being solved by the calling thread (NULL if none), which root_brent counts into.
+  static SolverCounters* current();
+  static void setCurrent(SolverCounters* counters);
+  static const char* solverName(int solver);
+
+  long long solves[NUM_SOLVERS];
+  long long evaluations[NUM_SOLVERS];
+  double seconds[NUM_SOLVERS];      /* wall time of the calls, including nested solves (VERBOSE only) */
+  long long warmStarts;            /* surface temperature solves tried on the warm-start bracket (TSURF_WARM_START) */
+  long long warmStartFallbacks;    /* ... of which fell back to the default bracket */
+};
+
 /*****************************************************************
   This structure joins together data which was accessed in the
   same way (as a 2d array [veg][band]). Since the data is specific
@@ -1407,6 +1526,8 @@ struct HRU {
   bool isGlacier;             /* Is this HRU a glacier? */
   bool isArtificialBareSoil;  /* Was this HRU added automatically (as bare soil) to make the cell Cv fractions add to 1? */
   int bandIndex;
+  SolverCounters solverCounters;  /* Work done by the energy balance solvers of this HRU */
+  aero_table_struct aero_table;   /* Wind-independent aerodynamic terms of each month */
 };
 
 /*****************************************************************
@@ -1446,6 +1567,8 @@ struct out_data_file_struct {
 		                (a variable's id number is its index in the out_data array).
 		                The order of the id numbers in the varid array
 		                is the order in which the variables will be written. */
+  int		out_dt;      /* aggregation interval of the file in hours (OUT_STEP unless
+		                given on its OUTFILE line) */
 };
 
 /********************************************************
@@ -1544,7 +1667,7 @@ class WriteOutputContext; //added
   dynamics model. Previously "cell_data_struct" in vicNL.c
   ***********************************************************/
 struct cell_info_struct {
-  cell_info_struct() : isValid(TRUE), Cv_sum(0), atmos(NULL) {}
+  cell_info_struct() : isValid(TRUE), Cv_sum(0), atmos(NULL), atmos_first_rec(0) {}
   soil_con_struct  soil_con;
   char             ErrStr[MAXSTRING];
   bool						isValid;	// to indicate if a cell was properly initialized for the model run
@@ -1555,6 +1678,7 @@ struct cell_info_struct {
   lake_con_struct  lake_con;
   save_data_struct save_data;
   atmos_data_struct *atmos;
+  int              atmos_first_rec;  // record held by atmos[0]; nonzero only when ATMOS_WINDOW_RECORDS streams the forcings
   CellBalanceErrors cellErrors;
   FallBackStats fallBackStats;
   GraphingEquation gmbEquation;
@@ -1566,7 +1690,7 @@ struct cell_info_struct {
   ********************************************************/
 class ProgramState {
 public:
-  ProgramState() { veg_lib = NULL; step_count = 0;}
+  ProgramState() { veg_lib = NULL; }
   global_param_struct global_param;
   veg_lib_struct *veg_lib;
   option_struct options;
@@ -1581,16 +1705,12 @@ public:
   int max_num_HRUs = 0; // the greatest number of HRUs within a grid cell, across all grid cells in the current simulation
   int NR;  /* array index for atmos struct that indicates the model step average or sum */
   int NF;  /* array index loop counter limit for atmos struct that indicates the SNOW_STEP values */
-  int step_count; /* running count of how many time record steps have been taken since the last write to file (for temporal aggregation) */
   int dt_sec; /* simulation time step in seconds */
-  int out_dt_sec; /* simulation output time step in seconds */
-  int out_step_ratio; /* ratio between output time step and simulation time step */
   std::set<std::tuple<double, double>> modeled_cell_coordinates;
-  bool *modeled_cell_mask;
+  GridTopology grid;  // the NetCDF output grid and the grid point of each cell
   bool glacier_accum_started; /* flag indicating that glacier accumulation has started (after wind-up period) */
   void initialize_global();
   void initGrid(const std::vector<cell_info_struct>& cells);
-  void initCellMask(const std::vector<cell_info_struct>& cells);
   void init_global_param(filenames_struct *, const char* global_file_name);
   void build_forcing_variable_mapping();
   void set_forcing_variable_name(std::string, std::string);
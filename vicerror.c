@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <strings.h>
 #include "vicNl.h"
+#include "EventLog.h"
 
 static char vcid[] = "$Id$";
 
@@ -17,6 +18,8 @@ void vicerror(const char *error_text)
   2006-Sep-23 Implemented flexible output configuration; uses the new
               out_data and out_data_files structures. TJB
   2006-Oct-16 Merged infiles and outfiles structs into filep_struct. TJB
+  2026-Oct-17 Writes the events the calling thread has not had drained
+              (e.g. the dump of the failed solver) before exiting.	AG
 
 **********************************************************************/
 {
@@ -25,6 +28,7 @@ void vicerror(const char *error_text)
 	/* turn off compression of last set of files */
   bool compress = false;
 
+	EventLog::instance().flushCallingThread();
 	fprintf(stderr,"VIC model run-time error...\n");
 	fprintf(stderr,"%s\n",error_text);
 	fprintf(stderr,"...now writing output files...\n");
@@ -8,16 +8,19 @@ static char vcid[] = "$Id$";
 void write_layer(layer_data_struct *layer,
                  int                veg,
                  int                Nlayer,
-                 const double*      frost_fract)
+                 const double*      frost_fract,
+                 FILE*              out)
 /**********************************************************************
 	write_soilvar		Keith Cherkauer		July 17, 1997
 
-  This routine writes soil variables to stdout.  It creates a table 
+  This routine writes soil variables to out.  It creates a table 
   of soil moisture values which shows how much liquid water and ice 
   are contained in the thawed, frozen and unfrozen sublayers of each 
   soil layer.  It also gives the total soil moisture for each layer.
 
   xx-xx-01 Modified to handle spatial soil frost.                 KAC
+  2026-Oct-17 Writes to the given stream instead of stdout, so that
+              the solver dumps can collect it in an event message.	AG
 
 **********************************************************************/
 {
@@ -27,34 +30,34 @@ void write_layer(layer_data_struct *layer,
   int    frost_area;
   double avg_ice;
 
-  printf("Layer Data for Vegetation Type #%i\n",veg);
-  printf("Layer:\t");
-  for(index=0;index<Nlayer;index++) printf("\t\t%i",index+1);
-  printf("\nEvaporation:\t");
-  for(index=0;index<Nlayer;index++) printf("\t%f",layer[index].evap);
-  printf("\n      Kappa:\t");
-  for(index=0;index<Nlayer;index++) printf("\t%f",layer[index].kappa);
-  printf("\n         Cs:\t");
-  for(index=0;index<Nlayer;index++) printf("\t%f",layer[index].Cs);
-  printf("\n\nMoisture Table\n---------------------------------------------------------------------------\n Moist:\t");
-  for(index=0;index<Nlayer;index++) printf("\t%f",layer[index].moist);
-  printf("\n        Ice:\t");
+  fprintf(out, "Layer Data for Vegetation Type #%i\n",veg);
+  fprintf(out, "Layer:\t");
+  for(index=0;index<Nlayer;index++) fprintf(out, "\t\t%i",index+1);
+  fprintf(out, "\nEvaporation:\t");
+  for(index=0;index<Nlayer;index++) fprintf(out, "\t%f",layer[index].evap);
+  fprintf(out, "\n      Kappa:\t");
+  for(index=0;index<Nlayer;index++) fprintf(out, "\t%f",layer[index].kappa);
+  fprintf(out, "\n         Cs:\t");
+  for(index=0;index<Nlayer;index++) fprintf(out, "\t%f",layer[index].Cs);
+  fprintf(out, "\n\nMoisture Table\n---------------------------------------------------------------------------\n Moist:\t");
+  for(index=0;index<Nlayer;index++) fprintf(out, "\t%f",layer[index].moist);
+  fprintf(out, "\n        Ice:\t");
 #if SPATIAL_FROST
   for(index=0;index<Nlayer;index++) {
     avg_ice = 0;
     for ( frost_area = 0; frost_area < FROST_SUBAREAS; frost_area++ )
       avg_ice += layer[index].soil_ice[frost_area] * frost_fract[frost_area];
-    printf("\t%f",avg_ice);
+    fprintf(out, "\t%f",avg_ice);
   }
 #else
-  for(index=0;index<Nlayer;index++) printf("\t%f",layer[index].soil_ice);
+  for(index=0;index<Nlayer;index++) fprintf(out, "\t%f",layer[index].soil_ice);
 #endif
-  printf("\n---------------------------------------------------------------------------\nLayer Moist:\t");
+  fprintf(out, "\n---------------------------------------------------------------------------\nLayer Moist:\t");
   sum_moist = 0.;
   for(index=0;index<Nlayer;index++) {
     layer_moist = layer[index].moist;
     sum_moist += layer_moist;
-    printf("\t%f",layer_moist);
+    fprintf(out, "\t%f",layer_moist);
   }
-  printf("\n\n-----> Total Moisture = %f\n\n",sum_moist);
+  fprintf(out, "\n\n-----> Total Moisture = %f\n\n",sum_moist);
 }
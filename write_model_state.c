@@ -5,10 +5,11 @@
 
 #include "vicNl.h"
 #include "StateIOContext.h"
+#include "StateIOStaging.h"
 
 static char vcid[] = "$Id$";
 
-void write_model_state(cell_info_struct* cell, const char* filename, const ProgramState  *state)
+void write_model_state(cell_info_struct* cell, StateIO* writer, const ProgramState  *state)
 /*********************************************************************
   write_model_state      Keith Cherkauer           April 14, 2000
 
@@ -69,14 +70,15 @@ void write_model_state(cell_info_struct* cell, const char* filename, const Progr
 	      lake state data.  Now, if options.LAKES is TRUE, every grid cell
 	      will save lake state data.  If no lake is present, default NULL
 	      values will be stored.						TJB
+  2026-Oct-17 Now writes to the given StateIO stream instead of opening
+	      the state file itself.  This is called from the parallel cell
+	      loop with a StateIOStaging stream per cell, and the staged cells
+	      are written to the file by write_staged_model_states().	AG
 *********************************************************************/
 {
   int Nbands = state->options.SNOW_BAND;
   int numHRUs = cell->prcp.hruList.size();
 
-  StateIOContext context(filename, StateIO::Writer, state);
-  StateIO* writer = context.stream;
-
   /* write cell information */
   writer->initializeDimensionIndices();
   writer->notifyDimensionUpdate(StateVariables::LAT_DIM, latitudeToIndex(cell->soil_con.lat, state));
@@ -90,6 +92,24 @@ void write_model_state(cell_info_struct* cell, const char* filename, const Progr
   
 }
 
+/*
+ * Writes the cells [first, first + numCells) staged by write_model_state() to the state file through the given
+ * StateIO stream, in the order they appear in stagedCells (NULL entries are skipped), then deletes them. The
+ * stream is used in batch mode, so the NetCDF writer writes the cells with a few large writes per variable
+ * instead of a few small writes per variable for every cell.
+ */
+void write_staged_model_states(std::vector<StateIOStaging*>& stagedCells, unsigned int first, unsigned int numCells, StateIO* writer, const ProgramState *state) {
+  writer->beginBatch();
+  for (unsigned int i = first; i < first + numCells && i < stagedCells.size(); i++) {
+    if (stagedCells[i] != NULL) {
+      stagedCells[i]->replay(writer);
+      delete stagedCells[i];
+      stagedCells[i] = NULL;
+    }
+  }
+  writer->endBatch();
+}
+
 /*
  * The processCellForStateFile function is used for reading and writing state files (depending on the type of StateIO stream).
  * This method is also generic for each different state format type (binary, ascii, netCDF). This means that adding a variable
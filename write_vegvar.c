@@ -5,22 +5,24 @@
 static char vcid[] = "$Id$";
 
 void write_vegvar(veg_var_struct *veg, 
-		  int             n)
+		  int             n,
+		  FILE           *out)
 /**********************************************************************
   write_vegvar		Keith Cherkauer		May 29, 1996
 
-  This routine writes vegetation variables to stdout.  Used primarily
+  This routine writes vegetation variables to out.  Used primarily
   for debugging purposes.
 
   Modifications:
   5/21/96	Routine was modified to allow for variable
 		number of layers				KAC
+  2026-Oct-17	Writes to the given stream instead of stdout.	AG
 
 **********************************************************************/
 {
-  printf("Vegetation Variables: vegtype %i\n",n);
-  printf("\tcanopyevap  = %f\n", veg->canopyevap);
-  printf("\tWdew        = %f\n", veg->Wdew);
-  printf("\tthroughfall = %f\n", veg->throughfall);
+  fprintf(out, "Vegetation Variables: vegtype %i\n",n);
+  fprintf(out, "\tcanopyevap  = %f\n", veg->canopyevap);
+  fprintf(out, "\tWdew        = %f\n", veg->Wdew);
+  fprintf(out, "\tthroughfall = %f\n", veg->throughfall);
 }
 